@@ -44,6 +44,8 @@ SOFTWARE.
 #import "OODebugMonitor.h"
 #import "OOProfilingStopwatch.h"
 #import "ResourceManager.h"
+#import "OOScriptTimer.h"
+#import "OOGalaxyRouteGraph.h"
 
 
 @interface Entity (OODebugInspector)
@@ -80,6 +82,13 @@ static JSBool ConsoleSetDisplayMessagesInClass(JSContext *context, uintN argc, j
 static JSBool ConsoleWriteLogMarker(JSContext *context, uintN argc, jsval *vp);
 static JSBool ConsoleWriteMemoryStats(JSContext *context, uintN argc, jsval *vp);
 static JSBool ConsoleGarbageCollect(JSContext *context, uintN argc, jsval *vp);
+static JSBool ConsoleGarbageCollectionStatistics(JSContext *context, uintN argc, jsval *vp);
+static JSBool ConsoleTimerStatistics(JSContext *context, uintN argc, jsval *vp);
+static JSBool ConsoleScriptCPUReport(JSContext *context, uintN argc, jsval *vp);
+static JSBool ConsoleWriteScriptCPUReport(JSContext *context, uintN argc, jsval *vp);
+#ifndef NDEBUG
+static JSBool ConsoleBenchmarkRouting(JSContext *context, uintN argc, jsval *vp);
+#endif
 #if DEBUG
 static JSBool ConsoleDumpNamedRoots(JSContext *context, uintN argc, jsval *vp);
 static JSBool ConsoleDumpHeap(JSContext *context, uintN argc, jsval *vp);
@@ -130,6 +139,8 @@ enum
 	kConsole_showErrorLocations,				// Show error/warning source locations, boolean (default true), read/write
 	kConsole_dumpStackForErrors,				// Write stack dump when reporting error/exception, boolean (default false), read/write
 	kConsole_dumpStackForWarnings,				// Write stack dump when reporting warning, boolean (default false), read/write
+	kConsole_timerCoalescingTolerance,			// Quantum for coalescing repeating script timers, number (default 0, disabled), read/write
+	kConsole_scriptCPUBudget,					// Per-script CPU budget in ms per second, number (default 0, unlimited), read/write
 	
 	kConsole_glVendorString,					// OpenGL GL_VENDOR string, string, read-only
 	kConsole_glRendererString,					// OpenGL GL_RENDERER string, string, read-only
@@ -166,6 +177,8 @@ static JSPropertySpec sConsoleProperties[] =
 	{ "__showErrorLocations",				kConsole_showErrorLocations,				OOJS_PROP_HIDDEN_READWRITE_CB },
 	{ "__dumpStackForErrors",				kConsole_dumpStackForErrors,				OOJS_PROP_HIDDEN_READWRITE_CB },
 	{ "__dumpStackForWarnings",				kConsole_dumpStackForWarnings,				OOJS_PROP_HIDDEN_READWRITE_CB },
+	{ "timerCoalescingTolerance",			kConsole_timerCoalescingTolerance,			OOJS_PROP_READWRITE_CB },
+	{ "scriptCPUBudget",					kConsole_scriptCPUBudget,					OOJS_PROP_READWRITE_CB },
 	{ "glVendorString",						kConsole_glVendorString,					OOJS_PROP_READONLY_CB },
 	{ "glRendererString",					kConsole_glRendererString,					OOJS_PROP_READONLY_CB },
 	{ "glFixedFunctionTextureUnitCount",	kConsole_glFixedFunctionTextureUnitCount,	OOJS_PROP_READONLY_CB },
@@ -206,6 +219,13 @@ static JSFunctionSpec sConsoleMethods[] =
 	{ "writeLogMarker",					ConsoleWriteLogMarker,				0 },
 	{ "writeMemoryStats",				ConsoleWriteMemoryStats,			0 },
 	{ "garbageCollect",					ConsoleGarbageCollect,				0 },
+	{ "garbageCollectionStatistics",	ConsoleGarbageCollectionStatistics,	0 },
+	{ "timerStatistics",				ConsoleTimerStatistics,				0 },
+	{ "scriptCPUReport",				ConsoleScriptCPUReport,				0 },
+	{ "writeScriptCPUReport",			ConsoleWriteScriptCPUReport,		0 },
+#ifndef NDEBUG
+	{ "benchmarkRouting",				ConsoleBenchmarkRouting,			0 },
+#endif
 #if DEBUG
 	{ "dumpNamedRoots",					ConsoleDumpNamedRoots,				0 },
 	{ "dumpHeap",						ConsoleDumpHeap,					0 },
@@ -363,6 +383,12 @@ static JSBool ConsoleGetProperty(JSContext *context, JSObject *this, jsid propID
 			*value = OOJSValueFromBOOL([[OOJavaScriptEngine sharedEngine] dumpStackForWarnings]);
 			break;
 			
+		case kConsole_timerCoalescingTolerance:
+			return JS_NewNumberValue(context, [OOScriptTimer coalescingTolerance], value);
+			
+		case kConsole_scriptCPUBudget:
+			return JS_NewNumberValue(context, OOJSGetScriptCPUBudget(), value);
+			
 		case kConsole_glVendorString:
 			*value = OOJSValueFromNativeObject(context, [[OOOpenGLExtensionManager sharedManager] vendorString]);
 			break;
@@ -414,6 +440,7 @@ static JSBool ConsoleSetProperty(JSContext *context, JSObject *this, jsid propID
 	int32						iValue;
 	NSString					*sValue = nil;
 	JSBool						bValue = NO;
+	jsdouble					fValue;
 	
 	switch (JSID_TO_INT(propID))
 	{
@@ -491,6 +518,20 @@ static JSBool ConsoleSetProperty(JSContext *context, JSObject *this, jsid propID
 			}
 			break;
 			
+		case kConsole_timerCoalescingTolerance:
+			if (JS_ValueToNumber(context, *value, &fValue))
+			{
+				[OOScriptTimer setCoalescingTolerance:fValue];
+			}
+			break;
+			
+		case kConsole_scriptCPUBudget:
+			if (JS_ValueToNumber(context, *value, &fValue))
+			{
+				OOJSSetScriptCPUBudget(fValue);
+			}
+			break;
+			
 		default:
 			OOJSReportBadPropertySelector(context, this, propID, sConsoleProperties);
 			return NO;
@@ -906,7 +947,7 @@ static JSBool ConsoleGarbageCollect(JSContext *context, uintN argc, jsval *vp)
 	OOJS_NATIVE_ENTER(context)
 	
 	uint32_t bytesBefore = JS_GetGCParameter(JS_GetRuntime(context), JSGC_BYTES);
-	JS_GC(context);
+	[[OOJavaScriptEngine sharedEngine] forceGarbageCollection];
 	uint32_t bytesAfter = JS_GetGCParameter(JS_GetRuntime(context), JSGC_BYTES);
 	
 	OOJS_RETURN_OBJECT(([NSString stringWithFormat:@"Bytes before: %u Bytes after: %u", bytesBefore, bytesAfter]));
@@ -915,6 +956,92 @@ static JSBool ConsoleGarbageCollect(JSContext *context, uintN argc, jsval *vp)
 }
 
 
+// function garbageCollectionStatistics() : Object
+static JSBool ConsoleGarbageCollectionStatistics(JSContext *context, uintN argc, jsval *vp)
+{
+	OOJS_NATIVE_ENTER(context)
+	
+	OOJS_RETURN_OBJECT([[OOJavaScriptEngine sharedEngine] garbageCollectionStatistics]);
+	
+	OOJS_NATIVE_EXIT
+}
+
+
+// function timerStatistics() : Array
+static JSBool ConsoleTimerStatistics(JSContext *context, uintN argc, jsval *vp)
+{
+	OOJS_NATIVE_ENTER(context)
+	
+	NSArray *result = nil;
+	
+	OOJS_BEGIN_FULL_NATIVE(context)
+	result = [OOScriptTimer timerStatistics];
+	OOJS_END_FULL_NATIVE
+	
+	OOJS_RETURN_OBJECT(result);
+	
+	OOJS_NATIVE_EXIT
+}
+
+
+// function scriptCPUReport() : Array
+static JSBool ConsoleScriptCPUReport(JSContext *context, uintN argc, jsval *vp)
+{
+	OOJS_NATIVE_ENTER(context)
+	
+	NSArray *result = nil;
+	
+	OOJS_BEGIN_FULL_NATIVE(context)
+	result = OOJSScriptCostReport();
+	OOJS_END_FULL_NATIVE
+	
+	OOJS_RETURN_OBJECT(result);
+	
+	OOJS_NATIVE_EXIT
+}
+
+
+// function writeScriptCPUReport()
+static JSBool ConsoleWriteScriptCPUReport(JSContext *context, uintN argc, jsval *vp)
+{
+	OOJS_NATIVE_ENTER(context)
+	
+	OOJS_BEGIN_FULL_NATIVE(context)
+	OOJSLogScriptCostReport();
+	OOJS_END_FULL_NATIVE
+	
+	OOJS_RETURN_VOID;
+	
+	OOJS_NATIVE_EXIT
+}
+
+
+#ifndef NDEBUG
+// function benchmarkRouting([originCount : Number]) : Object
+static JSBool ConsoleBenchmarkRouting(JSContext *context, uintN argc, jsval *vp)
+{
+	OOJS_NATIVE_ENTER(context)
+	
+	uint32_t originCount = kOOGalaxySystemCount;
+	NSDictionary *result = nil;
+	
+	if (argc > 0 && EXPECT_NOT(!JS_ValueToECMAUint32(context, OOJS_ARGV[0], &originCount)))
+	{
+		OOJSReportBadArguments(context, @"Console", @"benchmarkRouting", argc, OOJS_ARGV, nil, @"number of origin systems");
+		return NO;
+	}
+	
+	OOJS_BEGIN_FULL_NATIVE(context)
+	result = [UNIVERSE routingBenchmarkWithOriginCount:originCount];
+	OOJS_END_FULL_NATIVE
+	
+	OOJS_RETURN_OBJECT(result);
+	
+	OOJS_NATIVE_EXIT
+}
+#endif
+
+
 #if DEBUG
 typedef struct
 {
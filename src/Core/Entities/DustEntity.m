@@ -30,6 +30,7 @@ MA 02110-1301, USA.
 #import "OOGraphicsResetManager.h"
 #import "OODebugFlags.h"
 #import "OOMacroOpenGL.h"
+#import "OOQualityController.h"
 
 
 #if OO_SHADERS
@@ -273,11 +274,14 @@ enum
 	
 	OO_ENTER_OPENGL();
 	OOSetOpenGLState(OPENGL_STATE_OPAQUE);
-	OOGL(glDisableClientState(GL_NORMAL_ARRAY));
+	OOGLDisableClientState(GL_NORMAL_ARRAY);
 	
 	GLfloat	*fogcolor = [UNIVERSE skyClearColor];
 	float	idealDustSize = [[UNIVERSE gameView] viewSize].width / 800.0f;
 	
+	// Particles are scattered at random, so drawing the first few is as good as drawing any few.
+	unsigned dustCount = DUST_N_PARTICLES * [[UNIVERSE qualityController] dustFraction];
+	
 	BOOL	warp_stars = [player atHyperspeed];
 	float	dustIntensity;
 	
@@ -314,15 +318,13 @@ enum
 #endif
 	{
 		OOGL(glEnable(GL_FOG));
-		OOGL(glFogi(GL_FOG_MODE, GL_LINEAR));
-		OOGL(glFogfv(GL_FOG_COLOR, fogcolor));
+		OOGLLinearFog(NEAR_PLANE, FAR_PLANE);
+		OOGLFogColor(fogcolor);
 		OOGL(glHint(GL_FOG_HINT, GL_NICEST));
-		OOGL(glFogf(GL_FOG_START, NEAR_PLANE));
-		OOGL(glFogf(GL_FOG_END, FAR_PLANE));
 	}
 
-	OOGL(glEnable(GL_BLEND));
-	OOGL(glDepthMask(GL_FALSE));
+	OOGLSetBlending(true);
+	OOGLDepthMask(GL_FALSE);
 	
 	if (warp_stars)
 	{
@@ -338,14 +340,14 @@ enum
 		{
 			Vector  warpVector = [self warpVector];
 			unsigned vi;
-			for (vi = 0; vi < DUST_N_PARTICLES; vi++)
+			for (vi = 0; vi < dustCount; vi++)
 			{
 				vertices[vi + DUST_N_PARTICLES] = vector_subtract(vertices[vi], warpVector);
 			}
 		}
 		
 		OOGL(glVertexPointer(3, GL_FLOAT, 0, vertices));
-		OOGL(glDrawElements(GL_LINES, DUST_N_PARTICLES * 2, GL_UNSIGNED_SHORT, indices));
+		OOGL(glDrawElements(GL_LINES, dustCount * 2, GL_UNSIGNED_SHORT, indices));
 		
 #if OO_SHADERS
 		if (useShader)
@@ -364,19 +366,19 @@ enum
 			if (!useShader)
 #endif
 			{
-				OOGL(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
+				OOGLBlendFunc(GL_SRC_ALPHA, GL_ONE);
 			}
 			OOGL(glEnable(GL_POINT_SPRITE_ARB));
 			[texture apply];
 			OOGL(glVertexPointer(3, GL_FLOAT, 0, vertices));
-			OOGL(glDrawArrays(GL_POINTS, 0, DUST_N_PARTICLES));
+			OOGL(glDrawArrays(GL_POINTS, 0, dustCount));
 			OOGL(glDisable(GL_POINT_SPRITE_ARB));
 		}
 		else
 		{
 			OOGL(glDisable(GL_TEXTURE_2D));
 			OOGL(glVertexPointer(3, GL_FLOAT, 0, vertices));
-			OOGL(glDrawArrays(GL_POINTS, 0, DUST_N_PARTICLES));
+			OOGL(glDrawArrays(GL_POINTS, 0, dustCount));
 			OOGL(glEnable(GL_TEXTURE_2D));
 		}
 	}
@@ -393,9 +395,9 @@ enum
 		OOGL(glDisable(GL_FOG));
 	}
 	
-	OOGL(glDisable(GL_BLEND));
-	OOGL(glDepthMask(GL_TRUE));
-	OOGL(glEnableClientState(GL_NORMAL_ARRAY));
+	OOGLSetBlending(false);
+	OOGLDepthMask(GL_TRUE);
+	OOGLEnableClientState(GL_NORMAL_ARRAY);
 	
 	OOVerifyOpenGLState();
 	OOCheckOpenGLErrors(@"DustEntity after drawing %@", self);
@@ -107,6 +107,8 @@ enum OOScanClass
 	GLfloat					zero_distance;
 	GLfloat					cam_zero_distance;
 	GLfloat					no_draw_distance;		// 10 km initially
+	uint32_t				visibleFrameStamp;		// See -[Universe cullFrameStamp].
+	OOTimeDelta				deferredUpdateTime;		// Time not yet simulated; see -[Universe update:].
 	GLfloat					collision_radius;
 	Vector					position;
 	Quaternion				orientation;
@@ -137,22 +137,22 @@ MA 02110-1301, USA.
 		
 		OOGL(glDisable(GL_LIGHTING));
 		OOGL(glDisable(GL_TEXTURE_2D));
-		OOGL(glEnable(GL_BLEND));
-		OOGL(glDepthMask(GL_FALSE));
-		OOGL(glDisableClientState(GL_NORMAL_ARRAY));
+		OOGLSetBlending(true);
+		OOGLDepthMask(GL_FALSE);
+		OOGLDisableClientState(GL_NORMAL_ARRAY);
 		
 		OOGL(glVertexPointer(3, GL_FLOAT, 0, _vertexPosition));
-		OOGL(glEnableClientState(GL_COLOR_ARRAY));
+		OOGLEnableClientState(GL_COLOR_ARRAY);
 		OOGL(glColorPointer(4, GL_FLOAT, 0, _vertexColor));
 		
 		OOGL(glDrawArrays(GL_TRIANGLE_STRIP, 0, _vertexCount));
 		
 		OOGL(glEnable(GL_LIGHTING));
 		OOGL(glEnable(GL_TEXTURE_2D));
-		OOGL(glDisable(GL_BLEND));
-		OOGL(glDepthMask(GL_TRUE));
-		OOGL(glEnableClientState(GL_NORMAL_ARRAY));
-		OOGL(glDisableClientState(GL_COLOR_ARRAY));
+		OOGLSetBlending(false);
+		OOGLDepthMask(GL_TRUE);
+		OOGLEnableClientState(GL_NORMAL_ARRAY);
+		OOGLDisableClientState(GL_COLOR_ARRAY);
 		
 		OOVerifyOpenGLState();
 		OOCheckOpenGLErrors(@"OOBreakPatternEntity after drawing %@", self);
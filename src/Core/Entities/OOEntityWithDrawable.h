@@ -68,4 +68,10 @@ MA 02110-1301, USA.
 - (OODrawable *)drawable;
 - (void)setDrawable:(OODrawable *)drawable;
 
+// Draw distance and view frustum test applied by -drawImmediate:translucent:.
+- (BOOL) isInDrawRange;
+
+// Radius of the sphere tested against the view frustum.
+- (GLfloat) viewCullingRadius;
+
 @end
@@ -67,12 +67,11 @@ MA 02110-1301, USA.
 }
 
 
-- (void) drawImmediate:(bool)immediate translucent:(bool)translucent
+- (BOOL) isInDrawRange
 {
 	if (no_draw_distance < cam_zero_distance)
 	{
-		// Don't draw.
-		return;
+		return NO;
 	}
 	
 	if (no_draw_distance != INFINITY && ![self isImmuneToBreakPatternHide])
@@ -80,20 +79,12 @@ MA 02110-1301, USA.
 		// (always draw sky, always draw break patterns)
 		if (![self isSubEntity]) 
 		{
-			GLfloat clipradius = collision_radius;
-			if ([self isShip])
-			{
-				ShipEntity* shipself = (ShipEntity*)self;
-				clipradius = [shipself frustumRadius];
-			}
-			else if ([self isVisualEffect])
-			{
-				OOVisualEffectEntity* veself = (OOVisualEffectEntity*)self;
-				clipradius = [veself frustumRadius];
-			}
-			if (![UNIVERSE viewFrustumIntersectsSphereAt:position withRadius:clipradius])
+			// Universe's culling pass has already tested entities it stamped this frame.
+			if (visibleFrameStamp == [UNIVERSE cullFrameStamp])  return YES;
+			
+			if (![UNIVERSE viewFrustumIntersectsSphereAt:position withRadius:[self viewCullingRadius]])
 			{
-				return;
+				return NO;
 			}
 		} 
 		else 
@@ -101,11 +92,39 @@ MA 02110-1301, USA.
 			// check correct sub-entity position
 			if (![UNIVERSE viewFrustumIntersectsSphereAt:[self absolutePositionForSubentity] withRadius:[self collisionRadius]])
 			{
-				return;
+				return NO;
 			}
 		}
-	}	
+	}
+	
+	return YES;
+}
+
+
+- (GLfloat) viewCullingRadius
+{
+	if ([self isShip])
+	{
+		ShipEntity* shipself = (ShipEntity*)self;
+		return [shipself frustumRadius];
+	}
+	else if ([self isVisualEffect])
+	{
+		OOVisualEffectEntity* veself = (OOVisualEffectEntity*)self;
+		return [veself frustumRadius];
+	}
+	return collision_radius;
+}
+
 
+- (void) drawImmediate:(bool)immediate translucent:(bool)translucent
+{
+	if (![self isInDrawRange])
+	{
+		// Don't draw.
+		return;
+	}
+	
 	if ([UNIVERSE wireframeGraphics])  OOGLWireframeModeOn();
 		
 	if (translucent)  [drawable renderTranslucentParts];
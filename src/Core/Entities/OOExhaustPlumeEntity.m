@@ -32,6 +32,8 @@ MA 02110-1301, USA.
 
 #import "OOTexture.h"
 #import "OOGraphicsResetManager.h"
+#import "OOEffectBatch.h"
+#import "OOQualityController.h"
 
 
 #define kOverallAlpha		1.0f
@@ -43,13 +45,24 @@ MA 02110-1301, USA.
 #define kScaleLevel2  0.8f
 #define kScaleLevel3  0.6f
 
+enum
+{
+	kPlumeFrameSampleCount		= 5,
+	kPlumeMaxBatchVertices		= 4 * 7 * 3 + 8 * 3		// Four nine-index strips and one ten-index fan as separate triangles.
+};
+
 static OOTexture *sPlumeTexture = nil;
 
 
+static Frame InterpolateFrames(Frame frame_zero, Frame frame_one, double f0, double moment_in_time);
+static NSUInteger AppendStripTriangles(OOEffectVertex *outVertices, const GLuint *indices, unsigned count, const GLfloat *positions, const GLfloat *texCoords, const GLfloat *colors);
+static NSUInteger AppendFanTriangles(OOEffectVertex *outVertices, const GLuint *indices, unsigned count, const GLfloat *positions, const GLfloat *texCoords, const GLfloat *colors);
+
+
 @interface OOExhaustPlumeEntity (Private)
 
 - (void) saveToLastFrame;
-- (Frame) frameAtTime:(double) t_frame fromFrame:(Frame) frame_zero;	// t_frame is relative to now ie. -0.5 = half a second ago.
+- (void) getFrames:(Frame *)outFrames atTimes:(const double *)times count:(unsigned)count fromFrame:(Frame)frame_zero;	// times are relative to now and decreasing, ie. each further in the past than the one before.
 
 @end
 
@@ -184,15 +197,18 @@ static OOTexture *sPlumeTexture = nil;
 	GLfloat r03 = 1.0 - q03;
 	GLfloat r06 = 1.0 - q06;
 	GLfloat r08 = 1.0 - q08;
-	Frame	f01 = [self frameAtTime: i01 fromFrame: zero];
+	double	sampleTimes[kPlumeFrameSampleCount] = { i01, i03, i06, i08, i10 };
+	Frame	samples[kPlumeFrameSampleCount];
+	[self getFrames:samples atTimes:sampleTimes count:kPlumeFrameSampleCount fromFrame:zero];
+	Frame	f01 = samples[0];
 	Vector	b01 = make_vector(r01 * i01 * vfwd.x, r01 * i01 * vfwd.y, r01 * i01 * vfwd.z);
-	Frame	f03 = [self frameAtTime: i03 fromFrame: zero];
+	Frame	f03 = samples[1];
 	Vector	b03 = make_vector(r03 * i03 * vfwd.x, r03 * i03 * vfwd.y, r03 * i03 * vfwd.z);
-	Frame	f06 = [self frameAtTime: i06 fromFrame: zero];
+	Frame	f06 = samples[2];
 	Vector	b06 = make_vector(r06 * i06 * vfwd.x, r06 * i06 * vfwd.y, r06 * i06 * vfwd.z);
-	Frame	f08 = [self frameAtTime: i08 fromFrame: zero];
+	Frame	f08 = samples[3];
 	Vector	b08 = make_vector(r08 * i08 * vfwd.x, r08 * i08 * vfwd.y, r08 * i08 * vfwd.z);
-	Frame	f10 = [self frameAtTime: i10 fromFrame: zero];
+	Frame	f10 = samples[4];
 	
 	int ci = 0;
 	int iv = 0;
@@ -330,28 +346,6 @@ GLfloat pA[6] = { 0.01, 0.0, 2.0, 4.0, 6.0, 10.0 }; // phase adjustments
 	ShipEntity *ship = [self owner];
 	if ([ship speedFactor] <= 0.001f)  return;	// don't draw if not moving according to 'update' calculation
 
-	OO_ENTER_OPENGL();
-	OOSetOpenGLState(OPENGL_STATE_ADDITIVE_BLENDING);
-	
-	OOGL(glPopMatrix());	// restore absolute positioning
-	OOGL(glPushMatrix());	// avoid stack underflow
-	
-	OOGL(glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT));
-	
-	OOGL(glDisable(GL_LIGHTING));
-	OOGL(glEnable(GL_BLEND));
-	OOGL(glDepthMask(GL_FALSE));
-	OOGL(glEnableClientState(GL_TEXTURE_COORD_ARRAY));
-	OOGL(glEnable(GL_TEXTURE_2D));
-	[[self texture] apply];
-
-//	OOGL(glDisable(GL_CULL_FACE));		// face culling
-	OOGL(glShadeModel(GL_SMOOTH));
-	
-	OOGL(glEnableClientState(GL_COLOR_ARRAY));
-	OOGL(glVertexPointer(3, GL_FLOAT, 0, _vertices));
-	OOGL(glColorPointer(4, GL_FLOAT, 0, _exhaustBaseColors));
-
 	double intpart, dphase = 1.0-modf((double)[UNIVERSE getTime]*2.5,&intpart);
 	GLfloat phase = (GLfloat)dphase;
 
@@ -380,24 +374,6 @@ GLfloat pA[6] = { 0.01, 0.0, 2.0, 4.0, 6.0, 10.0 }; // phase adjustments
 
 		0.5, phase+pA[5],
 	};
-	OOGL(glTexCoordPointer(2, GL_FLOAT, 0, texCoords));
-
-	// reduced detail for internal view to avoid rendering artefacts
-	if ([[self owner] isPlayer] && [UNIVERSE viewDirection] != VIEW_CUSTOM)
-	{
-		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, afttstr1));
-		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, afttstr2));
-		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, afttstr3));
-		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, afttstr4));
-	} 
-	else
-	{
-		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 9, GL_UNSIGNED_INT, tstr1));
-		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 9, GL_UNSIGNED_INT, tstr2));
-		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 9, GL_UNSIGNED_INT, tstr3));
-		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 9, GL_UNSIGNED_INT, tstr4));
-	}
-
 	/* Need a different texture and color array for this segment */
 	GLfloat fanTextures[18] = {
 		0.5, 0.0+phase,
@@ -410,8 +386,6 @@ GLfloat pA[6] = { 0.01, 0.0, 2.0, 4.0, 6.0, 10.0 }; // phase adjustments
 		0.2, 0.2+phase,
 		0.2, 0.1+phase
 	};
-	OOGL(glTexCoordPointer(2, GL_FLOAT, 0, fanTextures));
-	
 	GLfloat fanColors[36];
 	GLfloat fr = _exhaustBaseColors[0], fg = _exhaustBaseColors[1], fb = _exhaustBaseColors[2];
 	unsigned i = 0;
@@ -426,17 +400,87 @@ GLfloat pA[6] = { 0.01, 0.0, 2.0, 4.0, 6.0, 10.0 }; // phase adjustments
 		fanColors[i++] = fb;
 		fanColors[i++] = 0.5;
 	}
+	
+	// reduced detail for internal view to avoid rendering artefacts, and for other ships under load
+	BOOL shortStrips = [ship isPlayer] ? [UNIVERSE viewDirection] != VIEW_CUSTOM : [[UNIVERSE qualityController] reducedExhaustPlumes];
+	
+	OOEffectBatch *batch = [OOEffectBatch activeBatch];
+	if (batch != nil)
+	{
+		OOEffectVertex triangles[kPlumeMaxBatchVertices];
+		NSUInteger count = 0;
+		
+		if (shortStrips)
+		{
+			count += AppendStripTriangles(triangles + count, afttstr1, 4, _vertices, texCoords, _exhaustBaseColors);
+			count += AppendStripTriangles(triangles + count, afttstr2, 4, _vertices, texCoords, _exhaustBaseColors);
+			count += AppendStripTriangles(triangles + count, afttstr3, 4, _vertices, texCoords, _exhaustBaseColors);
+			count += AppendStripTriangles(triangles + count, afttstr4, 4, _vertices, texCoords, _exhaustBaseColors);
+		}
+		else
+		{
+			count += AppendStripTriangles(triangles + count, tstr1, 9, _vertices, texCoords, _exhaustBaseColors);
+			count += AppendStripTriangles(triangles + count, tstr2, 9, _vertices, texCoords, _exhaustBaseColors);
+			count += AppendStripTriangles(triangles + count, tstr3, 9, _vertices, texCoords, _exhaustBaseColors);
+			count += AppendStripTriangles(triangles + count, tstr4, 9, _vertices, texCoords, _exhaustBaseColors);
+		}
+		count += AppendFanTriangles(triangles + count, tfan1, 10, _vertices, fanTextures, fanColors);
+		
+		[batch addTriangles:triangles count:count texture:[self texture] mode:kOOEffectTextureModulate];
+		return;
+	}
+	
+	OO_ENTER_OPENGL();
+	OOSetOpenGLState(OPENGL_STATE_ADDITIVE_BLENDING);
+	
+	OOGL(glPopMatrix());	// restore absolute positioning
+	OOGL(glPushMatrix());	// avoid stack underflow
+	
+	OOGLPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
+	
+	OOGL(glDisable(GL_LIGHTING));
+	OOGLSetBlending(true);
+	OOGLDepthMask(GL_FALSE);
+	OOGLEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	OOGL(glEnable(GL_TEXTURE_2D));
+	[[self texture] apply];
+
+//	OOGL(glDisable(GL_CULL_FACE));		// face culling
+	OOGL(glShadeModel(GL_SMOOTH));
+	
+	OOGLEnableClientState(GL_COLOR_ARRAY);
+	OOGL(glVertexPointer(3, GL_FLOAT, 0, _vertices));
+	OOGL(glColorPointer(4, GL_FLOAT, 0, _exhaustBaseColors));
+	OOGL(glTexCoordPointer(2, GL_FLOAT, 0, texCoords));
+
+	if (shortStrips)
+	{
+		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, afttstr1));
+		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, afttstr2));
+		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, afttstr3));
+		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_INT, afttstr4));
+	} 
+	else
+	{
+		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 9, GL_UNSIGNED_INT, tstr1));
+		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 9, GL_UNSIGNED_INT, tstr2));
+		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 9, GL_UNSIGNED_INT, tstr3));
+		OOGL(glDrawElements(GL_TRIANGLE_STRIP, 9, GL_UNSIGNED_INT, tstr4));
+	}
+
+	/* Need a different texture and color array for this segment */
+	OOGL(glTexCoordPointer(2, GL_FLOAT, 0, fanTextures));
 	OOGL(glColorPointer(4, GL_FLOAT, 0, fanColors));
 
 	OOGL(glDrawElements(GL_TRIANGLE_FAN, 10, GL_UNSIGNED_INT, tfan1));
 
-	OOGL(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
+	OOGLDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	OOGL(glDisable(GL_TEXTURE_2D));
 
-	OOGL(glDisableClientState(GL_COLOR_ARRAY));
+	OOGLDisableClientState(GL_COLOR_ARRAY);
 	
 
-	OOGL(glPopAttrib());
+	OOGLPopAttrib();
 	
 	OOVerifyOpenGLState();
 }
@@ -459,59 +503,48 @@ GLfloat pA[6] = { 0.01, 0.0, 2.0, 4.0, 6.0, 10.0 }; // phase adjustments
 }
 
 
-- (Frame) frameAtTime:(double)t_frame fromFrame:(Frame) frame_zero	// t_frame is relative to now ie. -0.5 = half a second ago.
+/*	Sampling the track at several times in one pass: the times are in
+	decreasing order, so the walk back through the track for each one carries
+	on from where the previous one stopped instead of starting again at the
+	most recent frame.
+*/
+- (void) getFrames:(Frame *)outFrames atTimes:(const double *)times count:(unsigned)count fromFrame:(Frame)frame_zero
 {
-	if (t_frame >= 0.0)  return frame_zero;
-	
-	Frame frame_one;
-	
+	unsigned i;
 	int t1 = PREV(_nextFrame);
-	double moment_in_time = frame_zero.timeframe + t_frame;
-	double period, f0;
 	
-	if (moment_in_time > _trackTime)					// between the last saved frame and now
-	{
-		frame_one = _track[t1];	// last saved moment
-		period = (moment_in_time - t_frame) - _trackTime;
-		f0 = 1.0 + t_frame/period;
-	}
-	else if (moment_in_time < _track[_nextFrame].timeframe)	// more than kExhaustFrameCount frames back
-	{
-		return _track[_nextFrame];
-	}
-	else
+	for (i = 0; i < count; i++)
 	{
-		while (moment_in_time < _track[t1].timeframe)
+		double t_frame = times[i];
+		if (t_frame >= 0.0)
 		{
-			t1 = PREV(t1);
+			outFrames[i] = frame_zero;
+			continue;
 		}
-		int t0 = NEXT(t1);
 		
-		frame_zero = _track[t0];
-		frame_one = _track[t1];
-		period = frame_zero.timeframe - frame_one.timeframe;
-		f0 = (moment_in_time - _track[t1].timeframe)/period;
+		double moment_in_time = frame_zero.timeframe + t_frame;
+		
+		if (moment_in_time > _trackTime)					// between the last saved frame and now
+		{
+			double period = frame_zero.timeframe - _trackTime;
+			outFrames[i] = InterpolateFrames(frame_zero, _track[PREV(_nextFrame)], 1.0 + t_frame/period, moment_in_time);
+		}
+		else if (moment_in_time < _track[_nextFrame].timeframe)	// more than kExhaustFrameCount frames back
+		{
+			outFrames[i] = _track[_nextFrame];
+		}
+		else
+		{
+			while (moment_in_time < _track[t1].timeframe)
+			{
+				t1 = PREV(t1);
+			}
+			int t0 = NEXT(t1);
+			
+			double period = _track[t0].timeframe - _track[t1].timeframe;
+			outFrames[i] = InterpolateFrames(_track[t0], _track[t1], (moment_in_time - _track[t1].timeframe)/period, moment_in_time);
+		}
 	}
-	
-	// interpolate
-	double f1 = 1.0 - f0;
-	
-	Vector posn;
-	posn.x =	f0 * frame_zero.position.x + f1 * frame_one.position.x;
-	posn.y =	f0 * frame_zero.position.y + f1 * frame_one.position.y;
-	posn.z =	f0 * frame_zero.position.z + f1 * frame_one.position.z;
-	Quaternion qrot;
-	qrot.w =	f0 * frame_zero.orientation.w + f1 * frame_one.orientation.w;
-	qrot.x =	f0 * frame_zero.orientation.x + f1 * frame_one.orientation.x;
-	qrot.y =	f0 * frame_zero.orientation.y + f1 * frame_one.orientation.y;
-	qrot.z =	f0 * frame_zero.orientation.z + f1 * frame_one.orientation.z;
-	
-	Frame result;
-	result.position = posn;
-	result.orientation = qrot;
-	result.timeframe = moment_in_time;
-	result.k = vector_forward_from_quaternion(qrot);
-	return result;
 }
 
 
@@ -590,3 +623,76 @@ GLfloat pA[6] = { 0.01, 0.0, 2.0, 4.0, 6.0, 10.0 }; // phase adjustments
 }
 
 @end
+
+
+static Frame InterpolateFrames(Frame frame_zero, Frame frame_one, double f0, double moment_in_time)
+{
+	double f1 = 1.0 - f0;
+	
+	Vector posn;
+	posn.x =	f0 * frame_zero.position.x + f1 * frame_one.position.x;
+	posn.y =	f0 * frame_zero.position.y + f1 * frame_one.position.y;
+	posn.z =	f0 * frame_zero.position.z + f1 * frame_one.position.z;
+	Quaternion qrot;
+	qrot.w =	f0 * frame_zero.orientation.w + f1 * frame_one.orientation.w;
+	qrot.x =	f0 * frame_zero.orientation.x + f1 * frame_one.orientation.x;
+	qrot.y =	f0 * frame_zero.orientation.y + f1 * frame_one.orientation.y;
+	qrot.z =	f0 * frame_zero.orientation.z + f1 * frame_one.orientation.z;
+	
+	Frame result;
+	result.position = posn;
+	result.orientation = qrot;
+	result.timeframe = moment_in_time;
+	result.k = vector_forward_from_quaternion(qrot);
+	return result;
+}
+
+
+static void SetEffectVertex(OOEffectVertex *outVertex, GLuint index, const GLfloat *positions, const GLfloat *texCoords, const GLfloat *colors)
+{
+	outVertex->position[0] = positions[index * 3];
+	outVertex->position[1] = positions[index * 3 + 1];
+	outVertex->position[2] = positions[index * 3 + 2];
+	outVertex->s = texCoords[index * 2];
+	outVertex->t = texCoords[index * 2 + 1];
+	outVertex->color[0] = colors[index * 4];
+	outVertex->color[1] = colors[index * 4 + 1];
+	outVertex->color[2] = colors[index * 4 + 2];
+	outVertex->color[3] = colors[index * 4 + 3];
+}
+
+
+// Expand an indexed triangle strip into separate triangles, keeping the winding of each.
+static NSUInteger AppendStripTriangles(OOEffectVertex *outVertices, const GLuint *indices, unsigned count, const GLfloat *positions, const GLfloat *texCoords, const GLfloat *colors)
+{
+	unsigned i;
+	NSUInteger written = 0;
+	
+	for (i = 0; i + 2 < count; i++)
+	{
+		GLuint a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		if (i & 1)  { GLuint t = a; a = b; b = t; }
+		
+		SetEffectVertex(&outVertices[written++], a, positions, texCoords, colors);
+		SetEffectVertex(&outVertices[written++], b, positions, texCoords, colors);
+		SetEffectVertex(&outVertices[written++], c, positions, texCoords, colors);
+	}
+	
+	return written;
+}
+
+
+static NSUInteger AppendFanTriangles(OOEffectVertex *outVertices, const GLuint *indices, unsigned count, const GLfloat *positions, const GLfloat *texCoords, const GLfloat *colors)
+{
+	unsigned i;
+	NSUInteger written = 0;
+	
+	for (i = 1; i + 1 < count; i++)
+	{
+		SetEffectVertex(&outVertices[written++], indices[0], positions, texCoords, colors);
+		SetEffectVertex(&outVertices[written++], indices[i], positions, texCoords, colors);
+		SetEffectVertex(&outVertices[written++], indices[i + 1], positions, texCoords, colors);
+	}
+	
+	return written;
+}
@@ -199,7 +199,7 @@ static const GLfloat kLaserVertices[] =
 		hurting whatever is hit in a given frame.
 		-- Ahruman 2011-01-31
 	*/
-	OOGL(glEnableClientState(GL_TEXTURE_COORD_ARRAY));
+	OOGLEnableClientState(GL_TEXTURE_COORD_ARRAY);
 	OOGL(glEnable(GL_TEXTURE_2D));
 	OOGL(glPushMatrix());
 	
@@ -240,7 +240,7 @@ static const GLfloat kLaserVertices[] =
 	glDrawArrays(GL_QUADS, 0, 8);
 	
 	OOGL(glPopMatrix());
-	OOGL(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
+	OOGLDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	OOGL(glDisable(GL_TEXTURE_2D));
 	
 	OOVerifyOpenGLState();
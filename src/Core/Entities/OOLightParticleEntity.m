@@ -32,6 +32,7 @@ MA 02110-1301, USA.
 #import "OOFunctionAttributes.h"
 #import "OOMacroOpenGL.h"
 #import "OOGraphicsResetManager.h"
+#import "OOEffectBatch.h"
 
 
 #define PARTICLE_DISTANCE_SCALE_LOW		12.0
@@ -45,6 +46,10 @@ static OOTexture *sBlobTexture = nil;
 
 + (void) resetGraphicsState;
 
+- (BOOL) shouldDraw;
+- (void) getDrawColor:(GLfloat[4])outComponents;
+- (void) addToEffectBatch:(OOEffectBatch *)batch atPosition:(Vector)centre;
+
 @end
 
 
@@ -123,6 +128,13 @@ static OOTexture *sBlobTexture = nil;
 		father = [father owner];
 	}
 	
+	OOEffectBatch *batch = [OOEffectBatch activeBatch];
+	if (batch != nil)
+	{
+		if ([self shouldDraw])  [self addToEffectBatch:batch atPosition:abspos];
+		return;
+	}
+	
 	OOMatrix temp_matrix = OOMatrixLoadGLMatrix(GL_MODELVIEW_MATRIX);
 	OOGL(glPopMatrix());  OOGL(glPushMatrix());  // restore zero!
 	GLTranslateOOVector(abspos);	// move to absolute position
@@ -135,35 +147,27 @@ static OOTexture *sBlobTexture = nil;
 
 - (void) drawImmediate:(bool)immediate translucent:(bool)translucent
 {
-	if (!translucent) return;
-	if ([UNIVERSE breakPatternHide] && ![self isImmuneToBreakPatternHide])
+	if (!translucent || ![self shouldDraw])  return;
+	
+	OOEffectBatch *batch = [OOEffectBatch activeBatch];
+	if (batch != nil)
 	{
-		Entity *father = [self owner];
-		while (father != nil && father != NO_TARGET)
-		{
-			if (![father isSubEntity])  break;
-			father = [father owner];
-		}
-		if (![father isImmuneToBreakPatternHide])
-		{
-			return;
-		}
+		[self addToEffectBatch:batch atPosition:position];
+		return;
 	}
-	if (no_draw_distance <= cam_zero_distance)  return;
 	
 	OO_ENTER_OPENGL();
 	OOSetOpenGLState(OPENGL_STATE_ADDITIVE_BLENDING);
 	
-	OOGL(glPushAttrib(GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT));
-	OOGL(glEnable(GL_BLEND));
-	OOGL(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
+	OOGLPushAttrib(GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT);
+	OOGLSetBlending(true);
+	OOGLBlendFunc(GL_SRC_ALPHA, GL_ONE);
 	
 	OOGL(glEnable(GL_TEXTURE_2D));
-	OOGL(glDepthMask(GL_FALSE));
+	OOGLDepthMask(GL_FALSE);
 	
-	GLfloat distanceAttenuation = cam_zero_distance / no_draw_distance;
-	distanceAttenuation = 1.0 - distanceAttenuation;
-	GLfloat components[4] = { _colorComponents[0], _colorComponents[1], _colorComponents[2], _colorComponents[3] * distanceAttenuation };
+	GLfloat components[4];
+	[self getDrawColor:components];
 	OOGL(glColor4fv(components));
 	
 	OOGL(glTexEnvfv(GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, components));
@@ -274,12 +278,31 @@ static OOTexture *sBlobTexture = nil;
 	OOGLEND();
 	
 	OOGL(glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE));
-	OOGL(glPopAttrib());
+	OOGLPopAttrib();
 	
 	OOVerifyOpenGLState();
 }
 
 
+- (void) addToEffectBatch:(OOEffectBatch *)batch atPosition:(Vector)centre
+{
+	GLfloat components[4];
+	[self getDrawColor:components];
+	
+	/*	Unlike the immediate path, which faces the particle along the view
+		direction, this faces it towards the viewpoint. The texture is round,
+		so the only difference is a negligible one in perspective.
+	*/
+	[batch addBillboardAt:centre
+				   matrix:OOMatrixForBillboard(centre, [PLAYER viewpointPosition])
+					 size:_diameter
+			  depthOffset:_diameter * 0.5f
+					color:components
+				  texture:[self texture]
+					 mode:kOOEffectTextureAlphaOnly];
+}
+
+
 - (OOTexture *) texture
 {
 	return [OOLightParticleEntity defaultParticleTexture];
@@ -314,6 +337,36 @@ static OOTexture *sBlobTexture = nil;
 }
 
 
+- (BOOL) shouldDraw
+{
+	if ([UNIVERSE breakPatternHide] && ![self isImmuneToBreakPatternHide])
+	{
+		Entity *father = [self owner];
+		while (father != nil && father != NO_TARGET)
+		{
+			if (![father isSubEntity])  break;
+			father = [father owner];
+		}
+		if (![father isImmuneToBreakPatternHide])
+		{
+			return NO;
+		}
+	}
+	return no_draw_distance > cam_zero_distance;
+}
+
+
+- (void) getDrawColor:(GLfloat[4])outComponents
+{
+	GLfloat distanceAttenuation = cam_zero_distance / no_draw_distance;
+	distanceAttenuation = 1.0 - distanceAttenuation;
+	outComponents[0] = _colorComponents[0];
+	outComponents[1] = _colorComponents[1];
+	outComponents[2] = _colorComponents[2];
+	outComponents[3] = _colorComponents[3] * distanceAttenuation;
+}
+
+
 - (BOOL) isEffect
 {
 	return YES;
@@ -29,12 +29,20 @@ MA 02110-1301, USA.
 #import "PlayerEntity.h"
 #import "OOLightParticleEntity.h"
 #import "OOMacroOpenGL.h"
+#import "OOEffectBatch.h"
 
 
 //	Testing toy: cause particle systems to stop after half a second.
 #define FREEZE_PARTICLES	0
 
 
+@interface OOParticleSystem (Private)
+
+- (void) addToEffectBatch:(OOEffectBatch *)batch;
+
+@end
+
+
 @implementation OOParticleSystem
 
 - (id) init
@@ -141,15 +149,22 @@ do { \
 {
 	if (!translucent || [UNIVERSE breakPatternHide])  return;
 	
+	OOEffectBatch *batch = [OOEffectBatch activeBatch];
+	if (batch != nil)
+	{
+		[self addToEffectBatch:batch];
+		return;
+	}
+	
 	OO_ENTER_OPENGL();
 	OOSetOpenGLState(OPENGL_STATE_ADDITIVE_BLENDING);
 	
-	OOGL(glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT));
+	OOGLPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
 	
 	OOGL(glEnable(GL_TEXTURE_2D));
 	[[OOLightParticleEntity defaultParticleTexture] apply];
-	OOGL(glEnable(GL_BLEND));
-	OOGL(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
+	OOGLSetBlending(true);
+	OOGLBlendFunc(GL_SRC_ALPHA, GL_ONE);
 	
 	Vector		viewPosition = [PLAYER viewpointPosition];
 	Vector		selfPosition = [self position];
@@ -229,13 +244,55 @@ do { \
 
 	}
 	
-	OOGL(glPopAttrib());
+	OOGLPopAttrib();
 	
 	OOVerifyOpenGLState();
 	OOCheckOpenGLErrors(@"OOParticleSystem after drawing %@", self);
 }
 
 
+// Same geometry as -drawImmediate:translucent:, in absolute coordinates.
+- (void) addToEffectBatch:(OOEffectBatch *)batch
+{
+	Vector		viewPosition = [PLAYER viewpointPosition];
+	Vector		selfPosition = [self position];
+	OOTexture	*texture = [OOLightParticleEntity defaultParticleTexture];
+	
+	unsigned	i, count = _count;
+	Vector		*particlePosition = _particlePosition;
+	GLfloat		(*particleColor)[4] = _particleColor;
+	GLfloat		*particleSize = _particleSize;
+	
+	float distanceThreshold = collision_radius * 2.0f;
+	float thresholdSq = distanceThreshold * distanceThreshold;
+	float distanceSq = cam_zero_distance;
+	BOOL flat = [UNIVERSE reducedDetail];
+	BOOL shared = flat || distanceSq > thresholdSq;
+	float individuality = OOClamp_0_1_f(3.0f * (1.0f - distanceSq / thresholdSq));
+	OOMatrix bbMatrix = OOMatrixForBillboard(selfPosition, viewPosition);
+	
+	for (i = 0; i < count; i++)
+	{
+		Vector centre;
+		if (flat)  centre = vector_add(selfPosition, OOVectorMultiplyMatrix(particlePosition[i], bbMatrix));
+		else  centre = vector_add(selfPosition, particlePosition[i]);
+		
+		if (!shared)
+		{
+			bbMatrix = OOMatrixForBillboard(vector_add(selfPosition, vector_multiply_scalar(particlePosition[i], individuality)), viewPosition);
+		}
+		
+		[batch addBillboardAt:centre
+					   matrix:bbMatrix
+						 size:particleSize[i]
+				  depthOffset:0.0f
+						color:particleColor[i]
+					  texture:texture
+						 mode:kOOEffectTextureModulate];
+	}
+}
+
+
 - (BOOL) isEffect
 {
 	return YES;
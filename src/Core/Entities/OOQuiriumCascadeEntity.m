@@ -123,19 +123,19 @@ MA 02110-1301, USA.
 	OO_ENTER_OPENGL();
 	OOSetOpenGLState(OPENGL_STATE_ADDITIVE_BLENDING);
 	
-	OOGL(glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT));
+	OOGLPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
 	
 	OOGL(glDisable(GL_CULL_FACE));
 	OOGL(glDisable(GL_TEXTURE_2D));
-	OOGL(glEnable(GL_BLEND));
-	OOGL(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
+	OOGLSetBlending(true);
+	OOGLBlendFunc(GL_SRC_ALPHA, GL_ONE);
 	
 	OOGL(glColor4fv(_color));
 	OOGLBEGIN(GL_TRIANGLE_FAN);
 		GLDrawBallBillboard(collision_radius, 4, sqrt(cam_zero_distance));
 	OOGLEND();
 	
-	OOGL(glPopAttrib());
+	OOGLPopAttrib();
 	
 	OOVerifyOpenGLState();
 	OOCheckOpenGLErrors(@"OOQuiriumCascadeEntity after drawing %@", self);
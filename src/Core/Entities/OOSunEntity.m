@@ -325,7 +325,7 @@ MA 02110-1301, USA.
 	// Close enough not to draw flat?
 	if (ignoreDepthBuffer)  OOGL(glDisable(GL_DEPTH_TEST));
 	
-	OOGL(glDisable(GL_BLEND));
+	OOGLSetBlending(false);
 	OOGL(glColor3fv(discColor));
 	
 	// FIXME: use vertex arrays
@@ -333,7 +333,7 @@ MA 02110-1301, USA.
 		GLDrawBallBillboard(collision_radius, steps, sqrt_zero_distance);
 	OOGLEND();
 	
-	OOGL(glEnable(GL_BLEND));
+	OOGLSetBlending(true);
 	if (ignoreDepthBuffer)  OOGL(glEnable(GL_DEPTH_TEST));
 	
 	if (![UNIVERSE reducedDetail])
@@ -31,6 +31,7 @@ MA 02110-1301, USA.
 #import "Entity.h"
 #import "legacy_random.h"
 #import "OOColor.h"
+#import "OOVertexBufferArena.h"
 
 @class OOTexture;
 
@@ -82,10 +83,15 @@ typedef struct
 	
 	double					sqrt_zero_distance;
 	
-	GLuint					displayListNames[MAX_SUBDIVIDE];
 	GLuint					vertexCount;
+	GLuint					meshVertexCount;		// Vertices in vertexdata for all subdivision levels.
 	VertexData				vertexdata;
 	
+	OOVertexBufferAllocation	vertexBuffer;		// Interleaved copy of vertexdata in the shared arena.
+	BOOL					vertexBufferUnavailable;
+	uint64_t				indexHash;				// Hash of vertexdata.index_array, which picks the shared index buffer.
+	struct OOPlanetPatch	*patches;				// Bounds of the parts drawn separately near the surface.
+	
 	Vector					rotationAxis;
 }
 
@@ -119,10 +125,20 @@ typedef struct
 
 - (void) launchShuttle;
 
+// Launch the first shuttle 30 seconds from now.
+- (void) scheduleFirstShuttleLaunch;
+
 - (void) welcomeShuttle:(ShipEntity *) shuttle;
 
 - (void) drawUnconditionally;
 
+/*	Geometry submitted by all planets and atmospheres since the last reset,
+	counting each index as a vertex. Reset by Universe every frame.
+*/
++ (void) resetDrawStatistics;
++ (NSUInteger) drawnVertexCount;
++ (NSUInteger) drawCallCount;
+
 #ifndef NDEBUG
 - (PlanetEntity *) atmosphere;
 #endif
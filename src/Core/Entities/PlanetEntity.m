@@ -43,6 +43,7 @@ MA 02110-1301, USA.
 #import "OOCollectionExtractors.h"
 #import "OODebugFlags.h"
 #import "OOGraphicsResetManager.h"
+#import "OOQualityController.h"
 
 #define kOOLogUnconvertedNSLog @"unclassified.PlanetEntity"
 
@@ -66,11 +67,81 @@ static GLuint vertex_index_array[3*(20+80+320+1280+5120+20480)];
 static GLfloat	texture_uv_array[MAX_PLANET_VERTICES * 2];
 
 
+/*	Levels of detail. Whole spheres are drawn at PLANET_MIN_LEVEL to
+	PLANET_MAX_SPHERE_LEVEL, chosen by size on screen; a level only changes
+	once the size has moved PLANET_LOD_HYSTERESIS levels past the boundary, so
+	a planet hovering around a boundary doesn't flicker between levels.
+	Close to the surface, PLANET_SURFACE_LEVEL is used, but only the patches
+	that can be above the horizon are drawn.
+*/
+#define PLANET_MIN_LEVEL				2
+#define PLANET_MAX_SPHERE_LEVEL			4
+#define PLANET_SURFACE_LEVEL			(MAX_SUBDIVIDE - 1)
+#define PLANET_PATCH_LEVEL				2		// Patches are the triangles of this level.
+#define PLANET_LOD_HYSTERESIS			0.2
+#define PLANET_SURFACE_ENTRY_DISTANCE	3.0		// Radii from the centre within which the surface level is used...
+#define PLANET_SURFACE_EXIT_DISTANCE	3.3		// ...and beyond which it stops being used.
+#define PLANET_HORIZON_MARGIN			0.02	// Radians.
+
+
+/*	Each patch's triangles at a higher level are contiguous in the index
+	array, since every triangle's four children are stored together.
+*/
+struct OOPlanetPatch
+{
+	Vector				centre;			// Unit vector, model space.
+	GLfloat				angle;			// Angle from the centre to the farthest corner.
+};
+typedef struct OOPlanetPatch Patch;
+
+
+#if OO_USE_VBO
+/*	OOPlanetVBOVertex
+	Interleaved layout of vertexdata used for vertex buffer uploads.
+*/
+typedef struct
+{
+	GLfloat				position[3];
+	GLfloat				normal[3];
+	GLfloat				color[4];
+	GLfloat				s, t;
+} OOPlanetVBOVertex;
+
+
+/*	Every planet built from the same base mesh has the same indices, so the
+	index buffers are shared, identified by indexHash. There are only two base
+	meshes; the extra entries are slack.
+*/
+enum
+{
+	kMaxSharedIndexBuffers		= 4
+};
+
+typedef struct
+{
+	uint64_t					hash;			// Zero if unused.
+	OOVertexBufferAllocation	allocation;
+} SharedIndexBuffer;
+
+static SharedIndexBuffer	sSharedIndexBuffers[kMaxSharedIndexBuffers];
+#endif
+
+
+static NSUInteger			sDrawnVertexCount;
+static NSUInteger			sDrawCallCount;
+
+
+static uint8_t SelectSphereLevel(double detail, uint8_t previous);
+static Vector InverseRotateVector(Vector v, OOMatrix m);
+
+
 @interface PlanetEntity (OOPrivate) <OOGraphicsResetClient>
 
 - (double) sqrtZeroDistance;
 
-- (void) drawModelWithVertexArraysAndSubdivision: (int) subdivide;
+- (void) drawModelWithVertexArraysAndSubdivision:(int)subdivide indices:(const GLuint *)indices;
+- (BOOL) drawSurfacePatchesWithIndices:(const GLuint *)indices;
+- (const Patch *) patches;
 
 - (void) initialiseBaseVertexArray;
 
@@ -88,7 +159,11 @@ static GLfloat	texture_uv_array[MAX_PLANET_VERTICES * 2];
 - (OOTexture *) planetTextureWithInfo:(NSDictionary *)info;
 - (OOTexture *) cloudTextureWithCloudColor:(OOColor *)cloudColor cloudImpress:(GLfloat)cloud_impress cloudBias:(GLfloat)cloud_bias;
 
-- (void) deleteDisplayLists;
+- (void) deleteVertexBuffer;
+#if OO_USE_VBO
+- (BOOL) bindVertexBuffer;
+- (BOOL) bindIndexBuffer:(const GLuint **)outIndices;
+#endif
 
 - (void) setUseTexturedModel:(BOOL)flag;
 
@@ -439,7 +514,7 @@ static const BaseFace kTexturedFaces[][3] =
 	last_launch_time = 0.0;
 	shuttle_launch_interval = 3600.0 / shuttles_on_ground; // all are launched in an hour
 
-	last_launch_time = [UNIVERSE getTime] + 30.0 - shuttle_launch_interval;   // debug - launch 30s after player enters universe
+	[self scheduleFirstShuttleLaunch];
 
 	collision_radius = radius_km * 10.0; // scale down by a factor of 100 !
 	
@@ -579,7 +654,8 @@ static const BaseFace kTexturedFaces[][3] =
 
 - (void) dealloc
 {
-	[self deleteDisplayLists];
+	[self deleteVertexBuffer];
+	free(patches);
 	
 	DESTROY(atmosphere);
 	DESTROY(_texture);
@@ -770,15 +846,21 @@ static const BaseFace kTexturedFaces[][3] =
 
 - (void) drawUnconditionally
 {
-	uint8_t	subdivideLevel =	2;		// 4 is probably the maximum!
+	uint8_t	subdivideLevel =	PLANET_MIN_LEVEL;
 	
+	float	detailScale = [[UNIVERSE qualityController] planetDetailScale];
 	double  drawFactor = [[UNIVERSE gameView] viewSize].width / 100.0;
 	double  drawRatio2 = drawFactor * collision_radius / sqrt_zero_distance; // equivalent to size on screen in pixels
 	
 	if (cam_zero_distance > 0.0)
 	{
-		subdivideLevel = 2 + floor(drawRatio2);
-		if (subdivideLevel > 4)  subdivideLevel = 4;
+		subdivideLevel = SelectSphereLevel(PLANET_MIN_LEVEL + drawRatio2 * detailScale, lastSubdivideLevel);
+		
+		double surfaceDistance = (lastSubdivideLevel == PLANET_SURFACE_LEVEL) ? PLANET_SURFACE_EXIT_DISTANCE : PLANET_SURFACE_ENTRY_DISTANCE;
+		if (![UNIVERSE reducedDetail] && detailScale >= 1.0f && sqrt_zero_distance < surfaceDistance * collision_radius)
+		{
+			subdivideLevel = PLANET_SURFACE_LEVEL;
+		}
 	}
 	
 	if (planet_type == STELLAR_TYPE_MINIATURE)
@@ -789,7 +871,7 @@ static const BaseFace kTexturedFaces[][3] =
 	lastSubdivideLevel = subdivideLevel;	// record
 	
 	OOSetOpenGLState(OPENGL_STATE_OPAQUE);
-	OOGL(glPushAttrib(GL_ENABLE_BIT));
+	OOGLPushAttrib(GL_ENABLE_BIT);
 	
 //	OOGL(glEnable(GL_LIGHTING));
 //	OOGL(glEnable(GL_LIGHT1));
@@ -824,7 +906,7 @@ static const BaseFace kTexturedFaces[][3] =
 				subdivideLevel = root_planet->lastSubdivideLevel;	// copy it from the planet (stops jerky LOD and such)
 			}
 			GLMultOOMatrix(rotMatrix);	// rotate the clouds!
-			OOGL(glEnable(GL_BLEND));
+			OOGLSetBlending(true);
 			OOGL(glDisable(GL_LIGHTING));
 			// Fall through.
 
@@ -876,51 +958,64 @@ static const BaseFace kTexturedFaces[][3] =
 				OOGL(glColor4fv(mat1));
 				OOGL(glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, mat1));
 				
-				OOGL(glEnableClientState(GL_COLOR_ARRAY));
-				OOGL(glColorPointer(4, GL_FLOAT, 0, vertexdata.color_array));
+				const GLvoid	*vertexPointer = vertexdata.vertex_array;
+				const GLvoid	*normalPointer = vertexdata.normal_array;
+				const GLvoid	*colorPointer = vertexdata.color_array;
+				const GLvoid	*uvPointer = vertexdata.uv_array;
+				const GLuint	*indices = vertexdata.index_array;
+				GLsizei			stride = 0;
+				
+#if OO_USE_VBO
+				BOOL usingVertexBuffer = [self bindVertexBuffer];
+				BOOL usingIndexBuffer = NO;
+				if (usingVertexBuffer)
+				{
+					const char *base = (const char *)NULL + vertexBuffer.offset;
+					vertexPointer = base + offsetof(OOPlanetVBOVertex, position);
+					normalPointer = base + offsetof(OOPlanetVBOVertex, normal);
+					colorPointer = base + offsetof(OOPlanetVBOVertex, color);
+					uvPointer = base + offsetof(OOPlanetVBOVertex, s);
+					stride = sizeof (OOPlanetVBOVertex);
+					
+					usingIndexBuffer = [self bindIndexBuffer:&indices];
+				}
+#endif
+				
+				OOGLEnableClientState(GL_COLOR_ARRAY);
+				OOGL(glColorPointer(4, GL_FLOAT, stride, colorPointer));
 //				OOGL(glEnableClientState(GL_VERTEX_ARRAY));
-				OOGL(glVertexPointer(3, GL_FLOAT, 0, vertexdata.vertex_array));
+				OOGL(glVertexPointer(3, GL_FLOAT, stride, vertexPointer));
 //				OOGL(glEnableClientState(GL_NORMAL_ARRAY));
-				OOGL(glNormalPointer(GL_FLOAT, 0, vertexdata.normal_array));
+				OOGL(glNormalPointer(GL_FLOAT, stride, normalPointer));
 				
 				if (_texture != nil)
 				{
-					OOGL(glEnableClientState(GL_TEXTURE_COORD_ARRAY));
+					OOGLEnableClientState(GL_TEXTURE_COORD_ARRAY);
 					if ([_texture isCubeMap])
 					{
-						OOGL(glTexCoordPointer(3, GL_FLOAT, 0, vertexdata.vertex_array));
+						OOGL(glTexCoordPointer(3, GL_FLOAT, stride, vertexPointer));
 					}
 					else
 					{
-						OOGL(glTexCoordPointer(2, GL_FLOAT, 0, vertexdata.uv_array));
+						OOGL(glTexCoordPointer(2, GL_FLOAT, stride, uvPointer));
 					}
 				}
 				else
 				{
-					OOGL(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
+					OOGLDisableClientState(GL_TEXTURE_COORD_ARRAY);
 				}
 				
-				if (displayListNames[subdivideLevel] != 0)
-				{
-					OOGL(glCallList(displayListNames[subdivideLevel]));
-				}
-				else
-				{
-					
-					OOGL(displayListNames[subdivideLevel] = glGenLists(1));
-					if (displayListNames[subdivideLevel] != 0)	// sanity check
-					{
-						OOGL(glNewList(displayListNames[subdivideLevel], GL_COMPILE_AND_EXECUTE));
-						
-						OOGL(glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE));
-						OOGL(glEnable(GL_COLOR_MATERIAL));
-						
-						[self drawModelWithVertexArraysAndSubdivision:subdivideLevel];
-						
-						OOGL(glDisable(GL_COLOR_MATERIAL));
-						OOGL(glEndList());
-					}
-				}
+				OOGL(glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE));
+				OOGL(glEnable(GL_COLOR_MATERIAL));
+				
+				[self drawModelWithVertexArraysAndSubdivision:subdivideLevel indices:indices];
+				
+				OOGL(glDisable(GL_COLOR_MATERIAL));
+				
+#if OO_USE_VBO
+				if (usingVertexBuffer)  OOGL(glBindBufferARB(GL_ARRAY_BUFFER, 0));
+				if (usingIndexBuffer)  OOGL(glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER, 0));
+#endif
 
 #if OO_TEXTURE_CUBE_MAP
 				if ([_texture isCubeMap])
@@ -930,8 +1025,8 @@ static const BaseFace kTexturedFaces[][3] =
 				}
 #endif
 
-			OOGL(glDisableClientState(GL_COLOR_ARRAY));
-			OOGL(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
+			OOGLDisableClientState(GL_COLOR_ARRAY);
+			OOGLDisableClientState(GL_TEXTURE_COORD_ARRAY);
 			OOGL(glEnable(GL_DEPTH_TEST));
 
 			}
@@ -956,10 +1051,10 @@ static const BaseFace kTexturedFaces[][3] =
 	}
 	OOGL(glEnable(GL_TEXTURE_2D));
 	OOGL(glEnable(GL_LIGHTING));
-	OOGL(glDisable(GL_BLEND));
+	OOGLSetBlending(false);
 
 
-	OOGL(glPopAttrib());
+	OOGLPopAttrib();
 	OOVerifyOpenGLState();
 	OOCheckOpenGLErrors(@"PlanetEntity after drawing %@", self);
 
@@ -978,6 +1073,25 @@ static const BaseFace kTexturedFaces[][3] =
 }
 
 
++ (void) resetDrawStatistics
+{
+	sDrawnVertexCount = 0;
+	sDrawCallCount = 0;
+}
+
+
++ (NSUInteger) drawnVertexCount
+{
+	return sDrawnVertexCount;
+}
+
+
++ (NSUInteger) drawCallCount
+{
+	return sDrawCallCount;
+}
+
+
 #ifndef NDEBUG
 - (PlanetEntity *) atmosphere
 {
@@ -1034,7 +1148,7 @@ static const BaseFace kTexturedFaces[][3] =
 	if (fileName == nil)  return NO;
 	
 	[self loadTexture:OOTextureSpecFromObject(fileName, nil)];
-	[self deleteDisplayLists];
+	[self deleteVertexBuffer];
 	
 	unsigned i;
 	[self setUseTexturedModel:YES];
@@ -1148,9 +1262,102 @@ static const BaseFace kTexturedFaces[][3] =
 }
 
 
-- (void) drawModelWithVertexArraysAndSubdivision: (int) subdivide
+- (void) drawModelWithVertexArraysAndSubdivision:(int)subdivide indices:(const GLuint *)indices
+{
+	if (subdivide == PLANET_SURFACE_LEVEL && planet_type != STELLAR_TYPE_MINIATURE)
+	{
+		if ([self drawSurfacePatchesWithIndices:indices])  return;
+	}
+	
+	GLsizei count = 3 * n_triangles[subdivide];
+	OOGL(glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, indices + triangle_start[subdivide]));
+	sDrawnVertexCount += count;
+	sDrawCallCount++;
+}
+
+
+/*	Draw the surface level, skipping patches entirely beyond the horizon.
+	Runs of adjacent visible patches are drawn together. Returns NO, having
+	drawn nothing, if the camera is inside the sphere or the patches aren't
+	available.
+*/
+- (BOOL) drawSurfacePatchesWithIndices:(const GLuint *)indices
+{
+	const Patch *patchArray = [self patches];
+	if (patchArray == NULL)  return NO;
+	
+	// Atmospheres share their planet's position, and are rotated by their own rotMatrix.
+	Vector relativeCamera = vector_subtract([PLAYER viewpointPosition], position);
+	double distance = magnitude(relativeCamera);
+	if (distance <= collision_radius)  return NO;
+	
+	Vector cameraDirection = vector_multiply_scalar(InverseRotateVector(relativeCamera, rotMatrix), 1.0 / distance);
+	double horizon = acos(collision_radius / distance) + PLANET_HORIZON_MARGIN;
+	
+	unsigned patchCount = n_triangles[PLANET_PATCH_LEVEL];
+	unsigned trianglesPerPatch = n_triangles[PLANET_SURFACE_LEVEL] / patchCount;
+	const GLuint *surfaceIndices = indices + triangle_start[PLANET_SURFACE_LEVEL];
+	unsigned i, runStart = 0;
+	BOOL inRun = NO;
+	
+	for (i = 0; i <= patchCount; i++)
+	{
+		BOOL visible = NO;
+		if (i < patchCount)
+		{
+			double cosine = fmax(fmin(dot_product(patchArray[i].centre, cameraDirection), 1.0), -1.0);
+			visible = acos(cosine) < horizon + patchArray[i].angle;
+		}
+		
+		if (visible && !inRun)
+		{
+			runStart = i;
+			inRun = YES;
+		}
+		else if (!visible && inRun)
+		{
+			GLsizei count = 3 * trianglesPerPatch * (i - runStart);
+			OOGL(glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, surfaceIndices + 3 * trianglesPerPatch * runStart));
+			sDrawnVertexCount += count;
+			sDrawCallCount++;
+			inRun = NO;
+		}
+	}
+	
+	return YES;
+}
+
+
+- (const Patch *) patches
 {
-	OOGL(glDrawElements(GL_TRIANGLES, 3 * n_triangles[subdivide], GL_UNSIGNED_INT, &vertexdata.index_array[triangle_start[subdivide]]));
+	if (patches == NULL)
+	{
+		unsigned i, j, count = n_triangles[PLANET_PATCH_LEVEL];
+		patches = malloc(sizeof *patches * count);
+		if (patches == NULL)  return NULL;
+		
+		const GLuint *corners = vertexdata.index_array + triangle_start[PLANET_PATCH_LEVEL];
+		for (i = 0; i < count; i++)
+		{
+			Vector centre = kZeroVector;
+			for (j = 0; j < 3; j++)
+			{
+				centre = vector_add(centre, vertexdata.normal_array[corners[i * 3 + j]]);
+			}
+			centre = vector_normal(centre);
+			
+			GLfloat minCosine = 1.0f;
+			for (j = 0; j < 3; j++)
+			{
+				minCosine = fminf(minCosine, dot_product(centre, vertexdata.normal_array[corners[i * 3 + j]]));
+			}
+			
+			patches[i].centre = centre;
+			patches[i].angle = acosf(fmaxf(minCosine, -1.0f));
+		}
+	}
+	
+	return patches;
 }
 
 
@@ -1190,6 +1397,12 @@ static const BaseFace kTexturedFaces[][3] =
 }
 
 
+- (void) scheduleFirstShuttleLaunch
+{
+	last_launch_time = [UNIVERSE getTime] + 30.0 - shuttle_launch_interval;   // debug - launch 30s after player enters universe
+}
+
+
 - (void) welcomeShuttle:(ShipEntity *) shuttle
 {
 	shuttles_on_ground++;
@@ -1293,12 +1506,18 @@ static const BaseFace kTexturedFaces[][3] =
 		}
 	}
 	
-	// all done - copy the indices to the instance
+	// all done - copy the indices to the instance, hashing them (FNV-1a over whole indices) to share index buffers.
+	uint64_t hash = 14695981039346656037ULL;
 	unsigned i;
 	for (i = 0; i < MAX_TRI_INDICES; i++)
 	{
 		vertexdata.index_array[i] = vertex_index_array[i];
+		hash = (hash ^ vertex_index_array[i]) * 1099511628211ULL;
 	}
+	indexHash = hash | 1;	// Never zero, which marks an unused shared index buffer.
+	
+	free(patches);
+	patches = NULL;
 }
 
 	
@@ -1468,6 +1687,9 @@ static unsigned baseVertexIndexForEdge(GLushort va, GLushort vb, BOOL textured)
 
 - (void) scaleVertices
 {
+	[self deleteVertexBuffer];
+	meshVertexCount = next_free_vertex;
+	
 	NSUInteger vi;
 	for (vi = 0; vi < next_free_vertex; vi++)
 	{
@@ -1481,23 +1703,93 @@ static unsigned baseVertexIndexForEdge(GLushort va, GLushort vb, BOOL textured)
 }
 
 
-- (void) deleteDisplayLists
+- (void) deleteVertexBuffer
 {
-	unsigned i;
-	for (i = 0; i < MAX_SUBDIVIDE; i++)
+	[[OOVertexBufferArena sharedArena] freeAllocation:&vertexBuffer];
+	vertexBufferUnavailable = NO;
+}
+
+
+#if OO_USE_VBO
+- (BOOL) bindVertexBuffer
+{
+	OOVertexBufferArena *arena = [OOVertexBufferArena sharedArena];
+	
+	if (![arena allocationIsValid:&vertexBuffer])
 	{
-		if (displayListNames[i] != 0)
+		if (vertexBufferUnavailable || meshVertexCount == 0)  return NO;
+		
+		size_t size = sizeof (OOPlanetVBOVertex) * meshVertexCount;
+		OOPlanetVBOVertex *vertices = malloc(size);
+		if (vertices == NULL)
+		{
+			vertexBufferUnavailable = YES;
+			return NO;
+		}
+		
+		GLuint i;
+		for (i = 0; i < meshVertexCount; i++)
 		{
-			glDeleteLists(displayListNames[i], 1);
-			displayListNames[i] = 0;
+			Vector v = vertexdata.vertex_array[i];
+			Vector n = vertexdata.normal_array[i];
+			const GLfloat *c = &vertexdata.color_array[i * 4];
+			vertices[i] = (OOPlanetVBOVertex)
+			{
+				{ v.x, v.y, v.z },
+				{ n.x, n.y, n.z },
+				{ c[0], c[1], c[2], c[3] },
+				vertexdata.uv_array[i * 2], vertexdata.uv_array[i * 2 + 1]
+			};
+		}
+		
+		BOOL OK = [arena allocateSize:size withData:vertices allocation:&vertexBuffer];
+		free(vertices);
+		if (!OK)
+		{
+			vertexBufferUnavailable = YES;
+			return NO;
 		}
 	}
+	
+	OO_ENTER_OPENGL();
+	OOGL(glBindBufferARB(GL_ARRAY_BUFFER, vertexBuffer.buffer));
+	return YES;
+}
+
+
+/*	On success, binds the shared index buffer for vertexdata.index_array and
+	sets *outIndices to the corresponding element array offset.
+*/
+- (BOOL) bindIndexBuffer:(const GLuint **)outIndices
+{
+	OOVertexBufferArena *arena = [OOVertexBufferArena sharedArena];
+	SharedIndexBuffer *entry = NULL;
+	unsigned i;
+	
+	for (i = 0; i < kMaxSharedIndexBuffers && entry == NULL; i++)
+	{
+		if (sSharedIndexBuffers[i].hash == indexHash || sSharedIndexBuffers[i].hash == 0)  entry = &sSharedIndexBuffers[i];
+	}
+	if (entry == NULL)  return NO;
+	
+	// Allocations become invalid when graphics are reset, and are then uploaded again.
+	if (![arena allocationIsValid:&entry->allocation])
+	{
+		if (![arena allocateSize:sizeof vertexdata.index_array withData:vertexdata.index_array allocation:&entry->allocation])  return NO;
+		entry->hash = indexHash;
+	}
+	
+	OO_ENTER_OPENGL();
+	OOGL(glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER, entry->allocation.buffer));
+	*outIndices = (const GLuint *)((const char *)NULL + entry->allocation.offset);
+	return YES;
 }
+#endif
 
 
 - (void)resetGraphicsState
 {
-	[self deleteDisplayLists];
+	[self deleteVertexBuffer];
 }
 
 
@@ -1611,4 +1903,25 @@ static unsigned baseVertexIndexForEdge(GLushort va, GLushort vb, BOOL textured)
 
 @end
 
+
+static uint8_t SelectSphereLevel(double detail, uint8_t previous)
+{
+	uint8_t level = OOClampInteger(previous, PLANET_MIN_LEVEL, PLANET_MAX_SPHERE_LEVEL);
+	
+	while (level < PLANET_MAX_SPHERE_LEVEL && detail >= level + 1 + PLANET_LOD_HYSTERESIS)  level++;
+	while (level > PLANET_MIN_LEVEL && detail < level - PLANET_LOD_HYSTERESIS)  level--;
+	
+	return level;
+}
+
+
+// Inverse of OOVectorMultiplyMatrix() for a pure rotation.
+static Vector InverseRotateVector(Vector v, OOMatrix m)
+{
+	return make_vector(v.x * m.m[0][0] + v.y * m.m[0][1] + v.z * m.m[0][2],
+					   v.x * m.m[1][0] + v.y * m.m[1][1] + v.z * m.m[1][2],
+					   v.x * m.m[2][0] + v.y * m.m[2][1] + v.z * m.m[2][2]);
+}
+
+
 #endif	// !NEW_PLANETS
@@ -708,9 +708,12 @@ static GLfloat		sBaseMass = 0.0;
 	[result oo_setInteger:ship_trade_in_factor forKey:@"ship_trade_in_factor"];
 
 	// mission variables
+	// Typed mission variables are saved as strings, for compatibility with older versions.
+	NSDictionary *missionVariables = nil;
 	if (mission_variables != nil)
 	{
-		[result setObject:[NSDictionary dictionaryWithDictionary:mission_variables] forKey:@"mission_variables"];
+		missionVariables = [self missionVariablesPropertyList];
+		[result setObject:missionVariables forKey:@"mission_variables"];
 	}
 
 	// communications log
@@ -828,9 +831,9 @@ static GLfloat		sBaseMass = 0.0;
 	munge_checksum(max_cargo);		munge_checksum(missiles);
 	munge_checksum(legalStatus);	munge_checksum(market_rnd);		munge_checksum(ship_kills);
 	
-	if (mission_variables != nil)
+	if (missionVariables != nil)
 	{
-		munge_checksum([[mission_variables description] length]);
+		munge_checksum([[missionVariables description] length]);
 	}
 	if (equipment != nil)
 	{
@@ -490,6 +490,7 @@ static NSTimeInterval	time_last_frame;
 		[self doScriptEvent:OOJSID("playerStartedJumpCountdown")
 					withArguments:[NSArray arrayWithObjects:@"standard", [NSNumber numberWithFloat:witchspaceCountdown], nil]];
 		[UNIVERSE preloadPlanetTexturesForSystem:target_system_seed];
+		[UNIVERSE prefetchSystem:target_system_seed];
 	}
 }
 
@@ -507,6 +508,7 @@ static NSTimeInterval	time_last_frame;
 	if ([self status] == STATUS_WITCHSPACE_COUNTDOWN) {
 		[self setStatus:STATUS_IN_FLIGHT];
 		[self playHyperspaceAborted];
+		[UNIVERSE cancelSystemPrefetch];
 	}
 	// say it!
 	[UNIVERSE clearPreviousMessage];
@@ -67,11 +67,21 @@ typedef enum
 // Test (sanitized) legacy script conditions array.
 - (BOOL) scriptTestConditions:(NSArray *)array;
 
-- (NSDictionary*) missionVariables;
+/*	Mission variables are stored typed: values are either NSStrings or
+	NSNumbers (doubles). Legacy scripts, string expansion and saved games see
+	only strings; numbers are converted lazily, using JavaScript number
+	formatting so the string form is the same as when everything was stored
+	as strings.
+*/
+- (NSDictionary*) missionVariables;					// Values are NSString or NSNumber.
+- (NSDictionary *) missionVariablesPropertyList;	// All values converted to strings, for saved games.
 
 - (NSString *)missionVariableForKey:(NSString *)key;
 - (void)setMissionVariable:(NSString *)value forKey:(NSString *)key;
 
+- (id) missionVariableValueForKey:(NSString *)key;
+- (void) setMissionVariableValue:(id)value forKey:(NSString *)key;	// value must be NSString, NSNumber or nil.
+
 - (NSMutableDictionary *)localVariablesForMission:(NSString *)missionKey;
 - (NSString *)localVariableForKey:(NSString *)variableName andMission:(NSString *)missionKey;
 - (void)setLocalVariable:(NSString *)value forKey:(NSString *)variableName andMission:(NSString *)missionKey;
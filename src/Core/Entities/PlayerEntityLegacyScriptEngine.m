@@ -48,6 +48,7 @@ MA 02110-1301, USA.
 #import "Comparison.h"
 #import "OOLegacyScriptWhitelist.h"
 #import "OOJavaScriptEngine.h"
+#import "OOJSMissionVariables.h"
 #import "OOEquipmentType.h"
 #import "HeadUpDisplay.h"
 
@@ -241,6 +242,37 @@ static void PerformActionStatment(NSArray *statement, Entity *target)
 }
 
 
+/*	Selectors named in sanitized conditions, which are whitelisted when
+	they're sanitized. Kept at run time only, since the conditions themselves
+	are cached on disk and a SEL means nothing in another process.
+*/
+static SEL ConditionSelector(NSString *selectorString)
+{
+	static NSMapTable *selectorCache = NULL;
+	SEL selector = NULL;
+	
+	if (selectorCache != NULL)
+	{
+		selector = NSMapGet(selectorCache, selectorString);
+	}
+	
+	if (selector == NULL)
+	{
+		selector = NSSelectorFromString(selectorString);
+		if (selector != NULL)
+		{
+			if (selectorCache == NULL)
+			{
+				selectorCache = NSCreateMapTable(NSObjectMapKeyCallBacks, NSNonOwnedPointerMapValueCallBacks, 64);
+			}
+			NSMapInsertKnownAbsent(selectorCache, selectorString, selector);
+		}
+	}
+	
+	return selector;
+}
+
+
 static BOOL TestScriptConditions(NSArray *conditions)
 {
 	NSEnumerator			*condEnum = nil;
@@ -452,6 +484,10 @@ static BOOL sRunningScript = NO;
 		The special opType OP_FALSE doesn't require any other elements in the
 		array. All other valid opTypes require the array to have five elements.
 		
+		Conditions from the sanitizer may also have a pre-expanded right-hand
+		side; see OOLegacyScriptWhitelist.h. It is used if present. Selectors
+		are looked up through a run-time cache.
+		
 		For performance reasons, this method assumes the script condition will
 		have been generated by OOSanitizeLegacyScriptConditions() and doesn't
 		perform extensive validity checks.
@@ -462,6 +498,9 @@ static BOOL sRunningScript = NO;
 	SEL							selector = NULL;
 	OOComparisonType			comparator;
 	NSArray						*operandArray = nil;
+	NSArray						*oneOfItems = nil;
+	id							precompiled = nil;
+	NSUInteger					conditionCount;
 	NSString					*lhsString = nil;
 	NSString					*expandedRHS = nil;
 	NSArray						*rhsComponents = nil;
@@ -477,11 +516,12 @@ static BOOL sRunningScript = NO;
 	selectorString = [scriptCondition oo_stringAtIndex:2];
 	comparator = [scriptCondition oo_unsignedIntAtIndex:3];
 	operandArray = [scriptCondition oo_arrayAtIndex:4];
+	conditionCount = [scriptCondition count];
 	
 	// Transform mission/local var ops into string ops.
 	if (opType == OP_MISSION_VAR)
 	{
-		sMissionStringValue = [mission_variables objectForKey:selectorString];
+		sMissionStringValue = [self missionVariableForKey:selectorString];
 		selector = @selector(mission_string);
 		opType = OP_STRING;
 	}
@@ -493,10 +533,19 @@ static BOOL sRunningScript = NO;
 	}
 	else
 	{
-		selector = NSSelectorFromString(selectorString);
+		selector = ConditionSelector(selectorString);
 	}
 	
-	expandedRHS = [self expandScriptRightHandSide:operandArray];
+	precompiled = (conditionCount > 5) ? [scriptCondition objectAtIndex:5] : nil;
+	if ([precompiled isKindOfClass:[NSString class]])
+	{
+		expandedRHS = precompiled;
+		if (conditionCount > 6)  oneOfItems = [scriptCondition oo_arrayAtIndex:6];
+	}
+	else
+	{
+		expandedRHS = [self expandScriptRightHandSide:operandArray];
+	}
 	
 	if (opType == OP_STRING)
 	{
@@ -523,12 +572,17 @@ static BOOL sRunningScript = NO;
 				
 			case COMPARISON_ONEOF:
 				{
-					rhsComponents = [expandedRHS componentsSeparatedByString:@","];
-					count = [rhsComponents count];
-					
 					whitespace = [NSCharacterSet whitespaceCharacterSet];
 					lhsString = [lhsString stringByTrimmingCharactersInSet:whitespace];
 					
+					if (oneOfItems != nil)
+					{
+						return [oneOfItems containsObject:lhsString];
+					}
+					
+					rhsComponents = [expandedRHS componentsSeparatedByString:@","];
+					count = [rhsComponents count];
+					
 					for (i = 0; i < count; i++)
 					{
 						rhsItem = [[rhsComponents objectAtIndex:i] stringByTrimmingCharactersInSet:whitespace];
@@ -547,7 +601,7 @@ static BOOL sRunningScript = NO;
 		
 		if (comparator == COMPARISON_ONEOF)
 		{
-			rhsComponents = [expandedRHS componentsSeparatedByString:@","];
+			rhsComponents = (oneOfItems != nil) ? oneOfItems : [expandedRHS componentsSeparatedByString:@","];
 			count = [rhsComponents count];
 			
 			for (i = 0; i < count; i++)
@@ -659,16 +713,48 @@ static BOOL sRunningScript = NO;
 }
 
 
+- (NSDictionary *) missionVariablesPropertyList
+{
+	NSMutableDictionary		*result = nil;
+	NSEnumerator			*keyEnum = nil;
+	NSString				*key = nil;
+	
+	result = [NSMutableDictionary dictionaryWithCapacity:[mission_variables count]];
+	for (keyEnum = [mission_variables keyEnumerator]; (key = [keyEnum nextObject]); )
+	{
+		[result setObject:[self missionVariableForKey:key] forKey:key];
+	}
+	
+	return result;
+}
+
+
 - (NSString *)missionVariableForKey:(NSString *)key
 {
-	NSString *result = nil;
+	id result = nil;
 	if (key != nil)  result = [mission_variables objectForKey:key];
+	if ([result isKindOfClass:[NSNumber class]])  result = OOJSMissionVariableStringFromNumber([result doubleValue]);
 	return result;
 }
 
 
 - (void)setMissionVariable:(NSString *)value forKey:(NSString *)key
 {
+	[self setMissionVariableValue:value forKey:key];
+}
+
+
+- (id) missionVariableValueForKey:(NSString *)key
+{
+	if (key == nil)  return nil;
+	return [mission_variables objectForKey:key];
+}
+
+
+- (void) setMissionVariableValue:(id)value forKey:(NSString *)key
+{
+	NSParameterAssert(value == nil || [value isKindOfClass:[NSString class]] || [value isKindOfClass:[NSNumber class]]);
+	
 	if (key != nil)
 	{
 		if (value != nil)  [mission_variables setObject:value forKey:key];
@@ -746,6 +832,7 @@ static BOOL sRunningScript = NO;
 	NSMutableDictionary	*locals = [self localVariablesForMission:sCurrentMissionKey];
 	NSMutableString		*resultString = [NSMutableString stringWithString: args];
 	NSString			*valueString;
+	NSString			*missionValue = nil;
 	unsigned			i;
 	NSMutableArray		*tokens = ScanTokensFromString(args);
 	
@@ -753,9 +840,9 @@ static BOOL sRunningScript = NO;
 	{
 		valueString = [tokens objectAtIndex:i];
 		
-		if ([valueString hasPrefix:@"mission_"] && [mission_variables objectForKey:valueString])
+		if ([valueString hasPrefix:@"mission_"] && (missionValue = [self missionVariableForKey:valueString]))
 		{
-			[resultString replaceOccurrencesOfString:valueString withString:[mission_variables objectForKey:valueString] options:NSLiteralSearch range:NSMakeRange(0, [resultString length])];
+			[resultString replaceOccurrencesOfString:valueString withString:missionValue options:NSLiteralSearch range:NSMakeRange(0, [resultString length])];
 		}
 		else if ([locals objectForKey:valueString])
 		{
@@ -414,6 +414,7 @@ typedef enum
 	NSString				*_shipKey;
 	
 	NSMutableSet			*_equipment;
+	NSUInteger				_equipmentGeneration;		// Incremented whenever _equipment changes.
 	float					_heatInsulation;
 	
 	OOWeakReference			*_lastAegisLock;			// remember last aegis planet/sun
@@ -460,6 +461,12 @@ typedef enum
 - (OOMesh *)mesh;
 - (void)setMesh:(OOMesh *)mesh;
 
+/*	The mesh to draw if this ship can be drawn as part of an instanced batch
+	instead of through -drawImmediate:translucent:, otherwise nil. Does not
+	include culling; see -isInDrawRange.
+*/
+- (OOMesh *) meshForInstancedDrawing;
+
 - (BoundingBox) totalBoundingBox;
 
 - (Vector) forwardVector;
@@ -561,6 +568,7 @@ typedef enum
 
 - (NSEnumerator *) equipmentEnumerator;
 - (NSUInteger) equipmentCount;
+- (NSUInteger) equipmentGeneration;	// Changes whenever equipment is added or removed, for caching equipment checks.
 - (void) removeEquipmentItem:(NSString *)equipmentKey;
 - (void) removeAllEquipment;
 - (OOEquipmentType *) selectMissile;
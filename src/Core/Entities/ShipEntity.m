@@ -1043,6 +1043,20 @@ static ShipEntity *doOctreesCollide(ShipEntity *prime, ShipEntity *other);
 }
 
 
+- (OOMesh *) meshForInstancedDrawing
+{
+	// Anything drawn by -drawImmediate:translucent: beyond the mesh itself rules out batching.
+	if ([self isPlayer] || [self isSubEntity] || [self subEntityCount] > 0 || cloaking_device_active)  return nil;
+#ifndef NDEBUG
+	if (gDebugFlags & DEBUG_BOUNDING_BOXES)  return nil;
+#endif
+	
+	OOMesh *mesh = [self mesh];
+	if (![mesh isKindOfClass:[OOMesh class]] || [mesh instancingKey] == nil)  return nil;
+	return mesh;
+}
+
+
 - (void)setMesh:(OOMesh *)mesh
 {
 	if (mesh != [self mesh])
@@ -2984,6 +2998,7 @@ ShipEntity* doOctreesCollide(ShipEntity* prime, ShipEntity* other)
 		if ([_equipment containsObject:damagedKey])
 		{
 			[_equipment removeObject:damagedKey];
+			_equipmentGeneration++;
 			isRepairedEquipment = YES;
 		}
 	}
@@ -3046,6 +3061,7 @@ ShipEntity* doOctreesCollide(ShipEntity* prime, ShipEntity* other)
 	}
 	// add the equipment
 	[_equipment addObject:equipmentKey];
+	_equipmentGeneration++;
 	return YES;
 }
 
@@ -3062,6 +3078,12 @@ ShipEntity* doOctreesCollide(ShipEntity* prime, ShipEntity* other)
 }
 
 
+- (NSUInteger) equipmentGeneration
+{
+	return _equipmentGeneration;
+}
+
+
 - (void) removeEquipmentItem:(NSString *)equipmentKey
 {
 	NSString		*equipmentTypeCheckKey = equipmentKey;
@@ -3112,6 +3134,7 @@ ShipEntity* doOctreesCollide(ShipEntity* prime, ShipEntity* other)
 		}
 		
 		[_equipment removeObject:equipmentKey];
+		_equipmentGeneration++;
 		if ([_equipment count] == 0)  [self removeAllEquipment];
 		if (!isPlayer)
 		{
@@ -3302,6 +3325,7 @@ ShipEntity* doOctreesCollide(ShipEntity* prime, ShipEntity* other)
 {
 	[_equipment release];
 	_equipment = nil;
+	_equipmentGeneration++;
 }
 
 
@@ -701,7 +701,7 @@ static void DrawWormholeCorona(GLfloat inner_radius, GLfloat outer_radius, int s
 		
 		OOSetOpenGLState(OPENGL_STATE_TRANSLUCENT_PASS);
 		OOGL(glDisable(GL_CULL_FACE));
-		OOGL(glEnable(GL_BLEND));
+		OOGLSetBlending(true);
 		
 		OOGL(glColor4fv(color_fv));
 		OOGLBEGIN(GL_TRIANGLE_FAN);
@@ -711,7 +711,7 @@ static void DrawWormholeCorona(GLfloat inner_radius, GLfloat outer_radius, int s
 		DrawWormholeCorona(0.67 * collision_radius, collision_radius, 4, srzd, color_fv);
 					
 		OOGL(glEnable(GL_CULL_FACE));
-		OOGL(glDisable(GL_BLEND));
+		OOGLSetBlending(false);
 	}
 	
 	OOVerifyOpenGLState();
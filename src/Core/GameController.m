@@ -37,6 +37,8 @@ MA 02110-1301, USA.
 #import "OOLogOutputHandler.h"
 #import "OODebugFlags.h"
 #import "OOJSFrameCallbacks.h"
+#import "OOJSEngineTimeManagement.h"
+#import "OOJavaScriptEngine.h"
 #import "OOOpenGLExtensionManager.h"
 
 #define kOOLogUnconvertedNSLog @"unclassified.GameController"
@@ -336,6 +338,8 @@ static GameController *sSharedController = nil;
 			[OOSound update];
 			OOJSFrameCallbacksInvoke(delta_t);
 		}
+		OOJSUpdateScriptCostAccounting();
+		[[OOJavaScriptEngine sharedEngine] updateGarbageCollectionScheduleForPausedGame:gameIsPaused];
 	}
 	@catch (id exception) 
 	{
@@ -120,6 +120,8 @@ typedef OOGUITabStop OOGUITabSettings[GUI_MAX_COLUMNS];
 	GLfloat					fade_sign;			//	-1.0 to 1.0
 	NSUInteger				statusPage; 		// status  screen: paging equipped items
 	OOSystemID				foundSystem;
+	
+	struct OOGalaxyChartGeometry	*chartGeometry;	// Cached long range chart stars and jump links.
 }
 
 - (id) init;
@@ -36,6 +36,23 @@ MA 02110-1301, USA.
 #import "OOCollectionExtractors.h"
 #import "OOTexture.h"
 #import "OOJavaScriptEngine.h"
+#import "OOVertexBufferArena.h"
+#import "OOOpenGLExtensionManager.h"
+
+
+/*	Long range chart geometry that only depends on the galaxy and the chart
+	layout: links between systems within jump range (GL_LINES), followed by
+	the star diamonds (GL_QUADS), as x, y pairs relative to the chart origin.
+*/
+struct OOGalaxyChartGeometry
+{
+	Random_Seed					galaxySeed;
+	GLfloat						hscale, vscale, voffset;
+	GLfloat						*vertices;
+	GLsizei						linkVertexCount;
+	GLsizei						starVertexCount;
+	OOVertexBufferAllocation	buffer;
+};
 
 
 OOINLINE BOOL RowInRange(OOGUIRow row, NSRange range)
@@ -57,6 +74,10 @@ OOINLINE BOOL RowInRange(OOGUIRow row, NSRange range)
 - (void) drawEquipmentList:(NSArray *)eqptList z:(GLfloat)z;
 - (void) drawAdvancedNavArrayAtX:(float)x y:(float)y z:(float)z alpha:(float)alpha usingRoute:(NSDictionary *) route optimizedBy:(OORouteType) optimizeBy;
 
+- (void) updateGalaxyChartGeometry;
+- (void) drawGalaxyChartGeometryMode:(GLenum)mode first:(GLsizei)first count:(GLsizei)count x:(GLfloat)x y:(GLfloat)y z:(GLfloat)z;
+- (void) releaseGalaxyChartGeometry;
+
 @end
 
 
@@ -173,6 +194,7 @@ static BOOL _refreshStarChart = NO;
 	[rowText release];
 	[rowKey release];
 	[rowColor release];
+	[self releaseGalaxyChartGeometry];
 	
 	[super dealloc];
 }
@@ -1145,6 +1167,7 @@ static OOTextureSprite *NewTextureSpriteWithDescriptor(NSDictionary *descriptor)
 
 	if (statusPage == 1 || statusPage == pageCount) itemsPerColumn++;
 	eqptCount = (NSInteger)OOClampInteger(eqptCount, 1, start + itemsPerColumn * 2);
+	OOBeginTextBatch();
 	for (i = start; i < eqptCount; i++)
 	{
 		info = [eqptList oo_arrayAtIndex:i];
@@ -1164,6 +1187,7 @@ static OOTextureSprite *NewTextureSpriteWithDescriptor(NSDictionary *descriptor)
 			OODrawString(name, 50, firstY - 16 * (NSInteger)(i - itemsPerColumn - start), z, NSMakeSize(15, 15));
 		}
 	}
+	OOEndTextBatch();
 }
 
 
@@ -1305,6 +1329,9 @@ static OOTextureSprite *NewTextureSpriteWithDescriptor(NSDictionary *descriptor)
 	////
 	// drawing operations here
 	
+	// Row highlights and the text cursor don't overlap text, so all text can be drawn at the end.
+	OOBeginTextBatch();
+	
 	if (title != nil)
 	{
 		//
@@ -1464,6 +1491,7 @@ static OOTextureSprite *NewTextureSpriteWithDescriptor(NSDictionary *descriptor)
 		}
 	}
 	
+	OOEndTextBatch();
 	[OOTexture applyNone];
 }
 
@@ -1557,7 +1585,7 @@ static OOTextureSprite *NewTextureSpriteWithDescriptor(NSDictionary *descriptor)
 	
 	// draw names
 	//
-	// Cache nearby systems so that [UNIVERSE generateSystemData:] does not get called on every frame
+	// Cache nearby systems so that [UNIVERSE systemSummaryForSystem:] does not get called on every frame
 	// Caching code submitted by Y A J, 20091022
 	
 	static Random_Seed saved_galaxy_seed;
@@ -1591,20 +1619,20 @@ static OOTextureSprite *NewTextureSpriteWithDescriptor(NSDictionary *descriptor)
 		
 			if ((dx < 20)&&(dy < 38))
 			{
-				NSDictionary* sys_info = [UNIVERSE generateSystemData:g_seed];
-				if (EXPECT_NOT([sys_info oo_boolForKey:@"sun_gone_nova"]))
+				OOSystemSummary summary = [UNIVERSE systemSummaryForSystem:i];
+				if (EXPECT_NOT(summary.sunGoneNova))
 				{
 					nearby_systems[ num_nearby_systems ].gov = -1;	// Flag up nova systems!
 				}
 				else
 				{
-					nearby_systems[ num_nearby_systems ].tec = [sys_info oo_intForKey:KEY_TECHLEVEL];
-					nearby_systems[ num_nearby_systems ].eco = [sys_info oo_intForKey:KEY_ECONOMY];
-					nearby_systems[ num_nearby_systems ].gov = [sys_info oo_intForKey:KEY_GOVERNMENT];
+					nearby_systems[ num_nearby_systems ].tec = (int)summary.techLevel;
+					nearby_systems[ num_nearby_systems ].eco = summary.economy;
+					nearby_systems[ num_nearby_systems ].gov = summary.government;
 				}
 				nearby_systems[ num_nearby_systems ].seed_d = g_seed.d;
 				nearby_systems[ num_nearby_systems ].seed_b = g_seed.b;
-				nearby_systems[ num_nearby_systems ].p_name = [[sys_info oo_stringForKey:KEY_NAME] retain];
+				nearby_systems[ num_nearby_systems ].p_name = [summary.name retain];
 				num_nearby_systems++;
 			}
 		}
@@ -1621,6 +1649,7 @@ static OOTextureSprite *NewTextureSpriteWithDescriptor(NSDictionary *descriptor)
 	struct saved_system *sys;
 	NSSize chSize = NSMakeSize(pixel_row_height,pixel_row_height);
 	
+	OOBeginTextBatch();
 	for (i = 0; i < num_nearby_systems; i++)
 	{
 		sys = nearby_systems + i;
@@ -1642,6 +1671,7 @@ static OOTextureSprite *NewTextureSpriteWithDescriptor(NSDictionary *descriptor)
 			OODrawPlanetInfo(sys->gov, sys->eco, sys->tec, x + star.x + 2.0, y + star.y + 2.0, z, chSize);
 		}
 	}
+	OOEndTextBatch();
 	
 	// highlight the name of the currently selected system
 	//
@@ -1924,23 +1954,9 @@ static OOTextureSprite *NewTextureSpriteWithDescriptor(NSDictionary *descriptor)
 	
 	// draw stars
 	//
+	[self updateGalaxyChartGeometry];
 	OOGL(glColor4f(1.0f, 1.0f, 1.0f, alpha));
-	OOGLBEGIN(GL_QUADS);
-	for (i = 0; i < 256; i++)
-	{
-		g_seed = [UNIVERSE systemSeedForSystemNumber:i];
-		
-		star.x = (float)(g_seed.d * hscale + hoffset);
-		star.y = (float)(g_seed.b * vscale + voffset);
-		
-		float sz = (4.0f + 0.5f * (0x03 | (g_seed.f & 0x0f))) / 7.0f;
-		
-		glVertex3f(x + star.x, y + star.y + sz, z);
-		glVertex3f(x + star.x + sz,	y + star.y, z);
-		glVertex3f(x + star.x, y + star.y - sz, z);
-		glVertex3f(x + star.x - sz,	y + star.y, z);
-	}
-	OOGLEND();
+	[self drawGalaxyChartGeometryMode:GL_QUADS first:chartGeometry->linkVertexCount count:chartGeometry->starVertexCount x:x y:y z:z];
 		
 	// draw found stars and captions
 	//
@@ -2008,34 +2024,17 @@ static OOTextureSprite *NewTextureSpriteWithDescriptor(NSDictionary *descriptor)
 - (void) drawAdvancedNavArrayAtX:(float)x y:(float)y z:(float)z alpha:(float)alpha usingRoute:(NSDictionary *) routeInfo optimizedBy:(OORouteType) optimizeBy
 {
 	Random_Seed		g_seed, g_seed2;
-	NSUInteger		i, j;
+	NSUInteger		i;
 	double			hscale = size_in_pixels.width / 256.0;
 	double			vscale = -1.0 * size_in_pixels.height / 512.0;
 	double			hoffset = 0.0f;
 	double			voffset = size_in_pixels.height - pixel_title_size.height - 5;
 	NSPoint			star, star2 = NSZeroPoint;
 	
+	// the links between systems in jump range only change with the galaxy, so they're cached.
+	[self updateGalaxyChartGeometry];
 	OOGL(glColor4f(0.25f, 0.25f, 0.25f, alpha));
-	
-	OOGLBEGIN(GL_LINES);
-	for (i = 0; i < 256; i++) for (j = i + 1; j < 256; j++)
-	{
-		g_seed = [UNIVERSE systemSeedForSystemNumber:i];
-		g_seed2 = [UNIVERSE systemSeedForSystemNumber:j];
-		
-		star.x = (float)(g_seed.d * hscale + hoffset);
-		star.y = (float)(g_seed.b * vscale + voffset);
-		star2.x = (float)(g_seed2.d * hscale + hoffset);
-		star2.y = (float)(g_seed2.b * vscale + voffset);
-		double d = distanceBetweenPlanetPositions(g_seed.d, g_seed.b, g_seed2.d, g_seed2.b);
-		
-		if (d <= MAX_JUMP_RANGE)	// another_commander - Default to 7.0 LY.
-		{
-			glVertex3f(x+star.x, y+star.y, z);
-			glVertex3f(x+star2.x, y+star2.y, z);
-		}
-	}
-	OOGLEND();
+	[self drawGalaxyChartGeometryMode:GL_LINES first:0 count:chartGeometry->linkVertexCount x:x y:y z:z];
 	
 	if (routeInfo)
 	{
@@ -2075,4 +2074,132 @@ static OOTextureSprite *NewTextureSpriteWithDescriptor(NSDictionary *descriptor)
 	}
 }
 
+
+- (void) updateGalaxyChartGeometry
+{
+	Random_Seed		galaxySeed = [PLAYER galaxy_seed];
+	GLfloat			hscale = size_in_pixels.width / 256.0;
+	GLfloat			vscale = -1.0 * size_in_pixels.height / 512.0;
+	GLfloat			voffset = size_in_pixels.height - pixel_title_size.height - 5;
+	
+	if (chartGeometry != NULL &&
+		equal_seeds(chartGeometry->galaxySeed, galaxySeed) &&
+		chartGeometry->hscale == hscale &&
+		chartGeometry->vscale == vscale &&
+		chartGeometry->voffset == voffset)
+	{
+		return;
+	}
+	
+	[self releaseGalaxyChartGeometry];
+	
+	Random_Seed		seeds[256];
+	GLfloat			starX[256], starY[256];
+	OOSystemID		i, j;
+	NSUInteger		linkCount = 0;
+	
+	for (i = 0; i < 256; i++)
+	{
+		seeds[i] = [UNIVERSE systemSeedForSystemNumber:i];
+		starX[i] = seeds[i].d * hscale;
+		starY[i] = seeds[i].b * vscale + voffset;
+	}
+	
+	// count first, so the vertices can go in one allocation.
+	for (i = 0; i < 256; i++) for (j = i + 1; j < 256; j++)
+	{
+		if (distanceBetweenPlanetPositions(seeds[i].d, seeds[i].b, seeds[j].d, seeds[j].b) <= MAX_JUMP_RANGE)  linkCount++;	// another_commander - Default to 7.0 LY.
+	}
+	
+	GLsizei linkVertexCount = linkCount * 2;
+	GLsizei starVertexCount = 256 * 4;
+	GLfloat *vertices = malloc(sizeof *vertices * 2 * (linkVertexCount + starVertexCount));
+	chartGeometry = calloc(1, sizeof *chartGeometry);
+	if (vertices == NULL || chartGeometry == NULL)
+	{
+		free(vertices);
+		free(chartGeometry);
+		chartGeometry = NULL;
+		[NSException raise:NSMallocException format:@"Failed to allocate galaxy chart geometry."];
+	}
+	
+	GLfloat *v = vertices;
+	for (i = 0; i < 256; i++) for (j = i + 1; j < 256; j++)
+	{
+		if (distanceBetweenPlanetPositions(seeds[i].d, seeds[i].b, seeds[j].d, seeds[j].b) <= MAX_JUMP_RANGE)
+		{
+			*v++ = starX[i];	*v++ = starY[i];
+			*v++ = starX[j];	*v++ = starY[j];
+		}
+	}
+	for (i = 0; i < 256; i++)
+	{
+		GLfloat sz = (4.0f + 0.5f * (0x03 | (seeds[i].f & 0x0f))) / 7.0f;
+		
+		*v++ = starX[i];		*v++ = starY[i] + sz;
+		*v++ = starX[i] + sz;	*v++ = starY[i];
+		*v++ = starX[i];		*v++ = starY[i] - sz;
+		*v++ = starX[i] - sz;	*v++ = starY[i];
+	}
+	
+	chartGeometry->galaxySeed = galaxySeed;
+	chartGeometry->hscale = hscale;
+	chartGeometry->vscale = vscale;
+	chartGeometry->voffset = voffset;
+	chartGeometry->vertices = vertices;
+	chartGeometry->linkVertexCount = linkVertexCount;
+	chartGeometry->starVertexCount = starVertexCount;
+}
+
+
+- (void) drawGalaxyChartGeometryMode:(GLenum)mode first:(GLsizei)first count:(GLsizei)count x:(GLfloat)x y:(GLfloat)y z:(GLfloat)z
+{
+	NSParameterAssert(chartGeometry != NULL);
+	
+	if (count == 0)  return;
+	
+	OO_ENTER_OPENGL();
+	const GLvoid *pointer = chartGeometry->vertices;
+	
+#if OO_USE_VBO
+	OOVertexBufferArena *arena = [OOVertexBufferArena sharedArena];
+	BOOL usingVertexBuffer = [arena allocationIsValid:&chartGeometry->buffer];
+	if (!usingVertexBuffer)
+	{
+		size_t size = sizeof *chartGeometry->vertices * 2 * (chartGeometry->linkVertexCount + chartGeometry->starVertexCount);
+		usingVertexBuffer = [arena allocateSize:size withData:chartGeometry->vertices allocation:&chartGeometry->buffer];
+	}
+	if (usingVertexBuffer)
+	{
+		OOGL(glBindBufferARB(GL_ARRAY_BUFFER, chartGeometry->buffer.buffer));
+		pointer = (const char *)NULL + chartGeometry->buffer.offset;
+	}
+#endif
+	
+	OOGL(glPushMatrix());
+	OOGL(glTranslatef(x, y, z));
+	
+	OOGLEnableClientState(GL_VERTEX_ARRAY);
+	OOGL(glVertexPointer(2, GL_FLOAT, 0, pointer));
+	OOGL(glDrawArrays(mode, first, count));
+	OOGLDisableClientState(GL_VERTEX_ARRAY);
+	
+	OOGL(glPopMatrix());
+	
+#if OO_USE_VBO
+	if (usingVertexBuffer)  OOGL(glBindBufferARB(GL_ARRAY_BUFFER, 0));
+#endif
+}
+
+
+- (void) releaseGalaxyChartGeometry
+{
+	if (chartGeometry == NULL)  return;
+	
+	[[OOVertexBufferArena sharedArena] freeAllocation:&chartGeometry->buffer];
+	free(chartGeometry->vertices);
+	free(chartGeometry);
+	chartGeometry = NULL;
+}
+
 @end
@@ -202,8 +202,15 @@ MA 02110-1301, USA.
 @interface HeadUpDisplay: NSObject
 {
 @private
-	NSMutableArray		*legendArray;
-	NSMutableArray		*dialArray;
+	// Compiled from hud.plist when the HUD is loaded; see struct OOHUDItem.
+	struct OOHUDItem	*_legends;
+	NSUInteger			_legendCount;
+	NSUInteger			_legendCapacity;
+	struct OOHUDItem	*_dials;
+	NSUInteger			_dialCount;
+	NSUInteger			_dialCapacity;
+	
+	OOTimeDelta			_lastRenderTime;
 	
 	// zoom level
 	GLfloat				scanner_zoom;
@@ -276,6 +283,9 @@ MA 02110-1301, USA.
 
 - (void) renderHUD;
 
+// Time spent in the most recent -renderHUD, for comparing HUD configurations.
+- (OOTimeDelta) lastRenderTime;
+
 - (void) refreshLastTransmitter;
 
 - (void) setLineWidth:(GLfloat)value;
@@ -318,3 +328,12 @@ void OODrawPlanetInfo(int gov, int eco, int tec, GLfloat x, GLfloat y, GLfloat z
 void OODrawHilightedPlanetInfo(int gov, int eco, int tec, GLfloat x, GLfloat y, GLfloat z, NSSize siz);
 NSRect OORectFromString(NSString *text, GLfloat x, GLfloat y, NSSize siz);
 CGFloat OOStringWidthInEm(NSString *text);
+
+/*	Text drawn between OOBeginTextBatch() and OOEndTextBatch() is collected,
+	with the colour current at the time of each call, and drawn with a single
+	call at the end. Other drawing done in between is not deferred, so batched
+	text ends up on top of it. The modelview matrix must not change inside a
+	batch. Batches may be nested; only the outermost end draws.
+*/
+void OOBeginTextBatch(void);
+void OOEndTextBatch(void);
@@ -35,10 +35,17 @@ MA 02110-1301, USA.
 #import "OOColor.h"
 #import "GuiDisplayGen.h"
 #import "OOTexture.h"
+#import "OOMesh.h"
+#import "OORenderQueue.h"
+#import "OOShaderUniform.h"
+#import "OOEffectBatch.h"
+#import "OOQualityController.h"
 #import "OOTextureSprite.h"
 #import "OOPolygonSprite.h"
 #import "OOCollectionExtractors.h"
 #import "OOEncodingConverter.h"
+#import "OOCache.h"
+#import "OOProfilingStopwatch.h"
 #import "OOCrosshairs.h"
 #import "OOConstToString.h"
 #import "OOStringParsing.h"
@@ -57,18 +64,46 @@ MA 02110-1301, USA.
 
 
 #define NOT_DEFINED					INFINITY
-#define WIDGET_INFO					0
-#define WIDGET_CACHE				1
-#define	WIDGET_SELECTOR				2
+
+
+enum
+{
+	// Which parts of CachedInfo.color were specified by hud.plist.
+	kCachedColorRGB				= 1 << 0,
+	kCachedColorAlpha			= 1 << 1
+};
 
 
 struct CachedInfo
 {
 	float x, y, x0, y0;
 	float width, height, alpha;
+	GLfloat color[4];
+	uint8_t colorFlags;
 };
 
-static NSArray *sCurrentDrawItem;
+
+/*	A dial or legend from hud.plist, compiled when the HUD is loaded so that
+	drawing doesn't need to parse the info dictionary or look up selectors
+	every frame. The equipment requirement is rechecked only when the
+	player's equipment generation changes.
+*/
+typedef void (*OOHUDDrawIMP)(id self, SEL _cmd, NSDictionary *info);
+
+struct OOHUDItem
+{
+	NSDictionary		*info;
+	SEL					selector;		// Dials only.
+	OOHUDDrawIMP		draw;			// Dials only.
+	NSString			*equipmentRequired;
+	NSUInteger			equipmentGeneration;
+	BOOL				hasEquipment;
+	BOOL				equipmentCacheable;
+	struct CachedInfo	cache;
+};
+typedef struct OOHUDItem OOHUDItem;
+
+static const OOHUDItem *sCurrentDrawItem;
 static unsigned sEnergyBanks;
 
 OOINLINE float useDefined(float val, float validVal) 
@@ -79,7 +114,7 @@ OOINLINE float useDefined(float val, float validVal)
 
 static void DrawSpecialOval(GLfloat x, GLfloat y, GLfloat z, NSSize siz, GLfloat step, GLfloat* color4v);
 
-static void GetRGBAArrayFromInfo(NSDictionary *info, GLfloat ioColor[4]);
+static void GetRGBAArrayFromCache(const struct CachedInfo *cached, GLfloat ioColor[4]);
 
 static void hudDrawIndicatorAt(GLfloat x, GLfloat y, GLfloat z, NSSize siz, GLfloat amount);
 static void hudDrawMarkerAt(GLfloat x, GLfloat y, GLfloat z, NSSize siz, GLfloat amount);
@@ -94,6 +129,73 @@ static OOTexture			*sFontTexture = nil;
 static OOEncodingConverter	*sEncodingCoverter = nil;
 
 
+/*	Text layout and batching.
+	
+	Strings are laid out once at unit size and cached by content, so drawing
+	one only costs a multiply-add per vertex. Glyph quads are collected in a
+	vertex array and drawn with one glDrawArrays() per string, or per batch
+	(see OOBeginTextBatch()).
+*/
+typedef struct
+{
+	GLfloat				x;			// In units of character width.
+	GLfloat				y;			// In units of character height.
+	uint8_t				chr;
+} OOGlyphPlacement;
+
+
+typedef struct
+{
+	GLfloat				x, y, z;
+	GLfloat				s, t;
+	GLfloat				color[4];
+} OOTextVertex;
+
+
+typedef struct
+{
+	GLfloat				x, y, z;
+	GLfloat				color[4];
+} OOScannerVertex;
+
+
+@interface OOTextLayout: NSObject
+{
+@private
+	OOGlyphPlacement	*_glyphs;
+	NSUInteger			_count;
+	GLfloat				_width;
+}
+
+- (id) initWithEncodedString:(NSData *)data;
+
+- (NSUInteger) glyphCount;
+- (const OOGlyphPlacement *) glyphs;
+- (GLfloat) width;		// In units of character width.
+
+@end
+
+
+enum
+{
+	kTextLayoutCacheSize		= 300,		// Shipyard and market screens use well over 100 strings.
+	kMinTextVertexCapacity		= 1024,
+	kMinScannerVertexCapacity	= 256
+};
+
+
+static OOCache				*sTextLayoutCache = nil;
+static OOTextVertex			*sTextVertices = NULL;
+static NSUInteger			sTextVertexCount = 0;
+static NSUInteger			sTextVertexCapacity = 0;
+static unsigned				sTextBatchDepth = 0;
+
+// Scanner blips are queued while walking the scanner neighbourhood and drawn together.
+static OOScannerVertex		*sScannerVertices = NULL;
+static NSUInteger			sScannerVertexCount = 0;
+static NSUInteger			sScannerVertexCapacity = 0;
+
+
 enum
 {
 	kFontTextureOptions = kOOTextureMinFilterMipMap | kOOTextureMagFilterLinear | kOOTextureNoShrink | kOOTextureAlphaMask
@@ -107,7 +209,6 @@ enum
 - (void) drawDials;
 
 - (void) drawLegend:(NSDictionary *)info;
-- (void) drawHUDItem:(NSDictionary *)info;
 
 - (void) drawScanner:(NSDictionary *)info;
 - (void) drawScannerZoomIndicator:(NSDictionary *)info;
@@ -177,8 +278,18 @@ static BOOL 	hostiles;
 static GLfloat drawCharacterQuad(uint8_t chr, GLfloat x, GLfloat y, GLfloat z, NSSize siz);
 
 static void InitTextEngine(void);
+static OOTextLayout *LayoutForString(NSString *text);
+static void AppendGlyph(uint8_t chr, GLfloat x, GLfloat y, GLfloat z, NSSize siz, const GLfloat color[4]);
+static void AppendTextLayout(OOTextLayout *layout, GLfloat x, GLfloat y, GLfloat z, NSSize siz, const GLfloat color[4]);
+static void FlushText(BOOL useColors);
+
+static void AppendScannerVertex(GLfloat x, GLfloat y, GLfloat z, const GLfloat color[4]);
+static void DrawScannerBlips(void);
 
 static void prefetchData(NSDictionary *info, struct CachedInfo *data);
+static OOHUDItem *AddHUDItem(OOHUDItem **ioItems, NSUInteger *ioCount, NSUInteger *ioCapacity, NSDictionary *info);
+static void ReleaseHUDItems(OOHUDItem *items, NSUInteger count);
+static BOOL HUDItemEquipmentAvailable(OOHUDItem *item);
 
 
 OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
@@ -209,11 +320,7 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 	deferredHudName = nil;	// if not nil, it means that we have a deferred HUD which is to be drawn at first available opportunity
 	hudName = [hudFileName copy];
 	
-	// init arrays
-	dialArray = [[NSMutableArray alloc] initWithCapacity:16];   // alloc retains
-	legendArray = [[NSMutableArray alloc] initWithCapacity:16]; // alloc retains
-	
-	// populate arrays
+	// compile dials and legends
 	NSArray *dials = [hudinfo oo_arrayForKey:DIALS_KEY];
 	for (i = 0; i < [dials count]; i++)
 	{
@@ -281,8 +388,8 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 
 - (void) dealloc
 {
-	DESTROY(legendArray);
-	DESTROY(dialArray);
+	ReleaseHUDItems(_legends, _legendCount);
+	ReleaseHUDItems(_dials, _dialCount);
 	DESTROY(hudName);
 	DESTROY(deferredHudName);
 	DESTROY(propertiesReticleTargetSensitive);
@@ -541,10 +648,6 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 	NSSize				imageSize;
 	OOTextureSprite		*legendSprite = nil;
 	NSMutableDictionary	*legendDict = nil;
-	struct CachedInfo	cache;
-	
-	// prefetch data associated with this legend
-	prefetchData(info, &cache);
 	
 	imageName = [info oo_stringForKey:IMAGE_KEY];
 	if (imageName != nil)
@@ -568,16 +671,13 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 		
 		legendDict = [info mutableCopy];
 		[legendDict setObject:legendSprite forKey:SPRITE_KEY];
-		// add WIDGET_INFO, WIDGET_CACHE to array
-		[legendArray addObject:[NSArray arrayWithObjects:legendDict, [NSValue valueWithBytes:&cache objCType:@encode(struct CachedInfo)], nil]];																	
+		AddHUDItem(&_legends, &_legendCount, &_legendCapacity, legendDict);
 		[legendDict release];
 		[legendSprite release];
 	}
 	else if ([info oo_stringForKey:TEXT_KEY] != nil)
 	{
-		// add WIDGET_INFO, WIDGET_CACHE to array
-		[legendArray addObject:[NSArray arrayWithObjects:info, [NSValue valueWithBytes:&cache objCType:@encode(struct CachedInfo)], nil]];
-
+		AddHUDItem(&_legends, &_legendCount, &_legendCapacity, info);
 	}
 }
 
@@ -615,12 +715,10 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 		return;
 	}
 	
-	// valid dial, now prefetch data
-	struct CachedInfo cache;
-	prefetchData(info, &cache);
-	// add WIDGET_INFO, WIDGET_CACHE, WIDGET_SELECTOR to array
-	[dialArray addObject:[NSArray arrayWithObjects:info, [NSValue valueWithBytes:&cache objCType:@encode(struct CachedInfo)],
-								[NSValue valueWithPointer:selector], nil]];
+	// valid dial, now compile it
+	OOHUDItem *item = AddHUDItem(&_dials, &_dialCount, &_dialCapacity, info);
+	item->selector = selector;
+	item->draw = (OOHUDDrawIMP)[self methodForSelector:selector];
 }
 
 
@@ -653,6 +751,8 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 */
 - (void) renderHUD
 {
+	OOHighResTimeValue startTime = OOGetHighResTime();
+	
 	hudUpdating = YES;
 	
 	OOVerifyOpenGLState();
@@ -675,6 +775,17 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 	OOVerifyOpenGLState();
 	
 	hudUpdating = NO;
+	
+	OOHighResTimeValue endTime = OOGetHighResTime();
+	_lastRenderTime = OOHighResTimeDeltaInSeconds(startTime, endTime);
+	OODisposeHighResTime(startTime);
+	OODisposeHighResTime(endTime);
+}
+
+
+- (OOTimeDelta) lastRenderTime
+{
+	return _lastRenderTime;
 }
 
 
@@ -684,11 +795,14 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 	 * as an incrementing one for compatibility with previous Oolite versions.
 	 * CIM: 28/9/12 */
 	z1 = [[UNIVERSE gameView] display_z];
-	NSUInteger i, nLegends = [legendArray count];
-	for (i = 0; i < nLegends; i++)
+	NSUInteger i;
+	for (i = 0; i < _legendCount; i++)
 	{
-		sCurrentDrawItem = [legendArray oo_arrayAtIndex:i];
-		[self drawLegend:[sCurrentDrawItem oo_dictionaryAtIndex:WIDGET_INFO]];
+		OOHUDItem *item = &_legends[i];
+		if (!HUDItemEquipmentAvailable(item))  continue;
+		
+		sCurrentDrawItem = item;
+		[self drawLegend:item->info];
 	}
 }
 
@@ -700,12 +814,19 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 	_scannerUpdated = NO;
 	_compassUpdated = NO;
 	
-	// tight loop, we assume dialArray doesn't change in mid-draw.
+	// tight loop, we assume the dial table doesn't change in mid-draw.
 	NSInteger i;
-	for (i = [dialArray count] - 1; i >= 0; i--)
+	for (i = (NSInteger)_dialCount - 1; i >= 0; i--)
 	{
-		sCurrentDrawItem = [dialArray oo_arrayAtIndex:i];
-		[self drawHUDItem:[sCurrentDrawItem oo_dictionaryAtIndex:WIDGET_INFO]];
+		OOHUDItem *item = &_dials[i];
+		if (!HUDItemEquipmentAvailable(item))  continue;
+		
+		// use the method resolved when the dial was added.
+		sCurrentDrawItem = item;
+		item->draw(self, item->selector, item->info);
+		OOCheckOpenGLErrors(@"HeadUpDisplay after drawing dial %@", item->info);
+		
+		OOVerifyOpenGLState();
 	}
 	
 	if (EXPECT_NOT(!_compassUpdated && _compassActive && [self checkPlayerInSystemFlight]))	// compass gone / broken / disabled ?
@@ -829,11 +950,6 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 
 - (void) drawLegend:(NSDictionary *)info
 {
-	// check if equipment is required
-	NSString *equipmentRequired = [info oo_stringForKey:EQUIPMENT_REQUIRED_KEY];
-	if (equipmentRequired != nil && ![PLAYER hasEquipmentItem:equipmentRequired])
-		return;
-	
 	OOTextureSprite				*legendSprite = nil;
 	NSString					*legendText = nil;
 	float						x, y;
@@ -841,7 +957,7 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 	GLfloat						alpha = overallAlpha;
 	struct CachedInfo			cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	// if either x or y is missing, use 0 instead
 	
@@ -869,22 +985,6 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 }
 
 
-- (void) drawHUDItem:(NSDictionary *)info
-{
-	NSString	*equipment = [info oo_stringForKey:EQUIPMENT_REQUIRED_KEY];
-	
-	if (equipment != nil && ![PLAYER hasEquipmentItem:equipment])
-	{
-		return;
-	}
-	// use the selector value stored during init.
-	[self performSelector:[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_SELECTOR] pointerValue] withObject:info];
-	OOCheckOpenGLErrors(@"HeadUpDisplay after drawHUDItem %@", info);
-	
-	OOVerifyOpenGLState();
-}
-
-
 - (BOOL) checkPlayerInFlight
 {
 	OOEntityStatus status = [PLAYER status];
@@ -908,17 +1008,12 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 {	
 	if ([self checkPlayerInFlight])
 	{
-		int				i, scanClass, ent_count = UNIVERSE->n_entities;
-		Entity			**uni_entities	= UNIVERSE->sortedEntities;	// grab the public sorted list
-		Entity			*my_entities[ent_count];
+		NSUInteger		i, ent_count;
+		Entity * const	*my_entities = [UNIVERSE scannerNeighbourhoodWithCount:&ent_count];
 		Entity			*scannedEntity = nil;
+		int				scanClass;
 		BOOL			massLocked = NO;
 		
-		for (i = 0; i < ent_count; i++)
-		{
-			my_entities[i] = [uni_entities[i] retain];	// retained
-		}
-	
 		for (i = 0; i < ent_count && !massLocked; i++)
 		{
 			scannedEntity = my_entities[i];
@@ -927,11 +1022,6 @@ OOINLINE void GLColorWithOverallAlpha(const GLfloat *color, GLfloat alpha)
 			massLocked = [self checkEntityForMassLock:scannedEntity withScanClass:scanClass];
 		}
 		[PLAYER setAlertFlag:ALERT_FLAG_MASS_LOCK to:massLocked];
-
-		for (i = 0; i < ent_count; i++)
-		{
-			[my_entities[i] release];	//	released
-		}
 	}
 }
 
@@ -1003,6 +1093,93 @@ static void prefetchData(NSDictionary *info, struct CachedInfo *data)
 	data->width = [info oo_nonNegativeFloatForKey:WIDTH_KEY defaultValue:NOT_DEFINED];
 	data->height = [info oo_nonNegativeFloatForKey:HEIGHT_KEY defaultValue:NOT_DEFINED];
 	data->alpha = [info oo_nonNegativeFloatForKey:ALPHA_KEY defaultValue:1.0f];	
+	
+	// Colour overrides, applied on top of each dial's default colour by GetRGBAArrayFromCache().
+	id colorDesc = [info objectForKey:RGB_COLOR_KEY];
+	OOColor *color = nil;
+	data->colorFlags = 0;
+	
+	// First, look for general colour specifier.
+	if (colorDesc != nil && ![info objectForKey:ALPHA_KEY])  color = [OOColor colorWithDescription:colorDesc];
+	if (color != nil)
+	{
+		[color getRed:&data->color[0] green:&data->color[1] blue:&data->color[2] alpha:&data->color[3]];
+		data->colorFlags = kCachedColorRGB | kCachedColorAlpha;
+	}
+	else
+	{
+		// Failing that, look for rgb_color and alpha.
+		colorDesc = [info oo_arrayForKey:RGB_COLOR_KEY];
+		if (colorDesc != nil && [colorDesc count] == 3)
+		{
+			data->color[0] = [colorDesc oo_nonNegativeFloatAtIndex:0];
+			data->color[1] = [colorDesc oo_nonNegativeFloatAtIndex:1];
+			data->color[2] = [colorDesc oo_nonNegativeFloatAtIndex:2];
+			data->colorFlags |= kCachedColorRGB;
+		}
+		if ([info objectForKey:ALPHA_KEY] != nil)
+		{
+			data->color[3] = [info oo_nonNegativeFloatForKey:ALPHA_KEY];
+			data->colorFlags |= kCachedColorAlpha;
+		}
+	}
+}
+
+
+static OOHUDItem *AddHUDItem(OOHUDItem **ioItems, NSUInteger *ioCount, NSUInteger *ioCapacity, NSDictionary *info)
+{
+	if (*ioCount == *ioCapacity)
+	{
+		NSUInteger newCapacity = MAX(*ioCapacity * 2, (NSUInteger)16);
+		OOHUDItem *newItems = realloc(*ioItems, sizeof *newItems * newCapacity);
+		if (newItems == NULL)
+		{
+			[NSException raise:NSMallocException format:@"Failed to grow HUD item table to %lu items.", (unsigned long)newCapacity];
+		}
+		*ioItems = newItems;
+		*ioCapacity = newCapacity;
+	}
+	
+	OOHUDItem *item = &(*ioItems)[(*ioCount)++];
+	memset(item, 0, sizeof *item);
+	item->info = [info retain];
+	prefetchData(info, &item->cache);
+	
+	item->equipmentRequired = [[info oo_stringForKey:EQUIPMENT_REQUIRED_KEY] copy];
+	// The player has trumbles without having them as equipment, so that one can't be cached.
+	item->equipmentCacheable = ![item->equipmentRequired isEqualToString:@"EQ_TRUMBLE"];
+	item->equipmentGeneration = NSUIntegerMax;
+	
+	return item;
+}
+
+
+static void ReleaseHUDItems(OOHUDItem *items, NSUInteger count)
+{
+	NSUInteger i;
+	for (i = 0; i < count; i++)
+	{
+		[items[i].info release];
+		[items[i].equipmentRequired release];
+	}
+	free(items);
+}
+
+
+static BOOL HUDItemEquipmentAvailable(OOHUDItem *item)
+{
+	if (EXPECT(item->equipmentRequired == nil))  return YES;
+	
+	PlayerEntity *player = PLAYER;
+	if (!item->equipmentCacheable)  return [player hasEquipmentItem:item->equipmentRequired];
+	
+	NSUInteger generation = [player equipmentGeneration];
+	if (item->equipmentGeneration != generation)
+	{
+		item->hasEquipment = [player hasEquipmentItem:item->equipmentRequired];
+		item->equipmentGeneration = generation;
+	}
+	return item->hasEquipment;
 }
 
 //---------------------------------------------------------------------//
@@ -1033,14 +1210,14 @@ static void prefetchData(NSDictionary *info, struct CachedInfo *data)
 	{
 		struct CachedInfo	cached;
 	
-		[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+		cached = sCurrentDrawItem->cache;
 		
 		x = useDefined(cached.x, SCANNER_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 		y = useDefined(cached.y, SCANNER_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
 		siz.width = useDefined(cached.width, SCANNER_WIDTH);
 		siz.height = useDefined(cached.height, SCANNER_HEIGHT);
 
-		GetRGBAArrayFromInfo(info, scanner_color);
+		GetRGBAArrayFromCache(&cached, scanner_color);
 		
 		scanner_color[3] *= overallAlpha;
 	}
@@ -1065,17 +1242,11 @@ static void prefetchData(NSDictionary *info, struct CachedInfo *data)
 	Vector			relativePosition;
 	int				flash = ((int)([UNIVERSE getTime] * 4))&1;
 	
-	// use a non-mutable copy so this can't be changed under us.
-	int				ent_count		= UNIVERSE->n_entities;
-	Entity			**uni_entities	= UNIVERSE->sortedEntities;	// grab the public sorted list
-	Entity			*my_entities[ent_count];
+	// the neighbourhood is retained by the universe until it's next rebuilt.
+	NSUInteger		ent_count;
+	Entity * const	*my_entities = [UNIVERSE scannerNeighbourhoodWithCount:&ent_count];
 	Entity			*scannedEntity = nil;
 	
-	for (i = 0; i < ent_count; i++)
-	{
-		my_entities[i] = [uni_entities[i] retain];	// retained
-	}
-	
 	if (!emptyDial)
 	{
 		OOGL(glColor4fv(scanner_color));
@@ -1090,7 +1261,7 @@ static void prefetchData(NSDictionary *info, struct CachedInfo *data)
 		
 		OOVerifyOpenGLState();
 		
-		for (i = 0; i < ent_count; i++)  // scanner lollypops
+		for (i = 0; i < (int)ent_count; i++)  // scanner lollypops
 		{
 			scannedEntity = my_entities[i];
 			
@@ -1215,17 +1386,16 @@ static void prefetchData(NSDictionary *info, struct CachedInfo *data)
 							scale_vector(&bounds[i], upscale);
 							bounds[i] = make_vector(bounds[i].x + scanner_cx, bounds[i].z * z_factor + bounds[i].y * y_factor + scanner_cy, z1 );
 						}
-						// draw the diamond
+						// queue the diamond
 						//
-						OOGLBEGIN(GL_QUADS);
-							glColor4f(col[0], col[1], col[2], 0.33333 * col[3]);
-							glVertex3f(bounds[0].x, bounds[0].y, bounds[0].z);	glVertex3f(bounds[4].x, bounds[4].y, bounds[4].z);
-							glVertex3f(bounds[1].x, bounds[1].y, bounds[1].z);	glVertex3f(bounds[5].x, bounds[5].y, bounds[5].z);
-							glVertex3f(bounds[2].x, bounds[2].y, bounds[2].z);	glVertex3f(bounds[4].x, bounds[4].y, bounds[4].z);
-							glVertex3f(bounds[3].x, bounds[3].y, bounds[3].z);	glVertex3f(bounds[5].x, bounds[5].y, bounds[5].z);
-							glVertex3f(bounds[2].x, bounds[2].y, bounds[2].z);	glVertex3f(bounds[0].x, bounds[0].y, bounds[0].z);
-							glVertex3f(bounds[3].x, bounds[3].y, bounds[3].z);	glVertex3f(bounds[1].x, bounds[1].y, bounds[1].z);
-						OOGLEND();
+						static const uint8_t diamondIndices[] = { 0, 4, 1, 5, 2, 4, 3, 5, 2, 0, 3, 1 };
+						GLfloat diamondColor[4] = { col[0], col[1], col[2], 0.33333 * col[3] };
+						unsigned j;
+						for (j = 0; j < sizeof diamondIndices; j++)
+						{
+							Vector v = bounds[diamondIndices[j]];
+							AppendScannerVertex(v.x, v.y, v.z, diamondColor);
+						}
 					}
 				}
 				
@@ -1256,17 +1426,16 @@ static void prefetchData(NSDictionary *info, struct CachedInfo *data)
 						OODrawString([(ShipEntity *)scannedEntity displayName], x1 + 2, y2 + 2, z1, NSMakeSize(8, 8));
 					}
 #endif
-					OOGLBEGIN(GL_QUADS);
-						glColor4fv(col);
-						glVertex3f(x1-3, y2, z1);	glVertex3f(x1+2, y2, z1);	glVertex3f(x1+2, y2+3, z1);	glVertex3f(x1-3, y2+3, z1);	
-						col[3] *= 0.3333; // one third the alpha
-						glColor4fv(col);
-						glVertex3f(x1, y1, z1);	glVertex3f(x1+2, y1, z1);	glVertex3f(x1+2, y2, z1);	glVertex3f(x1, y2, z1);
-					OOGLEND();
+					AppendScannerVertex(x1-3, y2, z1, col);	AppendScannerVertex(x1+2, y2, z1, col);	AppendScannerVertex(x1+2, y2+3, z1, col);	AppendScannerVertex(x1-3, y2+3, z1, col);
+					col[3] *= 0.3333; // one third the alpha
+					AppendScannerVertex(x1, y1, z1, col);	AppendScannerVertex(x1+2, y1, z1, col);	AppendScannerVertex(x1+2, y2, z1, col);	AppendScannerVertex(x1, y2, z1, col);
 				}
 			}
 		}
 		
+		// all the blips and diamonds in one go.
+		DrawScannerBlips();
+		
 		[PLAYER setAlertFlag:ALERT_FLAG_MASS_LOCK to:massLocked];
 		
 		[PLAYER setAlertFlag:ALERT_FLAG_HOSTILES to:foundHostiles];
@@ -1281,11 +1450,6 @@ static void prefetchData(NSDictionary *info, struct CachedInfo *data)
 		}
 	}
 	
-	for (i = 0; i < ent_count; i++)
-	{
-		[my_entities[i] release];	//	released
-	}
-	
 	OOVerifyOpenGLState();
 	
 	_scannerUpdated = YES;
@@ -1311,14 +1475,14 @@ static void prefetchData(NSDictionary *info, struct CachedInfo *data)
 	GLfloat				zoom_color[4] = { 1.0f, 0.1f, 0.0f, 1.0f };
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, ZOOM_INDICATOR_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, ZOOM_INDICATOR_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
 	siz.width = useDefined(cached.width, ZOOM_INDICATOR_WIDTH);
 	siz.height = useDefined(cached.height, ZOOM_INDICATOR_HEIGHT);
 	
-	GetRGBAArrayFromInfo(info, zoom_color);
+	GetRGBAArrayFromCache(&cached, zoom_color);
 	zoom_color[3] *= overallAlpha;
 	alpha = zoom_color[3];
 	
@@ -1352,14 +1516,14 @@ static void prefetchData(NSDictionary *info, struct CachedInfo *data)
 	GLfloat				compass_color[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, COMPASS_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, COMPASS_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
 	siz.width = useDefined(cached.width, COMPASS_HALF_SIZE);
 	siz.height = useDefined(cached.height, COMPASS_HALF_SIZE);
 	
-	GetRGBAArrayFromInfo(info, compass_color);
+	GetRGBAArrayFromCache(&cached, compass_color);
 	compass_color[3] *= overallAlpha;
 	alpha = compass_color[3];
 	
@@ -1602,7 +1766,7 @@ OOINLINE void SetCompassBlipColor(GLfloat relativeZ, GLfloat alpha)
 	GLfloat				alpha = 0.5f * overallAlpha;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, AEGIS_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, AEGIS_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -1633,11 +1797,11 @@ OOINLINE void SetCompassBlipColor(GLfloat relativeZ, GLfloat alpha)
 	
 	OOGL(glColor4f(0.0f, 1.0f, 0.0f, alpha));
 	OOGL(glVertexPointer(2, GL_FLOAT, 0, strip));
-	OOGL(glEnableClientState(GL_VERTEX_ARRAY));
-	OOGL(glDisableClientState(GL_COLOR_ARRAY));
+	OOGLEnableClientState(GL_VERTEX_ARRAY);
+	OOGLDisableClientState(GL_COLOR_ARRAY);
 	
 	OOGL(glDrawArrays(GL_QUAD_STRIP, 0, sizeof strip / sizeof *strip / 2));
-	OOGL(glDisableClientState(GL_VERTEX_ARRAY));
+	OOGLDisableClientState(GL_VERTEX_ARRAY);
 	
 	OOGL(glPopMatrix());
 #endif
@@ -1653,7 +1817,7 @@ OOINLINE void SetCompassBlipColor(GLfloat relativeZ, GLfloat alpha)
 	GLfloat				ds = [PLAYER dialSpeed];
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, SPEED_BAR_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, SPEED_BAR_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -1688,7 +1852,7 @@ OOINLINE void SetCompassBlipColor(GLfloat relativeZ, GLfloat alpha)
 	GLfloat				alpha = overallAlpha;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, ROLL_BAR_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, ROLL_BAR_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -1717,7 +1881,7 @@ OOINLINE void SetCompassBlipColor(GLfloat relativeZ, GLfloat alpha)
 	GLfloat				alpha = overallAlpha;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, PITCH_BAR_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, PITCH_BAR_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -1746,7 +1910,7 @@ OOINLINE void SetCompassBlipColor(GLfloat relativeZ, GLfloat alpha)
 	GLfloat				alpha = overallAlpha;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	// No standard YAW definitions - using PITCH ones instead.
 	x = useDefined(cached.x, PITCH_BAR_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
@@ -1779,7 +1943,7 @@ OOINLINE void SetCompassBlipColor(GLfloat relativeZ, GLfloat alpha)
 	GLfloat				energy = [PLAYER dialEnergy] * sEnergyBanks;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, ENERGY_GAUGE_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, ENERGY_GAUGE_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -1859,7 +2023,7 @@ OOINLINE void SetCompassBlipColor(GLfloat relativeZ, GLfloat alpha)
 	GLfloat				shield = [PLAYER dialForwardShield];
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, FORWARD_SHIELD_BAR_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, FORWARD_SHIELD_BAR_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -1893,7 +2057,7 @@ OOINLINE void SetCompassBlipColor(GLfloat relativeZ, GLfloat alpha)
 	GLfloat				shield = [PLAYER dialAftShield];
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, AFT_SHIELD_BAR_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, AFT_SHIELD_BAR_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -1927,7 +2091,7 @@ OOINLINE void SetCompassBlipColor(GLfloat relativeZ, GLfloat alpha)
 	GLfloat				alpha = overallAlpha;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, FUEL_BAR_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, FUEL_BAR_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -1967,7 +2131,7 @@ OOINLINE void SetCompassBlipColor(GLfloat relativeZ, GLfloat alpha)
 	GLfloat				alpha = overallAlpha;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, CABIN_TEMP_BAR_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, CABIN_TEMP_BAR_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -2014,7 +2178,7 @@ OOINLINE void SetCompassBlipColor(GLfloat relativeZ, GLfloat alpha)
 	GLfloat				alpha = overallAlpha;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, WEAPON_TEMP_BAR_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, WEAPON_TEMP_BAR_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -2049,7 +2213,7 @@ OOINLINE void SetCompassBlipColor(GLfloat relativeZ, GLfloat alpha)
 	GLfloat				alpha = overallAlpha;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, ALTITUDE_BAR_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, ALTITUDE_BAR_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -2206,7 +2370,7 @@ static OOPolygonSprite *IconForMissileRole(NSString *role)
 	GLfloat				alpha = overallAlpha;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, MISSILES_DISPLAY_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, MISSILES_DISPLAY_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -2289,7 +2453,7 @@ static OOPolygonSprite *IconForMissileRole(NSString *role)
 	BOOL				blueAlert = cloakIndicatorOnStatusLight && [PLAYER isCloaked];
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, STATUS_LIGHT_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, STATUS_LIGHT_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -2342,7 +2506,7 @@ static OOPolygonSprite *IconForMissileRole(NSString *role)
 	GLfloat				alpha = overallAlpha;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	alpha *= cached.alpha;
 	
@@ -2424,14 +2588,14 @@ static OOPolygonSprite *IconForMissileRole(NSString *role)
 	GLfloat				itemColor[4] = { 0.0f, 1.0f, 0.0f, 1.0f };
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, CLOCK_DISPLAY_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, CLOCK_DISPLAY_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
 	siz.width = useDefined(cached.width, CLOCK_DISPLAY_WIDTH);
 	siz.height = useDefined(cached.height, CLOCK_DISPLAY_HEIGHT);
 	
-	GetRGBAArrayFromInfo(info, itemColor);
+	GetRGBAArrayFromCache(&cached, itemColor);
 	itemColor[3] *= overallAlpha;
 	
 	OOGL(glColor4f(itemColor[0], itemColor[1], itemColor[2], itemColor[3]));
@@ -2448,7 +2612,7 @@ static OOPolygonSprite *IconForMissileRole(NSString *role)
 		GLfloat				alpha = overallAlpha;
 		struct CachedInfo	cached;
 	
-		[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+		cached = sCurrentDrawItem->cache;
 		
 		x = useDefined(cached.x, WEAPONSOFFLINETEXT_DISPLAY_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 		y = useDefined(cached.y, WEAPONSOFFLINETEXT_DISPLAY_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -2471,7 +2635,7 @@ static OOPolygonSprite *IconForMissileRole(NSString *role)
 	NSSize				siz;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, FPSINFO_DISPLAY_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, FPSINFO_DISPLAY_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -2485,10 +2649,18 @@ static OOPolygonSprite *IconForMissileRole(NSString *role)
 	// We would normally set a variable alpha value here, but in this case we don't.
 	// We prefer the FPS counter to be always visible - Nikos 20100405
 	OOGL(glColor4f(0.0, 1.0, 0.0, 1.0));
-	OODrawString([PLAYER dial_fpsinfo], x, y, z1, siz);
+	// HUD time is for the previous frame, since this one is still being drawn.
+	NSString *fpsInfo = [NSString stringWithFormat:@"%@ - HUD: %.2f ms (%lu dials, %lu legends)", [PLAYER dial_fpsinfo], _lastRenderTime * 1000.0, (unsigned long)_dialCount, (unsigned long)_legendCount];
+	OODrawString(fpsInfo, x, y, z1, siz);
+	
+	/*	Rendering statistics follow the frame rate in all builds; collision,
+		position and time acceleration details are for debug builds only.
+	*/
+	OOBeginTextBatch();
+	NSSize siz08 = NSMakeSize(0.8 * siz.width, 0.8 * siz.width);
+	float line = 1.2f;
 	
 #ifndef NDEBUG
-	NSSize siz08 = NSMakeSize(0.8 * siz.width, 0.8 * siz.width);
 	NSString *collDebugInfo = [NSString stringWithFormat:@"%@ - %@", [PLAYER dial_objinfo], [UNIVERSE collisionDescription]];
 	OODrawString(collDebugInfo, x, y - siz.height, z1, siz);
 	
@@ -2496,7 +2668,49 @@ static OOPolygonSprite *IconForMissileRole(NSString *role)
 	
 	NSString *timeAccelerationFactorInfo = [NSString stringWithFormat:@"TAF: %@%.2f", DESC(@"multiplication-sign"), [UNIVERSE timeAccelerationFactor]];
 	OODrawString(timeAccelerationFactorInfo, x, y - 3.2 * siz08.height, z1, siz08);
+	line = 4.2f;
+#endif
+	
+	NSString *drawCallInfo = [NSString stringWithFormat:@"Mesh draws: %lu (%lu instanced)", (unsigned long)[OOMesh drawCallCount], (unsigned long)[OOMesh instancedDrawCount]];
+	OODrawString(drawCallInfo, x, y - line++ * siz08.height, z1, siz08);
+	
+	NSString *stateChangeInfo = [NSString stringWithFormat:@"State changes: %lu programs, %lu textures, %lu materials, %lu lights, %lu fog",
+								 (unsigned long)OORenderStateChangeCount(kOORenderStateChangeProgram),
+								 (unsigned long)OORenderStateChangeCount(kOORenderStateChangeTexture),
+								 (unsigned long)OORenderStateChangeCount(kOORenderStateChangeMaterial),
+								 (unsigned long)OORenderStateChangeCount(kOORenderStateChangeLighting),
+								 (unsigned long)OORenderStateChangeCount(kOORenderStateChangeFog)];
+	OODrawString(stateChangeInfo, x, y - line++ * siz08.height, z1, siz08);
+	
+#ifndef NDEBUG
+	// Counting filtered calls would slow down the state cache itself, so this is debug only.
+	NSUInteger glStateCalls, glStateFiltered;
+	OOGLGetStateCacheStatistics(&glStateCalls, &glStateFiltered);
+	NSString *glStateInfo = [NSString stringWithFormat:@"GL state calls: %lu (%lu redundant)", (unsigned long)glStateCalls, (unsigned long)glStateFiltered];
+	OODrawString(glStateInfo, x, y - line++ * siz08.height, z1, siz08);
+#endif
+	
+#if OO_SHADERS
+	NSString *uniformInfo = [NSString stringWithFormat:@"Uniforms: %lu uploaded, %lu unchanged", (unsigned long)[OOShaderUniform uploadCount], (unsigned long)[OOShaderUniform skippedUploadCount]];
+	OODrawString(uniformInfo, x, y - line++ * siz08.height, z1, siz08);
+#endif
+	
+#if !NEW_PLANETS
+	NSString *planetInfo = [NSString stringWithFormat:@"Planet vertices: %lu (%lu draws)", (unsigned long)[PlanetEntity drawnVertexCount], (unsigned long)[PlanetEntity drawCallCount]];
+	OODrawString(planetInfo, x, y - line++ * siz08.height, z1, siz08);
 #endif
+	
+	OOEffectBatch *effectBatch = [UNIVERSE effectBatch];
+	NSString *effectInfo = [NSString stringWithFormat:@"Effect vertices: %lu (%lu draws)", (unsigned long)[effectBatch vertexCount], (unsigned long)[effectBatch drawCallCount]];
+	OODrawString(effectInfo, x, y - line++ * siz08.height, z1, siz08);
+	
+	NSString *cullingInfo = [NSString stringWithFormat:@"Entities drawn: %lu (%lu outside view, %lu occluded)", (unsigned long)[UNIVERSE visibleEntityCount], (unsigned long)[UNIVERSE frustumCulledEntityCount], (unsigned long)[UNIVERSE occludedEntityCount]];
+	OODrawString(cullingInfo, x, y - line++ * siz08.height, z1, siz08);
+	
+	OOQualityController *quality = [UNIVERSE qualityController];
+	NSString *qualityInfo = [NSString stringWithFormat:@"Quality level: %u (%u-%u%@), frame time %.1f ms (target %.1f ms)", [quality level], [quality minimumLevel], [quality maximumLevel], [quality isEnabled] ? @"" : @", fixed", [quality averageFrameTime] * 1000.0, [quality targetFrameTime] * 1000.0];
+	OODrawString(qualityInfo, x, y - line++ * siz08.height, z1, siz08);
+	OOEndTextBatch();
 }
 
 
@@ -2507,7 +2721,7 @@ static OOPolygonSprite *IconForMissileRole(NSString *role)
 	GLfloat				alpha;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, SCOOPSTATUS_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, SCOOPSTATUS_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -2602,7 +2816,7 @@ static OOPolygonSprite *IconForMissileRole(NSString *role)
 	OOJoystickManager	*stickHandler = [OOJoystickManager sharedStickHandler];
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	x = useDefined(cached.x, STATUS_LIGHT_CENTRE_X) + [[UNIVERSE gameView] x_offset] * cached.x0;
 	y = useDefined(cached.y, STATUS_LIGHT_CENTRE_Y) + [[UNIVERSE gameView] y_offset] * cached.y0;
@@ -2648,7 +2862,7 @@ static OOPolygonSprite *IconForMissileRole(NSString *role)
 	GLfloat				alpha = overallAlpha;
 	struct CachedInfo	cached;
 	
-	[(NSValue *)[sCurrentDrawItem objectAtIndex:WIDGET_CACHE] getValue:&cached];
+	cached = sCurrentDrawItem->cache;
 	
 	if (cached.x == NOT_DEFINED || cached.y == NOT_DEFINED || cached.width == NOT_DEFINED || cached.height == NOT_DEFINED)
 	{
@@ -3097,23 +3311,217 @@ static GLfloat drawCharacterQuad(uint8_t chr, GLfloat x, GLfloat y, GLfloat z, N
 }
 
 
-NSRect OORectFromString(NSString *text, GLfloat x, GLfloat y, NSSize siz)
+@implementation OOTextLayout
+
+- (id) initWithEncodedString:(NSData *)data
 {
-	GLfloat				w = 0;
-	NSData				*data = nil;
-	const uint8_t		*bytes = NULL;
-	NSUInteger			i, length;
+	if ((self = [super init]))
+	{
+		const uint8_t	*bytes = [data bytes];
+		NSUInteger		i;
+		GLfloat			cx = 0.0f;
+		
+		_count = [data length];
+		if (_count != 0)
+		{
+			_glyphs = malloc(sizeof *_glyphs * _count);
+			if (_glyphs == NULL)
+			{
+				[self release];
+				return nil;
+			}
+		}
+		
+		for (i = 0; i < _count; i++)
+		{
+			uint8_t chr = bytes[i];
+			_glyphs[i].x = cx;
+			_glyphs[i].y = (chr > 32) ? ONE_EIGHTH : 0.0f;	// Baseline offset, as in drawCharacterQuad().
+			_glyphs[i].chr = chr;
+			cx += sGlyphWidths[chr];
+		}
+		_width = cx;
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	free(_glyphs);
+	
+	[super dealloc];
+}
+
+
+- (NSUInteger) glyphCount
+{
+	return _count;
+}
+
+
+- (const OOGlyphPlacement *) glyphs
+{
+	return _glyphs;
+}
+
+
+- (GLfloat) width
+{
+	return _width;
+}
+
+@end
+
+
+static OOTextLayout *LayoutForString(NSString *text)
+{
+	if (text == nil)  return nil;
+	
+	if (sTextLayoutCache == nil)
+	{
+		sTextLayoutCache = [[OOCache alloc] init];
+		[sTextLayoutCache setPruneThreshold:kTextLayoutCacheSize];
+		[sTextLayoutCache setName:@"Text layout"];
+	}
+	
+	OOTextLayout *layout = [sTextLayoutCache objectForKey:text];
+	if (layout == nil)
+	{
+		layout = [[OOTextLayout alloc] initWithEncodedString:[sEncodingCoverter convertString:text]];
+		if (layout == nil)  return nil;
+		[sTextLayoutCache setObject:layout forKey:text];
+		[layout autorelease];
+	}
+	
+	return layout;
+}
+
+
+static BOOL ReserveTextVertices(NSUInteger count)
+{
+	if (sTextVertexCount + count <= sTextVertexCapacity)  return YES;
+	
+	NSUInteger newCapacity = MAX(sTextVertexCapacity * 2, (NSUInteger)kMinTextVertexCapacity);
+	while (newCapacity < sTextVertexCount + count)  newCapacity *= 2;
+	
+	OOTextVertex *newVertices = realloc(sTextVertices, sizeof *newVertices * newCapacity);
+	if (newVertices == NULL)  return NO;
+	
+	sTextVertices = newVertices;
+	sTextVertexCapacity = newCapacity;
+	return YES;
+}
+
+
+OOINLINE void SetTextVertex(OOTextVertex *vertex, GLfloat x, GLfloat y, GLfloat z, GLfloat s, GLfloat t, const GLfloat color[4])
+{
+	vertex->x = x;
+	vertex->y = y;
+	vertex->z = z;
+	vertex->s = s;
+	vertex->t = t;
+	vertex->color[0] = color[0];
+	vertex->color[1] = color[1];
+	vertex->color[2] = color[2];
+	vertex->color[3] = color[3];
+}
+
+
+// Same quad as drawCharacterQuad(), except that y is already adjusted for the baseline.
+static void AppendGlyph(uint8_t chr, GLfloat x, GLfloat y, GLfloat z, NSSize siz, const GLfloat color[4])
+{
+	if (!ReserveTextVertices(4))  return;
+	
+	GLfloat texture_x = ONE_SIXTEENTH * (chr & 0x0f);
+	GLfloat texture_y = ONE_SIXTEENTH * (chr >> 4);
+	OOTextVertex *v = &sTextVertices[sTextVertexCount];
+	
+	SetTextVertex(&v[0], x, y, z, texture_x, texture_y + ONE_SIXTEENTH, color);
+	SetTextVertex(&v[1], x + siz.width, y, z, texture_x + ONE_SIXTEENTH, texture_y + ONE_SIXTEENTH, color);
+	SetTextVertex(&v[2], x + siz.width, y + siz.height, z, texture_x + ONE_SIXTEENTH, texture_y, color);
+	SetTextVertex(&v[3], x, y + siz.height, z, texture_x, texture_y, color);
+	
+	sTextVertexCount += 4;
+}
+
+
+static void AppendTextLayout(OOTextLayout *layout, GLfloat x, GLfloat y, GLfloat z, NSSize siz, const GLfloat color[4])
+{
+	const OOGlyphPlacement	*glyphs = [layout glyphs];
+	NSUInteger				i, count = [layout glyphCount];
+	
+	if (!ReserveTextVertices(count * 4))  return;
+	
+	for (i = 0; i < count; i++)
+	{
+		AppendGlyph(glyphs[i].chr, x + glyphs[i].x * siz.width, y + glyphs[i].y * siz.height, z, siz, color);
+	}
+}
+
+
+/*	Draw and clear the collected glyphs. If useColors is NO, the vertex colours
+	are ignored and everything is drawn in the current colour; otherwise the
+	current colour is preserved.
+*/
+static void FlushText(BOOL useColors)
+{
+	if (sTextVertexCount == 0)  return;
+	
+	OOSetOpenGLState(OPENGL_STATE_OVERLAY);
 	
-	data = [sEncodingCoverter convertString:text];
-	bytes = [data bytes];
-	length = [data length];
+	OOGL(glEnable(GL_TEXTURE_2D));
+	[sFontTexture apply];
 	
-	for (i = 0; i < length; i++)
+	GLfloat savedColor[4];
+	OOGLEnableClientState(GL_VERTEX_ARRAY);
+	OOGLEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	OOGL(glVertexPointer(3, GL_FLOAT, sizeof *sTextVertices, &sTextVertices[0].x));
+	OOGL(glTexCoordPointer(2, GL_FLOAT, sizeof *sTextVertices, &sTextVertices[0].s));
+	if (useColors)
 	{
-		w += siz.width * sGlyphWidths[bytes[i]];
+		OOGL(glGetFloatv(GL_CURRENT_COLOR, savedColor));
+		OOGLEnableClientState(GL_COLOR_ARRAY);
+		OOGL(glColorPointer(4, GL_FLOAT, sizeof *sTextVertices, sTextVertices[0].color));
 	}
 	
-	return NSMakeRect(x, y, w, siz.height);
+	OOGL(glDrawArrays(GL_QUADS, 0, sTextVertexCount));
+	
+	if (useColors)
+	{
+		OOGLDisableClientState(GL_COLOR_ARRAY);
+		OOGL(glColor4fv(savedColor));
+	}
+	OOGLDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	OOGLDisableClientState(GL_VERTEX_ARRAY);
+	
+	sTextVertexCount = 0;
+	
+	[OOTexture applyNone];
+	OOGL(glDisable(GL_TEXTURE_2D));
+	
+	OOVerifyOpenGLState();
+}
+
+
+void OOBeginTextBatch(void)
+{
+	sTextBatchDepth++;
+}
+
+
+void OOEndTextBatch(void)
+{
+	NSCAssert(sTextBatchDepth != 0, @"Unbalanced OOEndTextBatch().");
+	
+	if (sTextBatchDepth != 0 && --sTextBatchDepth == 0)  FlushText(YES);
+}
+
+
+NSRect OORectFromString(NSString *text, GLfloat x, GLfloat y, NSSize siz)
+{
+	return NSMakeRect(x, y, siz.width * [LayoutForString(text) width], siz.height);
 }
 
 
@@ -3156,31 +3564,18 @@ void drawHighlight(GLfloat x, GLfloat y, GLfloat z, NSSize siz, GLfloat alpha)
 
 void OODrawString(NSString *text, GLfloat x, GLfloat y, GLfloat z, NSSize siz)
 {
-	GLfloat			cx = x;
-	NSUInteger		i, length;
-	NSData			*data = nil;
-	const uint8_t	*bytes = NULL;
+	OOTextLayout	*layout = LayoutForString(text);
+	GLfloat			color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 	
 	OOSetOpenGLState(OPENGL_STATE_OVERLAY);
 	
-	OOGL(glEnable(GL_TEXTURE_2D));
-	[sFontTexture apply];
-	
-	data = [sEncodingCoverter convertString:text];
-	length = [data length];
-	bytes = [data bytes];
+	if ([layout glyphCount] == 0)  return;
 	
-	OOGLBEGIN(GL_QUADS);
-		for (i = 0; i < length; i++)
-		{
-			cx += drawCharacterQuad(bytes[i], cx, y, z, siz);
-		}
-	OOGLEND();
+	if (sTextBatchDepth != 0)  OOGL(glGetFloatv(GL_CURRENT_COLOR, color));
 	
-	[OOTexture applyNone];
-	OOGL(glDisable(GL_TEXTURE_2D));
+	AppendTextLayout(layout, x, y, z, siz, color);
 	
-	OOVerifyOpenGLState();
+	if (sTextBatchDepth == 0)  FlushText(NO);
 }
 
 
@@ -3194,12 +3589,12 @@ void OODrawHilightedString(NSString *text, GLfloat x, GLfloat y, GLfloat z, NSSi
 	
 	OOSetOpenGLState(OPENGL_STATE_OVERLAY);
 	
-	OOGL(glPushAttrib(GL_CURRENT_BIT));	// save the text colour
+	OOGLPushAttrib(GL_CURRENT_BIT);	// save the text colour
 	OOGL(glGetFloatv(GL_CURRENT_COLOR, color));	// we need the original colour's alpha.
 	
 	drawHighlight(x, y, z, strsize, color[3]);
 	
-	OOGL(glPopAttrib());	//restore the colour
+	OOGLPopAttrib();	//restore the colour
 	
 	OODrawString(text, x, y, z, siz);
 	
@@ -3220,34 +3615,30 @@ void OODrawPlanetInfo(int gov, int eco, int tec, GLfloat x, GLfloat y, GLfloat z
 	
 	GLfloat cx = x;
 	int tl = tec + 1;
-	GLfloat ce1 = 1.0f - 0.125f * eco;
+	GLfloat ecoColor[4] = { 1.0f - 0.125f * eco, 1.0f, 0.0f, 1.0f };
+	GLfloat govColor[4] = { govcol[gov * 3], govcol[gov * 3 + 1], govcol[gov * 3 + 2], 1.0f };
+	static const GLfloat techColor[4] = { 0.5f, 1.0f, 1.0f, 1.0f };
 	
 	OOSetOpenGLState(OPENGL_STATE_OVERLAY);
 	
-	OOGL(glEnable(GL_TEXTURE_2D));
-	[sFontTexture apply];
-	
-	OOGLBEGIN(GL_QUADS);
-		glColor4f(ce1, 1.0f, 0.0f, 1.0f);
-		// see OODrawHilightedPlanetInfo
-		cx += drawCharacterQuad(23 - eco, cx, y, z, siz);	// characters 16..23 are economy symbols
-		glColor3fv(&govcol[gov * 3]);
-		cx += drawCharacterQuad(gov, cx, y, z, siz) - 1.0f;		// charcters 0..7 are government symbols
-		glColor4f(0.5f, 1.0f, 1.0f, 1.0f);
-		if (tl > 9)
-		{
-			// display TL clamped between 1..16, this must be a '1'!
-			cx += drawCharacterQuad(49, cx, y - 2, z, siz) - 2.0f;
-		}
-		cx += drawCharacterQuad(48 + (tl % 10), cx, y - 2.0f, z, siz);
-	OOGLEND();
-	
-	(void)cx;	// Suppress "value not used" analyzer issue.
+	// see OODrawHilightedPlanetInfo
+	// Digits get the same baseline offset as in drawCharacterQuad(); the symbols don't.
+	AppendGlyph(23 - eco, cx, y, z, siz, ecoColor);	// characters 16..23 are economy symbols
+	cx += siz.width * sGlyphWidths[23 - eco];
+	AppendGlyph(gov, cx, y, z, siz, govColor);		// charcters 0..7 are government symbols
+	cx += siz.width * sGlyphWidths[gov] - 1.0f;
+	if (tl > 9)
+	{
+		// display TL clamped between 1..16, this must be a '1'!
+		AppendGlyph(49, cx, y - 2.0f + ONE_EIGHTH * siz.height, z, siz, techColor);
+		cx += siz.width * sGlyphWidths[49] - 2.0f;
+	}
+	AppendGlyph(48 + (tl % 10), cx, y - 2.0f + ONE_EIGHTH * siz.height, z, siz, techColor);
 	
-	[OOTexture applyNone];
-	OOGL(glDisable(GL_TEXTURE_2D));
+	if (sTextBatchDepth == 0)  FlushText(YES);
 	
-	OOVerifyOpenGLState();
+	// Leave the tech level colour current, as drawing in immediate mode used to.
+	OOGL(glColor4fv(techColor));
 }
 
 
@@ -3270,12 +3661,12 @@ void OODrawHilightedPlanetInfo(int gov, int eco, int tec, GLfloat x, GLfloat y,
 	
 	OOSetOpenGLState(OPENGL_STATE_OVERLAY);
 	
-	OOGL(glPushAttrib(GL_CURRENT_BIT));	// save the text colour
+	OOGLPushAttrib(GL_CURRENT_BIT);	// save the text colour
 	OOGL(glGetFloatv(GL_CURRENT_COLOR, color));	// we need the original colour's alpha.
 	
 	drawHighlight(x, y - 2.0f, z, hisize, color[3]);
 	
-	OOGL(glPopAttrib());	//restore the colour
+	OOGLPopAttrib();	//restore the colour
 	
 	OODrawPlanetInfo(gov, eco, tec, x, y, z, siz);
 	
@@ -3364,6 +3755,51 @@ static void drawScannerGrid(GLfloat x, GLfloat y, GLfloat z, NSSize siz, int v_d
 }
 
 
+static void AppendScannerVertex(GLfloat x, GLfloat y, GLfloat z, const GLfloat color[4])
+{
+	if (EXPECT_NOT(sScannerVertexCount == sScannerVertexCapacity))
+	{
+		NSUInteger newCapacity = MAX(sScannerVertexCapacity * 2, (NSUInteger)kMinScannerVertexCapacity);
+		OOScannerVertex *newVertices = realloc(sScannerVertices, sizeof *newVertices * newCapacity);
+		if (newVertices == NULL)  return;
+		
+		sScannerVertices = newVertices;
+		sScannerVertexCapacity = newCapacity;
+	}
+	
+	OOScannerVertex *v = &sScannerVertices[sScannerVertexCount++];
+	v->x = x;
+	v->y = y;
+	v->z = z;
+	v->color[0] = color[0];
+	v->color[1] = color[1];
+	v->color[2] = color[2];
+	v->color[3] = color[3];
+}
+
+
+static void DrawScannerBlips(void)
+{
+	NSUInteger count = sScannerVertexCount;
+	sScannerVertexCount = 0;
+	if (count == 0)  return;
+	
+	GLfloat savedColor[4];
+	OOGL(glGetFloatv(GL_CURRENT_COLOR, savedColor));
+	
+	OOGLEnableClientState(GL_VERTEX_ARRAY);
+	OOGLEnableClientState(GL_COLOR_ARRAY);
+	OOGL(glVertexPointer(3, GL_FLOAT, sizeof *sScannerVertices, &sScannerVertices[0].x));
+	OOGL(glColorPointer(4, GL_FLOAT, sizeof *sScannerVertices, sScannerVertices[0].color));
+	
+	OOGL(glDrawArrays(GL_QUADS, 0, count));
+	
+	OOGLDisableClientState(GL_COLOR_ARRAY);
+	OOGLDisableClientState(GL_VERTEX_ARRAY);
+	OOGL(glColor4fv(savedColor));
+}
+
+
 static void DrawSpecialOval(GLfloat x, GLfloat y, GLfloat z, NSSize siz, GLfloat step, GLfloat *color4v)
 {
 	GLfloat			ww = 0.5 * siz.width;
@@ -3455,30 +3891,13 @@ static void DrawSpecialOval(GLfloat x, GLfloat y, GLfloat z, NSSize siz, GLfloat
 @end
 
 
-static void GetRGBAArrayFromInfo(NSDictionary *info, GLfloat ioColor[4])
+static void GetRGBAArrayFromCache(const struct CachedInfo *cached, GLfloat ioColor[4])
 {
-	id						colorDesc = nil;
-	OOColor					*color = nil;
-	
-	// First, look for general colour specifier.
-	colorDesc = [info objectForKey:RGB_COLOR_KEY];
-	if (colorDesc != nil && ![info objectForKey:ALPHA_KEY])
-	{
-		color = [OOColor colorWithDescription:colorDesc];
-		if (color != nil)
-		{
-			[color getRed:&ioColor[0] green:&ioColor[1] blue:&ioColor[2] alpha:&ioColor[3]];
-			return;
-		}
-	}
-	
-	// Failing that, look for rgb_color and alpha.
-	colorDesc = [info oo_arrayForKey:RGB_COLOR_KEY];
-	if (colorDesc != nil && [colorDesc count] == 3)
+	if (cached->colorFlags & kCachedColorRGB)
 	{
-		ioColor[0] = [colorDesc oo_nonNegativeFloatAtIndex:0];
-		ioColor[1] = [colorDesc oo_nonNegativeFloatAtIndex:1];
-		ioColor[2] = [colorDesc oo_nonNegativeFloatAtIndex:2];
+		ioColor[0] = cached->color[0];
+		ioColor[1] = cached->color[1];
+		ioColor[2] = cached->color[2];
 	}
-	ioColor[3] = [info oo_nonNegativeFloatForKey:ALPHA_KEY defaultValue:ioColor[3]];
+	if (cached->colorFlags & kCachedColorAlpha)  ioColor[3] = cached->color[3];
 }
@@ -36,6 +36,7 @@
 #import "OOMacroOpenGL.h"
 #import "OOCPUInfo.h"
 #import "OOPixMap.h"
+#import "OORenderQueue.h"
 
 #ifndef NDEBUG
 #import "OOTextureGenerator.h"
@@ -153,7 +154,7 @@ static BOOL DecodeFormat(OOTextureDataFormat format, uint32_t options, GLenum *o
 		if (_textureName != 0)
 		{
 			OO_ENTER_OPENGL();
-			OOGL(glDeleteTextures(1, &_textureName));
+			OOGLDeleteTextures(1, &_textureName);
 			_textureName = 0;
 		}
 		free(_bytes);
@@ -250,10 +251,16 @@ static BOOL DecodeFormat(OOTextureDataFormat format, uint32_t options, GLenum *o
 	
 	if (EXPECT_NOT(!_loaded))  [self setUpTexture];
 	else if (EXPECT_NOT(!_uploaded))  [self uploadTexture];
-	else  OOGL(glBindTexture([self glTextureTarget], _textureName));
+	else  OOGLBindTexture([self glTextureTarget], _textureName);
+	OOCountRenderStateChange(kOORenderStateChangeTexture);
 	
 #if GL_EXT_texture_lod_bias
-	if (gOOTextureInfo.textureLODBiasAvailable)  OOGL(glTexEnvf(GL_TEXTURE_FILTER_CONTROL_EXT, GL_TEXTURE_LOD_BIAS_EXT, _lodBias));
+	if (gOOTextureInfo.textureLODBiasAvailable)
+	{
+		GLfloat lodBias = _lodBias;
+		if ((_options & kOOTextureMinFilterMask) == kOOTextureMinFilterMipMap)  lodBias += gOOTextureInfo.extraLODBias;
+		OOGL(glTexEnvf(GL_TEXTURE_FILTER_CONTROL_EXT, GL_TEXTURE_LOD_BIAS_EXT, lodBias));
+	}
 #endif
 }
 
@@ -475,7 +482,7 @@ static BOOL DecodeFormat(OOTextureDataFormat format, uint32_t options, GLenum *o
 		GLenum texTarget = [self glTextureTarget];
 		
 		OOGL(glGenTextures(1, &_textureName));
-		OOGL(glBindTexture(texTarget, _textureName));
+		OOGLBindTexture(texTarget, _textureName);
 		
 		// Select wrap mode
 		GLint clampMode = gOOTextureInfo.clampToEdgeAvailable ? GL_CLAMP_TO_EDGE : GL_CLAMP;
@@ -635,7 +642,7 @@ static BOOL DecodeFormat(OOTextureDataFormat format, uint32_t options, GLenum *o
 		OO_ENTER_OPENGL();
 		
 		_uploaded = NO;
-		OOGL(glDeleteTextures(1, &_textureName));
+		OOGLDeleteTextures(1, &_textureName);
 		_textureName = 0;
 		
 #if OOTEXTURE_RELOADABLE
@@ -111,9 +111,10 @@ static NSString *FormatFloat(double value);
 #endif
 }
 
-- (id) initWithMaterialConfiguration:(NSDictionary *)configuration
-						 materialKey:(NSString *)materialKey
-						  entityName:(NSString *)name;
+// configuration must be in the form returned by CanonicalizeMaterialSpecifier().
+- (id) initWithCanonicalConfiguration:(NSDictionary *)configuration
+						  materialKey:(NSString *)materialKey
+						   entityName:(NSString *)name;
 
 - (BOOL) run;
 
@@ -261,25 +262,58 @@ static NSString *FormatFloat(double value);
 static NSString *GetExtractMode(NSDictionary *textureSpecifier);
 
 
+/*	Synthesized shaders, keyed by canonical material configuration. The
+	generated code depends on nothing else (the material key only matters as
+	the default diffuse map name, which canonicalization fills in), and ship
+	types commonly share identical materials, so each is only generated once
+	per session. Values are arrays of vertex shader, fragment shader, texture
+	specifications and uniform specifications.
+*/
+static NSMutableDictionary *sSynthesizedShaders = nil;
+
+
 BOOL OOSynthesizeMaterialShader(NSDictionary *configuration, NSString *materialKey, NSString *entityName, NSString **outVertexShader, NSString **outFragmentShader, NSArray **outTextureSpecs, NSDictionary **outUniformSpecs)
 {
 	NSCParameterAssert(configuration != nil && outVertexShader != NULL && outFragmentShader != NULL && outTextureSpecs != NULL && outUniformSpecs != NULL);
 	
 	NSAutoreleasePool *pool = [NSAutoreleasePool new];
 	
-	OODefaultShaderSynthesizer *synthesizer = [[OODefaultShaderSynthesizer alloc]
-											   initWithMaterialConfiguration:configuration
-																 materialKey:materialKey
-																  entityName:entityName];
-	[synthesizer autorelease];
+	NSDictionary *canonicalConfiguration = CanonicalizeMaterialSpecifier(configuration, materialKey);
+	NSArray *synthesized = [sSynthesizedShaders objectForKey:canonicalConfiguration];
+	
+	if (synthesized == nil)
+	{
+		OODefaultShaderSynthesizer *synthesizer = [[OODefaultShaderSynthesizer alloc]
+												   initWithCanonicalConfiguration:canonicalConfiguration
+																	  materialKey:materialKey
+																	   entityName:entityName];
+		[synthesizer autorelease];
+		
+		if ([synthesizer run])
+		{
+			synthesized = [NSArray arrayWithObjects:
+						   [synthesizer vertexShader],
+						   [synthesizer fragmentShader],
+						   [[[synthesizer textureSpecifications] copy] autorelease],
+						   [[[synthesizer uniformSpecifications] copy] autorelease],
+						   nil];
+			
+			if (sSynthesizedShaders == nil)  sSynthesizedShaders = [[NSMutableDictionary alloc] init];
+			[sSynthesizedShaders setObject:synthesized forKey:canonicalConfiguration];
+		}
+	}
+	else
+	{
+		OOLog(@"material.synthesis.reuse", @"Reusing synthesized shader for material \"%@\" of \"%@\".", materialKey, entityName);
+	}
 	
-	BOOL OK = [synthesizer run];
+	BOOL OK = (synthesized != nil);
 	if (OK)
 	{
-		*outVertexShader = [[synthesizer vertexShader] retain];
-		*outFragmentShader = [[synthesizer fragmentShader] retain];
-		*outTextureSpecs = [[synthesizer textureSpecifications] retain];
-		*outUniformSpecs = [[synthesizer uniformSpecifications] retain];
+		*outVertexShader = [[synthesized objectAtIndex:0] retain];
+		*outFragmentShader = [[synthesized objectAtIndex:1] retain];
+		*outTextureSpecs = [[synthesized objectAtIndex:2] retain];
+		*outUniformSpecs = [[synthesized objectAtIndex:3] retain];
 	}
 	else
 	{
@@ -302,13 +336,13 @@ BOOL OOSynthesizeMaterialShader(NSDictionary *configuration, NSString *materialK
 
 @implementation OODefaultShaderSynthesizer
 
-- (id) initWithMaterialConfiguration:(NSDictionary *)configuration
-						 materialKey:(NSString *)materialKey
-						  entityName:(NSString *)name
+- (id) initWithCanonicalConfiguration:(NSDictionary *)configuration
+						  materialKey:(NSString *)materialKey
+						   entityName:(NSString *)name
 {
 	if ((self = [super init]))
 	{
-		_configuration = [CanonicalizeMaterialSpecifier(configuration, materialKey) retain];
+		_configuration = [configuration retain];
 		_materialKey = [materialKey copy];
 		_entityName = [_entityName copy];
 	}
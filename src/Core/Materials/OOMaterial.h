@@ -68,6 +68,15 @@ SOFTWARE.
 // Only used by shader material, but defined for all materials for convenience.
 - (void) setBindingTarget:(id<OOWeakReferenceSupport>)target;
 
+/*	True if applying the material gives different results depending on the
+	binding target (bound or randomised uniforms). Materials for which this
+	is false can be shared between instances of a mesh when drawing.
+*/
+- (BOOL) dependsOnBindingTarget;
+
+// Identifies the program and textures the material applies; see -[OODrawable renderStateKey].
+- (NSUInteger) renderStateKey;
+
 // True if material wants three-component cube map texture coordinates.
 - (BOOL) wantsNormalsAsTextureCoordinates;
 
@@ -28,6 +28,7 @@ SOFTWARE.
 #import "OOMaterial.h"
 #import "OOFunctionAttributes.h"
 #import "OOLogging.h"
+#import "OORenderQueue.h"
 
 
 static OOMaterial *sActiveMaterial = nil;
@@ -66,6 +67,7 @@ static OOMaterial *sActiveMaterial = nil;
 // Make this the current GL shader program.
 - (void)apply
 {
+	OOCountRenderStateChange(kOORenderStateChangeMaterial);
 	[sActiveMaterial unapplyWithNext:self];
 	[sActiveMaterial release];
 	sActiveMaterial = nil;
@@ -109,6 +111,18 @@ static OOMaterial *sActiveMaterial = nil;
 }
 
 
+- (BOOL) dependsOnBindingTarget
+{
+	return NO;
+}
+
+
+- (NSUInteger) renderStateKey
+{
+	return (NSUInteger)[self class];
+}
+
+
 - (BOOL) wantsNormalsAsTextureCoordinates
 {
 	return NO;
@@ -134,6 +134,12 @@ SOFTWARE.
 }
 
 
+- (NSUInteger) renderStateKey
+{
+	return (NSUInteger)_diffuseMap ^ ((NSUInteger)_emissionMap >> 4);
+}
+
+
 - (NSString *) descriptionComponents
 {
 	NSMutableArray *bits = [NSMutableArray array];
@@ -175,7 +181,7 @@ SOFTWARE.
 	
 	if (_diffuseMap != nil)
 	{
-		OOGL(glActiveTextureARB(textureUnit++));
+		OOGLActiveTexture(textureUnit++);
 		OOGL(glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE_ARB));
 		OOGL(glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB_ARB, GL_MODULATE));
 		[_diffuseMap apply];
@@ -183,7 +189,7 @@ SOFTWARE.
 	
 	if (_emissionMap != nil)
 	{
-		OOGL(glActiveTextureARB(textureUnit++));
+		OOGLActiveTexture(textureUnit++);
 		OOGL(glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE_ARB));
 		OOGL(glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB_ARB, GL_ADD));
 		[_emissionMap apply];
@@ -193,7 +199,7 @@ SOFTWARE.
 	
 	if (textureUnit > GL_TEXTURE1_ARB)
 	{
-		OOGL(glActiveTextureARB(GL_TEXTURE0_ARB));
+		OOGLActiveTexture(GL_TEXTURE0_ARB);
 	}
 }
 
@@ -208,11 +214,11 @@ SOFTWARE.
 	i = [next isKindOfClass:[OOMultiTextureMaterial class]] ? [(OOMultiTextureMaterial *)next textureUnitCount] : 0;
 	for (; i != _unitsUsed; ++i)
 	{
-		OOGL(glActiveTextureARB(GL_TEXTURE0_ARB + i));
+		OOGLActiveTexture(GL_TEXTURE0_ARB + i);
 		[OOTexture applyNone];
 		OOGL(glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE));
 	}
-	OOGL(glActiveTextureARB(GL_TEXTURE0_ARB));
+	OOGLActiveTexture(GL_TEXTURE0_ARB);
 }
 
 
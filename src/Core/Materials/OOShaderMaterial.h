@@ -56,11 +56,13 @@ typedef uint16_t OOUniformConvertOptions;
 @private
 	OOShaderProgram					*shaderProgram;
 	NSMutableDictionary				*uniforms;
+	NSArray							*applyOrder;		// uniforms grouped by binding reference, built on demand.
 	
 	uint32_t						texCount;
 	OOTexture						**textures;
 	
 	OOWeakReference					*bindingTarget;
+	BOOL							dependsOnBindingTarget;
 }
 
 + (BOOL)configurationDictionarySpecifiesShaderMaterial:(NSDictionary *)configuration;
@@ -58,6 +58,7 @@ NSString * const kOOIsSynthesizedMaterialMacrosKey = @"_oo_synthesized_material_
 
 static BOOL GetShaderSource(NSString *fileName, NSString *shaderType, NSString *prefix, NSString **outResult);
 static NSString *MacrosToString(NSDictionary *macros);
+static NSComparisonResult CompareUniformBindingReferences(id a, id b, void *context);
 
 
 @interface OOShaderMaterial (OOPrivate)
@@ -68,6 +69,9 @@ static NSString *MacrosToString(NSDictionary *macros);
 // Load up an array of texture objects.
 - (void) addTexturesFromArray:(NSArray *)textureObjects unitCount:(GLuint)max;
 
+// Add, replace or (if uniform is nil) remove a uniform.
+- (void) setUniform:(OOShaderUniform *)uniform forName:(NSString *)uniformName;
+
 @end
 
 
@@ -274,6 +278,7 @@ static NSString *MacrosToString(NSDictionary *macros);
 	
 	[shaderProgram release];
 	[uniforms release];
+	[applyOrder release];
 	
 	if (textures != NULL)
 	{
@@ -307,14 +312,15 @@ static NSString *MacrosToString(NSDictionary *macros);
 	if (uniform != nil)
 	{
 		OOLog(@"shader.uniform.set", @"Set up uniform %@", uniform);
-		[uniforms setObject:uniform forKey:uniformName];
+		[self setUniform:uniform forName:uniformName];
 		[uniform release];
+		dependsOnBindingTarget = YES;
 		return YES;
 	}
 	else
 	{
 		OOLog(@"shader.uniform.unSet", @"Did not set uniform \"%@\"", uniformName);
-		[uniforms removeObjectForKey:uniformName];
+		[self setUniform:nil forName:uniformName];
 		return NO;
 	}
 }
@@ -357,13 +363,13 @@ static NSString *MacrosToString(NSDictionary *macros);
 	if (uniform != nil)
 	{
 		OOLog(@"shader.uniform.set", @"Set up uniform %@", uniform);
-		[uniforms setObject:uniform forKey:uniformName];
+		[self setUniform:uniform forName:uniformName];
 		[uniform release];
 	}
 	else
 	{
 		OOLog(@"shader.uniform.unSet", @"Did not set uniform \"%@\"", uniformName);
-		[uniforms removeObjectForKey:uniformName];
+		[self setUniform:nil forName:uniformName];
 	}
 }
 
@@ -380,13 +386,13 @@ static NSString *MacrosToString(NSDictionary *macros);
 	if (uniform != nil)
 	{
 		OOLog(@"shader.uniform.set", @"Set up uniform %@", uniform);
-		[uniforms setObject:uniform forKey:uniformName];
+		[self setUniform:uniform forName:uniformName];
 		[uniform release];
 	}
 	else
 	{
 		OOLog(@"shader.uniform.unSet", @"Did not set uniform \"%@\"", uniformName);
-		[uniforms removeObjectForKey:uniformName];
+		[self setUniform:nil forName:uniformName];
 	}
 }
 
@@ -403,13 +409,13 @@ static NSString *MacrosToString(NSDictionary *macros);
 	if (uniform != nil)
 	{
 		OOLog(@"shader.uniform.set", @"Set up uniform %@", uniform);
-		[uniforms setObject:uniform forKey:uniformName];
+		[self setUniform:uniform forName:uniformName];
 		[uniform release];
 	}
 	else
 	{
 		OOLog(@"shader.uniform.unSet", @"Did not set uniform \"%@\"", uniformName);
-		[uniforms removeObjectForKey:uniformName];
+		[self setUniform:nil forName:uniformName];
 	}
 }
 
@@ -441,13 +447,13 @@ static NSString *MacrosToString(NSDictionary *macros);
 	if (uniform != nil)
 	{
 		OOLog(@"shader.uniform.set", @"Set up uniform %@", uniform);
-		[uniforms setObject:uniform forKey:uniformName];
+		[self setUniform:uniform forName:uniformName];
 		[uniform release];
 	}
 	else
 	{
 		OOLog(@"shader.uniform.unSet", @"Did not set uniform \"%@\"", uniformName);
-		[uniforms removeObjectForKey:uniformName];
+		[self setUniform:nil forName:uniformName];
 	}
 }
 
@@ -465,13 +471,13 @@ static NSString *MacrosToString(NSDictionary *macros);
 	if (uniform != nil)
 	{
 		OOLog(@"shader.uniform.set", @"Set up uniform %@", uniform);
-		[uniforms setObject:uniform forKey:uniformName];
+		[self setUniform:uniform forName:uniformName];
 		[uniform release];
 	}
 	else
 	{
 		OOLog(@"shader.uniform.unSet", @"Did not set uniform \"%@\"", uniformName);
-		[uniforms removeObjectForKey:uniformName];
+		[self setUniform:nil forName:uniformName];
 	}
 }
 
@@ -551,6 +557,8 @@ static NSString *MacrosToString(NSDictionary *macros);
 		}
 		
 		// Transform random values to concrete values
+		if ([type hasPrefix:@"random"])  dependsOnBindingTarget = YES;
+		
 		if ([type isEqualToString:@"randomFloat"])
 		{
 			type = @"float";
@@ -655,9 +663,11 @@ static NSString *MacrosToString(NSDictionary *macros);
 
 - (BOOL)doApply
 {
-	NSEnumerator			*uniformEnum = nil;
 	OOShaderUniform			*uniform = nil;
+	OOWeakReference			*reference = nil, *currentReference = nil;
+	id						currentObject = nil;
 	uint32_t				i;
+	NSUInteger				u, count;
 	
 	OO_ENTER_OPENGL();
 	
@@ -666,16 +676,29 @@ static NSString *MacrosToString(NSDictionary *macros);
 	
 	for (i = 0; i != texCount; ++i)
 	{
-		OOGL(glActiveTextureARB(GL_TEXTURE0_ARB + i));
+		OOGLActiveTexture(GL_TEXTURE0_ARB + i);
 		[textures[i] apply];
 	}
-	if (texCount > 1)  OOGL(glActiveTextureARB(GL_TEXTURE0_ARB));
+	if (texCount > 1)  OOGLActiveTexture(GL_TEXTURE0_ARB);
+	
+	if (applyOrder == nil)
+	{
+		applyOrder = [[[uniforms allValues] sortedArrayUsingFunction:CompareUniformBindingReferences context:NULL] retain];
+	}
 	
 	@try
 	{
-		for (uniformEnum = [uniforms objectEnumerator]; (uniform = [uniformEnum nextObject]); )
+		// Resolve each bound object once for all the uniforms bound to it.
+		for (u = 0, count = [applyOrder count]; u != count; ++u)
 		{
-			[uniform apply];
+			uniform = [applyOrder objectAtIndex:u];
+			reference = [uniform bindingReference];
+			if (reference != currentReference)
+			{
+				currentReference = reference;
+				currentObject = [reference weakRefUnderlyingObject];
+			}
+			[uniform applyWithBoundObject:currentObject];
 		}
 	}
 	@catch (id exception) {}
@@ -734,10 +757,10 @@ static NSString *MacrosToString(NSDictionary *macros);
 		count = texCount ? texCount : 1;
 		for (i = 0; i != count; ++i)
 		{
-			OOGL(glActiveTextureARB(GL_TEXTURE0_ARB + i));
+			OOGLActiveTexture(GL_TEXTURE0_ARB + i);
 			[OOTexture applyNone];
 		}
-		if (count != 1)  OOGL(glActiveTextureARB(GL_TEXTURE0_ARB));
+		if (count != 1)  OOGLActiveTexture(GL_TEXTURE0_ARB);
 	}
 }
 
@@ -745,11 +768,26 @@ static NSString *MacrosToString(NSDictionary *macros);
 - (void)setBindingTarget:(id<OOWeakReferenceSupport>)target
 {
 	[[uniforms allValues] makeObjectsPerformSelector:@selector(setBindingTarget:) withObject:target];
+	DESTROY(applyOrder);
 	[bindingTarget release];
 	bindingTarget = [target weakRetain];
 }
 
 
+- (BOOL) dependsOnBindingTarget
+{
+	return dependsOnBindingTarget;
+}
+
+
+- (NSUInteger) renderStateKey
+{
+	NSUInteger key = (NSUInteger)shaderProgram;
+	if (texCount != 0)  key ^= (NSUInteger)textures[0] >> 4;
+	return key;
+}
+
+
 - (BOOL) permitSpecular
 {
 	return YES;
@@ -807,9 +845,30 @@ static NSString *MacrosToString(NSDictionary *macros);
 	}
 }
 
+
+- (void) setUniform:(OOShaderUniform *)uniform forName:(NSString *)uniformName
+{
+	if (uniform != nil)  [uniforms setObject:uniform forKey:uniformName];
+	else  [uniforms removeObjectForKey:uniformName];
+	
+	DESTROY(applyOrder);
+}
+
 @end
 
 
+// Constant uniforms (nil reference) first, then bindings grouped by the object they're bound to.
+static NSComparisonResult CompareUniformBindingReferences(id a, id b, void *context)
+{
+	uintptr_t refA = (uintptr_t)[(OOShaderUniform *)a bindingReference];
+	uintptr_t refB = (uintptr_t)[(OOShaderUniform *)b bindingReference];
+	
+	if (refA < refB)  return NSOrderedAscending;
+	if (refA > refB)  return NSOrderedDescending;
+	return NSOrderedSame;
+}
+
+
 static NSString *MacrosToString(NSDictionary *macros)
 {
 	NSMutableString			*result = nil;
@@ -42,6 +42,9 @@ SOFTWARE.
 @private
 	GLhandleARB						program;
 	NSString						*key;
+	
+	struct OOShaderUniformCacheEntry	*uniformCache;	// Last value uploaded to each uniform location, indexed by location.
+	GLint							uniformCacheCount;
 }
 
 + (id) shaderProgramWithVertexShader:(NSString *)vertexShaderSource
@@ -63,6 +66,14 @@ SOFTWARE.
 
 - (GLhandleARB) program;
 
+/*	Record the value about to be uploaded to the uniform at location, and
+	return NO if the uniform already has that value. Uniform values belong to
+	the program rather than the material, so this also catches redundant
+	uploads by different materials sharing a program. The program must be
+	active. Only intended for use by OOShaderUniform.
+*/
+- (BOOL) updateUniformCacheAtLocation:(GLint)location withValue:(const void *)bytes size:(size_t)size;
+
 @end
 
 #endif // OO_SHADERS
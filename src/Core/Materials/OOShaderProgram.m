@@ -37,16 +37,60 @@ SOFTWARE.
 #import "OOMacroOpenGL.h"
 #import "OOCollectionExtractors.h"
 #import "OODebugFlags.h"
+#import "OORenderQueue.h"
+
+#if OO_PROGRAM_BINARY
+#import "OOCacheManager.h"
+#endif
 
 
 static NSMutableDictionary		*sShaderCache = nil;
 static OOShaderProgram			*sActiveProgram = nil;
 
 
+enum
+{
+	kMaxCachedUniformLocation	= 255		// Uniforms at higher locations are always uploaded.
+};
+
+
+struct OOShaderUniformCacheEntry
+{
+	GLfloat						value[16];	// Large enough for a matrix.
+	uint8_t						size;		// 0 if nothing has been uploaded through the cache.
+};
+
+
 static BOOL GetShaderSource(NSString *fileName, NSString *shaderType, NSString *prefix, NSString **outResult);
 static NSString *GetGLSLInfoLog(GLhandleARB shaderObject);
 
 
+#if OO_PROGRAM_BINARY
+/*	Linked programs are kept on disk, in the driver's own binary format, so
+	shaders seen in an earlier session needn't be compiled again. Files are
+	keyed by everything that goes into the program: the complete sources
+	(which include the macro definitions in the prefix) and the attribute
+	bindings. Binaries are only valid for the driver that produced them, so
+	the driver's name and version are part of the key. The folder is kept
+	under shader-binary-cache-megabytes (default 64; 0 disables the cache)
+	by removing the least recently used binaries, which is also how binaries
+	from an earlier driver go away. Bump kProgramBinaryFormatVersion if the
+	way programs are built changes.
+*/
+enum
+{
+	kProgramBinaryFormatVersion				= 1,
+	kDefaultProgramBinaryCacheMegabytes		= 64
+};
+
+static NSString *ProgramBinaryCacheDirectory(void);
+static NSString *ProgramBinaryKey(NSString *vertexSource, NSString *fragmentSource, NSString *prefixString, NSDictionary *attributeBindings);
+static NSString *ProgramBinaryFilePath(NSString *directory, NSString *key);
+static GLhandleARB NewProgramFromBinary(NSString *path, NSString *key, NSString *name);
+static void WriteProgramBinary(GLhandleARB program, NSString *path, NSString *key);
+#endif
+
+
 @interface OOShaderProgram (OOPrivate)
 
 - (id)initWithVertexShaderSource:(NSString *)vertexSource
@@ -165,8 +209,11 @@ static NSString *GetGLSLInfoLog(GLhandleARB shaderObject);
 		[key release];
 	}
 	
+	OOGLForgetProgram(program);
 	OOGL(glDeleteObjectARB(program));
 	
+	free(uniformCache);
+	
 	[super dealloc];
 }
 
@@ -179,7 +226,8 @@ static NSString *GetGLSLInfoLog(GLhandleARB shaderObject);
 	{
 		[sActiveProgram release];
 		sActiveProgram = [self retain];
-		OOGL(glUseProgramObjectARB(program));
+		OOGLUseProgram(program);
+		OOCountRenderStateChange(kOORenderStateChangeProgram);
 	}
 }
 
@@ -192,7 +240,7 @@ static NSString *GetGLSLInfoLog(GLhandleARB shaderObject);
 	{
 		[sActiveProgram release];
 		sActiveProgram = nil;
-		OOGL(glUseProgramObjectARB(NULL_SHADER));
+		OOGLUseProgram(NULL_SHADER);
 	}
 }
 
@@ -202,6 +250,33 @@ static NSString *GetGLSLInfoLog(GLhandleARB shaderObject);
 	return program;
 }
 
+
+- (BOOL) updateUniformCacheAtLocation:(GLint)location withValue:(const void *)bytes size:(size_t)size
+{
+	NSParameterAssert(size <= sizeof uniformCache->value);
+	
+	if (EXPECT_NOT(location < 0 || location > kMaxCachedUniformLocation))  return YES;
+	
+	if (location >= uniformCacheCount)
+	{
+		GLint newCount = MAX(MAX(location + 1, uniformCacheCount * 2), 16);
+		newCount = MIN(newCount, kMaxCachedUniformLocation + 1);
+		struct OOShaderUniformCacheEntry *newCache = realloc(uniformCache, sizeof *newCache * newCount);
+		if (EXPECT_NOT(newCache == NULL))  return YES;
+		
+		memset(newCache + uniformCacheCount, 0, sizeof *newCache * (newCount - uniformCacheCount));
+		uniformCache = newCache;
+		uniformCacheCount = newCount;
+	}
+	
+	struct OOShaderUniformCacheEntry *entry = &uniformCache[location];
+	if (entry->size == size && memcmp(entry->value, bytes, size) == 0)  return NO;
+	
+	memcpy(entry->value, bytes, size);
+	entry->size = size;
+	return YES;
+}
+
 @end
 
 
@@ -290,6 +365,11 @@ static BOOL ValidateShaderObject(GLhandleARB object, NSString *name)
 	const GLcharARB			*sourceStrings[3] = { "", "#line 0\n", NULL };
 	GLhandleARB				vertexShader = NULL_SHADER;
 	GLhandleARB				fragmentShader = NULL_SHADER;
+	BOOL					fromBinary = NO;
+#if OO_PROGRAM_BINARY
+	NSString				*binaryKey = nil;
+	NSString				*binaryPath = nil;
+#endif
 	
 	OO_ENTER_OPENGL();
 	
@@ -298,12 +378,22 @@ static BOOL ValidateShaderObject(GLhandleARB object, NSString *name)
 	
 	if (OK && vertexSource == nil && fragmentSource == nil)  OK = NO;	// Must have at least one shader!
 	
+#if OO_PROGRAM_BINARY
+	if (OK && (binaryPath = ProgramBinaryCacheDirectory()) != nil)
+	{
+		binaryKey = ProgramBinaryKey(vertexSource, fragmentSource, prefixString, attributeBindings);
+		binaryPath = ProgramBinaryFilePath(binaryPath, binaryKey);
+		program = NewProgramFromBinary(binaryPath, binaryKey, [NSString stringWithFormat:@"%@/%@", vertexName, fragmentName]);
+		fromBinary = (program != NULL_SHADER);
+	}
+#endif
+	
 	if (OK && prefixString != nil)
 	{
 		sourceStrings[0] = [prefixString UTF8String];
 	}
 	
-	if (OK && vertexSource != nil)
+	if (OK && !fromBinary && vertexSource != nil)
 	{
 		// Compile vertex shader.
 		OOGL(vertexShader = glCreateShaderObjectARB(GL_VERTEX_SHADER_ARB));
@@ -318,7 +408,7 @@ static BOOL ValidateShaderObject(GLhandleARB object, NSString *name)
 		else  OK = NO;
 	}
 	
-	if (OK && fragmentSource != nil)
+	if (OK && !fromBinary && fragmentSource != nil)
 	{
 		// Compile fragment shader.
 		OOGL(fragmentShader = glCreateShaderObjectARB(GL_FRAGMENT_SHADER_ARB));
@@ -333,7 +423,7 @@ static BOOL ValidateShaderObject(GLhandleARB object, NSString *name)
 		else  OK = NO;
 	}
 	
-	if (OK)
+	if (OK && !fromBinary)
 	{
 		// Link shader.
 		OOGL(program = glCreateProgramObjectARB());
@@ -342,9 +432,15 @@ static BOOL ValidateShaderObject(GLhandleARB object, NSString *name)
 			if (vertexShader != NULL_SHADER)  OOGL(glAttachObjectARB(program, vertexShader));
 			if (fragmentShader != NULL_SHADER)  OOGL(glAttachObjectARB(program, fragmentShader));
 			[self bindAttributes:attributeBindings];
+#if OO_PROGRAM_BINARY
+			if (binaryKey != nil)  OOGL(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+#endif
 			OOGL(glLinkProgramARB(program));
 			
 			OK = ValidateShaderObject(program, [NSString stringWithFormat:@"%@/%@", vertexName, fragmentName]);
+#if OO_PROGRAM_BINARY
+			if (OK && binaryKey != nil)  WriteProgramBinary(program, binaryPath, binaryKey);
+#endif
 		}
 		else  OK = NO;
 	}
@@ -462,4 +558,127 @@ static NSString *GetGLSLInfoLog(GLhandleARB shaderObject)
 	return result;
 }
 
+
+#if OO_PROGRAM_BINARY
+
+static NSString * const		kProgramBinaryExtension = @"oosbin";
+
+static NSString				*sProgramBinaryDirectory = nil;
+static NSString				*sDriverString = nil;
+static unsigned long long	sProgramBinaryCacheSizeLimit;
+
+
+// nil if program binaries aren't supported or cached, or the folder can't be created.
+static NSString *ProgramBinaryCacheDirectory(void)
+{
+	static BOOL		initialized = NO;
+	
+	if (!initialized)
+	{
+		initialized = YES;
+		
+		OOOpenGLExtensionManager *extMgr = [OOOpenGLExtensionManager sharedManager];
+		sProgramBinaryCacheSizeLimit = (unsigned long long)[[NSUserDefaults standardUserDefaults] oo_unsignedIntegerForKey:@"shader-binary-cache-megabytes" defaultValue:kDefaultProgramBinaryCacheMegabytes] << 20;
+		if ([extMgr programBinarySupported] && sProgramBinaryCacheSizeLimit != 0)
+		{
+			OO_ENTER_OPENGL();
+			
+			sDriverString = [[NSString alloc] initWithFormat:@"%@\n%@\n%s", [extMgr vendorString], [extMgr rendererString], (const char *)glGetString(GL_VERSION)];
+			sProgramBinaryDirectory = [OOCacheFolderPath(@"Shader Binaries") retain];
+			
+			if (sProgramBinaryDirectory == nil)
+			{
+				OOLog(@"shader.binaryCache.error", @"Could not create shader binary cache folder; shaders will be compiled every session.");
+			}
+		}
+	}
+	
+	return sProgramBinaryDirectory;
+}
+
+
+static NSString *ProgramBinaryKey(NSString *vertexSource, NSString *fragmentSource, NSString *prefixString, NSDictionary *attributeBindings)
+{
+	NSMutableString *result = [NSMutableString stringWithFormat:@"%u\n%@\n", kProgramBinaryFormatVersion, sDriverString];
+	
+	NSEnumerator *nameEnum = nil;
+	NSString *name = nil;
+	for (nameEnum = [[[attributeBindings allKeys] sortedArrayUsingSelector:@selector(compare:)] objectEnumerator]; (name = [nameEnum nextObject]); )
+	{
+		[result appendFormat:@"%@=%u\n", name, [attributeBindings oo_unsignedIntForKey:name]];
+	}
+	
+	[result appendFormat:@"----\n%@\n----\n%@\n----\n%@", prefixString ?: (NSString *)@"", vertexSource ?: (NSString *)@"", fragmentSource ?: (NSString *)@""];
+	return result;
+}
+
+
+static NSString *ProgramBinaryFilePath(NSString *directory, NSString *key)
+{
+	return OOCacheFilePath(directory, key, kProgramBinaryExtension);
+}
+
+
+/*	Returns a linked program, or NULL_SHADER if there is no usable binary.
+	A binary the driver rejects is deleted, so it's replaced once the program
+	has been compiled.
+*/
+static GLhandleARB NewProgramFromBinary(NSString *path, NSString *key, NSString *name)
+{
+	NSData				*data = OOReadCacheFile(path, key);	// Stored as the binary format followed by the binary.
+	uint32_t			binaryFormat;
+	GLhandleARB			program = NULL_SHADER;
+	GLint				status;
+	
+	OO_ENTER_OPENGL();
+	
+	if ([data length] <= sizeof binaryFormat)  return NULL_SHADER;
+	[data getBytes:&binaryFormat length:sizeof binaryFormat];
+	
+	OOGL(program = glCreateProgramObjectARB());
+	if (program == NULL_SHADER)  return NULL_SHADER;
+	
+	OOGL(glProgramBinary(program, binaryFormat, (const char *)[data bytes] + sizeof binaryFormat, [data length] - sizeof binaryFormat));
+	OOGL(glGetObjectParameterivARB(program, GL_OBJECT_LINK_STATUS_ARB, &status));
+	if (status == GL_FALSE)
+	{
+		// Typically the driver has been updated without changing its version string.
+		OOLog(@"shader.binaryCache.rejected", @"Cached binary for shader program %@ was rejected by the driver, compiling instead.", name);
+		OOGL(glDeleteObjectARB(program));
+		remove([path fileSystemRepresentation]);
+		return NULL_SHADER;
+	}
+	
+	OOLog(@"shader.binaryCache.load", @"Loaded shader program %@ from binary cache.", name);
+	return program;
+}
+
+
+static void WriteProgramBinary(GLhandleARB program, NSString *path, NSString *key)
+{
+	if (![[OOCacheManager sharedCache] allowCacheWrites])  return;
+	
+	OO_ENTER_OPENGL();
+	
+	GLint length = 0;
+	OOGL(glGetObjectParameterivARB(program, GL_PROGRAM_BINARY_LENGTH, &length));
+	if (length <= 0)  return;
+	
+	uint32_t		binaryFormat;
+	NSMutableData	*data = [NSMutableData dataWithLength:sizeof binaryFormat + length];
+	GLenum			format = 0;
+	GLsizei			actualLength = 0;
+	
+	OOGL(glGetProgramBinary(program, length, &actualLength, &format, (char *)[data mutableBytes] + sizeof binaryFormat));
+	if (actualLength <= 0)  return;
+	
+	binaryFormat = format;
+	memcpy([data mutableBytes], &binaryFormat, sizeof binaryFormat);
+	[data setLength:sizeof binaryFormat + actualLength];
+	
+	OOWriteCacheFile(path, key, data, sProgramBinaryCacheSizeLimit);
+}
+
+#endif	// OO_PROGRAM_BINARY
+
 #endif // OO_SHADERS
@@ -4,6 +4,9 @@ OOShaderUniform.h
 
 Manages a uniform variable for OOShaderMaterial.
 
+Values are only uploaded when they differ from the last value uploaded to the
+same location of the shader program, which is tracked by OOShaderProgram.
+
 
 Copyright (C) 2007-2013 Jens Ayton
 
@@ -34,13 +37,14 @@ SOFTWARE.
 
 #import "OOMaths.h"
 
-@class OOColor;
+@class OOColor, OOWeakReference;
 
 
 @interface OOShaderUniform: NSObject
 {
 @private
 	NSString					*name;
+	OOShaderProgram				*program;
 	GLint						location;
 	uint8_t						isBinding: 1,
 								// flags that apply only to bindings:
@@ -85,8 +89,21 @@ SOFTWARE.
 
 - (void)apply;
 
+/*	Bindings to the same object share a weak reference, so a material can
+	resolve it once for all its uniforms bound to that object and apply them
+	with -applyWithBoundObject:. Returns nil for constant uniforms, which
+	ignore the object passed.
+*/
+- (OOWeakReference *)bindingReference;
+- (void)applyWithBoundObject:(id)object;
+
 - (void)setBindingTarget:(id<OOWeakReferenceSupport>)target;
 
+// Uniform values uploaded and skipped as unchanged since the last reset, for the FPS display.
++ (void)resetUploadStatistics;
++ (NSUInteger)uploadCount;
++ (NSUInteger)skippedUploadCount;
+
 @end
 
 #endif // OO_SHADERS
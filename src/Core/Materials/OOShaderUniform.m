@@ -38,18 +38,41 @@ SOFTWARE.
 #import "OOShaderUniformMethodType.h"
 
 
+static NSUInteger sUploadCount;
+static NSUInteger sSkippedUploadCount;
+
+
 OOINLINE BOOL ValidBindingType(OOShaderUniformType type)
 {
 	return kOOShaderUniformTypeInt <= type && type <= kOOShaderUniformTypeDouble;
 }
 
 
+OOINLINE BOOL UniformChanged(OOShaderProgram *program, GLint location, const void *bytes, size_t size)
+{
+	if ([program updateUniformCacheAtLocation:location withValue:bytes size:size])
+	{
+		sUploadCount++;
+		return YES;
+	}
+	sSkippedUploadCount++;
+	return NO;
+}
+
+
+static void UploadInt(OOShaderProgram *program, GLint location, GLint value);
+static void UploadFloat(OOShaderProgram *program, GLint location, GLfloat value);
+static void UploadVector2(OOShaderProgram *program, GLint location, const GLfloat value[2]);
+static void UploadVector4(OOShaderProgram *program, GLint location, const GLfloat value[4]);
+static void UploadMatrix(OOShaderProgram *program, GLint location, OOMatrix value);
+
+
 @interface OOShaderUniform (OOPrivate)
 
 - (id)initWithName:(NSString *)uniformName shaderProgram:(OOShaderProgram *)shaderProgram;
 
 - (void)applySimple;
-- (void)applyBinding;
+- (void)applyBindingWithObject:(id)object;
 
 @end
 
@@ -184,6 +207,7 @@ OOINLINE BOOL ValidBindingType(OOShaderUniformType type)
 	if (OK)
 	{
 		name = [uniformName retain];
+		program = [shaderProgram retain];
 		isBinding = YES;
 		value.binding.selector = selector;
 		
@@ -207,6 +231,7 @@ OOINLINE BOOL ValidBindingType(OOShaderUniformType type)
 - (void)dealloc
 {
 	[name release];
+	[program release];
 	if (isBinding)  [value.binding.object release];
 	
 	[super dealloc];
@@ -308,10 +333,25 @@ OOINLINE BOOL ValidBindingType(OOShaderUniformType type)
 
 - (void)apply
 {
-	
+	[self applyWithBoundObject:isBinding ? [value.binding.object weakRefUnderlyingObject] : nil];
+}
+
+
+- (OOWeakReference *)bindingReference
+{
+	return isBinding ? value.binding.object : nil;
+}
+
+
+- (void)applyWithBoundObject:(id)object
+{
 	if (isBinding)
 	{
-		if (isActiveBinding)  [self applyBinding];
+		/*	Design note: if the object has been dealloced, do nothing. Shaders
+			can specify a default value for uniforms, which will be used when
+			no setting has been provided by the host program.
+		*/
+		if (isActiveBinding && object != nil)  [self applyBindingWithObject:object];
 	}
 	else  [self applySimple];
 }
@@ -402,6 +442,25 @@ OOINLINE BOOL ValidBindingType(OOShaderUniformType type)
 	if (!OK)  OOLog(@"shader.uniform.bind.failed", @"Shader could not bind uniform \"%@\" to -[%@ %@] (%@).", name, [target class], NSStringFromSelector(value.binding.selector), methodProblem);
 }
 
+
++ (void)resetUploadStatistics
+{
+	sUploadCount = 0;
+	sSkippedUploadCount = 0;
+}
+
+
++ (NSUInteger)uploadCount
+{
+	return sUploadCount;
+}
+
+
++ (NSUInteger)skippedUploadCount
+{
+	return sSkippedUploadCount;
+}
+
 @end
 
 
@@ -429,6 +488,7 @@ OOINLINE BOOL ValidBindingType(OOShaderUniformType type)
 	if (OK)
 	{
 		name = [uniformName copy];
+		program = [shaderProgram retain];
 	}
 	
 	if (!OK)
@@ -444,48 +504,39 @@ OOINLINE BOOL ValidBindingType(OOShaderUniformType type)
 	switch (type)
 	{
 		case kOOShaderUniformTypeInt:
-			OOGL(glUniform1iARB(location, value.constInt));
+			UploadInt(program, location, value.constInt);
 			break;
 		
 		case kOOShaderUniformTypeFloat:
-			OOGL(glUniform1fARB(location, value.constFloat));
+			UploadFloat(program, location, value.constFloat);
 			break;
 		
 		case kOOShaderUniformTypeVector:
-			OOGL(glUniform4fvARB(location, 1, value.constVector));
+			UploadVector4(program, location, value.constVector);
 			break;
 		
 		case kOOShaderUniformTypeMatrix:
-			GLUniformMatrix(location, value.constMatrix);
+			UploadMatrix(program, location, value.constMatrix);
 	}
 }
 
 
-- (void)applyBinding
+/*	Each type uploads directly, and the common int and float cases come first,
+	since this is called for every bound uniform of every material drawn.
+	Values that haven't changed since the last upload to the program, such as
+	most heat levels and alert conditions, are skipped by the Upload*()
+	functions.
+*/
+- (void)applyBindingWithObject:(id)object
 {
-	
-	id							object = nil;
 	GLint						iVal;
 	GLfloat						fVal;
 	Vector						vVal;
 	GLfloat						expVVal[4];
-	OOMatrix					mVal;
 	Quaternion					qVal;
-	NSPoint						pVal = {0};
-	BOOL						isInt = NO, isFloat = NO, isVector = NO, isMatrix = NO, isPoint = NO;
+	NSPoint						pVal;
 	id							objVal = nil;
 	
-	/*	Design note: if the object has been dealloced, or an exception occurs,
-		do nothing. Shaders can specify a default value for uniforms, which
-		will be used when no setting has been provided by the host program.
-		
-		I considered clearing value.binding.object if the underlying object is
-		gone, but adding code to save a small amount of spacein a case that
-		shouldn't occur in normal usage is silly.
-	*/
-	object = [value.binding.object weakRefUnderlyingObject];
-	if (object == nil)  return;
-	
 	switch (type)
 	{
 		case kOOShaderUniformTypeChar:
@@ -497,13 +548,15 @@ OOINLINE BOOL ValidBindingType(OOShaderUniformType type)
 		case kOOShaderUniformTypeLong:
 		case kOOShaderUniformTypeUnsignedLong:
 			iVal = (GLint)OOCallIntegerMethod(object, value.binding.selector, value.binding.method, type);
-			isInt = YES;
+			if (convertClamp)  iVal = iVal ? 1 : 0;
+			UploadInt(program, location, iVal);
 			break;
 		
 		case kOOShaderUniformTypeFloat:
 		case kOOShaderUniformTypeDouble:
 			fVal = OOCallFloatMethod(object, value.binding.selector, value.binding.method, type);
-			isFloat = YES;
+			if (convertClamp)  fVal = OOClamp_0_1_f(fVal);
+			UploadFloat(program, location, fVal);
 			break;
 		
 		case kOOShaderUniformTypeVector:
@@ -513,15 +566,14 @@ OOINLINE BOOL ValidBindingType(OOShaderUniformType type)
 			expVVal[1] = vVal.y;
 			expVVal[2] = vVal.z;
 			expVVal[3] = 1.0f;
-			isVector = YES;
+			UploadVector4(program, location, expVVal);
 			break;
 		
 		case kOOShaderUniformTypeQuaternion:
 			qVal = ((QuaternionReturnMsgSend)value.binding.method)(object, value.binding.selector);
 			if (convertToMatrix)
 			{
-				mVal = OOMatrixForQuaternionRotation(qVal);
-				isMatrix = YES;
+				UploadMatrix(program, location, OOMatrixForQuaternionRotation(qVal));
 			}
 			else
 			{
@@ -529,18 +581,20 @@ OOINLINE BOOL ValidBindingType(OOShaderUniformType type)
 				expVVal[1] = qVal.y;
 				expVVal[2] = qVal.z;
 				expVVal[3] = qVal.w;
-				isVector = YES;
+				UploadVector4(program, location, expVVal);
 			}
 			break;
 		
 		case kOOShaderUniformTypeMatrix:
-			mVal = ((MatrixReturnMsgSend)value.binding.method)(object, value.binding.selector);
-			isMatrix = YES;
+			UploadMatrix(program, location, ((MatrixReturnMsgSend)value.binding.method)(object, value.binding.selector));
 			break;
 		
 		case kOOShaderUniformTypePoint:
 			pVal = ((PointReturnMsgSend)value.binding.method)(object, value.binding.selector);
-			isPoint = YES;
+			{
+				GLfloat v2[2] = { pVal.x, pVal.y };
+				UploadVector2(program, location, v2);
+			}
 			break;
 		
 		case kOOShaderUniformTypeObject:
@@ -548,7 +602,8 @@ OOINLINE BOOL ValidBindingType(OOShaderUniformType type)
 			if ([objVal isKindOfClass:[NSNumber class]])
 			{
 				fVal = [objVal floatValue];
-				isFloat = YES;
+				if (convertClamp)  fVal = OOClamp_0_1_f(fVal);
+				UploadFloat(program, location, fVal);
 			}
 			else if ([objVal isKindOfClass:[OOColor class]])
 			{
@@ -557,36 +612,42 @@ OOINLINE BOOL ValidBindingType(OOShaderUniformType type)
 				expVVal[1] = [color greenComponent];
 				expVVal[2] = [color blueComponent];
 				expVVal[3] = [color alphaComponent];
-				isVector = YES;
+				UploadVector4(program, location, expVVal);
 			}
 			break;
 	}
-	
-	if (isFloat)
-	{
-		if (convertClamp)  fVal = OOClamp_0_1_f(fVal);
-		OOGL(glUniform1fARB(location, fVal));
-	}
-	else if (isInt)
-	{
-		if (convertClamp)  iVal = iVal ? 1 : 0;
-		OOGL(glUniform1iARB(location, iVal));
-	}
-	else if (isPoint)
-	{
-		GLfloat v2[2] = { pVal.x, pVal.y };
-		OOGL(glUniform2fvARB(location, 1, v2));
-	}
-	else if (isVector)
-	{
-		OOGL(glUniform4fvARB(location, 1, expVVal));
-	}
-	else if (isMatrix)
-	{
-		GLUniformMatrix(location, mVal);
-	}
 }
 
 @end
 
+
+static void UploadInt(OOShaderProgram *program, GLint location, GLint value)
+{
+	if (UniformChanged(program, location, &value, sizeof value))  OOGL(glUniform1iARB(location, value));
+}
+
+
+static void UploadFloat(OOShaderProgram *program, GLint location, GLfloat value)
+{
+	if (UniformChanged(program, location, &value, sizeof value))  OOGL(glUniform1fARB(location, value));
+}
+
+
+static void UploadVector2(OOShaderProgram *program, GLint location, const GLfloat value[2])
+{
+	if (UniformChanged(program, location, value, sizeof *value * 2))  OOGL(glUniform2fvARB(location, 1, value));
+}
+
+
+static void UploadVector4(OOShaderProgram *program, GLint location, const GLfloat value[4])
+{
+	if (UniformChanged(program, location, value, sizeof *value * 4))  OOGL(glUniform4fvARB(location, 1, value));
+}
+
+
+static void UploadMatrix(OOShaderProgram *program, GLint location, OOMatrix value)
+{
+	if (UniformChanged(program, location, &value, sizeof value))  GLUniformMatrix(location, value);
+}
+
 #endif // OO_SHADERS
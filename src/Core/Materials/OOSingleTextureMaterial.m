@@ -121,6 +121,12 @@ SOFTWARE.
 }
 
 
+- (NSUInteger) renderStateKey
+{
+	return (NSUInteger)_texture;
+}
+
+
 #ifndef NDEBUG
 - (NSSet *) allTextures
 {
@@ -248,6 +248,12 @@ typedef OOPixMapFormat OOTextureDataFormat;
 //	Forget all cached textures so new texture objects will reload.
 + (void) clearCache;
 
+/*	Bias added to the LOD bias of every mip-mapped texture when it is applied.
+	Positive values select smaller mip levels. Used by the adaptive quality
+	controller.
+*/
++ (void) setExtraLODBias:(float)bias;
+
 // Called by OOGraphicsResetManager as necessary.
 + (void) rebindAllTextures;
 
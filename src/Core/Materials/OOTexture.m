@@ -268,9 +268,9 @@ static NSString *sGlobalTraceContext = nil;
 + (void)applyNone
 {
 	OO_ENTER_OPENGL();
-	OOGL(glBindTexture(GL_TEXTURE_2D, 0));
+	OOGLBindTexture(GL_TEXTURE_2D, 0);
 #if OO_TEXTURE_CUBE_MAP
-	if (OOCubeMapsAvailable())  OOGL(glBindTexture(GL_TEXTURE_CUBE_MAP, 0));
+	if (OOCubeMapsAvailable())  OOGLBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 #endif
 	
 #if GL_EXT_texture_lod_bias
@@ -363,6 +363,12 @@ static NSString *sGlobalTraceContext = nil;
 }
 
 
++ (void) setExtraLODBias:(float)bias
+{
+	gOOTextureInfo.extraLODBias = bias;
+}
+
+
 + (void)rebindAllTextures
 {
 	NSEnumerator			*textureEnum = nil;
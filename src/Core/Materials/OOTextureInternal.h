@@ -68,6 +68,7 @@ SOFTWARE.
 typedef struct OOTextureInfo
 {
 	GLfloat					anisotropyScale;
+	GLfloat					extraLODBias;
 	unsigned				anisotropyAvailable: 1,
 							clampToEdgeAvailable: 1,
 							clientStorageAvailable: 1,
@@ -51,8 +51,30 @@ MA 02110-1301, USA.
 - (void) reloadAllCaches;
 
 - (void)setAllowCacheWrites:(BOOL)flag;
+- (BOOL)allowCacheWrites;
+
+// Folder containing the data cache. Other on-disk caches may keep their files here too.
+- (NSString *)cacheDirectoryPathCreatingIfNecessary:(BOOL)inCreate;
 
 - (void)flush;
 - (void)finishOngoingFlush;	// Wait for flush to complete. Does nothing if async flushing is disabled.
 
 @end
+
+
+/*	File caches: caches kept as one file per entry in a folder next to the
+	data cache, for data too large for the plist (planet textures, shader
+	binaries).
+	
+	Files are named by a hash of their key, and store the full key so that a
+	different key with the same name reads as a miss. Reading a file marks it
+	as recently used. Writing one removes the least recently used files with
+	the same extension once the folder holds more than maxFolderBytes of them.
+	Nothing is written if cache writes are disabled.
+	
+	These use NSFileManager, so they may only be called on the main thread.
+*/
+NSString *OOCacheFolderPath(NSString *folderName);	// Created if necessary. May contain several path components. nil on failure.
+NSString *OOCacheFilePath(NSString *folderPath, NSString *key, NSString *extension);
+NSData *OOReadCacheFile(NSString *path, NSString *key);	// nil if missing or for another key.
+BOOL OOWriteCacheFile(NSString *path, NSString *key, NSData *data, unsigned long long maxFolderBytes);
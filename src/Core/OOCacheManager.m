@@ -28,6 +28,7 @@ MA 02110-1301, USA.
 #import "OOCollectionExtractors.h"
 #import "OOJavaScriptEngine.h"
 #import "NSFileManagerOOExtensions.h"
+#import <utime.h>
 
 
 #define WRITE_ASYNC				1
@@ -64,6 +65,7 @@ static NSString * const kOOLogDataCacheClearSuccess			= @"dataCache.clear.succes
 static NSString * const kOOLogDataCacheParamError			= @"general.error.parameterError.OOCacheManager";
 static NSString * const kOOLogDataCacheBuildPathError		= @"dataCache.write.buildPath.failed";
 static NSString * const kOOLogDataCacheSerializationError	= @"dataCache.write.serialize.failed";
+static NSString * const kOOLogCacheFileWriteFailed			= @"dataCache.file.write.failed";
 
 static NSString * const kCacheKeyVersion					= @"version";
 static NSString * const kCacheKeyEndianTag					= @"endian tag";
@@ -80,6 +82,11 @@ enum
 
 static OOCacheManager *sSingleton = nil;
 
+static const char kCacheFileMagic[4] = { 'O', 'O', 'C', 'F' };
+
+
+static void PruneCacheFolder(NSString *folderPath, NSString *extension, unsigned long long maxBytes);
+
 
 @interface OOCacheManager (Private)
 
@@ -298,6 +305,18 @@ static OOCacheManager *sSingleton = nil;
 	_permitWrites = (flag != NO);
 }
 
+
+- (BOOL)allowCacheWrites
+{
+	return _permitWrites;
+}
+
+
+- (NSString *)cacheDirectoryPathCreatingIfNecessary:(BOOL)inCreate
+{
+	return [[self cachePathCreatingIfNecessary:inCreate] stringByDeletingLastPathComponent];
+}
+
 @end
 
 
@@ -760,3 +779,144 @@ static OOCacheManager *sSingleton = nil;
 
 @end
 #endif	// WRITE_ASYNC
+
+
+NSString *OOCacheFolderPath(NSString *folderName)
+{
+	OOCacheManager			*cache = [OOCacheManager sharedCache];
+	NSString				*path = [cache cacheDirectoryPathCreatingIfNecessary:YES];
+	NSEnumerator			*componentEnum = nil;
+	NSString				*component = nil;
+	
+	for (componentEnum = [[folderName pathComponents] objectEnumerator]; path != nil && (component = [componentEnum nextObject]); )
+	{
+		path = [path stringByAppendingPathComponent:component];
+		if (![cache directoryExists:path create:YES])  path = nil;
+	}
+	
+	return path;
+}
+
+
+NSString *OOCacheFilePath(NSString *folderPath, NSString *key, NSString *extension)
+{
+	// 64-bit FNV-1a hash of the key.
+	uint64_t hash = 14695981039346656037ULL;
+	const unsigned char *bytes = (const unsigned char *)[key UTF8String];
+	while (*bytes != '\0')
+	{
+		hash ^= *bytes++;
+		hash *= 1099511628211ULL;
+	}
+	
+	NSString *name = [NSString stringWithFormat:@"%016llx", (unsigned long long)hash];
+	return [folderPath stringByAppendingPathComponent:[name stringByAppendingPathExtension:extension]];
+}
+
+
+NSData *OOReadCacheFile(NSString *path, NSString *key)
+{
+	NSData					*contents = [NSData dataWithContentsOfFile:path];
+	NSData					*keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+	const char				*bytes = [contents bytes];
+	uint32_t				keyLength = [keyData length];
+	NSUInteger				headerLength = sizeof kCacheFileMagic + sizeof keyLength + keyLength;
+	
+	if ([contents length] < headerLength ||
+		memcmp(bytes, kCacheFileMagic, sizeof kCacheFileMagic) != 0 ||
+		memcmp(bytes + sizeof kCacheFileMagic, &keyLength, sizeof keyLength) != 0 ||
+		memcmp(bytes + sizeof kCacheFileMagic + sizeof keyLength, [keyData bytes], keyLength) != 0)
+	{
+		return nil;
+	}
+	
+	// Mark as recently used, so pruning removes it last.
+	utime([path fileSystemRepresentation], NULL);
+	
+	return [contents subdataWithRange:NSMakeRange(headerLength, [contents length] - headerLength)];
+}
+
+
+BOOL OOWriteCacheFile(NSString *path, NSString *key, NSData *data, unsigned long long maxFolderBytes)
+{
+	if (![[OOCacheManager sharedCache] allowCacheWrites])  return NO;
+	
+	NSData					*keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+	uint32_t				keyLength = [keyData length];
+	
+	// Written under a temporary name and then renamed, so a partly written file is never read.
+	const char *fsPath = [path fileSystemRepresentation];
+	const char *fsTempPath = [[path stringByAppendingPathExtension:@"tmp"] fileSystemRepresentation];
+	
+	BOOL OK = NO;
+	FILE *file = fopen(fsTempPath, "wb");
+	if (file != NULL)
+	{
+		OK = fwrite(kCacheFileMagic, sizeof kCacheFileMagic, 1, file) == 1 &&
+			 fwrite(&keyLength, sizeof keyLength, 1, file) == 1 &&
+			 fwrite([keyData bytes], keyLength, 1, file) == 1 &&
+			 ([data length] == 0 || fwrite([data bytes], [data length], 1, file) == 1);
+		OK = (fclose(file) == 0) && OK;
+	}
+	
+	if (OK && rename(fsTempPath, fsPath) != 0)
+	{
+		// Windows won't rename over an existing file.
+		remove(fsPath);
+		OK = (rename(fsTempPath, fsPath) == 0);
+	}
+	
+	if (OK)
+	{
+		PruneCacheFolder([path stringByDeletingLastPathComponent], [path pathExtension], maxFolderBytes);
+	}
+	else
+	{
+		remove(fsTempPath);
+		OOLog(kOOLogCacheFileWriteFailed, @"Could not write cache file %@.", path);
+	}
+	
+	return OK;
+}
+
+
+static NSComparisonResult CompareModificationDates(id a, id b, void *context)
+{
+	return [[a objectAtIndex:1] compare:[b objectAtIndex:1]];
+}
+
+
+// Remove least recently used files until those with extension fit in maxBytes.
+static void PruneCacheFolder(NSString *folderPath, NSString *extension, unsigned long long maxBytes)
+{
+	NSFileManager			*fmgr = [NSFileManager defaultManager];
+	NSMutableArray			*files = [NSMutableArray array];
+	NSEnumerator			*fileEnum = nil;
+	NSString				*name = nil;
+	NSArray					*file = nil;
+	unsigned long long		totalSize = 0;
+	
+	for (fileEnum = [[fmgr oo_directoryContentsAtPath:folderPath] objectEnumerator]; (name = [fileEnum nextObject]); )
+	{
+		if (![[name pathExtension] isEqualToString:extension])  continue;
+		
+		NSString *path = [folderPath stringByAppendingPathComponent:name];
+		NSDictionary *attributes = [fmgr oo_fileAttributesAtPath:path traverseLink:NO];
+		NSDate *date = [attributes fileModificationDate];
+		if (date == nil)  continue;
+		
+		[files addObject:[NSArray arrayWithObjects:path, date, [NSNumber numberWithUnsignedLongLong:[attributes fileSize]], nil]];
+		totalSize += [attributes fileSize];
+	}
+	
+	if (totalSize <= maxBytes)  return;
+	
+	[files sortUsingFunction:CompareModificationDates context:NULL];
+	for (fileEnum = [files objectEnumerator]; totalSize > maxBytes && (file = [fileEnum nextObject]); )
+	{
+		if ([fmgr oo_removeItemAtPath:[file objectAtIndex:0]])
+		{
+			totalSize -= [[file objectAtIndex:2] unsignedLongLongValue];
+		}
+	}
+}
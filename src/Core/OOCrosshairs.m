@@ -84,7 +84,7 @@ SOFTWARE.
 		OO_ENTER_OPENGL();
 		OOSetOpenGLState(OPENGL_STATE_OVERLAY);
 		
-		OOGL(glPushAttrib(GL_ENABLE_BIT));
+		OOGLPushAttrib(GL_ENABLE_BIT);
 		OOGL(glDisable(GL_LIGHTING));
 		OOGL(glDisable(GL_TEXTURE_2D));
 		OOGL(glPushMatrix());
@@ -93,16 +93,16 @@ SOFTWARE.
 		OOGL(glVertexPointer(2, GL_FLOAT, sizeof (GLfloat) * 6, _data));
 		OOGL(glColorPointer(4, GL_FLOAT, sizeof (GLfloat) * 6, _data + 2));
 		
-		OOGL(glEnableClientState(GL_VERTEX_ARRAY));
-		OOGL(glEnableClientState(GL_COLOR_ARRAY));
+		OOGLEnableClientState(GL_VERTEX_ARRAY);
+		OOGLEnableClientState(GL_COLOR_ARRAY);
 		
 		OOGL(glDrawArrays(GL_LINES, 0, _count * 2));
 		
-		OOGL(glDisableClientState(GL_VERTEX_ARRAY));
-		OOGL(glDisableClientState(GL_COLOR_ARRAY));
+		OOGLDisableClientState(GL_VERTEX_ARRAY);
+		OOGLDisableClientState(GL_COLOR_ARRAY);
 		
 		OOGL(glPopMatrix());
-		OOGL(glPopAttrib());
+		OOGLPopAttrib();
 		
 		OOVerifyOpenGLState();
 		OOCheckOpenGLErrors(@"OOCrosshairs after rendering");
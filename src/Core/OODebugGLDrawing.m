@@ -137,7 +137,7 @@ OODebugWFState OODebugBeginWireframe(BOOL ignoreZ)
 	OODebugWFState state = { .material = [OOMaterial current] };
 	[OOMaterial applyNone];
 	
-	OOGL(glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT | GL_LINE_BIT | GL_POINT_BIT | GL_CURRENT_BIT));
+	OOGLPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT | GL_LINE_BIT | GL_POINT_BIT | GL_CURRENT_BIT);
 	
 	OOGL(glDisable(GL_LIGHTING));
 	OOGL(glDisable(GL_TEXTURE_2D));
@@ -145,12 +145,12 @@ OODebugWFState OODebugBeginWireframe(BOOL ignoreZ)
 	if (ignoreZ)
 	{
 		OOGL(glDisable(GL_DEPTH_TEST));
-		OOGL(glDepthMask(GL_FALSE));
+		OOGLDepthMask(GL_FALSE);
 	}
 	else
 	{
 		OOGL(glEnable(GL_DEPTH_TEST));
-		OOGL(glDepthMask(GL_TRUE));
+		OOGLDepthMask(GL_TRUE);
 	}
 	
 	OOGL(GLScaledLineWidth(1.0f));
@@ -162,7 +162,7 @@ OODebugWFState OODebugBeginWireframe(BOOL ignoreZ)
 void OODebugEndWireframe(OODebugWFState state)
 {
 	OO_ENTER_OPENGL();
-	OOGL(glPopAttrib());
+	OOGLPopAttrib();
 	[state.material apply];
 }
 
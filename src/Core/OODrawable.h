@@ -48,6 +48,12 @@ SOFTWARE.
 // Passed to all materials.
 - (void)setBindingTarget:(id<OOWeakReferenceSupport>)target;
 
+/*	Opaque value used to order drawing so that drawables sharing shader
+	programs and textures are drawn together. Equal keys suggest cheap
+	transitions; the value has no other meaning.
+*/
+- (NSUInteger) renderStateKey;
+
 - (void)dumpSelfState;
 
 #ifndef NDEBUG
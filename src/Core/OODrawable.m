@@ -79,6 +79,12 @@ SOFTWARE.
 }
 
 
+- (NSUInteger) renderStateKey
+{
+	return (NSUInteger)[self class];
+}
+
+
 - (void)dumpSelfState
 {
 	
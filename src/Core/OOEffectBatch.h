@@ -0,0 +1,117 @@
+/*
+
+OOEffectBatch.h
+
+Per-frame collection of additively blended effect geometry: exhaust plumes,
+light particles (flashers, sparks, plasma shots and flashes) and particle
+systems.
+
+During the translucent pass, effects that find an active batch add their
+geometry to it as triangles instead of drawing themselves. Triangles are
+grouped by texture and texture mode, and when the pass is over all groups are
+uploaded into one streaming vertex buffer and drawn with one call per group.
+
+Additive blending doesn't depend on drawing order, so collecting effects
+changes nothing except where they overlap translucent geometry that isn't
+additively blended, which is drawn before them instead of interleaved.
+
+Vertices are stored relative to an origin, normally the viewpoint, so that
+geometry far from the centre of the system keeps its precision.
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OOMaths.h"
+#import "OOOpenGL.h"
+#import "OOGraphicsResetManager.h"
+
+@class OOTexture;
+
+
+typedef struct
+{
+	GLfloat					position[3];
+	GLfloat					s, t;
+	GLfloat					color[4];
+} OOEffectVertex;
+
+
+typedef enum
+{
+	kOOEffectTextureModulate,			// Texture colour and alpha times vertex colour and alpha (GL_MODULATE).
+	kOOEffectTextureAlphaOnly			// Vertex colour, texture alpha times vertex alpha; what GL_BLEND does with the vertex colour as environment colour.
+} OOEffectTextureMode;
+
+
+@interface OOEffectBatch: NSObject <OOGraphicsResetClient>
+{
+@private
+	struct OOEffectBatchGroup	*_groups;
+	NSUInteger				_groupCount;
+	NSUInteger				_groupCapacity;
+	NSUInteger				_vertexCount;
+	Vector					_origin;
+	
+	GLuint					_vertexBuffer;
+	NSUInteger				_drawnVertexCount;
+	NSUInteger				_drawCallCount;
+}
+
+// The batch collecting effects for the current pass, or nil if effects should draw themselves.
++ (OOEffectBatch *) activeBatch;
+
+/*	Make this the active batch. origin is the absolute position that the
+	modelview matrix will be translated to when drawing.
+*/
+- (void) beginWithOrigin:(Vector)origin;
+
+/*	Draw everything collected, with the current modelview matrix as the
+	absolute coordinate system, then empty the batch and deactivate it. The
+	caller is responsible for fog.
+*/
+- (void) drawAndEnd;
+
+/*	Add count vertices, in absolute coordinates, forming count / 3 separate
+	triangles. The texture is not retained, and must stay alive until
+	-drawAndEnd.
+*/
+- (void) addTriangles:(const OOEffectVertex *)vertices
+				count:(NSUInteger)count
+			  texture:(OOTexture *)texture
+				 mode:(OOEffectTextureMode)mode;
+
+/*	Add a square of half-width size centred on centre, oriented by billboard
+	(normally from OOMatrixForBillboard()) and moved depthOffset towards the
+	viewer along the billboard's z axis, textured with the whole texture.
+*/
+- (void) addBillboardAt:(Vector)centre
+				 matrix:(OOMatrix)billboard
+				   size:(GLfloat)size
+			depthOffset:(GLfloat)depthOffset
+				  color:(const GLfloat *)color
+				texture:(OOTexture *)texture
+				   mode:(OOEffectTextureMode)mode;
+
+// Statistics for the most recent -drawAndEnd.
+- (NSUInteger) vertexCount;
+- (NSUInteger) drawCallCount;
+
+@end
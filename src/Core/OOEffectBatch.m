@@ -0,0 +1,402 @@
+/*
+
+OOEffectBatch.m
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OOEffectBatch.h"
+#import "OOTexture.h"
+#import "OOMacroOpenGL.h"
+#import "OOOpenGLExtensionManager.h"
+
+
+enum
+{
+	kMinGroupCapacity			= 4,
+	kMinVertexCapacity			= 96
+};
+
+
+/*	Groups persist between frames so their vertex arrays can be reused;
+	texture is only valid while count is non-zero.
+*/
+struct OOEffectBatchGroup
+{
+	OOTexture				*texture;
+	OOEffectTextureMode		mode;
+	OOEffectVertex			*vertices;
+	NSUInteger				count;
+	NSUInteger				capacity;
+};
+typedef struct OOEffectBatchGroup Group;
+
+
+static OOEffectBatch *sActiveBatch = nil;
+
+
+static void SetVertexPointers(const OOEffectVertex *base);
+static void ApplyTextureMode(OOEffectTextureMode mode);
+
+
+@interface OOEffectBatch (Private)
+
+- (OOEffectVertex *) reserveVertices:(NSUInteger)count texture:(OOTexture *)texture mode:(OOEffectTextureMode)mode;
+- (void) removeAllVertices;
+
+@end
+
+
+@implementation OOEffectBatch
+
++ (OOEffectBatch *) activeBatch
+{
+	return sActiveBatch;
+}
+
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		[[OOGraphicsResetManager sharedManager] registerClient:self];
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	if (sActiveBatch == self)  sActiveBatch = nil;
+	[[OOGraphicsResetManager sharedManager] unregisterClient:self];
+	[self resetGraphicsState];
+	
+	NSUInteger i;
+	for (i = 0; i < _groupCount; i++)
+	{
+		free(_groups[i].vertices);
+	}
+	free(_groups);
+	
+	[super dealloc];
+}
+
+
+- (void) beginWithOrigin:(Vector)origin
+{
+	[self removeAllVertices];
+	_origin = origin;
+	sActiveBatch = self;
+}
+
+
+- (void) drawAndEnd
+{
+	if (sActiveBatch == self)  sActiveBatch = nil;
+	
+	_drawnVertexCount = _vertexCount;
+	_drawCallCount = 0;
+	if (_vertexCount == 0)  return;
+	
+	OO_ENTER_OPENGL();
+	OOSetOpenGLState(OPENGL_STATE_ADDITIVE_BLENDING);
+	
+	OOGLPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT);
+	
+	OOGL(glDisable(GL_LIGHTING));
+	OOGLSetBlending(true);
+	OOGLBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	OOGLDepthMask(GL_FALSE);
+	OOGL(glEnable(GL_TEXTURE_2D));
+	OOGL(glShadeModel(GL_SMOOTH));
+	
+	OOGL(glPushMatrix());
+	GLTranslateOOVector(_origin);
+	
+	/*	All groups go into one buffer, which is orphaned every frame so the
+		driver doesn't have to wait for the previous frame's draws. Without
+		VBOs, each group is drawn from its own array.
+	*/
+	NSUInteger	i, first = 0;
+	BOOL		usingVertexBuffer = NO;
+	
+#if OO_USE_VBO
+	if ([[OOOpenGLExtensionManager sharedManager] vboSupported])
+	{
+		if (_vertexBuffer == 0)  OOGL(glGenBuffersARB(1, &_vertexBuffer));
+		if (_vertexBuffer != 0)
+		{
+			OOGL(glBindBufferARB(GL_ARRAY_BUFFER, _vertexBuffer));
+			OOGL(glBufferDataARB(GL_ARRAY_BUFFER, sizeof (OOEffectVertex) * _vertexCount, NULL, GL_STREAM_DRAW));
+			for (i = 0; i < _groupCount; i++)
+			{
+				Group *group = &_groups[i];
+				if (group->count == 0)  continue;
+				OOGL(glBufferSubDataARB(GL_ARRAY_BUFFER, sizeof (OOEffectVertex) * first, sizeof (OOEffectVertex) * group->count, group->vertices));
+				first += group->count;
+			}
+			usingVertexBuffer = YES;
+		}
+	}
+#endif
+	
+	OOGLEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	OOGLEnableClientState(GL_COLOR_ARRAY);
+	if (usingVertexBuffer)  SetVertexPointers(NULL);
+	
+	first = 0;
+	for (i = 0; i < _groupCount; i++)
+	{
+		Group *group = &_groups[i];
+		if (group->count == 0)  continue;
+		
+		ApplyTextureMode(group->mode);
+		[group->texture apply];
+		
+		if (usingVertexBuffer)
+		{
+			OOGL(glDrawArrays(GL_TRIANGLES, first, group->count));
+		}
+		else
+		{
+			SetVertexPointers(group->vertices);
+			OOGL(glDrawArrays(GL_TRIANGLES, 0, group->count));
+		}
+		
+		first += group->count;
+		_drawCallCount++;
+	}
+	
+#if OO_USE_VBO
+	if (usingVertexBuffer)  OOGL(glBindBufferARB(GL_ARRAY_BUFFER, 0));
+#endif
+	
+	OOGLDisableClientState(GL_COLOR_ARRAY);
+	OOGLDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	[OOTexture applyNone];
+	
+	OOGL(glPopMatrix());
+	OOGLPopAttrib();
+	
+	OOVerifyOpenGLState();
+	OOCheckOpenGLErrors(@"OOEffectBatch after drawing %lu vertices", (unsigned long)_vertexCount);
+	
+	[self removeAllVertices];
+}
+
+
+- (void) addTriangles:(const OOEffectVertex *)vertices
+				count:(NSUInteger)count
+			  texture:(OOTexture *)texture
+				 mode:(OOEffectTextureMode)mode
+{
+	NSParameterAssert(count % 3 == 0);
+	
+	OOEffectVertex *dst = [self reserveVertices:count texture:texture mode:mode];
+	if (dst == NULL)  return;
+	
+	NSUInteger i;
+	for (i = 0; i < count; i++)
+	{
+		dst[i] = vertices[i];
+		dst[i].position[0] -= _origin.x;
+		dst[i].position[1] -= _origin.y;
+		dst[i].position[2] -= _origin.z;
+	}
+}
+
+
+- (void) addBillboardAt:(Vector)centre
+				 matrix:(OOMatrix)billboard
+				   size:(GLfloat)size
+			depthOffset:(GLfloat)depthOffset
+				  color:(const GLfloat *)color
+				texture:(OOTexture *)texture
+				   mode:(OOEffectTextureMode)mode
+{
+	OOEffectVertex *dst = [self reserveVertices:6 texture:texture mode:mode];
+	if (dst == NULL)  return;
+	
+	// The billboard's z axis points away from the viewer.
+	Vector relative = vector_subtract(centre, _origin);
+	const Vector localCorners[4] =
+	{
+		{ -size, -size, -depthOffset },
+		{ +size, -size, -depthOffset },
+		{ +size, +size, -depthOffset },
+		{ -size, +size, -depthOffset }
+	};
+	const GLfloat cornerS[4] = { 0.0f, 1.0f, 1.0f, 0.0f };
+	const GLfloat cornerT[4] = { 1.0f, 1.0f, 0.0f, 0.0f };
+	const unsigned order[6] = { 0, 1, 2, 0, 2, 3 };
+	
+	unsigned i;
+	for (i = 0; i < 6; i++)
+	{
+		unsigned c = order[i];
+		Vector corner = vector_add(relative, OOVectorMultiplyMatrix(localCorners[c], billboard));
+		dst[i] = (OOEffectVertex)
+		{
+			{ corner.x, corner.y, corner.z },
+			cornerS[c], cornerT[c],
+			{ color[0], color[1], color[2], color[3] }
+		};
+	}
+}
+
+
+- (NSUInteger) vertexCount
+{
+	return _drawnVertexCount;
+}
+
+
+- (NSUInteger) drawCallCount
+{
+	return _drawCallCount;
+}
+
+
+- (void) resetGraphicsState
+{
+#if OO_USE_VBO
+	if (_vertexBuffer != 0)
+	{
+		OO_ENTER_OPENGL();
+		OOGL(glDeleteBuffersARB(1, &_vertexBuffer));
+		_vertexBuffer = 0;
+	}
+#endif
+}
+
+@end
+
+
+@implementation OOEffectBatch (Private)
+
+- (OOEffectVertex *) reserveVertices:(NSUInteger)count texture:(OOTexture *)texture mode:(OOEffectTextureMode)mode
+{
+	Group *group = NULL;
+	NSUInteger i;
+	for (i = 0; i < _groupCount; i++)
+	{
+		if (_groups[i].count != 0 && _groups[i].texture == texture && _groups[i].mode == mode)
+		{
+			group = &_groups[i];
+			break;
+		}
+	}
+	
+	if (group == NULL)
+	{
+		// Reuse an empty group's arrays if there is one.
+		for (i = 0; i < _groupCount; i++)
+		{
+			if (_groups[i].count == 0)
+			{
+				group = &_groups[i];
+				break;
+			}
+		}
+	}
+	
+	if (group == NULL)
+	{
+		if (_groupCount == _groupCapacity)
+		{
+			NSUInteger newCapacity = MAX(_groupCapacity * 2, (NSUInteger)kMinGroupCapacity);
+			Group *newGroups = realloc(_groups, sizeof *newGroups * newCapacity);
+			if (newGroups == NULL)  return NULL;
+			_groups = newGroups;
+			_groupCapacity = newCapacity;
+		}
+		
+		group = &_groups[_groupCount++];
+		memset(group, 0, sizeof *group);
+	}
+	
+	if (group->count + count > group->capacity)
+	{
+		NSUInteger newCapacity = MAX(group->capacity * 2, (NSUInteger)kMinVertexCapacity);
+		while (newCapacity < group->count + count)  newCapacity *= 2;
+		OOEffectVertex *newVertices = realloc(group->vertices, sizeof *newVertices * newCapacity);
+		if (newVertices == NULL)  return NULL;
+		group->vertices = newVertices;
+		group->capacity = newCapacity;
+	}
+	
+	group->texture = texture;
+	group->mode = mode;
+	
+	OOEffectVertex *result = group->vertices + group->count;
+	group->count += count;
+	_vertexCount += count;
+	return result;
+}
+
+
+- (void) removeAllVertices
+{
+	NSUInteger i;
+	for (i = 0; i < _groupCount; i++)
+	{
+		_groups[i].count = 0;
+		_groups[i].texture = nil;
+	}
+	_vertexCount = 0;
+}
+
+@end
+
+
+// base is NULL for the start of the bound vertex buffer.
+static void SetVertexPointers(const OOEffectVertex *base)
+{
+	OO_ENTER_OPENGL();
+	
+	const char *bytes = (const char *)base;
+	OOGL(glVertexPointer(3, GL_FLOAT, sizeof (OOEffectVertex), bytes + offsetof(OOEffectVertex, position)));
+	OOGL(glTexCoordPointer(2, GL_FLOAT, sizeof (OOEffectVertex), bytes + offsetof(OOEffectVertex, s)));
+	OOGL(glColorPointer(4, GL_FLOAT, sizeof (OOEffectVertex), bytes + offsetof(OOEffectVertex, color)));
+}
+
+
+static void ApplyTextureMode(OOEffectTextureMode mode)
+{
+	OO_ENTER_OPENGL();
+	
+#if OO_MULTITEXTURE
+	if (mode == kOOEffectTextureAlphaOnly && [[OOOpenGLExtensionManager sharedManager] textureCombinersSupported])
+	{
+		OOGL(glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE_ARB));
+		OOGL(glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB_ARB, GL_REPLACE));
+		OOGL(glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB_ARB, GL_PRIMARY_COLOR_ARB));
+		OOGL(glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA_ARB, GL_MODULATE));
+		OOGL(glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA_ARB, GL_TEXTURE));
+		OOGL(glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_ALPHA_ARB, GL_PRIMARY_COLOR_ARB));
+		return;
+	}
+#endif
+	
+	// For alpha-only textures, which all the built-in effects use, this is the same as kOOEffectTextureAlphaOnly.
+	OOGL(glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE));
+}
@@ -86,7 +86,7 @@ SOFTWARE.
 	OO_ENTER_OPENGL();
 	
 	// Save stuff.
-	OOGL(glPushAttrib(GL_VIEWPORT_BIT | GL_ENABLE_BIT));
+	OOGLPushAttrib(GL_VIEWPORT_BIT | GL_ENABLE_BIT);
 	OOGL(glMatrixMode(GL_MODELVIEW));
 	OOGL(glPushMatrix());
 	
@@ -140,7 +140,7 @@ SOFTWARE.
 	OOGL(glMatrixMode(GL_MODELVIEW));
 	OOGL(glPopMatrix());
 	OOGL(glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0));
-	OOGL(glPopAttrib());
+	OOGLPopAttrib();
 }
 
 
@@ -152,9 +152,9 @@ SOFTWARE.
 	OOGL(glClearDepth(MAX_CLEAR_DEPTH));
 	OOGL(glClear(_planets ? GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT));
 	
-	OOGL(glDepthMask(GL_FALSE));
+	OOGLDepthMask(GL_FALSE);
 	[sky renderOpaqueParts];
-	OOGL(glDepthMask(GL_TRUE));
+	OOGLDepthMask(GL_TRUE);
 	
 	OOGL(glLoadIdentity());
 	GLTranslateOOVector(vector_flip([PLAYER position]));
@@ -187,7 +187,7 @@ SOFTWARE.
 	_planets = [UNIVERSE reducedDetail];
 	
 	OOGL(glGenTextures(1, &_textureName));
-	OOGL(glBindTexture(GL_TEXTURE_CUBE_MAP, _textureName));
+	OOGLBindTexture(GL_TEXTURE_CUBE_MAP, _textureName);
 	OOGL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
 	OOGL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
 	OOGL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
@@ -223,7 +223,7 @@ SOFTWARE.
 	
 	OOCheckOpenGLErrors(@"after setting up environment cube map FBO");
 #endif
-	OOGL(glBindTexture(GL_TEXTURE_CUBE_MAP, 0));
+	OOGLBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 	OOGL(glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0));
 	OOGL(glBindRenderbufferEXT(GL_RENDERBUFFER_EXT, 0));
 }
@@ -234,7 +234,7 @@ SOFTWARE.
 - (void) apply
 {
 	OO_ENTER_OPENGL();
-	OOGL(glBindTexture(GL_TEXTURE_CUBE_MAP, _textureName));
+	OOGLBindTexture(GL_TEXTURE_CUBE_MAP, _textureName);
 }
 
 
@@ -249,7 +249,7 @@ SOFTWARE.
 	OO_ENTER_OPENGL();
 	if (_textureName == 0)  return;
 	
-	OOGL(glDeleteTextures(1, &_textureName));
+	OOGLDeleteTextures(1, &_textureName);
 	_textureName = 0;
 	
 	OOGL(glDeleteFramebuffersEXT(6, _fbos));
@@ -0,0 +1,82 @@
+/*
+
+OOGalaxyRouteGraph.h
+
+Jump network of a single galaxy, used for route planning.
+
+The adjacency of the 256 systems (pairs within MAX_JUMP_RANGE) is worked out
+once, when the graph is created, and stored as flat arrays. Routes are found
+with Dijkstra's algorithm using a binary heap. Each search finds the cheapest
+route from its origin to every other system, and the resulting shortest path
+tree is kept, so later routes from the same origin need no further searching.
+Trees are kept separately for each OORouteType.
+
+A graph is only valid for the galaxy it was built from; Universe throws it
+away when the galaxy seed changes.
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OOCocoa.h"
+#import "OOTypes.h"
+#import "legacy_random.h"
+
+
+enum
+{
+	kOOGalaxySystemCount		= kOOMaximumSystemID + 1
+};
+
+
+@interface OOGalaxyRouteGraph: NSObject
+{
+@private
+	uint32_t				_linkStart[kOOGalaxySystemCount + 1];
+	uint8_t					*_links;
+	double					*_linkDistances;
+	uint32_t				_linkCount;
+	
+	NSArray					*_neighbourArrays[kOOGalaxySystemCount];
+	struct OOGalaxyRouteTree	*_trees[OPTIMIZED_BY_TIME + 1][kOOGalaxySystemCount];
+	NSUInteger				_treeCount;
+	struct OOGalaxyRouteHeapEntry	*_heap;		// Search scratch space, _linkCount + 1 entries.
+}
+
+// systems must point to kOOGalaxySystemCount seeds, as in Universe's systems array.
+- (id) initWithSystemSeeds:(const Random_Seed *)systems;
+
+- (NSUInteger) linkCount;
+- (NSUInteger) neighbourCountOfSystem:(OOSystemID)system;
+
+// Array of NSNumbers with the IDs of systems within jump range, in ascending order.
+- (NSArray *) neighboursToSystem:(OOSystemID)system;
+
+/*	Dictionary with "route" (array of system IDs including both ends),
+	"distance" and "time", in the format of -[Universe routeFromSystem:...].
+	Returns nil if goal can't be reached or either ID is out of range.
+	OPTIMIZED_BY_NONE is treated as OPTIMIZED_BY_JUMPS.
+*/
+- (NSDictionary *) routeFromSystem:(OOSystemID)start toSystem:(OOSystemID)goal optimizedBy:(OORouteType)optimizeBy;
+
+// Number of shortest path trees computed so far.
+- (NSUInteger) treeCount;
+
+@end
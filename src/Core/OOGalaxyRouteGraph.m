@@ -0,0 +1,327 @@
+/*
+
+OOGalaxyRouteGraph.m
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OOGalaxyRouteGraph.h"
+#import "ShipEntity.h"
+
+
+/*	Jump-optimized routes cost one "max total distance" per jump plus the
+	distance, so fewer jumps always win and distance breaks ties. Time is
+	the square of the distance.
+*/
+#define JUMP_COST		(7.0 * 256.0)
+
+
+/*	Shortest path tree from one origin. Unreachable systems have an infinite
+	cost; the origin and unreachable systems have no parent.
+*/
+struct OOGalaxyRouteTree
+{
+	int16_t					parent[kOOGalaxySystemCount];
+	double					cost[kOOGalaxySystemCount];
+	double					distance[kOOGalaxySystemCount];
+	double					time[kOOGalaxySystemCount];
+};
+typedef struct OOGalaxyRouteTree RouteTree;
+
+
+/*	Binary min-heap entry. Systems are pushed again rather than moved when
+	their cost drops, and stale entries are skipped when popped, so the heap
+	never holds more than one entry per link plus the origin.
+*/
+struct OOGalaxyRouteHeapEntry
+{
+	double					cost;
+	OOSystemID				system;
+};
+typedef struct OOGalaxyRouteHeapEntry HeapEntry;
+
+
+static void HeapPush(HeapEntry *heap, uint32_t *count, double cost, OOSystemID system);
+static HeapEntry HeapPop(HeapEntry *heap, uint32_t *count);
+
+
+@interface OOGalaxyRouteGraph (Private)
+
+- (RouteTree *) treeFromSystem:(OOSystemID)start optimizedBy:(OORouteType)optimizeBy;
+
+@end
+
+
+@implementation OOGalaxyRouteGraph
+
+- (id) init
+{
+	[self release];
+	return nil;
+}
+
+
+- (id) initWithSystemSeeds:(const Random_Seed *)systems
+{
+	NSParameterAssert(systems != NULL);
+	
+	if ((self = [super init]))
+	{
+		OOSystemID		i, j;
+		uint32_t		count = 0;
+		
+		// Distances are symmetric, but each system's links are stored separately so they're contiguous.
+		for (i = 0; i < kOOGalaxySystemCount; i++)
+		{
+			for (j = 0; j < kOOGalaxySystemCount; j++)
+			{
+				if (i != j && !equal_seeds(systems[i], systems[j]) &&
+					distanceBetweenPlanetPositions(systems[i].d, systems[i].b, systems[j].d, systems[j].b) <= MAX_JUMP_RANGE)
+				{
+					count++;
+				}
+			}
+		}
+		
+		_linkCount = count;
+		_links = malloc(sizeof *_links * MAX(count, 1U));
+		_linkDistances = malloc(sizeof *_linkDistances * MAX(count, 1U));
+		_heap = malloc(sizeof *_heap * (count + 1));
+		if (_links == NULL || _linkDistances == NULL || _heap == NULL)
+		{
+			[self release];
+			return nil;
+		}
+		
+		count = 0;
+		for (i = 0; i < kOOGalaxySystemCount; i++)
+		{
+			_linkStart[i] = count;
+			for (j = 0; j < kOOGalaxySystemCount; j++)
+			{
+				if (i == j || equal_seeds(systems[i], systems[j]))  continue;
+				
+				double distance = distanceBetweenPlanetPositions(systems[i].d, systems[i].b, systems[j].d, systems[j].b);
+				if (distance <= MAX_JUMP_RANGE)
+				{
+					_links[count] = j;
+					_linkDistances[count] = distance;
+					count++;
+				}
+			}
+		}
+		_linkStart[kOOGalaxySystemCount] = count;
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	unsigned i, j;
+	
+	for (i = 0; i < kOOGalaxySystemCount; i++)
+	{
+		[_neighbourArrays[i] release];
+	}
+	for (i = 0; i <= OPTIMIZED_BY_TIME; i++)
+	{
+		for (j = 0; j < kOOGalaxySystemCount; j++)
+		{
+			free(_trees[i][j]);
+		}
+	}
+	
+	free(_links);
+	free(_linkDistances);
+	free(_heap);
+	
+	[super dealloc];
+}
+
+
+- (NSString *) descriptionComponents
+{
+	return [NSString stringWithFormat:@"%u links, %lu trees", _linkCount, (unsigned long)_treeCount];
+}
+
+
+- (NSUInteger) linkCount
+{
+	return _linkCount;
+}
+
+
+- (NSUInteger) neighbourCountOfSystem:(OOSystemID)system
+{
+	if (system < 0 || system > kOOMaximumSystemID)  return 0;
+	return _linkStart[system + 1] - _linkStart[system];
+}
+
+
+- (NSArray *) neighboursToSystem:(OOSystemID)system
+{
+	if (system < 0 || system > kOOMaximumSystemID)  return nil;
+	
+	if (_neighbourArrays[system] == nil)
+	{
+		uint32_t i, start = _linkStart[system], end = _linkStart[system + 1];
+		NSMutableArray *neighbours = [NSMutableArray arrayWithCapacity:end - start];
+		
+		for (i = start; i < end; i++)
+		{
+			[neighbours addObject:[NSNumber numberWithInt:_links[i]]];
+		}
+		_neighbourArrays[system] = [neighbours copy];
+	}
+	
+	return _neighbourArrays[system];
+}
+
+
+- (NSDictionary *) routeFromSystem:(OOSystemID)start toSystem:(OOSystemID)goal optimizedBy:(OORouteType)optimizeBy
+{
+	if (start < 0 || start > kOOMaximumSystemID || goal < 0 || goal > kOOMaximumSystemID)  return nil;
+	
+	RouteTree *tree = [self treeFromSystem:start optimizedBy:optimizeBy];
+	if (tree == NULL || tree->cost[goal] == INFINITY)  return nil;
+	
+	NSNumber *stops[kOOGalaxySystemCount];
+	NSUInteger stopCount = 0;
+	OOSystemID system;
+	
+	// Walk back from the goal, filling in the stops from the end.
+	for (system = goal; system != -1; system = tree->parent[system])
+	{
+		stops[kOOGalaxySystemCount - 1 - stopCount++] = [NSNumber numberWithInt:system];
+	}
+	
+	return [NSDictionary dictionaryWithObjectsAndKeys:
+			[NSArray arrayWithObjects:stops + kOOGalaxySystemCount - stopCount count:stopCount], @"route",
+			[NSNumber numberWithDouble:tree->distance[goal]], @"distance",
+			[NSNumber numberWithDouble:tree->time[goal]], @"time",
+			nil];
+}
+
+
+- (NSUInteger) treeCount
+{
+	return _treeCount;
+}
+
+@end
+
+
+@implementation OOGalaxyRouteGraph (Private)
+
+- (RouteTree *) treeFromSystem:(OOSystemID)start optimizedBy:(OORouteType)optimizeBy
+{
+	if (optimizeBy != OPTIMIZED_BY_TIME)  optimizeBy = OPTIMIZED_BY_JUMPS;
+	
+	RouteTree *tree = _trees[optimizeBy][start];
+	if (tree != NULL)  return tree;
+	
+	tree = malloc(sizeof *tree);
+	if (tree == NULL)  return NULL;
+	
+	OOSystemID i;
+	for (i = 0; i < kOOGalaxySystemCount; i++)
+	{
+		tree->parent[i] = -1;
+		tree->cost[i] = INFINITY;
+	}
+	tree->cost[start] = 0;
+	tree->distance[start] = 0;
+	tree->time[start] = 0;
+	
+	BOOL byTime = (optimizeBy == OPTIMIZED_BY_TIME);
+	uint32_t heapCount = 0;
+	HeapPush(_heap, &heapCount, 0, start);
+	
+	while (heapCount != 0)
+	{
+		HeapEntry entry = HeapPop(_heap, &heapCount);
+		OOSystemID current = entry.system;
+		if (entry.cost > tree->cost[current])  continue;	// Stale entry; a cheaper one was already settled.
+		
+		uint32_t link, end = _linkStart[current + 1];
+		for (link = _linkStart[current]; link < end; link++)
+		{
+			OOSystemID next = _links[link];
+			double linkDistance = _linkDistances[link];
+			double linkTime = linkDistance * linkDistance;
+			double cost = entry.cost + (byTime ? linkTime : JUMP_COST + linkDistance);
+			
+			if (cost < tree->cost[next])
+			{
+				tree->cost[next] = cost;
+				tree->parent[next] = current;
+				tree->distance[next] = tree->distance[current] + linkDistance;
+				tree->time[next] = tree->time[current] + linkTime;
+				HeapPush(_heap, &heapCount, cost, next);
+			}
+		}
+	}
+	
+	_trees[optimizeBy][start] = tree;
+	_treeCount++;
+	return tree;
+}
+
+@end
+
+
+static void HeapPush(HeapEntry *heap, uint32_t *count, double cost, OOSystemID system)
+{
+	uint32_t index = (*count)++;
+	
+	while (index > 0)
+	{
+		uint32_t parent = (index - 1) / 2;
+		if (heap[parent].cost <= cost)  break;
+		heap[index] = heap[parent];
+		index = parent;
+	}
+	heap[index].cost = cost;
+	heap[index].system = system;
+}
+
+
+static HeapEntry HeapPop(HeapEntry *heap, uint32_t *count)
+{
+	HeapEntry result = heap[0];
+	HeapEntry last = heap[--*count];
+	uint32_t index = 0, n = *count;
+	
+	for (;;)
+	{
+		uint32_t child = index * 2 + 1;
+		if (child >= n)  break;
+		if (child + 1 < n && heap[child + 1].cost < heap[child].cost)  child++;
+		if (last.cost <= heap[child].cost)  break;
+		heap[index] = heap[child];
+		index = child;
+	}
+	if (n != 0)  heap[index] = last;
+	
+	return result;
+}
@@ -78,6 +78,7 @@ static OOGraphicsResetManager *sSingleton = nil;
 	OOLogIndentIf(@"rendering.reset.start");
 	
 	[[OOOpenGLExtensionManager sharedManager] reset];
+	OOGLInvalidateStateCache();
 	[OOTexture rebindAllTextures];
 	
 	for (clientEnum = [clients objectEnumerator]; (client = [[clientEnum nextObject] pointerValue]); )
@@ -38,8 +38,9 @@ MA 02110-1301, USA.
 #import "OOOpenGL.h"
 #import "OOWeakReference.h"
 #import "OOOpenGLExtensionManager.h"
+#import "OOVertexBufferArena.h"
 
-@class OOMaterial, Octree;
+@class OOMaterial, Octree, OOMeshVertexBuffer;
 
 
 #define OOMESH_PROFILE	0
@@ -91,7 +92,8 @@ typedef struct
 @private
 	uint8_t					_normalMode: 2,
 							brokenInRender: 1,
-							listsReady: 1;
+							listsReady: 1,
+							instancingKeyValid: 1;
 	
 	OOMeshMaterialCount		materialCount;
 	OOMeshVertexCount		vertexCount;
@@ -111,6 +113,7 @@ typedef struct
 	NSString				*materialKeys[kOOMeshMaxMaterials];
 	OOMaterial				*materials[kOOMeshMaxMaterials];
 	GLuint					displayList0;
+	OOMeshVertexBuffer		*_vertexBuffer;	// Interleaved copy of _displayLists, shared by meshes loaded from the same data.
 	
 	GLfloat					collisionRadius;
 	GLfloat					maxDrawDistance;
@@ -125,6 +128,7 @@ typedef struct
 	NSString				*_cacheKey;
 	NSDictionary			*_shaderMacros;
 	id						_shaderBindingTarget;
+	id						_instancingKey;		// Interned.
 
 	Vector					_lastPosition;
 	OOMatrix				_lastRotMatrix;
@@ -154,6 +158,9 @@ typedef struct
 
 - (void) rebindMaterials;
 
+// YES if all materials have finished loading their textures.
+- (BOOL) isFinishedLoading;
+
 - (NSDictionary *) materials;
 - (NSDictionary *) shaders;
 
@@ -171,6 +178,30 @@ typedef struct
 
 - (OOMesh *) meshRescaledBy:(GLfloat)scaleFactor;
 
+/*	Meshes with the same instancing key have identical geometry, and
+	materials whose state doesn't depend on their binding target, so any one
+	of them can draw the others. Keys are interned and may be compared by
+	pointer. Returns nil if the mesh can't be instanced.
+*/
+- (id) instancingKey;
+
+/*	Forget the interned keys, so configurations that have left the game
+	don't accumulate. Meshes still in use keep their keys; a mesh that works
+	out its key afterwards may get a different pointer for the same
+	configuration, and is merely batched separately.
+*/
++ (void) forgetInstancingKeys;
+
+/*	Draw count copies of the opaque parts, each with the corresponding
+	transform multiplied onto the current modelview matrix.
+*/
+- (void) renderOpaquePartsWithTransforms:(const OOMatrix *)transforms count:(NSUInteger)count;
+
+// Mesh draw calls issued since the last reset, for the FPS display.
++ (void) resetDrawStatistics;
++ (NSUInteger) drawCallCount;
++ (NSUInteger) instancedDrawCount;
+
 @end
 
 
@@ -124,6 +124,28 @@ typedef struct VertexFaceRef
 } VertexFaceRef;
 
 
+#if OO_USE_VBO
+/*	OOMeshVBOVertex
+	Interleaved layout of _displayLists used for vertex buffer uploads.
+*/
+typedef struct
+{
+	GLfloat				position[3];
+	GLfloat				normal[3];
+	GLfloat				tangent[3];
+	GLfloat				s, t;
+} OOMeshVBOVertex;
+#endif
+
+
+static NSUInteger			sDrawCallCount;
+static NSUInteger			sInstancedDrawCount;
+static NSMutableDictionary	*sInstancingKeys = nil;
+#if OO_USE_VBO
+static NSMapTable			*sSharedVertexBuffers = NULL;
+#endif
+
+
 static void VFRAddFace(VertexFaceRef *vfr, NSUInteger index);
 static NSUInteger VFRGetCount(VertexFaceRef *vfr);
 static NSUInteger VFRGetFaceAtIndex(VertexFaceRef *vfr, NSUInteger index);
@@ -146,6 +168,10 @@ shaderBindingTarget:(id<OOWeakReferenceSupport>)object;
 - (void) calculateVertexTangentsWithFaceRefs:(VertexFaceRef *)faceRefs;
 
 - (void) deleteDisplayLists;
+#if OO_USE_VBO
+- (BOOL) bindVertexBuffer;
+#endif
+- (NSString *) vertexDataKey;
 
 - (NSDictionary*) modelData;
 - (BOOL) setModelFromModelData:(NSDictionary*) dict name:(NSString *)fileName;
@@ -177,6 +203,34 @@ shaderBindingTarget:(id<OOWeakReferenceSupport>)object;
 @end
 
 
+/*	OOMeshVertexBuffer
+	Interleaved vertex data in the shared arena. Meshes loaded from the same
+	data share one, so a model is uploaded once however many ships use it.
+	The table of shared buffers doesn't retain them; each one removes itself
+	when its last mesh releases it.
+*/
+@interface OOMeshVertexBuffer: NSObject <OOGraphicsResetClient>
+{
+@private
+	NSString					*_key;
+	OOVertexBufferAllocation	_allocation;
+	BOOL						_unavailable;
+}
+
+// Returns the buffer already in use for key if there is one. If key is nil, the buffer is not shared.
++ (id) vertexBufferForKey:(NSString *)key;
+
+#if OO_USE_VBO
+// Upload the display lists if they aren't already. Returns NO if VBOs can't be used.
+- (BOOL) uploadDisplayLists:(const OOMeshDisplayLists *)displayLists;
+#endif
+
+- (GLuint) buffer;
+- (size_t) offset;
+
+@end
+
+
 @interface OOCacheManager (OOMesh)
 
 + (NSDictionary *)meshDataForName:(NSString *)inShipName;
@@ -287,6 +341,7 @@ static BOOL IsPerVertexNormalMode(OOMeshNormalMode mode)
 	DESTROY(octree);
 	
 	[self deleteDisplayLists];
+	DESTROY(_vertexBuffer);
 	
 	for (i = 0; i != kOOMeshMaxMaterials; ++i)
 	{
@@ -303,6 +358,7 @@ static BOOL IsPerVertexNormalMode(OOMeshNormalMode mode)
 	DESTROY(_cacheKey);
 	DESTROY(_shaderMacros);
 	DESTROY(_shaderBindingTarget);
+	DESTROY(_instancingKey);
 	
 #if OOMESH_PROFILE
 	DESTROY(_stopwatch);
@@ -357,19 +413,44 @@ static NSString *NormalModeDescription(OOMeshNormalMode mode)
 
 
 - (void)renderOpaqueParts
+{
+	[self renderOpaquePartsWithTransforms:NULL count:1];
+}
+
+
+- (void) renderOpaquePartsWithTransforms:(const OOMatrix *)transforms count:(NSUInteger)count
 {
 	OO_ENTER_OPENGL();
 	
 	OOSetOpenGLState(OPENGL_STATE_OPAQUE);
 	
-	OOGL(glVertexPointer(3, GL_FLOAT, 0, _displayLists.vertexArray));
-	OOGL(glNormalPointer(GL_FLOAT, 0, _displayLists.normalArray));
+	const GLvoid	*vertexPointer = _displayLists.vertexArray;
+	const GLvoid	*normalPointer = _displayLists.normalArray;
+	const GLvoid	*tangentPointer = _displayLists.tangentArray;
+	const GLvoid	*uvPointer = _displayLists.textureUVArray;
+	GLsizei			stride = 0;
+	
+#if OO_USE_VBO
+	BOOL usingVertexBuffer = [self bindVertexBuffer];
+	if (usingVertexBuffer)
+	{
+		const char *base = (const char *)NULL + [_vertexBuffer offset];
+		vertexPointer = base + offsetof(OOMeshVBOVertex, position);
+		normalPointer = base + offsetof(OOMeshVBOVertex, normal);
+		tangentPointer = base + offsetof(OOMeshVBOVertex, tangent);
+		uvPointer = base + offsetof(OOMeshVBOVertex, s);
+		stride = sizeof (OOMeshVBOVertex);
+	}
+#endif
+	
+	OOGL(glVertexPointer(3, GL_FLOAT, stride, vertexPointer));
+	OOGL(glNormalPointer(GL_FLOAT, stride, normalPointer));
 	
 #if OO_SHADERS
 	if ([[OOOpenGLExtensionManager sharedManager] shadersSupported])
 	{
 		OOGL(glEnableVertexAttribArrayARB(kTangentAttributeIndex));
-		OOGL(glVertexAttribPointerARB(kTangentAttributeIndex, 3, GL_FLOAT, GL_FALSE, 0, _displayLists.tangentArray));
+		OOGL(glVertexAttribPointerARB(kTangentAttributeIndex, 3, GL_FLOAT, GL_FALSE, stride, tangentPointer));
 	}
 #endif
 	
@@ -397,7 +478,7 @@ static NSString *NormalModeDescription(OOMeshNormalMode mode)
 	NSUInteger unit;
 	if (_textureUnitCount <= 1)
 	{
-		OOGL(glEnableClientState(GL_TEXTURE_COORD_ARRAY));
+		OOGLEnableClientState(GL_TEXTURE_COORD_ARRAY);
 	}
 	else
 	{
@@ -408,12 +489,12 @@ static NSString *NormalModeDescription(OOMeshNormalMode mode)
 		
 		for (unit = 0; unit < _textureUnitCount; unit++)
 		{
-			OOGL(glClientActiveTextureARB(GL_TEXTURE0_ARB + unit));
-			OOGL(glEnableClientState(GL_TEXTURE_COORD_ARRAY));
+			OOGLClientActiveTexture(GL_TEXTURE0_ARB + unit);
+			OOGLEnableClientState(GL_TEXTURE_COORD_ARRAY);
 		}
 	}
 #else
-	OOGL(glEnableClientState(GL_TEXTURE_COORD_ARRAY));
+	OOGLEnableClientState(GL_TEXTURE_COORD_ARRAY);
 #endif
 	
 	@try
@@ -440,14 +521,14 @@ static NSString *NormalModeDescription(OOMeshNormalMode mode)
 				{
 					if (_textureUnitCount > 1)
 					{
-						OOGL(glClientActiveTextureARB(GL_TEXTURE0_ARB + unit));
-						OOGL(glActiveTextureARB(GL_TEXTURE0_ARB + unit));
+						OOGLClientActiveTexture(GL_TEXTURE0_ARB + unit);
+						OOGLActiveTexture(GL_TEXTURE0_ARB + unit);
 					}
 #endif
 					if (!wantsNormalsAsTextureCoordinates)
 					{
 						OOGL(glDisable(GL_TEXTURE_CUBE_MAP));
-						OOGL(glTexCoordPointer(2, GL_FLOAT, 0, _displayLists.textureUVArray));
+						OOGL(glTexCoordPointer(2, GL_FLOAT, stride, uvPointer));
 						/*	FIXME: Not including the line below breaks multitexturing in no-shaders mode.
 							However, the OpenGL state manager should probably be handling this;
 							TEXTURE_2D is part of OPENGL_STATE_OPAQUE, which has already been set.
@@ -458,7 +539,7 @@ static NSString *NormalModeDescription(OOMeshNormalMode mode)
 					else
 					{
 						OOGL(glDisable(GL_TEXTURE_2D));
-						OOGL(glTexCoordPointer(3, GL_FLOAT, 0, _displayLists.vertexArray));
+						OOGL(glTexCoordPointer(3, GL_FLOAT, stride, vertexPointer));
 						OOGL(glEnable(GL_TEXTURE_CUBE_MAP));
 					}
 #if OO_MULTITEXTURE
@@ -468,7 +549,24 @@ static NSString *NormalModeDescription(OOMeshNormalMode mode)
 			}
 			
 			[materials[ti] apply];
-			OOGL(glDrawArrays(GL_TRIANGLES, triangle_range[ti].location, triangle_range[ti].length));
+			if (transforms == NULL)
+			{
+				OOGL(glDrawArrays(GL_TRIANGLES, triangle_range[ti].location, triangle_range[ti].length));
+				sDrawCallCount++;
+			}
+			else
+			{
+				NSUInteger instance;
+				for (instance = 0; instance < count; instance++)
+				{
+					OOGL(glPushMatrix());
+					GLMultOOMatrix(transforms[instance]);
+					OOGL(glDrawArrays(GL_TRIANGLES, triangle_range[ti].location, triangle_range[ti].length));
+					OOGL(glPopMatrix());
+				}
+				sDrawCallCount += count;
+				sInstancedDrawCount += count;
+			}
 		}
 		
 		listsReady = YES;
@@ -476,6 +574,9 @@ static NSString *NormalModeDescription(OOMeshNormalMode mode)
 	}
 	@catch (NSException *exception)
 	{
+#if OO_USE_VBO
+		if (usingVertexBuffer)  OOGL(glBindBufferARB(GL_ARRAY_BUFFER, 0));
+#endif
 		if (!brokenInRender)
 		{
 			OOLog(kOOLogException, @"***** %s for %@ encountered exception: %@ : %@ *****", __PRETTY_FUNCTION__, self, [exception name], [exception reason]);
@@ -485,6 +586,10 @@ static NSString *NormalModeDescription(OOMeshNormalMode mode)
 		else  @throw exception;	// pass these on
 	}
 	
+#if OO_USE_VBO
+	if (usingVertexBuffer)  OOGL(glBindBufferARB(GL_ARRAY_BUFFER, 0));
+#endif
+	
 #if OO_SHADERS
 	if ([[OOOpenGLExtensionManager sharedManager] shadersSupported])
 	{
@@ -498,32 +603,105 @@ static NSString *NormalModeDescription(OOMeshNormalMode mode)
 #if OO_MULTITEXTURE
 	if (_textureUnitCount <= 1)
 	{
-		OOGL(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
+		OOGLDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	}
 	else
 	{
 		for (unit = 0; unit < _textureUnitCount; unit++)
 		{
-			OOGL(glClientActiveTextureARB(GL_TEXTURE0_ARB + unit));
-			OOGL(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
+			OOGLClientActiveTexture(GL_TEXTURE0_ARB + unit);
+			OOGLDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		}
 		
-		OOGL(glClientActiveTextureARB(GL_TEXTURE0_ARB));
-		OOGL(glActiveTextureARB(GL_TEXTURE0_ARB));
+		OOGLClientActiveTexture(GL_TEXTURE0_ARB);
+		OOGLActiveTexture(GL_TEXTURE0_ARB);
 	}
 #else
-	OOGL(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
+	OOGLDisableClientState(GL_TEXTURE_COORD_ARRAY);
 #endif
 	
 #ifndef NDEBUG
-	if (gDebugFlags & DEBUG_DRAW_NORMALS)  [self debugDrawNormals];
-	if (gDebugFlags & DEBUG_OCTREE_DRAW)  [[self octree] drawOctree];
+	if (transforms == NULL)
+	{
+		if (gDebugFlags & DEBUG_DRAW_NORMALS)  [self debugDrawNormals];
+		if (gDebugFlags & DEBUG_OCTREE_DRAW)  [[self octree] drawOctree];
+	}
 #endif
 	
 	OOVerifyOpenGLState();
 }
 
 
+- (id) instancingKey
+{
+	if (!instancingKeyValid)
+	{
+		DESTROY(_instancingKey);
+		instancingKeyValid = YES;
+		
+		// Rescaled meshes drop baseFile, and their geometry no longer matches the cache key.
+		if (baseFile == nil || _cacheKey == nil)  return nil;
+		
+		OOMeshMaterialIndex i;
+		for (i = 0; i < materialCount; i++)
+		{
+			if ([materials[i] dependsOnBindingTarget])  return nil;
+		}
+		
+		NSArray *key = [NSArray arrayWithObjects:
+						_cacheKey,
+						baseFile,
+						[NSNumber numberWithInt:_normalMode],
+						_materialDict ? (id)_materialDict : (id)[NSNull null],
+						_shadersDict ? (id)_shadersDict : (id)[NSNull null],
+						nil];
+		
+		if (sInstancingKeys == nil)  sInstancingKeys = [[NSMutableDictionary alloc] init];
+		_instancingKey = [sInstancingKeys objectForKey:key];
+		if (_instancingKey == nil)
+		{
+			[sInstancingKeys setObject:key forKey:key];
+			_instancingKey = key;
+		}
+		[_instancingKey retain];
+	}
+	
+	return _instancingKey;
+}
+
+
++ (void) forgetInstancingKeys
+{
+	DESTROY(sInstancingKeys);
+}
+
+
+- (NSUInteger) renderStateKey
+{
+	if (materialCount == 0)  return [super renderStateKey];
+	return [materials[0] renderStateKey];
+}
+
+
++ (void) resetDrawStatistics
+{
+	sDrawCallCount = 0;
+	sInstancedDrawCount = 0;
+}
+
+
++ (NSUInteger) drawCallCount
+{
+	return sDrawCallCount;
+}
+
+
++ (NSUInteger) instancedDrawCount
+{
+	return sInstancedDrawCount;
+}
+
+
 - (void) rebindMaterials
 {
 	OOMeshMaterialCount		i;
@@ -565,6 +743,19 @@ static NSString *NormalModeDescription(OOMeshNormalMode mode)
 			[oldMaterial release];
 		}
 	}
+	
+	instancingKeyValid = NO;
+}
+
+
+- (BOOL) isFinishedLoading
+{
+	OOMeshMaterialCount i;
+	for (i = 0; i != materialCount; ++i)
+	{
+		if (![materials[i] isFinishedLoading])  return NO;
+	}
+	return YES;
 }
 
 
@@ -850,6 +1041,14 @@ shaderBindingTarget:(id<OOWeakReferenceSupport>)target
 		
 		baseFile = [name copy];
 		
+		/*	Meshes loaded from the same data share their vertex buffer, so
+			it's uploaded here rather than on first draw.
+		*/
+		_vertexBuffer = [[OOMeshVertexBuffer vertexBufferForKey:[self vertexDataKey]] retain];
+#if OO_USE_VBO
+		[_vertexBuffer uploadDisplayLists:&_displayLists];
+#endif
+		
 		/*	New in r3033: save the material-defining parameters here so we
 			can rebind the materials at any time.
 			-- Ahruman 2010-02-17
@@ -901,6 +1100,8 @@ shaderBindingTarget:(id<OOWeakReferenceSupport>)target
 		[result->_cacheKey retain];
 		[result->_shaderMacros retain];
 		[result->_shaderBindingTarget retain];
+		[result->_instancingKey retain];
+		[result->_vertexBuffer retain];
 		
 		for (i = 0; i != kOOMeshMaxMaterials; ++i)
 		{
@@ -910,6 +1111,7 @@ shaderBindingTarget:(id<OOWeakReferenceSupport>)target
 		
 		// Reset unsharable GL state
 		result->listsReady = NO;
+		result->instancingKeyValid = NO;
 		
 		[[OOGraphicsResetManager sharedManager] registerClient:result];
 	}
@@ -930,6 +1132,34 @@ shaderBindingTarget:(id<OOWeakReferenceSupport>)target
 }
 
 
+/*	Meshes with the same key have the same vertex data and can share a vertex
+	buffer. This matches the key used for the mesh data cache. Rescaled meshes
+	have no key.
+*/
+- (NSString *) vertexDataKey
+{
+	if (baseFile == nil)  return nil;
+	return [NSString stringWithFormat:@"%@:%u", baseFile, _normalMode];
+}
+
+
+#if OO_USE_VBO
+/*	Upload vertex data to the shared arena if necessary and bind it. Returns
+	NO if VBOs can't be used, in which case nothing is bound and the caller
+	should use client-side arrays.
+*/
+- (BOOL) bindVertexBuffer
+{
+	if (_vertexBuffer == nil)  _vertexBuffer = [[OOMeshVertexBuffer vertexBufferForKey:[self vertexDataKey]] retain];
+	if (![_vertexBuffer uploadDisplayLists:&_displayLists])  return NO;
+	
+	OO_ENTER_OPENGL();
+	OOGL(glBindBufferARB(GL_ARRAY_BUFFER, [_vertexBuffer buffer]));
+	return YES;
+}
+#endif
+
+
 - (void) resetGraphicsState
 {
 	[self deleteDisplayLists];
@@ -1979,6 +2209,8 @@ static float FaceAreaCorrect(GLuint *vertIndices, Vector *vertices)
 	[self calculateBoundingVolumes];
 	DESTROY(octree);
 	DESTROY(baseFile);	// Avoid octree cache.
+	DESTROY(_vertexBuffer);	// Don't share unscaled vertex data; a private buffer is made on next draw.
+	instancingKeyValid = NO;
 }
 
 
@@ -2230,3 +2462,123 @@ static NSUInteger VFRGetFaceAtIndex(VertexFaceRef *vfr, NSUInteger index)
 }
 
 @end
+
+
+@implementation OOMeshVertexBuffer
+
++ (id) vertexBufferForKey:(NSString *)key
+{
+	OOMeshVertexBuffer		*result = nil;
+	
+#if OO_USE_VBO
+	if (key != nil)
+	{
+		if (sSharedVertexBuffers == NULL)
+		{
+			sSharedVertexBuffers = NSCreateMapTable(NSObjectMapKeyCallBacks, NSNonRetainedObjectMapValueCallBacks, 0);
+		}
+		
+		result = NSMapGet(sSharedVertexBuffers, key);
+		if (result != nil)  return [[result retain] autorelease];
+	}
+#endif
+	
+	result = [[[self alloc] init] autorelease];
+#if OO_USE_VBO
+	if (result != nil && key != nil)
+	{
+		result->_key = [key copy];
+		NSMapInsert(sSharedVertexBuffers, result->_key, result);
+	}
+#endif
+	
+	return result;
+}
+
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		[[OOGraphicsResetManager sharedManager] registerClient:self];
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+#if OO_USE_VBO
+	if (_key != nil)  NSMapRemove(sSharedVertexBuffers, _key);
+	if (_allocation.buffer != 0)  [[OOVertexBufferArena sharedArena] freeAllocation:&_allocation];
+#endif
+	DESTROY(_key);
+	
+	[[OOGraphicsResetManager sharedManager] unregisterClient:self];
+	
+	[super dealloc];
+}
+
+
+#if OO_USE_VBO
+- (BOOL) uploadDisplayLists:(const OOMeshDisplayLists *)displayLists
+{
+	OOVertexBufferArena *arena = [OOVertexBufferArena sharedArena];
+	
+	if ([arena allocationIsValid:&_allocation])  return YES;
+	if (_unavailable || displayLists->count == 0)  return NO;
+	
+	size_t size = sizeof (OOMeshVBOVertex) * displayLists->count;
+	OOMeshVBOVertex *vertices = malloc(size);
+	if (vertices == NULL)
+	{
+		_unavailable = YES;
+		return NO;
+	}
+	
+	OOMeshVertexCount i;
+	for (i = 0; i < displayLists->count; i++)
+	{
+		Vector v = displayLists->vertexArray[i];
+		Vector n = displayLists->normalArray[i];
+		Vector t = displayLists->tangentArray[i];
+		vertices[i] = (OOMeshVBOVertex)
+		{
+			{ v.x, v.y, v.z },
+			{ n.x, n.y, n.z },
+			{ t.x, t.y, t.z },
+			displayLists->textureUVArray[i * 2], displayLists->textureUVArray[i * 2 + 1]
+		};
+	}
+	
+	BOOL OK = [arena allocateSize:size withData:vertices allocation:&_allocation];
+	free(vertices);
+	if (!OK)  _unavailable = YES;
+	return OK;
+}
+#endif
+
+
+- (GLuint) buffer
+{
+	return _allocation.buffer;
+}
+
+
+- (size_t) offset
+{
+	return _allocation.offset;
+}
+
+
+// The data is uploaded again the next time a mesh using it is drawn.
+- (void) resetGraphicsState
+{
+#if OO_USE_VBO
+	[[OOVertexBufferArena sharedArena] freeAllocation:&_allocation];
+#endif
+	_unavailable = NO;
+}
+
+@end
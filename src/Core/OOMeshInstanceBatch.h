@@ -0,0 +1,69 @@
+/*
+
+OOMeshInstanceBatch.h
+
+Per-frame grouping of meshes that can be drawn as instances of each other.
+
+Ships using the same model, scale and materials, whose materials don't depend
+on per-entity state, are collected here during the opaque pass instead of
+being drawn one by one. Each group is then drawn with one set of vertex arrays
+and one material application per material, changing only the modelview matrix
+between copies.
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OOMaths.h"
+
+@class OOMesh;
+
+
+@interface OOMeshInstanceBatch: NSObject
+{
+@private
+	struct OOMeshInstanceGroup	*_groups;
+	NSUInteger				_groupCount;
+	NSUInteger				_groupCapacity;
+	NSUInteger				_instanceCount;
+}
+
+/*	Add a copy of mesh to be drawn with transform multiplied onto the
+	modelview matrix. Returns NO if the mesh can't be instanced, in which case
+	the caller should draw it normally. The mesh is not retained, and must
+	stay alive until -removeAllInstances.
+*/
+- (BOOL) addMesh:(OOMesh *)mesh transform:(OOMatrix)transform sunlit:(BOOL)sunlit;
+
+/*	Draw all groups with the given sunlit flag. The caller is responsible for
+	setting up lighting and other state shared by every instance.
+*/
+- (void) renderOpaquePartsSunlit:(BOOL)sunlit;
+
+/*	Call once per frame, after drawing. Groups that were given no instances
+	since the previous call are discarded, so models that have left the scene
+	don't slow down -addMesh:.
+*/
+- (void) removeAllInstances;
+
+- (NSUInteger) instanceCount;
+- (NSUInteger) groupCount;
+
+@end
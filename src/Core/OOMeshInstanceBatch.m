@@ -0,0 +1,186 @@
+/*
+
+OOMeshInstanceBatch.m
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OOMeshInstanceBatch.h"
+#import "OOMesh.h"
+
+
+enum
+{
+	kMinGroupCapacity			= 8,
+	kMinInstanceCapacity		= 16
+};
+
+
+/*	Groups persist between frames so their transform arrays can be reused,
+	and are dropped once a frame passes without them being used. The key is
+	interned by OOMesh and compared by pointer; mesh is only valid while count
+	is non-zero.
+*/
+struct OOMeshInstanceGroup
+{
+	id						key;
+	BOOL					sunlit;
+	OOMesh					*mesh;
+	OOMatrix				*transforms;
+	NSUInteger				count;
+	NSUInteger				capacity;
+};
+typedef struct OOMeshInstanceGroup Group;
+
+
+@interface OOMeshInstanceBatch (Private)
+
+- (Group *) groupForKey:(id)key sunlit:(BOOL)sunlit;
+
+@end
+
+
+@implementation OOMeshInstanceBatch
+
+- (void) dealloc
+{
+	NSUInteger i;
+	for (i = 0; i < _groupCount; i++)
+	{
+		[_groups[i].key release];
+		free(_groups[i].transforms);
+	}
+	free(_groups);
+	
+	[super dealloc];
+}
+
+
+- (BOOL) addMesh:(OOMesh *)mesh transform:(OOMatrix)transform sunlit:(BOOL)sunlit
+{
+	id key = [mesh instancingKey];
+	if (key == nil)  return NO;
+	
+	Group *group = [self groupForKey:key sunlit:sunlit];
+	if (group == NULL)  return NO;
+	
+	if (group->count == group->capacity)
+	{
+		NSUInteger newCapacity = MAX(group->capacity * 2, (NSUInteger)kMinInstanceCapacity);
+		OOMatrix *newTransforms = realloc(group->transforms, sizeof *newTransforms * newCapacity);
+		if (newTransforms == NULL)  return NO;
+		group->transforms = newTransforms;
+		group->capacity = newCapacity;
+	}
+	
+	if (group->count == 0)  group->mesh = mesh;
+	group->transforms[group->count++] = transform;
+	_instanceCount++;
+	
+	return YES;
+}
+
+
+- (void) renderOpaquePartsSunlit:(BOOL)sunlit
+{
+	NSUInteger i;
+	for (i = 0; i < _groupCount; i++)
+	{
+		Group *group = &_groups[i];
+		if (group->count != 0 && group->sunlit == sunlit)
+		{
+			[group->mesh renderOpaquePartsWithTransforms:group->transforms count:group->count];
+		}
+	}
+}
+
+
+- (void) removeAllInstances
+{
+	NSUInteger i = 0;
+	while (i < _groupCount)
+	{
+		Group *group = &_groups[i];
+		if (group->count == 0)
+		{
+			// Unused since the last call; replace it with the last group.
+			[group->key release];
+			free(group->transforms);
+			*group = _groups[--_groupCount];
+		}
+		else
+		{
+			group->count = 0;
+			group->mesh = nil;
+			i++;
+		}
+	}
+	_instanceCount = 0;
+}
+
+
+- (NSUInteger) instanceCount
+{
+	return _instanceCount;
+}
+
+
+- (NSUInteger) groupCount
+{
+	NSUInteger i, count = 0;
+	for (i = 0; i < _groupCount; i++)
+	{
+		if (_groups[i].count != 0)  count++;
+	}
+	return count;
+}
+
+@end
+
+
+@implementation OOMeshInstanceBatch (Private)
+
+- (Group *) groupForKey:(id)key sunlit:(BOOL)sunlit
+{
+	NSUInteger i;
+	for (i = 0; i < _groupCount; i++)
+	{
+		if (_groups[i].key == key && _groups[i].sunlit == sunlit)  return &_groups[i];
+	}
+	
+	if (_groupCount == _groupCapacity)
+	{
+		NSUInteger newCapacity = MAX(_groupCapacity * 2, (NSUInteger)kMinGroupCapacity);
+		Group *newGroups = realloc(_groups, sizeof *newGroups * newCapacity);
+		if (newGroups == NULL)  return NULL;
+		_groups = newGroups;
+		_groupCapacity = newCapacity;
+	}
+	
+	Group *group = &_groups[_groupCount++];
+	memset(group, 0, sizeof *group);
+	group->key = [key retain];
+	group->sunlit = sunlit;
+	
+	return group;
+}
+
+@end
@@ -140,6 +140,61 @@ void OOSetOpenGLState(OOOpenGLStateID state);
 void OOResetGLStateVerifier(void);
 
 
+/*	Shadowed state
+	
+	These wrap OpenGL calls for state that is changed many times per frame,
+	and skip the call if the last value set through them is still current.
+	This matters most for drivers that validate eagerly, where a redundant
+	glBindTexture() or glUseProgramObjectARB() can cost as much as a real one.
+	
+	The shadow is only correct if every change goes through these functions
+	(the state manager above uses them too). Anything which changes the state
+	behind their backs - a new context, or code outside Oolite's control -
+	must be followed by OOGLInvalidateStateCache(). Attribute stack pushes and
+	pops must use OOGLPushAttrib() and OOGLPopAttrib(), which forget whatever
+	the popped attribute groups may have restored.
+	
+	Texture bindings are tracked per texture unit for GL_TEXTURE_2D and
+	GL_TEXTURE_CUBE_MAP. GL_TEXTURE_COORD_ARRAY is tracked per client texture
+	unit; other client arrays are global.
+	
+	Blend enabling should go through OOGLSetBlending(), because some drivers
+	reset the blend function when GL_BLEND is disabled.
+*/
+void OOGLActiveTexture(GLenum textureUnit);
+void OOGLClientActiveTexture(GLenum textureUnit);
+void OOGLBindTexture(GLenum target, GLuint texture);
+void OOGLDeleteTextures(GLsizei count, const GLuint *textures);
+
+void OOGLUseProgram(GLhandleARB program);
+// Call before deleting a program object, since its handle may be reused.
+void OOGLForgetProgram(GLhandleARB program);
+
+void OOGLSetBlending(bool enabled);
+void OOGLBlendFunc(GLenum sourceFactor, GLenum destFactor);
+void OOGLDepthMask(GLboolean flag);
+
+void OOGLEnableClientState(GLenum array);
+void OOGLDisableClientState(GLenum array);
+
+void OOGLLinearFog(GLfloat start, GLfloat end);
+void OOGLFogColor(const GLfloat color[4]);
+
+void OOGLPushAttrib(GLbitfield mask);
+void OOGLPopAttrib(void);
+
+void OOGLInvalidateStateCache(void);
+
+#ifndef NDEBUG
+/*	Counts of calls to the functions above and of how many were skipped as
+	redundant. OOGLResetStateCacheStatistics() is called once per frame;
+	OOGLGetStateCacheStatistics() reports the previous complete frame.
+*/
+void OOGLResetStateCacheStatistics(void);
+void OOGLGetStateCacheStatistics(NSUInteger *outCalls, NSUInteger *outFiltered);
+#endif
+
+
 /*	OOCheckOpenGLErrors()
 	Check for and log OpenGL errors, and returns YES if an error occurred.
 	NOTE: this is controlled by the log message class rendering.opengl.error.
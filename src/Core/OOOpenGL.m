@@ -87,7 +87,7 @@ void OOGLWireframeModeOn(void)
 {
 	OO_ENTER_OPENGL();
 	
-	OOGL(glPushAttrib(GL_POLYGON_BIT | GL_LINE_BIT | GL_TEXTURE_BIT));
+	OOGLPushAttrib(GL_POLYGON_BIT | GL_LINE_BIT | GL_TEXTURE_BIT);
 	OOGL(GLScaledLineWidth(1.0f));
 	OOGL(glPolygonMode(GL_FRONT_AND_BACK, GL_LINE));
 }
@@ -97,7 +97,7 @@ void OOGLWireframeModeOff(void)
 {
 	OO_ENTER_OPENGL();
 	
-	OOGL(glPopAttrib());
+	OOGLPopAttrib();
 }
 
 
@@ -73,7 +73,7 @@ SOFTWARE.
 
 
 #if GL_ARB_vertex_buffer_object
-#define OO_USE_VBO				0	// Disabled due to crashes on certain systems (and limited VBO use)
+#define OO_USE_VBO				1	// Can be disabled per GPU with use_vbo in gpu-settings.plist.
 #else
 #define OO_USE_VBO				0
 #warning Building without vertex buffer object support, are your OpenGL headers up to date?
@@ -108,6 +108,17 @@ SOFTWARE.
 #endif
 
 
+/*	Program binaries let linked shader programs be saved to disk and reused
+	in later sessions. Not used on Mac OS X, where the legacy OpenGL profile
+	doesn't provide them and GLhandleARB isn't a program name.
+*/
+#if OO_SHADERS && GL_ARB_get_program_binary && !OOLITE_MAC_OS_X
+#define OO_PROGRAM_BINARY		1	// Can be disabled per GPU with use_program_binary_cache in gpu-settings.plist.
+#else
+#define OO_PROGRAM_BINARY		0
+#endif
+
+
 
 #define OOOPENGLEXTMGR_LOCK_SET_ACCESS		(!OOLITE_MAC_OS_X)
 
@@ -141,6 +152,9 @@ SOFTWARE.
 #if OO_USE_FBO
 	BOOL					fboSupported;
 #endif
+#if OO_PROGRAM_BINARY
+	BOOL					programBinarySupported;
+#endif
 #if OO_MULTITEXTURE
 	BOOL					textureCombinersSupported;
 	GLint					textureUnitCount;
@@ -160,6 +174,7 @@ SOFTWARE.
 
 - (BOOL)vboSupported;					// Vertex buffer objects
 - (BOOL)fboSupported;					// Frame buffer objects
+- (BOOL)programBinarySupported;			// Saving and loading linked shader programs (GL_ARB_get_program_binary)
 - (BOOL)textureCombinersSupported;
 - (GLint)textureUnitCount;				// Fixed function multitexture limit, does not apply to shaders. (GL_MAX_TEXTURE_UNITS_ARB)
 
@@ -233,6 +248,7 @@ PFNGLGENBUFFERSARBPROC					glGenBuffersARB;
 PFNGLDELETEBUFFERSARBPROC				glDeleteBuffersARB;
 PFNGLBINDBUFFERARBPROC					glBindBufferARB;
 PFNGLBUFFERDATAARBPROC					glBufferDataARB;
+PFNGLBUFFERSUBDATAARBPROC				glBufferSubDataARB;
 #endif
 
 #if OO_USE_FBO
@@ -248,4 +264,10 @@ PFNGLDELETEFRAMEBUFFERSEXTPROC			glDeleteFramebuffersEXT;
 PFNGLDELETERENDERBUFFERSEXTPROC			glDeleteRenderbuffersEXT;
 #endif
 
+#if OO_PROGRAM_BINARY
+PFNGLGETPROGRAMBINARYPROC				glGetProgramBinary;
+PFNGLPROGRAMBINARYPROC					glProgramBinary;
+PFNGLPROGRAMPARAMETERIPROC				glProgramParameteri;
+#endif
+
 #endif	// OOLITE_WINDOWS
@@ -93,6 +93,7 @@ PFNGLGENBUFFERSARBPROC					glGenBuffersARB					= (PFNGLGENBUFFERSARBPROC)&OOBadO
 PFNGLDELETEBUFFERSARBPROC				glDeleteBuffersARB				= (PFNGLDELETEBUFFERSARBPROC)&OOBadOpenGLExtensionUsed;
 PFNGLBINDBUFFERARBPROC					glBindBufferARB					= (PFNGLBINDBUFFERARBPROC)&OOBadOpenGLExtensionUsed;
 PFNGLBUFFERDATAARBPROC					glBufferDataARB					= (PFNGLBUFFERDATAARBPROC)&OOBadOpenGLExtensionUsed;
+PFNGLBUFFERSUBDATAARBPROC				glBufferSubDataARB				= (PFNGLBUFFERSUBDATAARBPROC)&OOBadOpenGLExtensionUsed;
 #endif
 
 #if OO_USE_FBO
@@ -107,6 +108,12 @@ PFNGLCHECKFRAMEBUFFERSTATUSEXTPROC		glCheckFramebufferStatusEXT		= (PFNGLCHECKFR
 PFNGLDELETEFRAMEBUFFERSEXTPROC			glDeleteFramebuffersEXT			= (PFNGLDELETEFRAMEBUFFERSEXTPROC)&OOBadOpenGLExtensionUsed;
 PFNGLDELETERENDERBUFFERSEXTPROC			glDeleteRenderbuffersEXT		= (PFNGLDELETERENDERBUFFERSEXTPROC)&OOBadOpenGLExtensionUsed;
 #endif
+
+#if OO_PROGRAM_BINARY
+PFNGLGETPROGRAMBINARYPROC				glGetProgramBinary				= (PFNGLGETPROGRAMBINARYPROC)&OOBadOpenGLExtensionUsed;
+PFNGLPROGRAMBINARYPROC					glProgramBinary					= (PFNGLPROGRAMBINARYPROC)&OOBadOpenGLExtensionUsed;
+PFNGLPROGRAMPARAMETERIPROC				glProgramParameteri				= (PFNGLPROGRAMPARAMETERIPROC)&OOBadOpenGLExtensionUsed;
+#endif
 #endif
 
 
@@ -134,6 +141,10 @@ static unsigned IntegerFromString(const GLubyte **ioString);
 - (void)checkFBOSupported;
 #endif
 
+#if OO_PROGRAM_BINARY
+- (void)checkProgramBinarySupported;
+#endif
+
 #if GL_ARB_texture_env_combine
 - (void)checkTextureCombinersSupported;
 #endif
@@ -267,10 +278,23 @@ static NSArray *ArrayOfExtensions(NSString *extensionString)
 	
 #if OO_USE_VBO
 	[self checkVBOSupported];
+	if (vboSupported && ![gpuConfig oo_boolForKey:@"use_vbo" defaultValue:YES])
+	{
+		OOLog(@"rendering.opengl.vbo", @"Vertex buffer objects disabled by GPU configuration.");
+		vboSupported = NO;
+	}
 #endif
 #if OO_USE_FBO
 	[self checkFBOSupported];
 #endif
+#if OO_PROGRAM_BINARY
+	[self checkProgramBinarySupported];
+	if (programBinarySupported && ![gpuConfig oo_boolForKey:@"use_program_binary_cache" defaultValue:YES])
+	{
+		OOLog(kOOLogOpenGLShaderSupport, @"Shader program binary cache disabled by GPU configuration.");
+		programBinarySupported = NO;
+	}
+#endif
 #if OO_MULTITEXTURE
 	[self checkTextureCombinersSupported];
 	GLint texUnitOverride = [gpuConfig oo_intForKey:@"texture_units" defaultValue:textureUnitCount];
@@ -383,6 +407,16 @@ static NSArray *ArrayOfExtensions(NSString *extensionString)
 }
 
 
+- (BOOL)programBinarySupported
+{
+#if OO_PROGRAM_BINARY
+	return programBinarySupported;
+#else
+	return NO;
+#endif
+}
+
+
 - (BOOL)textureCombinersSupported
 {
 #if OO_MULTITEXTURE
@@ -562,6 +596,7 @@ static unsigned IntegerFromString(const GLubyte **ioString)
 		glDeleteBuffersARB = (PFNGLDELETEBUFFERSARBPROC)wglGetProcAddress("glDeleteBuffersARB");
 		glBindBufferARB = (PFNGLBINDBUFFERARBPROC)wglGetProcAddress("glBindBufferARB");
 		glBufferDataARB = (PFNGLBUFFERDATAARBPROC)wglGetProcAddress("glBufferDataARB");
+		glBufferSubDataARB = (PFNGLBUFFERSUBDATAARBPROC)wglGetProcAddress("glBufferSubDataARB");
 	}
 #endif
 }
@@ -597,6 +632,31 @@ static unsigned IntegerFromString(const GLubyte **ioString)
 #endif
 
 
+#if OO_PROGRAM_BINARY
+- (void)checkProgramBinarySupported
+{
+	programBinarySupported = NO;
+	
+	if (shadersAvailable && ([self versionIsAtLeastMajor:4 minor:1] || [self haveExtension:@"GL_ARB_get_program_binary"]))
+	{
+		// Some drivers advertise the extension but support no binary formats.
+		GLint formatCount = 0;
+		OOGL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount));
+		programBinarySupported = formatCount > 0;
+	}
+	
+#if OOLITE_WINDOWS
+	if (programBinarySupported)
+	{
+		glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)wglGetProcAddress("glGetProgramBinary");
+		glProgramBinary = (PFNGLPROGRAMBINARYPROC)wglGetProcAddress("glProgramBinary");
+		glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)wglGetProcAddress("glProgramParameteri");
+	}
+#endif
+}
+#endif
+
+
 #if OO_MULTITEXTURE
 - (void)checkTextureCombinersSupported
 {
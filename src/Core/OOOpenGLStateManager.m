@@ -2,7 +2,8 @@
 
 OOOpenGLStateManager.m
 
-Implementation of OOSetOpenGLState()/OOVerifyOpenGLState().
+Implementation of OOSetOpenGLState()/OOVerifyOpenGLState(), and of the
+shadowed state functions used to filter out redundant OpenGL calls.
 
 
 Oolite
@@ -47,6 +48,13 @@ MA 02110-1301, USA.
 	definitions are all in one place. This somewhat reduces the chance of
 	missing one when updating OOOpenGLStates.tbl. The actual definitions are
 	at the bottom of this file.
+	
+	Client array, depth mask, active texture unit and blend function changes
+	made by the state manager go through the shadowed state functions, so
+	that the shadow stays in step with switches between nominal states. The
+	shadow is deliberately separate from the nominal state: the nominal state
+	says what the state should be between drawing operations, while the
+	shadow records what it actually is at any moment.
 */
 
 
@@ -92,6 +100,8 @@ static OOOpenGLStateID sCurrentStateID = OPENGL_STATE_INTERNAL_USE_ONLY;
 */
 static void SwitchOpenGLStateInternal(const OOOpenGLState *sourceState, const OOOpenGLState *targetState) NONNULL_FUNC;
 
+static inline void ForgetBlendFunc(void);
+
 
 /*	Accessors
 	
@@ -108,7 +118,7 @@ static inline bool GetState_DEPTH_WRITEMASK(void)
 	return value;
 }
 
-#define SetState_DEPTH_WRITEMASK(VALUE)  OOGL(glDepthMask(VALUE))
+#define SetState_DEPTH_WRITEMASK(VALUE)  OOGLDepthMask(VALUE)
 
 #define SetState_SHADE_MODEL(VALUE)  OOGL(glShadeModel(VALUE))
 
@@ -133,7 +143,7 @@ static inline GLenum GetState_ACTIVE_TEXTURE(void)
 	return value;
 }
 
-#define SetState_ACTIVE_TEXTURE(VALUE)  OOGL(glActiveTextureARB(VALUE))
+#define SetState_ACTIVE_TEXTURE(VALUE)  OOGLActiveTexture(VALUE)
 
 static inline GLenum GetState_CLIENT_ACTIVE_TEXTURE(void)
 {
@@ -144,7 +154,7 @@ static inline GLenum GetState_CLIENT_ACTIVE_TEXTURE(void)
 	return value;
 }
 
-#define SetState_CLIENT_ACTIVE_TEXTURE(VALUE)  OOGL(glClientActiveTextureARB(VALUE))
+#define SetState_CLIENT_ACTIVE_TEXTURE(VALUE)  OOGLClientActiveTexture(VALUE)
 
 #else
 static inline GLenum GetState_ACTIVE_TEXTURE(void) {}
@@ -329,6 +339,9 @@ static void VerifyOpenGLStateInternal(const char *caller, const char *nominalCal
 	
 	if (!StatesEqual(&currentState, expectedState))
 	{
+		// Whatever changed the state also invalidated the shadow.
+		OOGLInvalidateStateCache();
+		
 		if (OOLogWillDisplayMessagesInClass(kOOLogOpenGLVerifyDump))
 		{
 			OOLog(kOOLogOpenGLVerifyDump, @"Incorrect OpenGL state in %s (line %u)->%s", nominalCaller, line, caller);
@@ -415,11 +428,11 @@ static void SwitchOpenGLStateInternal(const OOOpenGLState *sourceState, const OO
 	{ \
 		if (targetState->NAME) \
 		{ \
-			OOGL(glEnableClientState(GL_##NAME)); \
+			OOGLEnableClientState(GL_##NAME); \
 		} \
 		else \
 		{ \
-			OOGL(glDisableClientState(GL_##NAME)); \
+			OOGLDisableClientState(GL_##NAME); \
 		} \
 	}
 	#define ITEM_SPECIAL(NAME, TYPE, _) \
@@ -439,10 +452,12 @@ static void SwitchOpenGLStateInternal(const OOOpenGLState *sourceState, const OO
 	 * BlendFunc if Blend is disabled. Therefore, if coming from Blend=false
 	 * always reset the blend function even if this should be unnecessary
 	 * CIM: 3/1/13 */
+	if (!sourceState->BLEND)  ForgetBlendFunc();
 	if (sourceState->BLEND_SRC != targetState->BLEND_SRC || sourceState->BLEND_DST != targetState->BLEND_DST || !sourceState->BLEND)
 	{
-		OOGL(glBlendFunc(targetState->BLEND_SRC, targetState->BLEND_DST));
+		OOGLBlendFunc(targetState->BLEND_SRC, targetState->BLEND_DST);
 	}
+	if (!targetState->BLEND)  ForgetBlendFunc();
 	
 	#undef ITEM_STATEFLAG
 	#undef ITEM_CLIENTSTATEFLAG
@@ -455,9 +470,448 @@ void OOResetGLStateVerifier(void)
 {
 	// State has been reset behind our backs, so to speak; don't verify.
 	sCurrentStateID = OPENGL_STATE_INTERNAL_USE_ONLY;
+	OOGLInvalidateStateCache();
+}
+
+
+/*	Shadowed state.
+	
+	Everything starts out invalid (zeroed), meaning the next call for each
+	item is always passed through to OpenGL.
+*/
+enum
+{
+	kMaxShadowedTextureUnits	= 16,
+	kAttribStackDepth			= 16,
+	
+	// Client array bits; TEXTURE_COORD_ARRAY gets one bit per client texture unit.
+	kClientArrayVertex			= 1UL << 0,
+	kClientArrayNormal			= 1UL << 1,
+	kClientArrayColor			= 1UL << 2,
+	kClientArrayIndex			= 1UL << 3,
+	kClientArrayEdgeFlag		= 1UL << 4,
+	kClientArrayTexCoordShift	= 8
+};
+
+
+static struct
+{
+	GLenum						activeTexture;
+	GLenum						clientActiveTexture;
+	GLuint						texture2D[kMaxShadowedTextureUnits];
+	GLuint						textureCubeMap[kMaxShadowedTextureUnits];
+	uint32_t					texture2DValid;			// Bit per texture unit.
+	uint32_t					textureCubeMapValid;
+	GLhandleARB					program;
+	GLenum						blendSrc, blendDst;
+	uint32_t					clientArraysValid;
+	uint32_t					clientArraysEnabled;
+	GLfloat						fogStart, fogEnd;
+	GLfloat						fogColor[4];
+	GLboolean					depthMask;
+	
+	uint8_t						activeTextureValid: 1,
+								clientActiveTextureValid: 1,
+								programValid: 1,
+								blendFuncValid: 1,
+								depthMaskValid: 1,
+								linearFogValid: 1,
+								fogColorValid: 1;
+} sShadow;
+
+static GLbitfield sAttribStack[kAttribStackDepth];
+static unsigned sAttribStackTop;
+
+
+#ifndef NDEBUG
+static NSUInteger sShadowCalls, sShadowFiltered;
+static NSUInteger sLastShadowCalls, sLastShadowFiltered;
+
+#define NOTE_SHADOW_CALL()		(sShadowCalls++)
+#define NOTE_SHADOW_FILTERED()	(sShadowFiltered++)
+#else
+#define NOTE_SHADOW_CALL()		do {} while (0)
+#define NOTE_SHADOW_FILTERED()	do {} while (0)
+#endif
+
+
+static inline void ForgetBlendFunc(void)
+{
+	sShadow.blendFuncValid = 0;
+}
+
+
+// Returns a mask of texture unit bits, or 0 if the unit is unknown or untracked.
+static inline uint32_t TextureUnitBit(GLenum textureUnit, bool valid)
+{
+	if (!valid || textureUnit < GL_TEXTURE0_ARB)  return 0;
+	GLenum index = textureUnit - GL_TEXTURE0_ARB;
+	if (index >= kMaxShadowedTextureUnits)  return 0;
+	return 1UL << index;
+}
+
+
+static inline unsigned TextureUnitIndex(uint32_t unitBit)
+{
+	unsigned index = 0;
+	while (unitBit >>= 1)  index++;
+	return index;
+}
+
+
+static uint32_t ClientArrayBit(GLenum array)
+{
+	switch (array)
+	{
+		case GL_VERTEX_ARRAY:			return kClientArrayVertex;
+		case GL_NORMAL_ARRAY:			return kClientArrayNormal;
+		case GL_COLOR_ARRAY:			return kClientArrayColor;
+		case GL_INDEX_ARRAY:			return kClientArrayIndex;
+		case GL_EDGE_FLAG_ARRAY:		return kClientArrayEdgeFlag;
+		
+		case GL_TEXTURE_COORD_ARRAY:
+			return TextureUnitBit(sShadow.clientActiveTexture, sShadow.clientActiveTextureValid) << kClientArrayTexCoordShift;
+	}
+	
+	return 0;
+}
+
+
+static void NoteClientArrayChange(GLenum array, uint32_t bit, bool enabled)
+{
+	if (bit != 0)
+	{
+		sShadow.clientArraysValid |= bit;
+		if (enabled)  sShadow.clientArraysEnabled |= bit;
+		else  sShadow.clientArraysEnabled &= ~bit;
+	}
+	else if (array == GL_TEXTURE_COORD_ARRAY)
+	{
+		// Don't know which client texture unit was affected.
+		sShadow.clientArraysValid &= (1UL << kClientArrayTexCoordShift) - 1;
+	}
+}
+
+
+void OOGLActiveTexture(GLenum textureUnit)
+{
+#if OO_MULTITEXTURE
+	NOTE_SHADOW_CALL();
+	if (sShadow.activeTextureValid && sShadow.activeTexture == textureUnit)
+	{
+		NOTE_SHADOW_FILTERED();
+		return;
+	}
+	
+	OO_ENTER_OPENGL();
+	OOGL(glActiveTextureARB(textureUnit));
+	sShadow.activeTexture = textureUnit;
+	sShadow.activeTextureValid = 1;
+#endif
+}
+
+
+void OOGLClientActiveTexture(GLenum textureUnit)
+{
+#if OO_MULTITEXTURE
+	NOTE_SHADOW_CALL();
+	if (sShadow.clientActiveTextureValid && sShadow.clientActiveTexture == textureUnit)
+	{
+		NOTE_SHADOW_FILTERED();
+		return;
+	}
+	
+	OO_ENTER_OPENGL();
+	OOGL(glClientActiveTextureARB(textureUnit));
+	sShadow.clientActiveTexture = textureUnit;
+	sShadow.clientActiveTextureValid = 1;
+#endif
+}
+
+
+void OOGLBindTexture(GLenum target, GLuint texture)
+{
+	GLuint *names = NULL;
+	uint32_t *valid = NULL;
+	
+	if (target == GL_TEXTURE_2D)
+	{
+		names = sShadow.texture2D;
+		valid = &sShadow.texture2DValid;
+	}
+#if OO_TEXTURE_CUBE_MAP
+	else if (target == GL_TEXTURE_CUBE_MAP)
+	{
+		names = sShadow.textureCubeMap;
+		valid = &sShadow.textureCubeMapValid;
+	}
+#endif
+	
+	NOTE_SHADOW_CALL();
+	
+#if OO_MULTITEXTURE
+	uint32_t unitBit = TextureUnitBit(sShadow.activeTexture, sShadow.activeTextureValid);
+#else
+	uint32_t unitBit = 1;
+#endif
+	
+	if (names != NULL && (*valid & unitBit) && names[TextureUnitIndex(unitBit)] == texture)
+	{
+		NOTE_SHADOW_FILTERED();
+		return;
+	}
+	
+	OO_ENTER_OPENGL();
+	OOGL(glBindTexture(target, texture));
+	
+	if (names != NULL)
+	{
+		if (unitBit != 0)
+		{
+			names[TextureUnitIndex(unitBit)] = texture;
+			*valid |= unitBit;
+		}
+		else
+		{
+			// Don't know which unit was affected.
+			*valid = 0;
+		}
+	}
+}
+
+
+void OOGLDeleteTextures(GLsizei count, const GLuint *textures)
+{
+	NSCParameterAssert(count == 0 || textures != NULL);
+	
+	OO_ENTER_OPENGL();
+	OOGL(glDeleteTextures(count, textures));
+	
+	// Deleting a bound texture reverts the binding to 0, and the name may be reused.
+	GLsizei i;
+	unsigned unit;
+	for (i = 0; i < count; i++)
+	{
+		if (textures[i] == 0)  continue;
+		
+		for (unit = 0; unit < kMaxShadowedTextureUnits; unit++)
+		{
+			if (sShadow.texture2D[unit] == textures[i])  sShadow.texture2DValid &= ~(1UL << unit);
+			if (sShadow.textureCubeMap[unit] == textures[i])  sShadow.textureCubeMapValid &= ~(1UL << unit);
+		}
+	}
 }
 
 
+void OOGLUseProgram(GLhandleARB program)
+{
+#if OO_SHADERS
+	NOTE_SHADOW_CALL();
+	if (sShadow.programValid && sShadow.program == program)
+	{
+		NOTE_SHADOW_FILTERED();
+		return;
+	}
+	
+	OO_ENTER_OPENGL();
+	OOGL(glUseProgramObjectARB(program));
+	sShadow.program = program;
+	sShadow.programValid = 1;
+#endif
+}
+
+
+void OOGLForgetProgram(GLhandleARB program)
+{
+	if (sShadow.program == program)  sShadow.programValid = 0;
+}
+
+
+void OOGLSetBlending(bool enabled)
+{
+	OO_ENTER_OPENGL();
+	
+	if (enabled)
+	{
+		OOGL(glEnable(GL_BLEND));
+	}
+	else
+	{
+		OOGL(glDisable(GL_BLEND));
+		ForgetBlendFunc();
+	}
+}
+
+
+void OOGLBlendFunc(GLenum sourceFactor, GLenum destFactor)
+{
+	NOTE_SHADOW_CALL();
+	if (sShadow.blendFuncValid && sShadow.blendSrc == sourceFactor && sShadow.blendDst == destFactor)
+	{
+		NOTE_SHADOW_FILTERED();
+		return;
+	}
+	
+	OO_ENTER_OPENGL();
+	OOGL(glBlendFunc(sourceFactor, destFactor));
+	sShadow.blendSrc = sourceFactor;
+	sShadow.blendDst = destFactor;
+	sShadow.blendFuncValid = 1;
+}
+
+
+void OOGLDepthMask(GLboolean flag)
+{
+	flag = !!flag;
+	
+	NOTE_SHADOW_CALL();
+	if (sShadow.depthMaskValid && sShadow.depthMask == flag)
+	{
+		NOTE_SHADOW_FILTERED();
+		return;
+	}
+	
+	OO_ENTER_OPENGL();
+	OOGL(glDepthMask(flag));
+	sShadow.depthMask = flag;
+	sShadow.depthMaskValid = 1;
+}
+
+
+void OOGLEnableClientState(GLenum array)
+{
+	uint32_t bit = ClientArrayBit(array);
+	
+	NOTE_SHADOW_CALL();
+	if ((sShadow.clientArraysValid & bit) && (sShadow.clientArraysEnabled & bit))
+	{
+		NOTE_SHADOW_FILTERED();
+		return;
+	}
+	
+	OO_ENTER_OPENGL();
+	OOGL(glEnableClientState(array));
+	NoteClientArrayChange(array, bit, true);
+}
+
+
+void OOGLDisableClientState(GLenum array)
+{
+	uint32_t bit = ClientArrayBit(array);
+	
+	NOTE_SHADOW_CALL();
+	if ((sShadow.clientArraysValid & bit) && !(sShadow.clientArraysEnabled & bit))
+	{
+		NOTE_SHADOW_FILTERED();
+		return;
+	}
+	
+	OO_ENTER_OPENGL();
+	OOGL(glDisableClientState(array));
+	NoteClientArrayChange(array, bit, false);
+}
+
+
+void OOGLLinearFog(GLfloat start, GLfloat end)
+{
+	NOTE_SHADOW_CALL();
+	if (sShadow.linearFogValid && sShadow.fogStart == start && sShadow.fogEnd == end)
+	{
+		NOTE_SHADOW_FILTERED();
+		return;
+	}
+	
+	OO_ENTER_OPENGL();
+	OOGL(glFogi(GL_FOG_MODE, GL_LINEAR));
+	OOGL(glFogf(GL_FOG_START, start));
+	OOGL(glFogf(GL_FOG_END, end));
+	sShadow.fogStart = start;
+	sShadow.fogEnd = end;
+	sShadow.linearFogValid = 1;
+}
+
+
+void OOGLFogColor(const GLfloat color[4])
+{
+	NSCParameterAssert(color != NULL);
+	
+	NOTE_SHADOW_CALL();
+	if (sShadow.fogColorValid && memcmp(sShadow.fogColor, color, sizeof sShadow.fogColor) == 0)
+	{
+		NOTE_SHADOW_FILTERED();
+		return;
+	}
+	
+	OO_ENTER_OPENGL();
+	OOGL(glFogfv(GL_FOG_COLOR, color));
+	memcpy(sShadow.fogColor, color, sizeof sShadow.fogColor);
+	sShadow.fogColorValid = 1;
+}
+
+
+void OOGLPushAttrib(GLbitfield mask)
+{
+	OO_ENTER_OPENGL();
+	OOGL(glPushAttrib(mask));
+	
+	if (sAttribStackTop < kAttribStackDepth)  sAttribStack[sAttribStackTop] = mask;
+	sAttribStackTop++;
+}
+
+
+void OOGLPopAttrib(void)
+{
+	OO_ENTER_OPENGL();
+	OOGL(glPopAttrib());
+	
+	GLbitfield mask = GL_ALL_ATTRIB_BITS;
+	if (sAttribStackTop > 0)
+	{
+		sAttribStackTop--;
+		if (sAttribStackTop < kAttribStackDepth)  mask = sAttribStack[sAttribStackTop];
+	}
+	
+	// GL_ENABLE_BIT restores GL_BLEND, which may reset the blend function.
+	if (mask & (GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT))  ForgetBlendFunc();
+	if (mask & GL_DEPTH_BUFFER_BIT)  sShadow.depthMaskValid = 0;
+	if (mask & GL_FOG_BIT)
+	{
+		sShadow.linearFogValid = 0;
+		sShadow.fogColorValid = 0;
+	}
+	if (mask & GL_TEXTURE_BIT)
+	{
+		sShadow.activeTextureValid = 0;
+		sShadow.texture2DValid = 0;
+		sShadow.textureCubeMapValid = 0;
+	}
+}
+
+
+void OOGLInvalidateStateCache(void)
+{
+	memset(&sShadow, 0, sizeof sShadow);
+}
+
+
+#ifndef NDEBUG
+void OOGLResetStateCacheStatistics(void)
+{
+	sLastShadowCalls = sShadowCalls;
+	sLastShadowFiltered = sShadowFiltered;
+	sShadowCalls = 0;
+	sShadowFiltered = 0;
+}
+
+
+void OOGLGetStateCacheStatistics(NSUInteger *outCalls, NSUInteger *outFiltered)
+{
+	if (outCalls != NULL)  *outCalls = sLastShadowCalls;
+	if (outFiltered != NULL)  *outFiltered = sLastShadowFiltered;
+}
+#endif
+
+
 // The state definitions.
 static const OOOpenGLState kStandardStates[OPENGL_STATE_INTERNAL_USE_ONLY + 1] =
 {
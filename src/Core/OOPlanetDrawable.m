@@ -200,18 +200,18 @@
 	
 	OOSetOpenGLState(OPENGL_STATE_OPAQUE);
 	
-	OOGL(glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT));
+	OOGLPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT);
 	OOGL(glShadeModel(GL_SMOOTH));
 	
 	if (_isAtmosphere)
 	{
-		OOGL(glEnable(GL_BLEND));
+		OOGLSetBlending(true);
 		OOGL(glDisable(GL_DEPTH_TEST));
-		OOGL(glDepthMask(GL_FALSE));
+		OOGLDepthMask(GL_FALSE);
 	}
 	else
 	{
-		OOGL(glDisable(GL_BLEND));
+		OOGLSetBlending(false);
 	}
 	
 	[_material apply];
@@ -223,9 +223,9 @@
 	OOGL(glEnable(GL_LIGHTING));
 	OOGL(glEnable(GL_TEXTURE_2D));
 	
-	OOGL(glDisableClientState(GL_COLOR_ARRAY));
+	OOGLDisableClientState(GL_COLOR_ARRAY);
 	
-	OOGL(glEnableClientState(GL_TEXTURE_COORD_ARRAY));
+	OOGLEnableClientState(GL_TEXTURE_COORD_ARRAY);
 	
 	OOGL(glVertexPointer(3, GL_FLOAT, 0, kOOPlanetVertices));
 	OOGL(glTexCoordPointer(2, GL_FLOAT, 0, kOOPlanetTexCoords));
@@ -249,9 +249,9 @@
 #endif
 	
 	[OOMaterial applyNone];
-	OOGL(glPopAttrib());
+	OOGLPopAttrib();
 	
-	OOGL(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
+	OOGLDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	
 	OOVerifyOpenGLState();
 }
@@ -203,10 +203,10 @@ static void APIENTRY ErrorCallback(GLenum error, void *polygonData);
 	}
 #endif
 	
-	OOGL(glEnableClientState(GL_VERTEX_ARRAY));
+	OOGLEnableClientState(GL_VERTEX_ARRAY);
 	OOGL(glVertexPointer(2, GL_FLOAT, 0, data));
 	OOGL(glDrawArrays(GL_TRIANGLES, 0, count));
-	OOGL(glDisableClientState(GL_VERTEX_ARRAY));
+	OOGLDisableClientState(GL_VERTEX_ARRAY);
 	
 #if OO_USE_VBO
 	if (useVBO)  OOGL(glBindBufferARB(GL_ARRAY_BUFFER, 0));
@@ -0,0 +1,114 @@
+/*
+
+OOQualityController.h
+
+Adjusts rendering and simulation detail to keep the frame rate near a target
+under sustained load.
+
+Universe reports the start of each frame drawn in flight. The controller
+keeps a short history of frame times and moves between quality levels, from
+0 (cheapest) to kOOQualityLevelCount - 1 (full detail), within bounds set in
+the user defaults. Each level sets a group of knobs that the code paying the
+cost reads when it needs them: planet level of detail, the number of dust
+particles, exhaust plume detail, how often distant ships are simulated, and
+an extra texture LOD bias.
+
+To avoid oscillating, quality is only reduced when the average frame time
+has been over the budget for a while, and only raised when it has been well
+under it for much longer. Raising quality again soon after a raise had to be
+undone waits twice as long as the previous attempt did. Every change is
+logged under rendering.adaptiveQuality with the measurements behind it.
+
+User defaults:
+	adaptive-quality				Enable adjustment (default YES). When off,
+									the maximum level is used.
+	adaptive-quality-target-fps		Frame rate to maintain (default 40).
+	adaptive-quality-min-level		Lowest level to use (default 0).
+	adaptive-quality-max-level		Highest level to use (default
+									kOOQualityLevelCount - 1), and the level
+									to start at.
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OOCocoa.h"
+#import "OOTypes.h"
+#import "OOProfilingStopwatch.h"
+
+
+enum
+{
+	kOOQualityLevelCount			= 5,
+	kOOQualityFrameHistoryLength	= 60
+};
+
+
+@interface OOQualityController: NSObject
+{
+@private
+	BOOL					_enabled;
+	unsigned				_level;
+	unsigned				_minimumLevel;
+	unsigned				_maximumLevel;
+	OOTimeDelta				_targetFrameTime;
+	
+	OOHighResTimeValue		_lastFrameStart;
+	BOOL					_haveLastFrameStart;
+	OOTimeDelta				_frameTimes[kOOQualityFrameHistoryLength];
+	unsigned				_frameTimeIndex;
+	unsigned				_frameTimeCount;
+	OOTimeDelta				_frameTimeSum;
+	
+	OOTimeDelta				_overBudgetTime;		// How long the average has been over budget...
+	OOTimeDelta				_underBudgetTime;		// ...or comfortably under it.
+	OOTimeDelta				_timeSinceChange;
+	OOTimeDelta				_raiseDelay;			// Time under budget needed to raise quality; backs off after failed raises.
+	BOOL					_lastChangeWasRaise;
+}
+
+// Reads the settings from the user defaults.
+- (id) init;
+
+/*	Call at the start of each frame that should count towards the frame rate.
+	Gaps longer than a quarter of a second, such as loading, aren't counted.
+*/
+- (void) frameDidBegin;
+
+/*	Forget the previous frame start, for instance while a GUI screen is
+	shown, so the next frame isn't timed from it.
+*/
+- (void) suspendTiming;
+
+- (BOOL) isEnabled;
+- (unsigned) level;
+- (unsigned) minimumLevel;
+- (unsigned) maximumLevel;
+- (OOTimeDelta) targetFrameTime;
+- (OOTimeDelta) averageFrameTime;		// Over the history, or 0 if there isn't any.
+
+// Knobs for the current level.
+- (float) planetDetailScale;			// Multiplies planet size on screen when choosing a level of detail; below 1, close-up surface detail is also disabled.
+- (float) dustFraction;					// Fraction of dust particles to draw.
+- (BOOL) reducedExhaustPlumes;			// Draw other ships' exhaust plumes with the short strips used for the player's own view.
+- (unsigned) distantShipUpdateInterval;	// Ships beyond twice scanner range are updated once every this many frames.
+- (float) textureLODBias;				// Added to the LOD bias of every texture.
+
+@end
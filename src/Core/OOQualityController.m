@@ -0,0 +1,302 @@
+/*
+
+OOQualityController.m
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OOQualityController.h"
+#import "OOTexture.h"
+#import "OOCollectionExtractors.h"
+
+
+static NSString * const kOOLogAdaptiveQuality = @"rendering.adaptiveQuality";
+
+
+#define kMaxFrameGap				0.25	// Longer frames are stalls (loading, window dragging) rather than load.
+#define kMinSampleCount				15		// Frames needed in the history before deciding anything.
+#define kReduceThreshold			1.1		// Reduce quality when the average is this far over budget...
+#define kReduceDelay				1.0		// ...for this long.
+#define kRaiseThreshold				0.7		// Raise quality when the average is this far under budget...
+#define kInitialRaiseDelay			5.0		// ...for this long, at first.
+#define kMaxRaiseDelay				80.0
+#define kMinChangeInterval			2.0		// Give each level time to show its effect.
+#define kFailedRaiseWindow			10.0	// A raise undone within this time doubles the raise delay.
+
+
+typedef struct
+{
+	float					planetDetailScale;
+	float					dustFraction;
+	BOOL					reducedExhaustPlumes;
+	unsigned				distantShipUpdateInterval;
+	float					textureLODBias;
+} OOQualityLevelSettings;
+
+
+static const OOQualityLevelSettings kLevelSettings[kOOQualityLevelCount] =
+{
+	//	Planet	Dust	Plumes	Ships	LOD bias
+	{	0.5f,	0.25f,	YES,	4,		1.5f	},
+	{	0.6f,	0.4f,	YES,	3,		1.0f	},
+	{	0.75f,	0.6f,	YES,	2,		0.5f	},
+	{	1.0f,	0.8f,	NO,		1,		0.0f	},
+	{	1.0f,	1.0f,	NO,		1,		0.0f	}
+};
+
+
+@interface OOQualityController (Private)
+
+- (void) noteFrameTime:(OOTimeDelta)frameTime;
+- (void) setLevel:(unsigned)level;
+- (void) resetHistory;
+- (NSString *) settingsDescription;
+
+@end
+
+
+@implementation OOQualityController
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		NSUserDefaults *prefs = [NSUserDefaults standardUserDefaults];
+		
+		_enabled = [prefs oo_boolForKey:@"adaptive-quality" defaultValue:YES];
+		_targetFrameTime = 1.0 / fmin(fmax([prefs oo_doubleForKey:@"adaptive-quality-target-fps" defaultValue:40.0], 10.0), 200.0);
+		_maximumLevel = MIN([prefs oo_unsignedIntForKey:@"adaptive-quality-max-level" defaultValue:kOOQualityLevelCount - 1], kOOQualityLevelCount - 1U);
+		_minimumLevel = MIN([prefs oo_unsignedIntForKey:@"adaptive-quality-min-level" defaultValue:0], _maximumLevel);
+		
+		_raiseDelay = kInitialRaiseDelay;
+		[self setLevel:_maximumLevel];
+		
+		if (_enabled)
+		{
+			OOLog(kOOLogAdaptiveQuality, @"Adaptive quality on: keeping frame time near %.1f ms with quality levels %u to %u (%@).", _targetFrameTime * 1000.0, _minimumLevel, _maximumLevel, [self settingsDescription]);
+		}
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	[self suspendTiming];
+	
+	[super dealloc];
+}
+
+
+- (NSString *) descriptionComponents
+{
+	return [NSString stringWithFormat:@"level %u of %u..%u, %@", _level, _minimumLevel, _maximumLevel, _enabled ? @"enabled" : @"disabled"];
+}
+
+
+- (void) frameDidBegin
+{
+	if (!_enabled)  return;
+	
+	OOHighResTimeValue now = OOGetHighResTime();
+	if (_haveLastFrameStart)
+	{
+		OOTimeDelta frameTime = OOHighResTimeDeltaInSeconds(_lastFrameStart, now);
+		OODisposeHighResTime(_lastFrameStart);
+		if (frameTime <= kMaxFrameGap)  [self noteFrameTime:frameTime];
+	}
+	
+	_lastFrameStart = now;
+	_haveLastFrameStart = YES;
+}
+
+
+- (void) suspendTiming
+{
+	if (_haveLastFrameStart)
+	{
+		OODisposeHighResTime(_lastFrameStart);
+		_haveLastFrameStart = NO;
+	}
+}
+
+
+- (BOOL) isEnabled
+{
+	return _enabled;
+}
+
+
+- (unsigned) level
+{
+	return _level;
+}
+
+
+- (unsigned) minimumLevel
+{
+	return _minimumLevel;
+}
+
+
+- (unsigned) maximumLevel
+{
+	return _maximumLevel;
+}
+
+
+- (OOTimeDelta) targetFrameTime
+{
+	return _targetFrameTime;
+}
+
+
+- (OOTimeDelta) averageFrameTime
+{
+	if (_frameTimeCount == 0)  return 0.0;
+	return _frameTimeSum / _frameTimeCount;
+}
+
+
+- (float) planetDetailScale
+{
+	return kLevelSettings[_level].planetDetailScale;
+}
+
+
+- (float) dustFraction
+{
+	return kLevelSettings[_level].dustFraction;
+}
+
+
+- (BOOL) reducedExhaustPlumes
+{
+	return kLevelSettings[_level].reducedExhaustPlumes;
+}
+
+
+- (unsigned) distantShipUpdateInterval
+{
+	return kLevelSettings[_level].distantShipUpdateInterval;
+}
+
+
+- (float) textureLODBias
+{
+	return kLevelSettings[_level].textureLODBias;
+}
+
+@end
+
+
+@implementation OOQualityController (Private)
+
+- (void) noteFrameTime:(OOTimeDelta)frameTime
+{
+	// Running sum over the history ring.
+	if (_frameTimeCount == kOOQualityFrameHistoryLength)  _frameTimeSum -= _frameTimes[_frameTimeIndex];
+	else  _frameTimeCount++;
+	_frameTimes[_frameTimeIndex] = frameTime;
+	_frameTimeSum += frameTime;
+	_frameTimeIndex = (_frameTimeIndex + 1) % kOOQualityFrameHistoryLength;
+	
+	OOTimeDelta average = [self averageFrameTime];
+	_timeSinceChange += frameTime;
+	
+	if (average > _targetFrameTime * kReduceThreshold)
+	{
+		_overBudgetTime += frameTime;
+		_underBudgetTime = 0.0;
+	}
+	else if (average < _targetFrameTime * kRaiseThreshold)
+	{
+		_underBudgetTime += frameTime;
+		_overBudgetTime = 0.0;
+	}
+	else
+	{
+		_overBudgetTime = 0.0;
+		_underBudgetTime = 0.0;
+	}
+	
+	// A raise that has held is no reason to hesitate over the next one.
+	if (_lastChangeWasRaise && _timeSinceChange > kFailedRaiseWindow)  _raiseDelay = kInitialRaiseDelay;
+	
+	if (_frameTimeCount < kMinSampleCount || _timeSinceChange < kMinChangeInterval)  return;
+	
+	if (_overBudgetTime >= kReduceDelay && _level > _minimumLevel)
+	{
+		if (_lastChangeWasRaise && _timeSinceChange <= kFailedRaiseWindow)
+		{
+			_raiseDelay = fmin(_raiseDelay * 2.0, kMaxRaiseDelay);
+		}
+		
+		OOTimeDelta overBudgetTime = _overBudgetTime;
+		[self setLevel:_level - 1];
+		_lastChangeWasRaise = NO;
+		OOLog(kOOLogAdaptiveQuality, @"Average frame time %.1f ms over %.1f ms budget for %.1f s; reduced quality to level %u (%@). Next raise after %.0f s under budget.", average * 1000.0, _targetFrameTime * 1000.0, overBudgetTime, _level, [self settingsDescription], _raiseDelay);
+	}
+	else if (_underBudgetTime >= _raiseDelay && _level < _maximumLevel)
+	{
+		OOTimeDelta underBudgetTime = _underBudgetTime;
+		[self setLevel:_level + 1];
+		_lastChangeWasRaise = YES;
+		OOLog(kOOLogAdaptiveQuality, @"Average frame time %.1f ms under %.1f ms budget for %.1f s; raised quality to level %u (%@).", average * 1000.0, _targetFrameTime * 1000.0, underBudgetTime, _level, [self settingsDescription]);
+	}
+}
+
+
+- (void) setLevel:(unsigned)level
+{
+	_level = MIN(level, kOOQualityLevelCount - 1U);
+	[OOTexture setExtraLODBias:[self textureLODBias]];
+	
+	[self resetHistory];
+	_timeSinceChange = 0.0;
+}
+
+
+// Measurements from the previous level say nothing about the new one.
+- (void) resetHistory
+{
+	_frameTimeIndex = 0;
+	_frameTimeCount = 0;
+	_frameTimeSum = 0.0;
+	_overBudgetTime = 0.0;
+	_underBudgetTime = 0.0;
+}
+
+
+- (NSString *) settingsDescription
+{
+	const OOQualityLevelSettings *settings = &kLevelSettings[_level];
+	
+	return [NSString stringWithFormat:@"planet detail %g, dust %u%%, %@ exhaust plumes, distant ships updated every %u frames, texture LOD bias %g",
+			settings->planetDetailScale,
+			(unsigned)(settings->dustFraction * 100.0f),
+			settings->reducedExhaustPlumes ? @"reduced" : @"full",
+			settings->distantShipUpdateInterval,
+			settings->textureLODBias];
+}
+
+@end
@@ -0,0 +1,100 @@
+/*
+
+OORenderQueue.h
+
+Ordering of entity draws within a render pass.
+
+Universe submits visible entities in painter's order (furthest first). Items
+marked sortable may be reordered among themselves, between the surrounding
+non-sortable items, by fog and lighting state, render state key (shader
+program and textures) and then front to back. Non-sortable items keep their
+place; they are used for things like the sun, which draws without depth
+testing and relies on being drawn before anything nearer.
+
+Also tracks per-frame counts of state changes made while drawing the world,
+for profiling content with many unique materials.
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OOCocoa.h"
+#import "OOOpenGL.h"
+
+@class Entity;
+
+
+typedef struct
+{
+	Entity					*entity;
+	NSUInteger				stateKey;
+	GLfloat					depth;		// Squared distance from camera.
+	uint8_t					sunlit: 1,
+							fogged: 1,
+							sortable: 1;
+} OORenderQueueItem;
+
+
+@interface OORenderQueue: NSObject
+{
+@private
+	OORenderQueueItem		*_items;
+	NSUInteger				_count;
+	NSUInteger				_capacity;
+}
+
+- (void) addEntity:(Entity *)entity
+		  stateKey:(NSUInteger)stateKey
+			 depth:(GLfloat)depth
+			sunlit:(BOOL)sunlit
+			fogged:(BOOL)fogged
+		  sortable:(BOOL)sortable;
+
+// Reorder runs of sortable items to minimise state changes.
+- (void) sortForStateChanges;
+
+- (NSUInteger) count;
+- (const OORenderQueueItem *) items;
+
+// Entities are not retained; clear the queue before they may be released.
+- (void) removeAllItems;
+
+@end
+
+
+typedef enum
+{
+	kOORenderStateChangeProgram,
+	kOORenderStateChangeTexture,
+	kOORenderStateChangeMaterial,
+	kOORenderStateChangeLighting,
+	kOORenderStateChangeFog,
+	
+	kOORenderStateChangeKindCount
+} OORenderStateChangeKind;
+
+
+void OOCountRenderStateChange(OORenderStateChangeKind kind);
+
+// Called by Universe around world drawing; the snapshot is what gets reported.
+void OOResetRenderStateChangeCounts(void);
+void OOSnapshotRenderStateChangeCounts(void);
+
+NSUInteger OORenderStateChangeCount(OORenderStateChangeKind kind);
@@ -0,0 +1,156 @@
+/*
+
+OORenderQueue.m
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OORenderQueue.h"
+
+
+enum
+{
+	kMinItemCapacity			= 64
+};
+
+
+static NSUInteger			sStateChangeCounts[kOORenderStateChangeKindCount];
+static NSUInteger			sStateChangeSnapshot[kOORenderStateChangeKindCount];
+
+
+static int CompareSortableItems(const void *a, const void *b);
+
+
+@implementation OORenderQueue
+
+- (void) dealloc
+{
+	free(_items);
+	
+	[super dealloc];
+}
+
+
+- (void) addEntity:(Entity *)entity
+		  stateKey:(NSUInteger)stateKey
+			 depth:(GLfloat)depth
+			sunlit:(BOOL)sunlit
+			fogged:(BOOL)fogged
+		  sortable:(BOOL)sortable
+{
+	if (_count == _capacity)
+	{
+		NSUInteger newCapacity = MAX(_capacity * 2, (NSUInteger)kMinItemCapacity);
+		OORenderQueueItem *newItems = realloc(_items, sizeof *newItems * newCapacity);
+		if (newItems == NULL)
+		{
+			[NSException raise:NSMallocException format:@"Failed to grow render queue to %lu items.", (unsigned long)newCapacity];
+		}
+		_items = newItems;
+		_capacity = newCapacity;
+	}
+	
+	OORenderQueueItem *item = &_items[_count++];
+	item->entity = entity;
+	item->stateKey = stateKey;
+	item->depth = depth;
+	item->sunlit = !!sunlit;
+	item->fogged = !!fogged;
+	item->sortable = !!sortable;
+}
+
+
+- (void) sortForStateChanges
+{
+	NSUInteger runStart = 0, i;
+	
+	for (i = 0; i <= _count; i++)
+	{
+		if (i == _count || !_items[i].sortable)
+		{
+			if (i - runStart > 1)
+			{
+				qsort(&_items[runStart], i - runStart, sizeof *_items, CompareSortableItems);
+			}
+			runStart = i + 1;
+		}
+	}
+}
+
+
+- (NSUInteger) count
+{
+	return _count;
+}
+
+
+- (const OORenderQueueItem *) items
+{
+	return _items;
+}
+
+
+- (void) removeAllItems
+{
+	_count = 0;
+}
+
+@end
+
+
+static int CompareSortableItems(const void *a, const void *b)
+{
+	const OORenderQueueItem *itemA = a;
+	const OORenderQueueItem *itemB = b;
+	
+	if (itemA->fogged != itemB->fogged)  return (int)itemA->fogged - (int)itemB->fogged;
+	if (itemA->sunlit != itemB->sunlit)  return (int)itemB->sunlit - (int)itemA->sunlit;
+	if (itemA->stateKey != itemB->stateKey)  return (itemA->stateKey < itemB->stateKey) ? -1 : 1;
+	
+	// Front to back within a state group, so nearer objects fill the depth buffer first.
+	if (itemA->depth != itemB->depth)  return (itemA->depth < itemB->depth) ? -1 : 1;
+	return 0;
+}
+
+
+void OOCountRenderStateChange(OORenderStateChangeKind kind)
+{
+	sStateChangeCounts[kind]++;
+}
+
+
+void OOResetRenderStateChangeCounts(void)
+{
+	memset(sStateChangeCounts, 0, sizeof sStateChangeCounts);
+}
+
+
+void OOSnapshotRenderStateChangeCounts(void)
+{
+	memcpy(sStateChangeSnapshot, sStateChangeCounts, sizeof sStateChangeSnapshot);
+}
+
+
+NSUInteger OORenderStateChangeCount(OORenderStateChangeKind kind)
+{
+	NSCParameterAssert(kind < kOORenderStateChangeKindCount);
+	return sStateChangeSnapshot[kind];
+}
@@ -200,7 +200,7 @@ static OOColor *SaturatedColorInRange(OOColor *color1, OOColor *color2);
 	
 	// Make stars dim in atmosphere. Note: works OK on night side because sky is dark blue, not black.
 	GLfloat fogColor[4] = {0.02, 0.02, 0.02, 1.0};
-	OOGL(glFogfv(GL_FOG_COLOR, fogColor));
+	OOGLFogColor(fogColor);
 	
 	if (_displayListName != 0)
 	{
@@ -212,19 +212,24 @@ static OOColor *SaturatedColorInRange(OOColor *color1, OOColor *color2);
 		[self ensureTexturesLoaded];
 		_displayListName = glGenLists(1);
 		
+		// Texture bindings must all be recorded, so none may be skipped as redundant.
+		OOGLInvalidateStateCache();
 		OOGL(glNewList(_displayListName, GL_COMPILE));
 		
-		OOGL(glEnableClientState(GL_TEXTURE_COORD_ARRAY));
-		OOGL(glEnableClientState(GL_COLOR_ARRAY));
+		OOGLEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		OOGLEnableClientState(GL_COLOR_ARRAY);
 		
 		[_quadSets makeObjectsPerformSelector:@selector(render)];
 		
-		OOGL(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
-		OOGL(glDisableClientState(GL_COLOR_ARRAY));
+		OOGLDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		OOGLDisableClientState(GL_COLOR_ARRAY);
 		
 		OOGL(glEndList());
 	}
 	
+	// The display list binds textures behind the state cache's back.
+	OOGLInvalidateStateCache();
+	
 	// Restore state
 	OOGL(glEnable(GL_DEPTH_TEST));
 	OOGL(glDisable(GL_TEXTURE_2D));
@@ -0,0 +1,106 @@
+/*
+
+OOSystemPrefetcher.h
+
+Prepares a destination system's expensive assets while the player's
+hyperspace countdown is running, so less of the work happens in the frame in
+which the player arrives.
+
+The work is split into steps: building the sky backdrop, building the main
+planet, and loading the models (and through them the textures and shaders)
+of the ships most likely to be spawned there, namely the main station, the
+navigation buoys and the ships of the roles used to populate a system.
+Universe performs steps between frames, within a small time budget, for as
+long as the countdown is running, and throws the prefetcher away if the jump
+is aborted.
+
+When the player arrives, -[Universe setUpSpace] claims the sky and planet if
+they are still valid for the system information at that time. Claiming
+leaves the random number generators in the state generating the objects
+would have left them in, so the system is set up exactly as it would be
+without prefetching. Ship models are only held on to so that their textures
+and shaders stay in the caches until the system is populated.
+
+Only used for ordinary hyperspace jumps; the destination of a galactic jump
+is not known until it happens.
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OOCocoa.h"
+#import "OOTypes.h"
+#import "legacy_random.h"
+
+@class SkyEntity, OOPlanetEntity;
+
+
+@interface OOSystemPrefetcher: NSObject
+{
+@private
+	Random_Seed				_systemSeed;
+	NSDictionary			*_systemInfo;
+	
+	NSArray					*_shipKeys;
+	NSMutableArray			*_meshes;
+	NSUInteger				_nextStep;
+	NSUInteger				_stepCount;
+	
+	SkyEntity				*_sky;
+	OORandomState			_randomStateAfterSky;
+	OOPlanetEntity			*_planet;
+	NSDictionary			*_planetDictionary;
+	OORandomState			_randomStateAfterPlanet;
+	BOOL					_reducedDetail;
+	
+	BOOL					_skyClaimed;
+	BOOL					_planetClaimed;
+	double					_prefetchTime;
+}
+
+- (id) initWithSystemSeed:(Random_Seed)seed;
+
+- (Random_Seed) systemSeed;
+
+- (BOOL) isFinished;
+
+/*	Perform steps until interval seconds have passed. At least one step is
+	performed if any remain, however long it takes.
+*/
+- (void) performStepsForInterval:(OOTimeDelta)interval;
+
+/*	Return the prefetched sky or main planet if it was built from the same
+	data, and advance the random number generators past it; otherwise return
+	nil without touching them. Each can only be claimed once. The random
+	number generators must be seeded with seed_for_planet_description() for
+	the system, as they would be for building the object.
+*/
+- (SkyEntity *) claimSkyForSystemInfo:(NSDictionary *)systemInfo;
+- (OOPlanetEntity *) claimMainPlanetForDictionary:(NSDictionary *)planetDict;
+
+/*	Summary of how much of the work was done in advance: steps performed
+	and total ("stepsDone", "stepCount"), whether the sky and planet were
+	claimed ("skyClaimed", "planetClaimed"), ship models loaded and how many
+	have all their textures loaded ("meshCount", "meshesReady") and the time
+	spent prefetching ("prefetchTime").
+*/
+- (NSDictionary *) report;
+
+@end
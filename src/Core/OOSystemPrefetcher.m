@@ -0,0 +1,348 @@
+/*
+
+OOSystemPrefetcher.m
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OOSystemPrefetcher.h"
+#import "Universe.h"
+#import "OOShipRegistry.h"
+#import "OOProbabilitySet.h"
+#import "OOMesh.h"
+#import "ShipEntity.h"
+#import "SkyEntity.h"
+#import "OOPlanetEntity.h"
+#import "OOCollectionExtractors.h"
+#import "OOProfilingStopwatch.h"
+
+
+/*	Roles used when setting up and populating a system, apart from the main
+	station's, which depends on the system.
+*/
+static NSString * const kPrefetchRoles[] =
+{
+	@"buoy", @"buoy-witchpoint",
+	@"trader", @"sunskim-trader", @"pirate", @"hunter", @"police", @"interceptor", @"thargoid", @"rockhermit"
+};
+
+
+enum
+{
+	kMaxShipKeysPerRole			= 4			// Most likely ship types loaded for each role...
+};
+
+#define kRoleWeightCoverage		0.75f		// ...or fewer, if they're this likely between them.
+
+
+enum
+{
+	kStepSky,
+	kStepPlanet,
+	kFirstShipStep							// One step per ship key follows.
+};
+
+
+static NSComparisonResult CompareByWeightDescending(id a, id b, void *context);
+
+
+@interface OOSystemPrefetcher (Private)
+
+- (NSArray *) likelyShipKeys;
+- (void) performStep:(NSUInteger)step;
+- (void) buildSky;
+- (void) buildPlanet;
+- (void) loadShipModel:(NSString *)shipKey;
+
+@end
+
+
+@implementation OOSystemPrefetcher
+
+- (id) init
+{
+	[self release];
+	return nil;
+}
+
+
+- (id) initWithSystemSeed:(Random_Seed)seed
+{
+	if ((self = [super init]))
+	{
+		_systemSeed = seed;
+		
+		// Generating system data reseeds the legacy generator, which the current system is still using.
+		OORandomState saved = OOSaveRandomState();
+		_systemInfo = [[UNIVERSE generateSystemData:seed useCache:NO] copy];
+		OORestoreRandomState(saved);
+		
+		_reducedDetail = [UNIVERSE reducedDetail];
+		
+		_shipKeys = [[self likelyShipKeys] retain];
+		_meshes = [[NSMutableArray alloc] initWithCapacity:[_shipKeys count]];
+		_stepCount = kFirstShipStep + [_shipKeys count];
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	DESTROY(_systemInfo);
+	DESTROY(_shipKeys);
+	DESTROY(_meshes);
+	DESTROY(_sky);
+	DESTROY(_planet);
+	DESTROY(_planetDictionary);
+	
+	[super dealloc];
+}
+
+
+- (NSString *) descriptionComponents
+{
+	return [NSString stringWithFormat:@"%@, %lu of %lu steps done", [_systemInfo oo_stringForKey:KEY_NAME], (unsigned long)_nextStep, (unsigned long)_stepCount];
+}
+
+
+- (Random_Seed) systemSeed
+{
+	return _systemSeed;
+}
+
+
+- (BOOL) isFinished
+{
+	return _nextStep >= _stepCount;
+}
+
+
+- (void) performStepsForInterval:(OOTimeDelta)interval
+{
+	if ([self isFinished])  return;
+	
+	OOHighResTimeValue start = OOGetHighResTime();
+	double elapsed;
+	
+	do
+	{
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		@try
+		{
+			[self performStep:_nextStep];
+		}
+		@catch (NSException *exception)
+		{
+			OOLog(kOOLogException, @"***** Exception while prefetching step %lu for %@: %@ : %@ *****", (unsigned long)_nextStep, [_systemInfo oo_stringForKey:KEY_NAME], [exception name], [exception reason]);
+		}
+		[pool release];
+		_nextStep++;
+		
+		OOHighResTimeValue now = OOGetHighResTime();
+		elapsed = OOHighResTimeDeltaInSeconds(start, now);
+		OODisposeHighResTime(now);
+	}
+	while (![self isFinished] && elapsed < interval);
+	
+	OODisposeHighResTime(start);
+	_prefetchTime += elapsed;
+}
+
+
+- (SkyEntity *) claimSkyForSystemInfo:(NSDictionary *)systemInfo
+{
+	if (_sky == nil || _reducedDetail != [UNIVERSE reducedDetail] || ![systemInfo isEqualToDictionary:_systemInfo])  return nil;
+	
+	SkyEntity *result = [_sky autorelease];
+	_sky = nil;
+	_skyClaimed = YES;
+	OORestoreRandomState(_randomStateAfterSky);
+	
+	return result;
+}
+
+
+- (OOPlanetEntity *) claimMainPlanetForDictionary:(NSDictionary *)planetDict
+{
+	if (_planet == nil || ![planetDict isEqualToDictionary:_planetDictionary])  return nil;
+	
+	OOPlanetEntity *result = [_planet autorelease];
+	_planet = nil;
+	_planetClaimed = YES;
+	OORestoreRandomState(_randomStateAfterPlanet);
+	
+#if !NEW_PLANETS
+	// The first shuttle launch is timed from when the planet was created.
+	[result scheduleFirstShuttleLaunch];
+#endif
+	
+	return result;
+}
+
+
+- (NSDictionary *) report
+{
+	NSUInteger meshesReady = 0;
+	NSEnumerator *meshEnum = nil;
+	OOMesh *mesh = nil;
+	for (meshEnum = [_meshes objectEnumerator]; (mesh = [meshEnum nextObject]); )
+	{
+		if ([mesh isFinishedLoading])  meshesReady++;
+	}
+	
+	return [NSDictionary dictionaryWithObjectsAndKeys:
+			[NSNumber numberWithUnsignedInteger:MIN(_nextStep, _stepCount)], @"stepsDone",
+			[NSNumber numberWithUnsignedInteger:_stepCount], @"stepCount",
+			[NSNumber numberWithBool:_skyClaimed], @"skyClaimed",
+			[NSNumber numberWithBool:_planetClaimed], @"planetClaimed",
+			[NSNumber numberWithUnsignedInteger:[_meshes count]], @"meshCount",
+			[NSNumber numberWithUnsignedInteger:meshesReady], @"meshesReady",
+			[NSNumber numberWithDouble:_prefetchTime], @"prefetchTime",
+			nil];
+}
+
+@end
+
+
+@implementation OOSystemPrefetcher (Private)
+
+/*	The most likely ship types for each role, by weight, without duplicates.
+	Roles that the population code picks many ships for tend to be dominated
+	by a few common types, so this catches most of what will actually appear
+	without loading every OXP ship that shares a role.
+*/
+- (NSArray *) likelyShipKeys
+{
+	OOShipRegistry		*registry = [OOShipRegistry sharedRegistry];
+	NSMutableArray		*result = [NSMutableArray array];
+	NSMutableSet		*seen = [NSMutableSet set];
+	NSUInteger			i, j, count = sizeof kPrefetchRoles / sizeof *kPrefetchRoles;
+	
+	unsigned techLevel = [_systemInfo oo_unsignedIntForKey:KEY_TECHLEVEL];
+	NSString *stationRole = [_systemInfo oo_stringForKey:@"station" defaultValue:[UNIVERSE defaultStationRoleForSystem:_systemSeed techLevel:techLevel]];
+	
+	for (i = 0; i <= count; i++)
+	{
+		NSString *role = (i == 0) ? stationRole : kPrefetchRoles[i - 1];
+		OOProbabilitySet *pset = [registry probabilitySetForRole:role];
+		float total = [pset sumOfWeights];
+		if ([pset count] == 0 || total <= 0.0f)  continue;
+		
+		NSArray *keys = [[pset allObjects] sortedArrayUsingFunction:CompareByWeightDescending context:pset];
+		float covered = 0.0f;
+		for (j = 0; j < [keys count] && j < kMaxShipKeysPerRole && covered < kRoleWeightCoverage * total; j++)
+		{
+			NSString *key = [keys objectAtIndex:j];
+			covered += [pset weightForObject:key];
+			if (![seen containsObject:key])
+			{
+				[seen addObject:key];
+				[result addObject:key];
+			}
+		}
+	}
+	
+	return result;
+}
+
+
+- (void) performStep:(NSUInteger)step
+{
+	switch (step)
+	{
+		case kStepSky:
+			[self buildSky];
+			break;
+		
+		case kStepPlanet:
+			[self buildPlanet];
+			break;
+		
+		default:
+			[self loadShipModel:[_shipKeys objectAtIndex:step - kFirstShipStep]];
+	}
+}
+
+
+/*	The sky and planet are built exactly as -[Universe setUpSpace] builds
+	them, starting from the same random number generator state, and the
+	generators are put back afterwards so nothing else notices.
+*/
+- (void) buildSky
+{
+	OORandomState saved = OOSaveRandomState();
+	
+	seed_for_planet_description(_systemSeed);
+	_sky = [UNIVERSE newSkyWithSystemInfo:_systemInfo];
+	_randomStateAfterSky = OOSaveRandomState();
+	
+	OORestoreRandomState(saved);
+}
+
+
+- (void) buildPlanet
+{
+	OORandomState saved = OOSaveRandomState();
+	
+	seed_for_planet_description(_systemSeed);
+	_planetDictionary = [[UNIVERSE mainPlanetDictionaryForSystem:_systemSeed] retain];
+	_planet = [[OOPlanetEntity alloc] initFromDictionary:_planetDictionary withAtmosphere:YES andSeed:_systemSeed];
+	_randomStateAfterPlanet = OOSaveRandomState();
+	
+	OORestoreRandomState(saved);
+}
+
+
+/*	Loading a model with the same options as ShipEntity creates its materials,
+	which start their textures loading in the background and compile any
+	shaders. Ships set up on arrival get separate meshes but share those.
+*/
+- (void) loadShipModel:(NSString *)shipKey
+{
+	NSDictionary *shipDict = [[OOShipRegistry sharedRegistry] shipInfoForKey:shipKey];
+	NSString *modelName = [shipDict oo_stringForKey:@"model"];
+	if (modelName == nil)  return;
+	
+	OOMesh *mesh = [OOMesh meshWithName:modelName
+							   cacheKey:shipKey
+					 materialDictionary:[shipDict oo_dictionaryForKey:@"materials"]
+					  shadersDictionary:[shipDict oo_dictionaryForKey:@"shaders"]
+								 smooth:[shipDict oo_boolForKey:@"smooth" defaultValue:NO]
+						   shaderMacros:OODefaultShipShaderMacros()
+					shaderBindingTarget:nil];
+	if (mesh != nil)  [_meshes addObject:mesh];
+}
+
+@end
+
+
+static NSComparisonResult CompareByWeightDescending(id a, id b, void *context)
+{
+	OOProbabilitySet *pset = context;
+	float weightA = [pset weightForObject:a];
+	float weightB = [pset weightForObject:b];
+	
+	if (weightA > weightB)  return NSOrderedAscending;
+	if (weightA < weightB)  return NSOrderedDescending;
+	return [a compare:b];
+}
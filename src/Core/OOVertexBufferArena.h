@@ -0,0 +1,76 @@
+/*
+
+OOVertexBufferArena.h
+
+Shared vertex buffer storage for static geometry.
+
+Rather than giving each mesh its own buffer object, geometry is packed into a
+small number of large GL_ARRAY_BUFFER objects ("pages"), and each client holds
+an allocation describing which page it lives in and at what offset. Draw calls
+then only need to bind the page and use the offset as the array base pointer.
+
+Allocations are invalidated by a graphics reset; -allocationIsValid: returns NO
+afterwards and the client should reallocate and re-upload. Freeing a stale
+allocation is harmless.
+
+If vertex buffer objects aren't available, allocation always fails and
+clients should fall back to client-side arrays.
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OOOpenGL.h"
+#import "OOGraphicsResetManager.h"
+
+
+typedef struct
+{
+	GLuint					buffer;			// Zero if not allocated.
+	uint32_t				generation;
+	size_t					offset;
+	size_t					size;
+} OOVertexBufferAllocation;
+
+
+@interface OOVertexBufferArena: NSObject <OOGraphicsResetClient>
+{
+@private
+	struct OOVertexBufferPage	*_pages;
+	NSUInteger				_pageCount;
+	uint32_t				_generation;
+	size_t					_bytesAllocated;
+}
+
++ (OOVertexBufferArena *) sharedArena;
+
+/*	Allocate space for size bytes and upload data into it. Returns NO (and
+	leaves *allocation zeroed) if VBOs are unavailable or allocation fails.
+	Must be called with a current OpenGL context. Leaves no buffer bound.
+*/
+- (BOOL) allocateSize:(size_t)size withData:(const void *)data allocation:(OOVertexBufferAllocation *)allocation;
+- (void) freeAllocation:(OOVertexBufferAllocation *)allocation;
+
+- (BOOL) allocationIsValid:(const OOVertexBufferAllocation *)allocation;
+
+- (size_t) bytesAllocated;
+- (NSUInteger) pageCount;
+
+@end
@@ -0,0 +1,361 @@
+/*
+
+OOVertexBufferArena.m
+
+
+Oolite
+Copyright (C) 2004-2013 Giles C Williams and contributors
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+MA 02110-1301, USA.
+
+*/
+
+#import "OOVertexBufferArena.h"
+#import "OOOpenGLExtensionManager.h"
+#import "OOMacroOpenGL.h"
+
+
+enum
+{
+	kPageSize					= 4 << 20,	// 4 MiB; larger requests get a page of their own.
+	kAllocationAlignment		= 16,
+	kMinFreeRangeCapacity		= 8
+};
+
+
+typedef struct
+{
+	size_t					offset;
+	size_t					size;
+} FreeRange;
+
+
+struct OOVertexBufferPage
+{
+	GLuint					name;
+	size_t					size;
+	FreeRange				*freeRanges;	// Sorted by offset, never adjacent.
+	NSUInteger				freeCount;
+	NSUInteger				freeCapacity;
+};
+typedef struct OOVertexBufferPage Page;
+
+
+static OOVertexBufferArena *sSharedArena = nil;
+
+
+#if OO_USE_VBO
+static BOOL TakeFromPage(Page *page, size_t size, size_t *outOffset);
+static BOOL ReturnToPage(Page *page, size_t offset, size_t size);
+static BOOL PageIsEmpty(Page *page);
+#endif
+
+
+@interface OOVertexBufferArena (Private)
+
+- (Page *) addPageWithSize:(size_t)size;
+- (void) removePageAtIndex:(NSUInteger)index;
+- (void) deleteAllPages;
+
+@end
+
+
+@implementation OOVertexBufferArena
+
++ (OOVertexBufferArena *) sharedArena
+{
+	if (sSharedArena == nil)
+	{
+		sSharedArena = [[self alloc] init];
+		[[OOGraphicsResetManager sharedManager] registerClient:sSharedArena];
+	}
+	return sSharedArena;
+}
+
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		_generation = 1;
+	}
+	return self;
+}
+
+
+- (void) dealloc
+{
+	[[OOGraphicsResetManager sharedManager] unregisterClient:self];
+	[self deleteAllPages];
+	
+	[super dealloc];
+}
+
+
+- (BOOL) allocateSize:(size_t)size withData:(const void *)data allocation:(OOVertexBufferAllocation *)allocation
+{
+	NSParameterAssert(allocation != NULL);
+	
+	memset(allocation, 0, sizeof *allocation);
+	
+#if OO_USE_VBO
+	if (size == 0 || ![[OOOpenGLExtensionManager sharedManager] vboSupported])  return NO;
+	
+	size_t dataSize = size;
+	size = (size + kAllocationAlignment - 1) & ~(size_t)(kAllocationAlignment - 1);
+	
+	Page *page = NULL;
+	size_t offset = 0;
+	NSUInteger i;
+	for (i = 0; i < _pageCount; i++)
+	{
+		if (TakeFromPage(&_pages[i], size, &offset))
+		{
+			page = &_pages[i];
+			break;
+		}
+	}
+	
+	if (page == NULL)
+	{
+		page = [self addPageWithSize:MAX(size, (size_t)kPageSize)];
+		if (page == NULL || !TakeFromPage(page, size, &offset))  return NO;
+	}
+	
+	OO_ENTER_OPENGL();
+	
+	OOGL(glBindBufferARB(GL_ARRAY_BUFFER, page->name));
+	OOGL(glBufferSubDataARB(GL_ARRAY_BUFFER, offset, dataSize, data));
+	OOGL(glBindBufferARB(GL_ARRAY_BUFFER, 0));
+	
+	allocation->buffer = page->name;
+	allocation->generation = _generation;
+	allocation->offset = offset;
+	allocation->size = size;
+	_bytesAllocated += size;
+	
+	return YES;
+#else
+	return NO;
+#endif
+}
+
+
+- (void) freeAllocation:(OOVertexBufferAllocation *)allocation
+{
+	NSParameterAssert(allocation != NULL);
+	
+#if OO_USE_VBO
+	if ([self allocationIsValid:allocation])
+	{
+		NSUInteger i;
+		for (i = 0; i < _pageCount; i++)
+		{
+			if (_pages[i].name == allocation->buffer)
+			{
+				if (ReturnToPage(&_pages[i], allocation->offset, allocation->size))
+				{
+					_bytesAllocated -= allocation->size;
+				}
+				
+				// Keep one page around, but release any others once emptied.
+				if (_pageCount > 1 && PageIsEmpty(&_pages[i]))  [self removePageAtIndex:i];
+				break;
+			}
+		}
+	}
+#endif
+	
+	memset(allocation, 0, sizeof *allocation);
+}
+
+
+- (BOOL) allocationIsValid:(const OOVertexBufferAllocation *)allocation
+{
+	return allocation != NULL && allocation->buffer != 0 && allocation->generation == _generation;
+}
+
+
+- (size_t) bytesAllocated
+{
+	return _bytesAllocated;
+}
+
+
+- (NSUInteger) pageCount
+{
+	return _pageCount;
+}
+
+
+- (void) resetGraphicsState
+{
+	[self deleteAllPages];
+	_generation++;
+}
+
+@end
+
+
+@implementation OOVertexBufferArena (Private)
+
+- (Page *) addPageWithSize:(size_t)size
+{
+#if OO_USE_VBO
+	Page *newPages = realloc(_pages, sizeof *_pages * (_pageCount + 1));
+	if (newPages == NULL)  return NULL;
+	_pages = newPages;
+	
+	Page *page = &_pages[_pageCount];
+	memset(page, 0, sizeof *page);
+	
+	page->freeRanges = malloc(sizeof *page->freeRanges * kMinFreeRangeCapacity);
+	if (page->freeRanges == NULL)  return NULL;
+	page->freeCapacity = kMinFreeRangeCapacity;
+	
+	OO_ENTER_OPENGL();
+	
+	OOGL(glGenBuffersARB(1, &page->name));
+	if (page->name == 0)
+	{
+		free(page->freeRanges);
+		return NULL;
+	}
+	OOGL(glBindBufferARB(GL_ARRAY_BUFFER, page->name));
+	OOGL(glBufferDataARB(GL_ARRAY_BUFFER, size, NULL, GL_STATIC_DRAW));
+	OOGL(glBindBufferARB(GL_ARRAY_BUFFER, 0));
+	
+	page->size = size;
+	page->freeRanges[0] = (FreeRange){ 0, size };
+	page->freeCount = 1;
+	
+	_pageCount++;
+	OOLog(@"rendering.vertexBufferArena.grow", @"Allocated vertex buffer page %u of %lu KiB (now %lu pages).", page->name, (unsigned long)(size >> 10), (unsigned long)_pageCount);
+	
+	return page;
+#else
+	return NULL;
+#endif
+}
+
+
+- (void) removePageAtIndex:(NSUInteger)index
+{
+	NSParameterAssert(index < _pageCount);
+	
+#if OO_USE_VBO
+	OO_ENTER_OPENGL();
+	OOGL(glDeleteBuffersARB(1, &_pages[index].name));
+#endif
+	free(_pages[index].freeRanges);
+	
+	_pageCount--;
+	if (index < _pageCount)  memmove(&_pages[index], &_pages[index + 1], sizeof *_pages * (_pageCount - index));
+}
+
+
+- (void) deleteAllPages
+{
+	while (_pageCount != 0)  [self removePageAtIndex:_pageCount - 1];
+	
+	free(_pages);
+	_pages = NULL;
+	_bytesAllocated = 0;
+}
+
+@end
+
+
+#if OO_USE_VBO
+
+static BOOL TakeFromPage(Page *page, size_t size, size_t *outOffset)
+{
+	NSUInteger i;
+	for (i = 0; i < page->freeCount; i++)
+	{
+		FreeRange *range = &page->freeRanges[i];
+		if (range->size >= size)
+		{
+			*outOffset = range->offset;
+			range->offset += size;
+			range->size -= size;
+			
+			if (range->size == 0)
+			{
+				page->freeCount--;
+				memmove(range, range + 1, sizeof *range * (page->freeCount - i));
+			}
+			return YES;
+		}
+	}
+	
+	return NO;
+}
+
+
+static BOOL ReturnToPage(Page *page, size_t offset, size_t size)
+{
+	// Find first free range after the returned block.
+	NSUInteger i;
+	for (i = 0; i < page->freeCount; i++)
+	{
+		if (page->freeRanges[i].offset > offset)  break;
+	}
+	
+	BOOL joinsPrevious = (i > 0 && page->freeRanges[i - 1].offset + page->freeRanges[i - 1].size == offset);
+	BOOL joinsNext = (i < page->freeCount && offset + size == page->freeRanges[i].offset);
+	
+	if (joinsPrevious && joinsNext)
+	{
+		page->freeRanges[i - 1].size += size + page->freeRanges[i].size;
+		page->freeCount--;
+		memmove(&page->freeRanges[i], &page->freeRanges[i + 1], sizeof *page->freeRanges * (page->freeCount - i));
+	}
+	else if (joinsPrevious)
+	{
+		page->freeRanges[i - 1].size += size;
+	}
+	else if (joinsNext)
+	{
+		page->freeRanges[i].offset = offset;
+		page->freeRanges[i].size += size;
+	}
+	else
+	{
+		if (page->freeCount == page->freeCapacity)
+		{
+			NSUInteger newCapacity = page->freeCapacity * 2;
+			FreeRange *newRanges = realloc(page->freeRanges, sizeof *newRanges * newCapacity);
+			if (newRanges == NULL)  return NO;	// Leak the space rather than fail.
+			page->freeRanges = newRanges;
+			page->freeCapacity = newCapacity;
+		}
+		
+		memmove(&page->freeRanges[i + 1], &page->freeRanges[i], sizeof *page->freeRanges * (page->freeCount - i));
+		page->freeRanges[i] = (FreeRange){ offset, size };
+		page->freeCount++;
+	}
+	
+	return YES;
+}
+
+
+static BOOL PageIsEmpty(Page *page)
+{
+	return page->freeCount == 1 && page->freeRanges[0].size == page->size;
+}
+
+#endif
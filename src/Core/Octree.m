@@ -178,7 +178,7 @@ static Vector offsetForOctant(int oct, GLfloat r)
 	OODebugWFState state = OODebugBeginWireframe(NO);
 	
 	OO_ENTER_OPENGL();
-	OOGL(glEnable(GL_BLEND));
+	OOGLSetBlending(true);
 	OOGLBEGIN(GL_LINES);
 	glColor4f(0.4f, 0.4f, 0.4f, 0.5f);
 	
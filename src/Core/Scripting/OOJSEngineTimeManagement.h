@@ -63,6 +63,64 @@ void OOJSStopTimeLimiter(void);
 #define kOOJSLongTimeLimit (5.0)
 
 
+/*	Script cost accounting
+	
+	Time spent in event handlers, timers and frame callbacks is charged to the
+	script responsible, by name, so that all instances of a ship script share
+	one account. Nested calls into other scripts are charged to the inner
+	script only. Rates are measured in milliseconds of CPU time per second of
+	real time, smoothed over a one-second window updated by
+	OOJSUpdateScriptCostAccounting(), which should be called once per frame.
+	
+	If a CPU budget is set (user default script-cpu-budget, in milliseconds per
+	second, or console.scriptCPUBudget; zero disables throttling), scripts
+	exceeding it are throttled until they drop back under three quarters of
+	the budget:
+	* Frame callbacks run every other frame, with the combined time delta.
+	* Repeating timers with intervals under one second skip every other firing.
+	* High-frequency combat notifications (shipTakingDamage, shipBeingAttacked
+	  and friends) are delivered at most four times a second per script.
+	Entering and leaving the throttled state is logged.
+	
+	OOJSBeginScriptCostAccounting() and OOJSEndScriptCostAccounting() must be
+	balanced. Passing a NULL account is valid; the time is then charged to
+	nobody, but is still excluded from any enclosing account.
+*/
+typedef struct OOJSScriptCostAccount OOJSScriptCostAccount;
+
+typedef enum
+{
+	kOOJSCostHandler,
+	kOOJSCostTimer,
+	kOOJSCostFrameCallback,
+	
+	kOOJSCostCategoryCount
+} OOJSCostCategory;
+
+OOJSScriptCostAccount *OOJSScriptCostAccountForName(NSString *scriptName);	// Returns NULL for nil.
+
+void OOJSBeginScriptCostAccounting(OOJSScriptCostAccount *account, OOJSCostCategory category);
+void OOJSEndScriptCostAccounting(void);
+
+void OOJSUpdateScriptCostAccounting(void);
+
+BOOL OOJSScriptCostAccountIsThrottled(OOJSScriptCostAccount *account);
+void OOJSNoteScriptCostAccountThrottledCall(OOJSScriptCostAccount *account);
+
+// Returns NO if event should be dropped because account is throttled.
+BOOL OOJSScriptCostAccountShouldDeliverEvent(OOJSScriptCostAccount *account, jsid event);
+
+double OOJSGetScriptCPUBudget(void);
+void OOJSSetScriptCPUBudget(double msPerSecond);
+
+/*	Array of dictionaries, most expensive script first. Keys: name,
+	handlerTime, timerTime, frameCallbackTime, totalTime (in ms/s), callCount,
+	throttled, throttledCallCount.
+*/
+NSArray *OOJSScriptCostReport(void);
+void OOJSLogScriptCostReport(void);
+
+
 #if OOJS_PROFILE
 #import "OOProfilingStopwatch.h"
 
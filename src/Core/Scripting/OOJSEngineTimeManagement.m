@@ -253,6 +253,303 @@ void OOJSTimeManagementInit(OOJavaScriptEngine *engine, JSRuntime *runtime)
 }
 
 
+// MARK: Script cost accounting
+
+enum
+{
+	kMaxCostStackDepth			= 64,
+	kThrottledEventCount		= 4
+};
+
+#define kCostWindowLength			(1.0)	// seconds
+#define kThrottledEventInterval		(0.25)	// seconds
+#define kThrottleReleaseFactor		(0.75)
+
+
+struct OOJSScriptCostAccount
+{
+	NSString					*name;
+	
+	OOTimeDelta					windowTime[kOOJSCostCategoryCount];
+	double						msPerSecond[kOOJSCostCategoryCount];
+	unsigned long				callCount;
+	unsigned long				throttledCallCount;
+	
+	BOOL						hasSample;
+	BOOL						throttled;
+	
+	OOTimeAbsolute				lastEventDelivery[kThrottledEventCount];
+};
+
+
+typedef struct
+{
+	OOJSScriptCostAccount		*account;
+	OOJSCostCategory			category;
+	OOHighResTimeValue			start;
+	OOTimeDelta					childTime;
+} CostStackFrame;
+
+
+static NSMutableDictionary		*sCostAccounts;
+static CostStackFrame			sCostStack[kMaxCostStackDepth];
+static unsigned					sCostStackDepth;
+static OOHighResTimeValue		sCostLastUpdate;
+static OOTimeAbsolute			sCostClock;			// Real time, advanced once per frame.
+static OOTimeAbsolute			sCostWindowStart;
+static BOOL						sCostClockStarted;
+static double					sScriptCPUBudget = -1.0;	// Negative: not yet read from defaults.
+
+static const char * const		sThrottledEventNames[kThrottledEventCount] =
+{
+	"shipTakingDamage",
+	"shipBeingAttacked",
+	"shipBeingAttackedByCloaked",
+	"shipAttackedOther"
+};
+static jsid						sThrottledEvents[kThrottledEventCount];
+static BOOL						sThrottledEventsInited;
+
+
+OOJSScriptCostAccount *OOJSScriptCostAccountForName(NSString *scriptName)
+{
+	if (scriptName == nil)  return NULL;
+	
+	if (sCostAccounts == nil)  sCostAccounts = [[NSMutableDictionary alloc] init];
+	
+	OOJSScriptCostAccount *account = [[sCostAccounts objectForKey:scriptName] pointerValue];
+	if (account == NULL)
+	{
+		// Accounts are never freed; there is one per script name.
+		account = calloc(1, sizeof *account);
+		if (EXPECT_NOT(account == NULL))  return NULL;
+		
+		account->name = [scriptName copy];
+		[sCostAccounts setObject:[NSValue valueWithPointer:account] forKey:account->name];
+	}
+	
+	return account;
+}
+
+
+void OOJSBeginScriptCostAccounting(OOJSScriptCostAccount *account, OOJSCostCategory category)
+{
+	if (EXPECT(sCostStackDepth < kMaxCostStackDepth))
+	{
+		CostStackFrame *frame = &sCostStack[sCostStackDepth];
+		frame->account = account;
+		frame->category = category;
+		frame->childTime = 0.0;
+		frame->start = OOGetHighResTime();
+	}
+	sCostStackDepth++;
+}
+
+
+void OOJSEndScriptCostAccounting(void)
+{
+	if (EXPECT_NOT(sCostStackDepth == 0))
+	{
+		OOLog(@"bug.javaScript.costAccountingDepth", @"Attempt to end script cost accounting while it is already fully stopped. This is an internal bug, please report it.");
+		return;
+	}
+	
+	sCostStackDepth--;
+	if (EXPECT_NOT(sCostStackDepth >= kMaxCostStackDepth))  return;
+	
+	CostStackFrame *frame = &sCostStack[sCostStackDepth];
+	OOHighResTimeValue now = OOGetHighResTime();
+	OOTimeDelta elapsed = OOHighResTimeDeltaInSeconds(frame->start, now);
+	OODisposeHighResTime(frame->start);
+	OODisposeHighResTime(now);
+	
+	if (frame->account != NULL)
+	{
+		frame->account->windowTime[frame->category] += fmax(elapsed - frame->childTime, 0.0);
+		frame->account->callCount++;
+	}
+	if (sCostStackDepth != 0)
+	{
+		sCostStack[sCostStackDepth - 1].childTime += elapsed;
+	}
+}
+
+
+double OOJSGetScriptCPUBudget(void)
+{
+	if (sScriptCPUBudget < 0.0)
+	{
+		OOJSSetScriptCPUBudget([[NSUserDefaults standardUserDefaults] oo_doubleForKey:@"script-cpu-budget" defaultValue:0.0]);
+	}
+	return sScriptCPUBudget;
+}
+
+
+void OOJSSetScriptCPUBudget(double msPerSecond)
+{
+	sScriptCPUBudget = fmax(msPerSecond, 0.0);
+}
+
+
+static double TotalMSPerSecond(OOJSScriptCostAccount *account)
+{
+	double total = 0.0;
+	unsigned i;
+	for (i = 0; i < kOOJSCostCategoryCount; i++)  total += account->msPerSecond[i];
+	return total;
+}
+
+
+void OOJSUpdateScriptCostAccounting(void)
+{
+	OOHighResTimeValue now = OOGetHighResTime();
+	
+	if (EXPECT_NOT(!sCostClockStarted))
+	{
+		sCostLastUpdate = now;
+		sCostClockStarted = YES;
+		return;
+	}
+	
+	OOTimeDelta delta = OOHighResTimeDeltaInSeconds(sCostLastUpdate, now);
+	OODisposeHighResTime(sCostLastUpdate);
+	sCostLastUpdate = now;
+	sCostClock += delta;
+	
+	OOTimeDelta elapsed = sCostClock - sCostWindowStart;
+	if (elapsed < kCostWindowLength)  return;
+	sCostWindowStart = sCostClock;
+	
+	double budget = OOJSGetScriptCPUBudget();
+	NSEnumerator *accountEnum = nil;
+	NSValue *accountValue = nil;
+	
+	for (accountEnum = [sCostAccounts objectEnumerator]; (accountValue = [accountEnum nextObject]); )
+	{
+		OOJSScriptCostAccount *account = [accountValue pointerValue];
+		unsigned i;
+		
+		for (i = 0; i < kOOJSCostCategoryCount; i++)
+		{
+			double rate = account->windowTime[i] * 1000.0 / elapsed;
+			if (account->hasSample)  account->msPerSecond[i] = 0.5 * (account->msPerSecond[i] + rate);
+			else  account->msPerSecond[i] = rate;
+			account->windowTime[i] = 0.0;
+		}
+		account->hasSample = YES;
+		
+		double total = TotalMSPerSecond(account);
+		if (!account->throttled && budget > 0.0 && total > budget)
+		{
+			account->throttled = YES;
+			OOLogWARN(@"script.javaScript.budget.throttled", @"Script \"%@\" is using %.1f ms of CPU time per second, exceeding the budget of %g ms per second. Its frame callbacks, fast timers and combat notifications will be throttled.", account->name, total, budget);
+		}
+		else if (account->throttled && (budget <= 0.0 || total < budget * kThrottleReleaseFactor))
+		{
+			account->throttled = NO;
+			OOLog(@"script.javaScript.budget.released", @"Script \"%@\" is back within its CPU budget (%.1f ms per second); throttling released.", account->name, total);
+		}
+	}
+}
+
+
+BOOL OOJSScriptCostAccountIsThrottled(OOJSScriptCostAccount *account)
+{
+	return account != NULL && account->throttled;
+}
+
+
+void OOJSNoteScriptCostAccountThrottledCall(OOJSScriptCostAccount *account)
+{
+	if (account != NULL)  account->throttledCallCount++;
+}
+
+
+BOOL OOJSScriptCostAccountShouldDeliverEvent(OOJSScriptCostAccount *account, jsid event)
+{
+	if (EXPECT(!OOJSScriptCostAccountIsThrottled(account)))  return YES;
+	
+	unsigned i;
+	if (EXPECT_NOT(!sThrottledEventsInited))
+	{
+		for (i = 0; i < kThrottledEventCount; i++)
+		{
+			sThrottledEvents[i] = OOJSIDFromString([NSString stringWithUTF8String:sThrottledEventNames[i]]);
+		}
+		sThrottledEventsInited = YES;
+	}
+	
+	for (i = 0; i < kThrottledEventCount; i++)
+	{
+		if (JSID_BITS(event) == JSID_BITS(sThrottledEvents[i]))
+		{
+			if (sCostClock - account->lastEventDelivery[i] < kThrottledEventInterval)
+			{
+				account->throttledCallCount++;
+				return NO;
+			}
+			account->lastEventDelivery[i] = sCostClock;
+			break;
+		}
+	}
+	
+	return YES;
+}
+
+
+NSArray *OOJSScriptCostReport(void)
+{
+	NSMutableArray *result = [NSMutableArray arrayWithCapacity:[sCostAccounts count]];
+	NSEnumerator *accountEnum = nil;
+	NSValue *accountValue = nil;
+	
+	for (accountEnum = [sCostAccounts objectEnumerator]; (accountValue = [accountEnum nextObject]); )
+	{
+		OOJSScriptCostAccount *account = [accountValue pointerValue];
+		if (account->callCount == 0)  continue;
+		
+		[result addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+						   account->name, @"name",
+						   [NSNumber numberWithDouble:account->msPerSecond[kOOJSCostHandler]], @"handlerTime",
+						   [NSNumber numberWithDouble:account->msPerSecond[kOOJSCostTimer]], @"timerTime",
+						   [NSNumber numberWithDouble:account->msPerSecond[kOOJSCostFrameCallback]], @"frameCallbackTime",
+						   [NSNumber numberWithDouble:TotalMSPerSecond(account)], @"totalTime",
+						   [NSNumber numberWithUnsignedLong:account->callCount], @"callCount",
+						   [NSNumber numberWithBool:account->throttled], @"throttled",
+						   [NSNumber numberWithUnsignedLong:account->throttledCallCount], @"throttledCallCount",
+						   nil]];
+	}
+	
+	NSSortDescriptor *byTotal = [[[NSSortDescriptor alloc] initWithKey:@"totalTime" ascending:NO] autorelease];
+	[result sortUsingDescriptors:[NSArray arrayWithObject:byTotal]];
+	
+	return result;
+}
+
+
+void OOJSLogScriptCostReport(void)
+{
+	NSArray *report = OOJSScriptCostReport();
+	NSEnumerator *entryEnum = nil;
+	NSDictionary *entry = nil;
+	
+	OOLog(@"script.javaScript.budget.report", @"Script CPU usage (ms per second; budget %g, 0 = unlimited):", OOJSGetScriptCPUBudget());
+	OOLogIndent();
+	for (entryEnum = [report objectEnumerator]; (entry = [entryEnum nextObject]); )
+	{
+		OOLog(@"script.javaScript.budget.report", @"%@: %.2f (handlers %.2f, timers %.2f, frame callbacks %.2f), %lu calls%@",
+			  [entry objectForKey:@"name"],
+			  [entry oo_doubleForKey:@"totalTime"],
+			  [entry oo_doubleForKey:@"handlerTime"],
+			  [entry oo_doubleForKey:@"timerTime"],
+			  [entry oo_doubleForKey:@"frameCallbackTime"],
+			  [entry oo_unsignedLongForKey:@"callCount"],
+			  [entry oo_boolForKey:@"throttled"] ? [NSString stringWithFormat:@", THROTTLED (%lu calls dropped)", [entry oo_unsignedLongForKey:@"throttledCallCount"]] : @"");
+	}
+	OOLogOutdent();
+}
+
+
 #if OOJS_PROFILE
 	
 #ifndef MOZ_TRACE_JSCALLS
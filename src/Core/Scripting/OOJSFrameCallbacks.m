@@ -27,6 +27,7 @@ SOFTWARE.
 
 #import "OOJSFrameCallbacks.h"
 #import "OOJSEngineTimeManagement.h"
+#import "OOJSScript.h"
 #import "OOCollectionExtractors.h"
 
 
@@ -79,8 +80,10 @@ enum
 typedef struct
 {
 	jsval					callback;
+	OOJSScriptCostAccount	*account;		// Cost account of the script which added the callback.
+	OOTimeDelta				pendingDelta;	// Time skipped while throttled, passed on at next call.
 	uint32					trackingID;
-	uint32					_padding;
+	uint32					skipped;
 } CallbackEntry;
 
 
@@ -100,7 +103,7 @@ static JSBool GlobalIsValidFrameCallback(JSContext *context, uintN argc, jsval *
 
 
 // Internals
-static BOOL AddCallback(JSContext *context, jsval callback, uint32 trackingID, NSString **errorString);
+static BOOL AddCallback(JSContext *context, jsval callback, uint32 trackingID, OOJSScriptCostAccount *account, NSString **errorString);
 static BOOL GrowCallbackList(JSContext *context, NSString **errorString);
 
 static BOOL GetIndexForTrackingID(uint32 trackingID, NSUInteger *outIndex);
@@ -108,7 +111,7 @@ static BOOL GetIndexForTrackingID(uint32 trackingID, NSUInteger *outIndex);
 static BOOL RemoveCallbackWithTrackingID(JSContext *context, uint32 trackingID);
 static void RemoveCallbackAtIndex(JSContext *context, NSUInteger index);
 
-static void QueueDeferredOperation(NSString *opType, uint32 trackingID, OOJSValue *value);
+static void QueueDeferredOperation(NSString *opType, uint32 trackingID, OOJSScriptCostAccount *account, OOJSValue *value);
 static void RunDeferredOperations(JSContext *context);
 
 
@@ -137,7 +140,9 @@ void OOJSFrameCallbacksInvoke(OOTimeDelta inDeltaT)
 	{
 		const OOTimeDelta	delta = inDeltaT * [UNIVERSE timeAccelerationFactor];
 		JSContext			*context = OOJSAcquireContext();
-		jsval				deltaVal, result;
+		jsval				deltaVal, coalescedDeltaVal, result;
+		jsval				*argv = NULL;
+		CallbackEntry		*entry = NULL;
 		NSUInteger			i;
 		
 		if (EXPECT(JS_NewNumberValue(context, delta, &deltaVal)))
@@ -153,8 +158,33 @@ void OOJSFrameCallbacksInvoke(OOTimeDelta inDeltaT)
 			
 			for (i = 0; i < sCount; i++)
 			{
+				entry = &sCallbacks[i];
+				argv = &deltaVal;
+				
+				/*	Callbacks belonging to a script which is over its CPU budget
+					run every other frame, and are passed the combined delta.
+				*/
+				if (EXPECT_NOT(OOJSScriptCostAccountIsThrottled(entry->account)))
+				{
+					if (!entry->skipped)
+					{
+						entry->skipped = YES;
+						entry->pendingDelta += delta;
+						OOJSNoteScriptCostAccountThrottledCall(entry->account);
+						continue;
+					}
+					entry->skipped = NO;
+				}
+				if (EXPECT_NOT(entry->pendingDelta != 0.0))
+				{
+					if (JS_NewNumberValue(context, delta + entry->pendingDelta, &coalescedDeltaVal))  argv = &coalescedDeltaVal;
+					entry->pendingDelta = 0.0;
+				}
+				
 				// TODO: remove out of scope callbacks - post MNSR!
-				JS_CallFunctionValue(context, NULL, sCallbacks[i].callback, 1, &deltaVal, &result);
+				OOJSBeginScriptCostAccounting(entry->account, kOOJSCostFrameCallback);
+				JS_CallFunctionValue(context, NULL, entry->callback, 1, argv, &result);
+				OOJSEndScriptCostAccounting();
 				JS_ReportPendingException(context);
 			}
 			
@@ -204,11 +234,13 @@ static JSBool GlobalAddFrameCallback(JSContext *context, uintN argc, jsval *vp)
 	uint32 trackingID = sNextID ^ kIDScrambleMask;
 	sNextID += kIDIncrement;
 	
+	OOJSScriptCostAccount *account = OOJSScriptCostAccountForName([[OOJSScript currentlyRunningScript] name]);
+	
 	if (EXPECT(!sRunning))
 	{
 		// Add to list immediately.
 		NSString *errorString = nil;
-		if (EXPECT_NOT(!AddCallback(context, callback, trackingID, &errorString)))
+		if (EXPECT_NOT(!AddCallback(context, callback, trackingID, account, &errorString)))
 		{
 			OOJSReportError(context, @"%@", errorString);
 			return NO;
@@ -218,7 +250,7 @@ static JSBool GlobalAddFrameCallback(JSContext *context, uintN argc, jsval *vp)
 	{
 		// Defer mutations during callback invocation.
 		FCBLog(@"script.frameCallback.debug.add.deferred", @"Deferring addition of frame callback with tracking ID %u.", trackingID);
-		QueueDeferredOperation(@"add", trackingID, [OOJSValue valueWithJSValue:callback inContext:context]);
+		QueueDeferredOperation(@"add", trackingID, account, [OOJSValue valueWithJSValue:callback inContext:context]);
 	}
 	
 	OOJS_RETURN_INT(trackingID);
@@ -252,7 +284,7 @@ static JSBool GlobalRemoveFrameCallback(JSContext *context, uintN argc, jsval *v
 	{
 		// Defer mutations during callback invocation.
 		FCBLog(@"script.frameCallback.debug.remove.deferred", @"Deferring removal of frame callback with tracking ID %u.", trackingID);
-		QueueDeferredOperation(@"remove", trackingID, nil);
+		QueueDeferredOperation(@"remove", trackingID, NULL, nil);
 	}
 	
 	OOJS_RETURN_VOID;
@@ -288,7 +320,7 @@ static JSBool GlobalIsValidFrameCallback(JSContext *context, uintN argc, jsval *
 
 // MARK: Internals
 
-static BOOL AddCallback(JSContext *context, jsval callback, uint32 trackingID, NSString **errorString)
+static BOOL AddCallback(JSContext *context, jsval callback, uint32 trackingID, OOJSScriptCostAccount *account, NSString **errorString)
 {
 	NSCParameterAssert(context != NULL && JS_IsInRequest(context));
 	NSCParameterAssert(errorString != NULL);
@@ -316,6 +348,9 @@ static BOOL AddCallback(JSContext *context, jsval callback, uint32 trackingID, N
 	}
 	
 	sCallbacks[sCount].trackingID = trackingID;
+	sCallbacks[sCount].account = account;
+	sCallbacks[sCount].pendingDelta = 0.0;
+	sCallbacks[sCount].skipped = NO;
 	sCount++;
 	
 	return YES;
@@ -435,7 +470,7 @@ static void RemoveCallbackAtIndex(JSContext *context, NSUInteger index)
 }
 
 
-static void QueueDeferredOperation(NSString *opType, uint32 trackingID, OOJSValue *value)
+static void QueueDeferredOperation(NSString *opType, uint32 trackingID, OOJSScriptCostAccount *account, OOJSValue *value)
 {
 	NSCAssert1(sRunning, @"%s can only be called while frame callbacks are running.", __PRETTY_FUNCTION__);
 	
@@ -443,6 +478,7 @@ static void QueueDeferredOperation(NSString *opType, uint32 trackingID, OOJSValu
 	[sDeferredOps addObject:[NSDictionary dictionaryWithObjectsAndKeys:
 							 opType, @"operation",
 							 [NSNumber numberWithInt:trackingID], @"trackingID",
+							 [NSValue valueWithPointer:account], @"account",
 							 value, @"value",
 							 nil]];
 }
@@ -466,7 +502,9 @@ static void RunDeferredOperations(JSContext *context)
 			OOJSValue	*callbackObj = [operation objectForKey:@"value"];
 			NSString	*errorString = nil;
 			
-			if (!AddCallback(context, OOJSValueFromNativeObject(context, callbackObj), trackingID, &errorString))
+			OOJSScriptCostAccount *account = [[operation objectForKey:@"account"] pointerValue];
+			
+			if (!AddCallback(context, OOJSValueFromNativeObject(context, callbackObj), trackingID, account, &errorString))
 			{
 				OOLogWARN(@"script.frameCallback.deferredAdd.failed", @"Deferred frame callback insertion failed: %@", errorString);
 			}
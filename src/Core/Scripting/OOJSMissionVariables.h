@@ -30,3 +30,17 @@ MA 02110-1301, USA.
 
 
 void InitOOJSMissionVariables(JSContext *context, JSObject *global);
+
+/*	Empty the cache of mission variable keys by property name. Must be
+	called after each garbage collection, since the cache is keyed by
+	string addresses that may then be reused.
+*/
+void OOJSMissionVariablesForgetPropertyKeys(void);
+
+
+/*	String form of a numeric mission variable, formatted the way JavaScript
+	would format it. Numbers written from JavaScript are stored as NSNumbers
+	and only converted with this when a string is required (legacy scripts,
+	string expansion, saved games).
+*/
+NSString *OOJSMissionVariableStringFromNumber(double value);
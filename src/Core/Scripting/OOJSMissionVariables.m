@@ -32,13 +32,57 @@ MA 02110-1301, USA.
 #import "OOJSPlayer.h"
 
 
+/*	Map from property name atoms to mission variable keys ("foo" ->
+	"mission_foo"), so the key doesn't have to be rebuilt on every access.
+	Names which aren't valid mission variables map to an empty string.
+	
+	The atoms aren't pinned, so the garbage collector may free them and
+	reuse their addresses for other names. The cache is therefore emptied
+	after every collection; see OOJSMissionVariablesForgetPropertyKeys().
+*/
+static NSMapTable *sKeyCache;
+
+
 static NSString *KeyForPropertyID(JSContext *context, jsid propID)
 {
 	NSCParameterAssert(JSID_IS_STRING(propID));
 	
-	NSString *key = OOStringFromJSString(context, JSID_TO_STRING(propID));
-	if ([key hasPrefix:@"_"])  return nil;
-	return [@"mission_" stringByAppendingString:key];
+	JSString *jsKey = JSID_TO_STRING(propID);
+	NSString *key = NSMapGet(sKeyCache, jsKey);
+	
+	if (EXPECT_NOT(key == nil))
+	{
+		key = OOStringFromJSString(context, jsKey);
+		if ([key hasPrefix:@"_"])  key = @"";
+		else  key = [@"mission_" stringByAppendingString:key];
+		
+		NSMapInsert(sKeyCache, jsKey, key);
+	}
+	
+	if ([key length] == 0)  return nil;
+	return key;
+}
+
+
+void OOJSMissionVariablesForgetPropertyKeys(void)
+{
+	if (sKeyCache != NULL)  NSResetMapTable(sKeyCache);
+}
+
+
+NSString *OOJSMissionVariableStringFromNumber(double value)
+{
+	NSString *result = nil;
+	jsval jsValue;
+	
+	JSContext *context = OOJSAcquireContext();
+	if (JS_NewNumberValue(context, value, &jsValue))
+	{
+		result = OOStringFromJSValue(context, jsValue);
+	}
+	OOJSRelinquishContext(context);
+	
+	return result;
 }
 
 
@@ -72,6 +116,11 @@ void InitOOJSMissionVariables(JSContext *context, JSObject *global)
 {
 	JS_DefineObject(context, global, "missionVariables", &sMissionVariablesClass, NULL, OOJS_PROP_READONLY);
 	
+	if (sKeyCache == NULL)
+	{
+		sKeyCache = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks, NSObjectMapValueCallBacks, 64);
+	}
+	
 #ifndef NDEBUG
 	// Allow callObjC() on missionVariables to call methods on the mission variables dictionary.
 	OOJSRegisterObjectConverter(&sMissionVariablesClass, MissionVariablesConverter);
@@ -115,14 +164,26 @@ static JSBool MissionVariablesGetProperty(JSContext *context, JSObject *this, js
 		NSString *key = KeyForPropertyID(context, propID);
 		if (key == nil)  return YES;
 		
-		id mvar = [player missionVariableForKey:key];
+		id mvar = [player missionVariableValueForKey:key];
+		
+		if ([mvar isKindOfClass:[NSNumber class]])
+		{
+			return JS_NewNumberValue(context, [mvar doubleValue], value);
+		}
 		
-		if ([mvar isKindOfClass:[NSString class]])	// Currently there should only be strings, but we may want to change this.
+		if ([mvar isKindOfClass:[NSString class]] && OOIsNumberLiteral(mvar, YES))
 		{
-			if (OOIsNumberLiteral(mvar, YES))
+			/*	Strings come from legacy scripts and saved games. If the
+				number formats back to exactly the same string, store it
+				typed so it doesn't have to be parsed again; otherwise the
+				string form must be preserved (e.g. "007").
+			*/
+			double number = [mvar doubleValue];
+			if ([OOJSMissionVariableStringFromNumber(number) isEqualToString:mvar])
 			{
-				return JS_NewNumberValue(context, [mvar doubleValue], value);
+				[player setMissionVariableValue:[NSNumber numberWithDouble:number] forKey:key];
 			}
+			return JS_NewNumberValue(context, number, value);
 		}
 		
 		*value = OOJSValueFromNativeObject(context, mvar);
@@ -148,6 +209,27 @@ static JSBool MissionVariablesSetProperty(JSContext *context, JSObject *this, js
 			return NO;
 		}
 		
+		if (JSVAL_IS_NUMBER(*value))
+		{
+			jsdouble number;
+			if (JS_ValueToNumber(context, *value, &number) && isfinite(number))
+			{
+				// -0 would previously have been stored as "0".
+				if (number == 0.0)  number = 0.0;
+				[player setMissionVariableValue:[NSNumber numberWithDouble:number] forKey:key];
+				return YES;
+			}
+		}
+		else if (JSVAL_IS_BOOLEAN(*value))
+		{
+			/*	Booleans have always been read back as the strings "true" and
+				"false", and scripts rely on that, so they're stored as
+				constant strings rather than converted on each write.
+			*/
+			[player setMissionVariableValue:JSVAL_TO_BOOLEAN(*value) ? @"true" : @"false" forKey:key];
+			return YES;
+		}
+		
 		NSString *objValue = OOStringFromJSValue(context, *value);
 		
 		if ([objValue isKindOfClass:[NSNull class]])  objValue = nil;
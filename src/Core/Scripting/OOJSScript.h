@@ -38,6 +38,8 @@ MA 02110-1301, USA.
 	NSString			*filePath;
 	
 	OOWeakReference		*weakSelf;
+	
+	struct OOJSScriptCostAccount *_costAccount;
 }
 
 + (id) scriptWithPath:(NSString *)path properties:(NSDictionary *)properties;
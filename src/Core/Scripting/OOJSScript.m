@@ -375,6 +375,9 @@ static JSFunctionSpec sScriptMethods[] =
 	NSParameterAssert(name != NULL && (argv != NULL || argc == 0) && context != NULL && JS_IsInRequest(context));
 	if (_jsSelf == NULL)  return NO;
 	
+	if (EXPECT_NOT(_costAccount == NULL))  _costAccount = OOJSScriptCostAccountForName([self name]);
+	if (EXPECT_NOT(!OOJSScriptCostAccountShouldDeliverEvent(_costAccount, methodID)))  return NO;
+	
 	JSObject				*root = NULL;
 	BOOL					OK = NO;
 	jsval					method;
@@ -406,7 +409,9 @@ static JSFunctionSpec sScriptMethods[] =
 		
 		// Call the method.
 		OOJSStartTimeLimiter();
+		OOJSBeginScriptCostAccounting(_costAccount, kOOJSCostHandler);
 		OK = JS_CallFunctionValue(context, _jsSelf, method, argc, argv, outResult);
+		OOJSEndScriptCostAccounting();
 		OOJSStopTimeLimiter();
 		
 		if (JS_IsExceptionPending(context))
@@ -39,6 +39,9 @@ MA 02110-1301, USA.
 	OOJSScript			*_owningScript;
 	
 	JSObject			*_jsSelf;	// The JS Timer object proxy for this OOJSTimer.
+	
+	struct OOJSScriptCostAccount *_costAccount;
+	BOOL				_skippedLastFire;
 }
 
 @end
@@ -25,6 +25,7 @@ MA 02110-1301, USA.
 
 #import "OOJSTimer.h"
 #import "OOJavaScriptEngine.h"
+#import "OOJSEngineTimeManagement.h"
 #import "Universe.h"
 
 
@@ -78,6 +79,7 @@ static JSClass sTimerClass;
 		}
 		
 		_owningScript = [[OOJSScript currentlyRunningScript] weakRetain];
+		_costAccount = OOJSScriptCostAccountForName([[OOJSScript currentlyRunningScript] name]);
 		
 		[[NSNotificationCenter defaultCenter] addObserver:self
 												 selector:@selector(deleteJSPointers)
@@ -149,6 +151,12 @@ static JSClass sTimerClass;
 }
 
 
+- (NSString *) ownerDescription
+{
+	return [[_owningScript weakRefUnderlyingObject] name];
+}
+
+
 - (void) timerFired
 {
 	jsval					rval = JSVAL_VOID;
@@ -172,12 +180,27 @@ static JSClass sTimerClass;
 		return;
 	}
 	
+	/*	If the owning script is over its CPU budget, fast repeating timers
+		only fire every other time.
+	*/
+	OOTimeDelta interval = [self interval];
+	if (EXPECT_NOT(OOJSScriptCostAccountIsThrottled(_costAccount)) && 0.0 < interval && interval < 1.0 && !_skippedLastFire)
+	{
+		_skippedLastFire = YES;
+		OOJSNoteScriptCostAccountThrottledCall(_costAccount);
+		OOJSRelinquishContext(context);
+		return;
+	}
+	_skippedLastFire = NO;
+	
 	[OOJSScript pushScript:_owningScript];
+	OOJSBeginScriptCostAccounting(_costAccount, kOOJSCostTimer);
 	[engine callJSFunction:_function
 				 forObject:_jsThis
 					  argc:0
 					  argv:NULL
 					result:&rval];
+	OOJSEndScriptCostAccounting();
 	[OOJSScript popScript:_owningScript];
 	
 	OOJSRelinquishContext(context);
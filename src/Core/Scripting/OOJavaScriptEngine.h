@@ -84,6 +84,28 @@ MA 02110-1301, USA.
 
 - (void) garbageCollectionOpportunity;
 
+/*	Garbage collection scheduling.
+	
+	SpiderMonkey collects whenever its heap reaches a trigger size, which is
+	frequently in the middle of combat. To smooth this out, the engine is told
+	once per frame how busy the game is:
+	* At safe moments (docked GUI screens, hyperspace countdown and transition,
+	  intro screens or paused), a full collection is forced if the heap has
+	  grown appreciably since the last one.
+	* In flight under red alert, collections requested by SpiderMonkey are
+	  deferred for up to ten seconds, unless the heap is close to its limit.
+	* Otherwise, SpiderMonkey's own heuristics apply.
+	
+	Allocation rate and pause times are tracked; -garbageCollectionStatistics
+	returns them (keys: collectionCount, forcedCount, deferredCount,
+	lastPause, maxPause, totalPause (seconds), heapBytes,
+	heapBytesAfterLastCollection, allocationRate (bytes/second)). Each pause
+	is also logged under script.javaScript.gc.pause.
+*/
+- (void) updateGarbageCollectionScheduleForPausedGame:(BOOL)paused;
+- (void) forceGarbageCollection;	// Full collection, never deferred.
+- (NSDictionary *) garbageCollectionStatistics;
+
 - (BOOL) showErrorLocations;
 - (void) setShowErrorLocations:(BOOL)value;
 
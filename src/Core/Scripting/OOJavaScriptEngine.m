@@ -88,6 +88,39 @@ MA 02110-1301, USA.
 static OOJavaScriptEngine	*sSharedEngine = nil;
 static unsigned				sErrorHandlerStackSkip = 0;
 
+
+typedef enum
+{
+	kGCLoadNormal,		// Let SpiderMonkey collect when it wants to.
+	kGCLoadIdle,		// Safe moment; collect proactively.
+	kGCLoadCombat		// Defer non-urgent collections.
+} GCLoad;
+
+#define kIdleCollectionMinGrowth	(256 * 1024)	// bytes
+#define kIdleCollectionMinInterval	(2.0)			// seconds
+#define kMaxCollectionDeferral		(10.0)			// seconds
+#define kUrgentHeapFraction			(0.75)
+
+static GCLoad				sGCLoad = kGCLoadNormal;
+static BOOL					sForcingGC;
+static BOOL					sTimingGC;
+static OOHighResTimeValue	sGCStart;
+static NSTimeInterval		sDeferralStart;			// Zero if no collection is being deferred.
+static NSTimeInterval		sLastCollectionTime;
+static uint32				sBytesAfterLastGC;
+static uint32				sLastSampleBytes;
+static NSTimeInterval		sLastSampleTime;
+static double				sAllocatedSinceSample;
+static double				sAllocationRate;
+static unsigned long		sCollectionCount;
+static unsigned long		sForcedCount;
+static unsigned long		sDeferredCount;
+static OOTimeDelta			sLastPause;
+static OOTimeDelta			sMaxPause;
+static OOTimeDelta			sTotalPause;
+
+static GCLoad CurrentGCLoad(BOOL paused);
+
 JSContext					*gOOJSMainThreadContext = NULL;
 
 
@@ -134,6 +167,8 @@ static id JSBooleanConverter(JSContext *context, JSObject *object);
 static void UnregisterObjectConverters(void);
 static void UnregisterSubclasses(void);
 
+static JSBool GCCallback(JSContext *context, JSGCStatus status);
+
 
 static void ReportJSError(JSContext *context, const char *message, JSErrorReport *report)
 {
@@ -284,6 +319,7 @@ static void ReportJSError(JSContext *context, const char *message, JSErrorReport
 	
 	// OOJSTimeManagementInit() must be called before any context is created!
 	OOJSTimeManagementInit(self, _runtime);
+	JS_SetGCCallbackRT(_runtime, GCCallback);
 	
 	[self createMainThreadContext];
 	
@@ -518,15 +554,75 @@ static void ReportJSError(JSContext *context, const char *message, JSErrorReport
 - (void) garbageCollectionOpportunity
 {
 	JSContext *context = OOJSAcquireContext();
+	sForcingGC = YES;
 #ifndef NDEBUG
 	JS_GC(context);
 #else
 	JS_MaybeGC(context);
 #endif
+	sForcingGC = NO;
 	OOJSRelinquishContext(context);
 }
 
 
+- (void) updateGarbageCollectionScheduleForPausedGame:(BOOL)paused
+{
+	sGCLoad = CurrentGCLoad(paused);
+	
+	NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+	uint32 bytes = JS_GetGCParameter(_runtime, JSGC_BYTES);
+	
+	// Sample allocation rate about once a second, counting bytes freed by intervening collections as allocated.
+	if (sLastSampleTime == 0.0)
+	{
+		sLastSampleTime = now;
+		sLastSampleBytes = bytes;
+	}
+	else if (now - sLastSampleTime >= 1.0)
+	{
+		double allocated = sAllocatedSinceSample + ((bytes > sLastSampleBytes) ? bytes - sLastSampleBytes : 0);
+		sAllocationRate = 0.5 * (sAllocationRate + allocated / (now - sLastSampleTime));
+		sAllocatedSinceSample = 0;
+		sLastSampleTime = now;
+		sLastSampleBytes = bytes;
+	}
+	
+	if (sGCLoad == kGCLoadIdle &&
+		bytes > sBytesAfterLastGC + kIdleCollectionMinGrowth &&
+		now - sLastCollectionTime >= kIdleCollectionMinInterval)
+	{
+		sForcedCount++;
+		[self forceGarbageCollection];
+	}
+}
+
+
+- (void) forceGarbageCollection
+{
+	JSContext *context = OOJSAcquireContext();
+	sForcingGC = YES;
+	JS_GC(context);
+	sForcingGC = NO;
+	OOJSRelinquishContext(context);
+}
+
+
+- (NSDictionary *) garbageCollectionStatistics
+{
+	return [NSDictionary dictionaryWithObjectsAndKeys:
+			[NSNumber numberWithUnsignedLong:sCollectionCount], @"collectionCount",
+			[NSNumber numberWithUnsignedLong:sForcedCount], @"forcedCount",
+			[NSNumber numberWithUnsignedLong:sDeferredCount], @"deferredCount",
+			[NSNumber numberWithDouble:sLastPause], @"lastPause",
+			[NSNumber numberWithDouble:sMaxPause], @"maxPause",
+			[NSNumber numberWithDouble:sTotalPause], @"totalPause",
+			[NSNumber numberWithUnsignedInt:JS_GetGCParameter(_runtime, JSGC_BYTES)], @"heapBytes",
+			[NSNumber numberWithUnsignedInt:sBytesAfterLastGC], @"heapBytesAfterLastCollection",
+			[NSNumber numberWithDouble:sAllocationRate], @"allocationRate",
+			nil];
+}
+
+
 - (BOOL) showErrorLocations
 {
 	return _showErrorLocations;
@@ -2491,3 +2587,80 @@ static id JSBooleanConverter(JSContext *context, JSObject *object)
 	}
 	return nil;
 }
+
+
+static GCLoad CurrentGCLoad(BOOL paused)
+{
+	if (paused)  return kGCLoadIdle;
+	
+	PlayerEntity *player = PLAYER;
+	switch ([player status])
+	{
+		case STATUS_START_GAME:
+		case STATUS_DOCKED:
+		case STATUS_ENTERING_WITCHSPACE:
+		case STATUS_EXITING_WITCHSPACE:
+			return kGCLoadIdle;
+			
+		default:
+			break;
+	}
+	
+	// Combat takes precedence over a hyperspace countdown.
+	if ([player alertCondition] == ALERT_CONDITION_RED)  return kGCLoadCombat;
+	if ([player status] == STATUS_WITCHSPACE_COUNTDOWN)  return kGCLoadIdle;
+	
+	return kGCLoadNormal;
+}
+
+
+static JSBool GCCallback(JSContext *context, JSGCStatus status)
+{
+	JSRuntime *runtime = JS_GetRuntime(context);
+	uint32 bytes = JS_GetGCParameter(runtime, JSGC_BYTES);
+	
+	if (status == JSGC_BEGIN)
+	{
+		if (sGCLoad == kGCLoadCombat && !sForcingGC &&
+			bytes < kUrgentHeapFraction * JS_GetGCParameter(runtime, JSGC_MAX_BYTES))
+		{
+			NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+			if (sDeferralStart == 0.0)
+			{
+				sDeferralStart = now;
+				sDeferredCount++;
+			}
+			/*	Note: SpiderMonkey ignores the return value when destroying the
+				last context, so we must not assume the collection won't happen.
+			*/
+			if (now - sDeferralStart < kMaxCollectionDeferral)  return JS_FALSE;
+		}
+		
+		sDeferralStart = 0.0;
+		if (bytes > sLastSampleBytes)  sAllocatedSinceSample += bytes - sLastSampleBytes;
+		sTimingGC = YES;
+		sGCStart = OOGetHighResTime();
+	}
+	else if (status == JSGC_END && sTimingGC)
+	{
+		OOHighResTimeValue end = OOGetHighResTime();
+		OOTimeDelta pause = OOHighResTimeDeltaInSeconds(sGCStart, end);
+		OODisposeHighResTime(sGCStart);
+		OODisposeHighResTime(end);
+		sTimingGC = NO;
+		
+		sCollectionCount++;
+		sLastPause = pause;
+		sMaxPause = fmax(sMaxPause, pause);
+		sTotalPause += pause;
+		sBytesAfterLastGC = bytes;
+		sLastSampleBytes = bytes;
+		sLastCollectionTime = [NSDate timeIntervalSinceReferenceDate];
+		
+		OOLog(@"script.javaScript.gc.pause", @"JavaScript garbage collection%@ took %.2f ms, heap is now %u KiB.", sForcingGC ? @" (scheduled)" : @"", pause * 1000.0, bytes / 1024);
+	}
+	
+	if (status == JSGC_END)  OOJSMissionVariablesForgetPropertyKeys();
+	
+	return JS_TRUE;
+}
@@ -39,6 +39,16 @@ of two items: a boolean indicating whether it's a method selector
 The special opType OP_FALSE doesn't require any other elements in the
 array. All other valid opTypes require the array to have five elements.
 
+Conditions produced by the sanitizer carry up to two more elements, which
+let them be tested without further parsing:
+	(..., constantRHS [, oneOfItems]).
+constantRHS is the expanded right-hand side if operandArray contains only
+literals, otherwise a false boolean. oneOfItems is present for "oneof"
+comparisons with a constant right-hand side, and is the list of
+whitespace-trimmed alternatives. Sanitized conditions are stored in the
+cache, so these are property list types; the tester resolves selectors
+itself. It must accept conditions without these elements.
+
 
 A complete example: given the following script (the Cloaking Device mission
 script from Oolite 1.65):
@@ -55,6 +55,7 @@ static OOOperationType ClassifyLHSConditionSelector(NSString *selectorString, NS
 static NSString *SanitizeQueryMethod(NSString *selectorString);							// Checks aliases and whitelist, returns nil if whitelist fails.
 static NSString *SanitizeActionMethod(NSString *selectorString, BOOL allowAIMethods);	// Checks aliases and whitelist, returns nil if whitelist fails.
 static NSArray *AlwaysFalseConditions(void);
+static NSString *ConstantRightHandSide(NSArray *rhs);
 static BOOL IsAlwaysFalseConditions(NSArray *conditions);
 
 static NSString *StringFromStack(SanStackElement *topOfStack);
@@ -310,16 +311,55 @@ static NSArray *SanitizeCondition(NSString *condition, SanStackElement *stack)
 	rawString = @"<condition>";
 #endif
 	
+	/*	Expand what can be expanded now, so that the condition doesn't need
+		to be re-examined each time it's tested. Sanitized conditions are
+		cached on disk, so everything added here must be a property list type.
+	*/
+	id constantRHS = ConstantRightHandSide(rhs);
+	NSMutableArray *oneOfItems = nil;
+	if (constantRHS != nil && comparatorValue == COMPARISON_ONEOF)
+	{
+		NSArray *components = [constantRHS componentsSeparatedByString:@","];
+		NSCharacterSet *whitespace = [NSCharacterSet whitespaceCharacterSet];
+		
+		oneOfItems = [NSMutableArray arrayWithCapacity:[components count]];
+		for (i = 0; i < [components count]; i++)
+		{
+			[oneOfItems addObject:[[components objectAtIndex:i] stringByTrimmingCharactersInSet:whitespace]];
+		}
+	}
+	if (constantRHS == nil)  constantRHS = [NSNumber numberWithBool:NO];
+	
 	return [NSArray arrayWithObjects:
 			[NSNumber numberWithUnsignedInt:opType],
 			rawString,
 			sanitizedSelectorString,
 			[NSNumber numberWithUnsignedInt:comparatorValue],
 			rhs,
+			constantRHS,
+			oneOfItems,	// May be nil, terminating the list.
 			nil];
 }
 
 
+// If a right-hand side consists only of literals, return its expansion.
+static NSString *ConstantRightHandSide(NSArray *rhs)
+{
+	NSMutableArray			*result = nil;
+	NSEnumerator			*componentEnum = nil;
+	NSArray					*component = nil;
+	
+	result = [NSMutableArray arrayWithCapacity:[rhs count]];
+	for (componentEnum = [rhs objectEnumerator]; (component = [componentEnum nextObject]); )
+	{
+		if ([[component objectAtIndex:0] boolValue])  return nil;
+		[result addObject:[component objectAtIndex:1]];
+	}
+	
+	return [result componentsJoinedByString:@" "];
+}
+
+
 static NSArray *SanitizeConditionalStatement(NSDictionary *statement, SanStackElement *stack, BOOL allowAIMethods)
 {
 	NSArray					*conditions = nil;
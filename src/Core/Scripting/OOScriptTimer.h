@@ -11,6 +11,15 @@ inited will cause the timer to fire after the specified interval. A persistent
 timer will remain if the player dies and respawns; non-persistent timers will
 be removed.
 
+Scheduled timers are kept in a hierarchical timer wheel, so scheduling and
+unscheduling are constant-time regardless of how many timers are running.
+Timers which become due in the same update are fired as one batch, in
+nextTime order. If a coalescing tolerance is set (user default
+timer-coalescing-tolerance, or console.timerCoalescingTolerance), repeating
+timers are quantized to multiples of the tolerance so that timers with
+similar intervals fire in the same batch; a timer may then fire up to one
+tolerance late, but its nominal schedule does not drift.
+
 
 Oolite
 Copyright (C) 2004-2013 Giles C Williams and contributors
@@ -43,6 +52,18 @@ MA 02110-1301, USA.
 	OOTimeDelta					_interval;
 	BOOL						_isScheduled;
 	BOOL						_hasBeenRun;	// Needed for one-shot timers.
+	BOOL						_pendingFire;	// Removed from wheel for firing in current batch.
+	
+	// Timer wheel links. Owned by the timer subsystem.
+	OOTimeAbsolute				_fireTime;		// _nextTime, possibly quantized for coalescing.
+	OOScriptTimer				*_wheelNext;
+	OOScriptTimer				*_wheelPrev;
+	OOScriptTimer				**_slotHead;
+	
+	// Cost accounting.
+	unsigned					_fireCount;
+	OOTimeDelta					_totalFireTime;
+	OOTimeDelta					_maxFireTime;
 }
 
 - (id) initWithNextTime:(OOTimeAbsolute)nextTime
@@ -67,6 +88,18 @@ MA 02110-1301, USA.
 + (void) updateTimers;
 + (void) noteGameReset;
 
++ (OOTimeDelta) coalescingTolerance;
++ (void) setCoalescingTolerance:(OOTimeDelta)tolerance;	// 0 to disable coalescing.
+
+/*	Array of dictionaries describing the cost of each scheduled timer, most
+	expensive first. Keys are timer, owner (if known), interval, fireCount,
+	totalTime, averageTime and maxTime; times are in seconds.
+*/
++ (NSArray *) timerStatistics;
+
+// Subclasses may override to name the script or object responsible for the timer.
+- (NSString *) ownerDescription;
+
 
 - (BOOL) isValidForScheduling;
 
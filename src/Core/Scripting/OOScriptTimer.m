@@ -26,14 +26,84 @@ MA 02110-1301, USA.
 #import "OOScriptTimer.h"
 #import "Universe.h"
 #import "OOLogging.h"
-#import "OOPriorityQueue.h"
+#import "OOCollectionExtractors.h"
+#import "OOProfilingStopwatch.h"
 
 
-static OOPriorityQueue	*sTimers;
+/*	Hierarchical timer wheel.
+	
+	Time is divided into ticks of 1/kTimerWheelTicksPerSecond seconds. Level 0
+	has one slot per tick for the next kLevel0Size ticks; each slot of level 1
+	covers kLevel0Size ticks, and each slot of level 2 covers a full turn of
+	level 1. Timers further out than that go in an unsorted overflow list.
+	Whenever level 0 wraps around, the next level 1 slot is redistributed
+	("cascaded") into level 0, and likewise for the higher levels.
+	
+	sWheelTick is the tick currently being processed. All slots for earlier
+	ticks are empty; the slot for sWheelTick may contain timers that are due
+	later within the tick.
+*/
+enum
+{
+	kTimerWheelTicksPerSecond	= 16,
+	
+	kLevel0Bits					= 8,
+	kLevel1Bits					= 6,
+	kLevel2Bits					= 6,
+	
+	kLevel0Size					= 1 << kLevel0Bits,
+	kLevel1Size					= 1 << kLevel1Bits,
+	kLevel2Size					= 1 << kLevel2Bits,
+	
+	kLevel0Mask					= kLevel0Size - 1,
+	kLevel1Mask					= kLevel1Size - 1,
+	kLevel2Mask					= kLevel2Size - 1,
+	
+	kLevel1Shift				= kLevel0Bits,
+	kLevel2Shift				= kLevel0Bits + kLevel1Bits,
+	kOverflowShift				= kLevel0Bits + kLevel1Bits + kLevel2Bits,
+	
+	// If time jumps further than this, rebuild the wheel instead of stepping through it.
+	kMaxWheelWalk				= kLevel0Size * 4
+};
+
+
+static OOScriptTimer	*sLevel0[kLevel0Size];
+static OOScriptTimer	*sLevel1[kLevel1Size];
+static OOScriptTimer	*sLevel2[kLevel2Size];
+static OOScriptTimer	*sOverflow;
+static int64_t			sWheelTick;
+static NSUInteger		sTimerCount;
+
+// Timers being fired in the current update. Each entry holds the reference previously owned by the wheel.
+static OOScriptTimer	**sBatch;
+static NSUInteger		sBatchCount;
+static NSUInteger		sBatchCapacity;
 
-// During an update, new timers must be deferred to avoid an infinite loop.
 static BOOL				sUpdating;
-static NSMutableArray	*sDeferredTimers;
+static OOTimeDelta		sCoalescingTolerance = -1.0;	// Negative: not yet read from defaults.
+
+
+static int64_t TickForTime(OOTimeAbsolute time);
+static void LinkTimer(OOScriptTimer *timer);
+static void UnlinkTimer(OOScriptTimer *timer);
+static OOScriptTimer *DetachSlot(OOScriptTimer **slot);
+static OOScriptTimer *DetachAllTimers(void);
+static void RelinkTimers(OOScriptTimer *list);
+static void CascadeWheel(void);
+static void RebuildWheel(int64_t tick);
+static void CollectDueTimers(OOScriptTimer **slot, OOTimeAbsolute now);
+static void FireBatch(void);
+static void ApplyToAllTimers(void (*function)(OOScriptTimer *timer, void *context), void *context);
+static int CompareTimersByNextTime(const void *a, const void *b);
+
+
+@interface OOScriptTimer (OOPrivate)
+
+- (void) updateFireTime;
+- (NSComparisonResult) compareByTotalFireTimeReverse:(OOScriptTimer *)other;
+
+@end
 
 
 @implementation OOScriptTimer
@@ -126,21 +196,25 @@ static NSMutableArray	*sDeferredTimers;
 }
 
 
+- (NSString *) ownerDescription
+{
+	return nil;
+}
+
+
 - (BOOL) scheduleTimer
 {
 	if (_isScheduled)  return YES;
 	if (![self isValidForScheduling])  return NO;
 	
-	if (EXPECT(!sUpdating))
-	{
-		if (EXPECT_NOT(sTimers == nil))  sTimers = [[OOPriorityQueue alloc] initWithComparator:@selector(compareByNextFireTime:)];
-		[sTimers addObject:self];
-	}
-	else
-	{
-		if (sDeferredTimers == nil)  sDeferredTimers = [[NSMutableArray alloc] init];
-		[sDeferredTimers addObject:self];
-	}
+	/*	Timers scheduled during an update go straight into the wheel; they
+		can't be fired until the next update because the due timers have
+		already been collected into the batch.
+	*/
+	[self updateFireTime];
+	[self retain];
+	LinkTimer(self);
+	sTimerCount++;
 	
 	_isScheduled = YES;
 	return YES;
@@ -149,9 +223,19 @@ static NSMutableArray	*sDeferredTimers;
 
 - (void) unscheduleTimer
 {
-	[sTimers removeExactObject:self];
+	BOOL inWheel = (_slotHead != NULL);
+	
+	// A timer waiting in the current batch is skipped; the batch releases it.
+	_pendingFire = NO;
 	_isScheduled = NO;
 	_hasBeenRun = NO;
+	
+	if (inWheel)
+	{
+		UnlinkTimer(self);
+		sTimerCount--;
+		[self release];
+	}
 }
 
 
@@ -163,36 +247,37 @@ static NSMutableArray	*sDeferredTimers;
 
 + (void) updateTimers
 {
-	OOScriptTimer		*timer = nil;
 	OOTimeAbsolute		now;
+	int64_t				nowTick;
 	
+	if (EXPECT_NOT(sUpdating))  return;
 	sUpdating = YES;
 	
 	now = [UNIVERSE getTime];
-	for (;;)
+	nowTick = TickForTime(now);
+	
+	if (sTimerCount == 0)
 	{
-		timer = [sTimers peekAtNextObject];
-		if (timer == nil || now < [timer nextTime])  break;
-		
-		[sTimers removeNextObject];
-		
-		// Must fire before rescheduling so that the timer callback can stop itself. -- Ahruman 2011-01-01
-		[timer timerFired];
-		
-		timer->_hasBeenRun = YES;
+		sWheelTick = nowTick;
+	}
+	else
+	{
+		if (nowTick < sWheelTick || nowTick - sWheelTick > kMaxWheelWalk)
+		{
+			RebuildWheel(nowTick);
+		}
 		
-		if (timer->_isScheduled)
+		for (;;)
 		{
-			timer->_isScheduled = NO;
-			[timer scheduleTimer];
+			CollectDueTimers(&sLevel0[sWheelTick & kLevel0Mask], now);
+			if (sWheelTick >= nowTick)  break;
+			
+			sWheelTick++;
+			if ((sWheelTick & kLevel0Mask) == 0)  CascadeWheel();
 		}
 	}
 	
-	if (sDeferredTimers != nil)
-	{
-		[sTimers addObjects:sDeferredTimers];
-		DESTROY(sDeferredTimers);
-	}
+	FireBatch();
 	
 	sUpdating = NO;
 }
@@ -200,16 +285,77 @@ static NSMutableArray	*sDeferredTimers;
 
 + (void) noteGameReset
 {
-	NSArray				*timers = nil;
+	OOScriptTimer		*timer = nil;
+	OOScriptTimer		*next = nil;
+	
+	// Intermediate list is required so we don't release timers while walking the wheel.
+	for (timer = DetachAllTimers(); timer != nil; timer = next)
+	{
+		next = timer->_wheelNext;
+		timer->_wheelNext = nil;
+		timer->_isScheduled = NO;
+		[timer release];
+	}
+	
+	sTimerCount = 0;
+}
+
+
++ (OOTimeDelta) coalescingTolerance
+{
+	if (sCoalescingTolerance < 0.0)
+	{
+		[self setCoalescingTolerance:[[NSUserDefaults standardUserDefaults] oo_doubleForKey:@"timer-coalescing-tolerance" defaultValue:0.0]];
+	}
+	return sCoalescingTolerance;
+}
+
+
++ (void) setCoalescingTolerance:(OOTimeDelta)tolerance
+{
+	// Running timers pick up the new tolerance next time they're rescheduled.
+	sCoalescingTolerance = fmax(tolerance, 0.0);
+}
+
+
+static void CollectTimer(OOScriptTimer *timer, void *context)
+{
+	[(NSMutableArray *)context addObject:timer];
+}
+
+
++ (NSArray *) timerStatistics
+{
+	NSMutableArray		*timers = nil;
+	NSMutableArray		*result = nil;
 	NSEnumerator		*timerEnum = nil;
 	OOScriptTimer		*timer = nil;
+	NSUInteger			i;
 	
-	// Intermediate array is required so we don't get stuck in an endless loop over reinserted timers. Note that -sortedObjects also clears the queue!
-	timers = [sTimers sortedObjects];
+	timers = [NSMutableArray arrayWithCapacity:sTimerCount + sBatchCount];
+	ApplyToAllTimers(CollectTimer, timers);
+	for (i = 0; i < sBatchCount; i++)
+	{
+		if (sBatch[i]->_pendingFire)  [timers addObject:sBatch[i]];
+	}
+	[timers sortUsingSelector:@selector(compareByTotalFireTimeReverse:)];
+	
+	result = [NSMutableArray arrayWithCapacity:[timers count]];
 	for (timerEnum = [timers objectEnumerator]; (timer = [timerEnum nextObject]); )
 	{
-		timer->_isScheduled = NO;
+		NSMutableDictionary *entry = [NSMutableDictionary dictionaryWithCapacity:7];
+		[entry setObject:[timer description] forKey:@"timer"];
+		NSString *owner = [timer ownerDescription];
+		if (owner != nil)  [entry setObject:owner forKey:@"owner"];
+		[entry setObject:[NSNumber numberWithDouble:timer->_interval] forKey:@"interval"];
+		[entry setObject:[NSNumber numberWithUnsignedInt:timer->_fireCount] forKey:@"fireCount"];
+		[entry setObject:[NSNumber numberWithDouble:timer->_totalFireTime] forKey:@"totalTime"];
+		[entry setObject:[NSNumber numberWithDouble:(timer->_fireCount != 0) ? timer->_totalFireTime / timer->_fireCount : 0.0] forKey:@"averageTime"];
+		[entry setObject:[NSNumber numberWithDouble:timer->_maxFireTime] forKey:@"maxTime"];
+		[result addObject:entry];
 	}
+	
+	return result;
 }
 
 
@@ -255,4 +401,254 @@ static NSMutableArray	*sDeferredTimers;
 	else  return NSOrderedSame;
 }
 
+
+- (void) updateFireTime
+{
+	OOTimeDelta tolerance = [OOScriptTimer coalescingTolerance];
+	
+	/*	Coalesce only repeating timers, and only when the tolerance is small
+		relative to the interval; otherwise the quantization would swallow
+		whole intervals.
+	*/
+	if (tolerance > 0.0 && _interval >= 2.0 * tolerance)
+	{
+		_fireTime = ceil(_nextTime / tolerance) * tolerance;
+	}
+	else
+	{
+		_fireTime = _nextTime;
+	}
+}
+
+
+- (NSComparisonResult) compareByTotalFireTimeReverse:(OOScriptTimer *)other
+{
+	if (_totalFireTime > other->_totalFireTime)  return NSOrderedAscending;
+	if (_totalFireTime < other->_totalFireTime)  return NSOrderedDescending;
+	return NSOrderedSame;
+}
+
+
+static int64_t TickForTime(OOTimeAbsolute time)
+{
+	return (int64_t)floor(time * kTimerWheelTicksPerSecond);
+}
+
+
+static void LinkTimer(OOScriptTimer *timer)
+{
+	int64_t				tick = TickForTime(timer->_fireTime);
+	int64_t				delta;
+	OOScriptTimer		**slot = NULL;
+	
+	// Overdue timers go in the current slot and fire on the next update.
+	if (tick < sWheelTick)  tick = sWheelTick;
+	delta = tick - sWheelTick;
+	
+	if (delta < kLevel0Size)  slot = &sLevel0[tick & kLevel0Mask];
+	else if (delta < (1LL << kLevel2Shift))  slot = &sLevel1[(tick >> kLevel1Shift) & kLevel1Mask];
+	else if (delta < (1LL << kOverflowShift))  slot = &sLevel2[(tick >> kLevel2Shift) & kLevel2Mask];
+	else  slot = &sOverflow;
+	
+	timer->_slotHead = slot;
+	timer->_wheelPrev = nil;
+	timer->_wheelNext = *slot;
+	if (*slot != nil)  (*slot)->_wheelPrev = timer;
+	*slot = timer;
+}
+
+
+static void UnlinkTimer(OOScriptTimer *timer)
+{
+	if (timer->_wheelPrev != nil)  timer->_wheelPrev->_wheelNext = timer->_wheelNext;
+	else  *timer->_slotHead = timer->_wheelNext;
+	if (timer->_wheelNext != nil)  timer->_wheelNext->_wheelPrev = timer->_wheelPrev;
+	
+	timer->_wheelNext = nil;
+	timer->_wheelPrev = nil;
+	timer->_slotHead = NULL;
+}
+
+
+// Empty a slot, returning its timers as a list linked through _wheelNext.
+static OOScriptTimer *DetachSlot(OOScriptTimer **slot)
+{
+	OOScriptTimer		*list = *slot;
+	OOScriptTimer		*timer = nil;
+	
+	*slot = nil;
+	for (timer = list; timer != nil; timer = timer->_wheelNext)
+	{
+		timer->_wheelPrev = nil;
+		timer->_slotHead = NULL;
+	}
+	return list;
+}
+
+
+static OOScriptTimer *AppendList(OOScriptTimer *list, OOScriptTimer *tail)
+{
+	OOScriptTimer		*last = list;
+	
+	if (list == nil)  return tail;
+	while (last->_wheelNext != nil)  last = last->_wheelNext;
+	last->_wheelNext = tail;
+	return list;
+}
+
+
+static OOScriptTimer *DetachAllTimers(void)
+{
+	OOScriptTimer		*result = nil;
+	unsigned			i;
+	
+	for (i = 0; i < kLevel0Size; i++)  result = AppendList(DetachSlot(&sLevel0[i]), result);
+	for (i = 0; i < kLevel1Size; i++)  result = AppendList(DetachSlot(&sLevel1[i]), result);
+	for (i = 0; i < kLevel2Size; i++)  result = AppendList(DetachSlot(&sLevel2[i]), result);
+	result = AppendList(DetachSlot(&sOverflow), result);
+	
+	return result;
+}
+
+
+static void RelinkTimers(OOScriptTimer *list)
+{
+	OOScriptTimer		*next = nil;
+	
+	for (; list != nil; list = next)
+	{
+		next = list->_wheelNext;
+		LinkTimer(list);
+	}
+}
+
+
+// Called when sWheelTick reaches the start of a new turn of level 0.
+static void CascadeWheel(void)
+{
+	unsigned			index1 = (sWheelTick >> kLevel1Shift) & kLevel1Mask;
+	unsigned			index2 = (sWheelTick >> kLevel2Shift) & kLevel2Mask;
+	
+	if (index1 == 0)
+	{
+		if (index2 == 0)  RelinkTimers(DetachSlot(&sOverflow));
+		RelinkTimers(DetachSlot(&sLevel2[index2]));
+	}
+	RelinkTimers(DetachSlot(&sLevel1[index1]));
+}
+
+
+static void RebuildWheel(int64_t tick)
+{
+	OOScriptTimer		*all = DetachAllTimers();
+	
+	sWheelTick = tick;
+	RelinkTimers(all);
+}
+
+
+static void CollectDueTimers(OOScriptTimer **slot, OOTimeAbsolute now)
+{
+	OOScriptTimer		*timer = *slot;
+	OOScriptTimer		*next = nil;
+	
+	for (; timer != nil; timer = next)
+	{
+		next = timer->_wheelNext;
+		if (now < timer->_fireTime)  continue;
+		
+		UnlinkTimer(timer);
+		sTimerCount--;
+		
+		if (sBatchCount == sBatchCapacity)
+		{
+			sBatchCapacity = (sBatchCapacity != 0) ? sBatchCapacity * 2 : 32;
+			sBatch = realloc(sBatch, sBatchCapacity * sizeof *sBatch);
+			if (EXPECT_NOT(sBatch == NULL))
+			{
+				[NSException raise:NSMallocException format:@"Failed to allocate memory for timer batch."];
+			}
+		}
+		timer->_pendingFire = YES;
+		sBatch[sBatchCount++] = timer;
+	}
+}
+
+
+static void FireBatch(void)
+{
+	NSUInteger			i;
+	OOScriptTimer		*timer = nil;
+	OOHighResTimeValue	start, end;
+	OOTimeDelta			elapsed;
+	
+	if (sBatchCount == 0)  return;
+	if (sBatchCount > 1)  qsort(sBatch, sBatchCount, sizeof *sBatch, CompareTimersByNextTime);
+	
+	for (i = 0; i < sBatchCount; i++)
+	{
+		timer = sBatch[i];
+		
+		// An earlier timer in the batch may have stopped this one.
+		if (!timer->_pendingFire)  continue;
+		timer->_pendingFire = NO;
+		
+		// Must fire before rescheduling so that the timer callback can stop itself. -- Ahruman 2011-01-01
+		start = OOGetHighResTime();
+		[timer timerFired];
+		end = OOGetHighResTime();
+		
+		elapsed = OOHighResTimeDeltaInSeconds(start, end);
+		OODisposeHighResTime(start);
+		OODisposeHighResTime(end);
+		timer->_fireCount++;
+		timer->_totalFireTime += elapsed;
+		if (timer->_maxFireTime < elapsed)  timer->_maxFireTime = elapsed;
+		
+		timer->_hasBeenRun = YES;
+		
+		// If the callback restarted the timer, it's already back in the wheel.
+		if (timer->_isScheduled && timer->_slotHead == NULL)
+		{
+			timer->_isScheduled = NO;
+			[timer scheduleTimer];
+		}
+	}
+	
+	for (i = 0; i < sBatchCount; i++)
+	{
+		sBatch[i]->_pendingFire = NO;
+		[sBatch[i] release];
+	}
+	sBatchCount = 0;
+}
+
+
+static void ApplyToSlot(OOScriptTimer *list, void (*function)(OOScriptTimer *timer, void *context), void *context)
+{
+	for (; list != nil; list = list->_wheelNext)  function(list, context);
+}
+
+
+static void ApplyToAllTimers(void (*function)(OOScriptTimer *timer, void *context), void *context)
+{
+	unsigned			i;
+	
+	for (i = 0; i < kLevel0Size; i++)  ApplyToSlot(sLevel0[i], function, context);
+	for (i = 0; i < kLevel1Size; i++)  ApplyToSlot(sLevel1[i], function, context);
+	for (i = 0; i < kLevel2Size; i++)  ApplyToSlot(sLevel2[i], function, context);
+	ApplyToSlot(sOverflow, function, context);
+}
+
+
+static int CompareTimersByNextTime(const void *a, const void *b)
+{
+	OOScriptTimer		*timerA = *(OOScriptTimer * const *)a;
+	OOScriptTimer		*timerB = *(OOScriptTimer * const *)b;
+	
+	if (timerA->_nextTime < timerB->_nextTime)  return -1;
+	if (timerA->_nextTime > timerB->_nextTime)  return 1;
+	return 0;
+}
+
 @end
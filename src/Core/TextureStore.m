@@ -35,6 +35,9 @@ MA 02110-1301, USA.
 #endif
 
 #import "OOCollectionExtractors.h"
+#import "OOAsyncWorkManager.h"
+#import "OOCacheManager.h"
+#import "OOCPUInfo.h"
 
 #define DEBUG_DUMP			(	0	&& !defined(NDEBUG))
 
@@ -101,8 +104,81 @@ static FloatRGB PlanetTextureColor(float q, float impress, float bias, FloatRGB
 }
 
 
-static void fillSquareImageDataWithCloudTexture(unsigned char * imageBuffer, int width, OOColor* cloudcolor, float impress, float bias);
-static void fillSquareImageWithPlanetTex(unsigned char * imageBuffer, int width, float impress, float bias, FloatRGB seaColor, FloatRGB paleSeaColor, FloatRGB landColor, FloatRGB paleLandColor);
+/*	Generation runs in row bands on the async work manager's threads, in
+	stages with a join between them, since the normals read q from the rows
+	on either side. The result is the same for any number of bands.
+*/
+typedef struct
+{
+	uint8_t					i, j;		// Noise lattice points on either side...
+	float					q;			// ...and the position between them.
+} NoiseLatticePosition;
+
+
+typedef struct
+{
+	int						width;
+	float					impress;
+	float					bias;
+	float					poleValue;
+	float					*accBuffer;
+	float					*qBuffer;
+	unsigned char			*imageBuffer;
+	unsigned				octaveCount;
+	NoiseLatticePosition	*lattice;		// width entries per octave; the texture is square, so rows and columns share them.
+	
+	FloatRGB				seaColor, paleSeaColor, landColor, paleLandColor;	// Planets only.
+	GLfloat					rgba[4];		// Clouds only.
+} TextureGenContext;
+
+
+typedef void (*RowFunction)(TextureGenContext *context, int y);
+
+
+@interface OOTextureStoreRowBand: NSObject <OOAsyncWorkTask>
+{
+@private
+	RowFunction				_function;
+	TextureGenContext		*_context;
+	int						_firstRow;
+	int						_endRow;
+}
+
+- (id) initWithFunction:(RowFunction)function context:(TextureGenContext *)context firstRow:(int)firstRow endRow:(int)endRow;
+
+@end
+
+
+enum
+{
+	kTextureCacheVersion			= 1,
+	kDefaultTextureCacheMegabytes	= 256
+};
+
+static NSString * const kTextureCacheExtension = @"ooptex";
+
+
+static RANROTSeed sNoiseSeed;
+float ranNoiseBuffer[ 128 * 128];
+
+static unsigned long long sTextureCacheSizeLimit;
+
+
+static void RunRowFunction(RowFunction function, TextureGenContext *context);
+static BOOL SetUpTextureGenContext(TextureGenContext *context, unsigned char *imageBuffer, int width, float impress, float bias);
+static void DestroyTextureGenContext(TextureGenContext *context);
+static void FillNoiseRow(TextureGenContext *context, int y);
+static void FillQRow(TextureGenContext *context, int y);
+static void FillPlanetRow(TextureGenContext *context, int y);
+static void FillCloudRow(TextureGenContext *context, int y);
+
+static NSString *FloatRGBCacheKey(FloatRGB color);
+static NSString *TextureCacheFolder(void);
+static BOOL ReadCachedTexture(NSString *key, unsigned char *imageBuffer, size_t size);
+static void WriteCachedTexture(NSString *key, const unsigned char *imageBuffer, size_t size);
+
+static BOOL fillSquareImageDataWithCloudTexture(unsigned char * imageBuffer, int width, OOColor* cloudcolor, float impress, float bias);
+static BOOL fillSquareImageWithPlanetTex(unsigned char * imageBuffer, int width, float impress, float bias, FloatRGB seaColor, FloatRGB paleSeaColor, FloatRGB landColor, FloatRGB paleLandColor);
 
 
 @implementation TextureStore
@@ -122,15 +198,9 @@ static void fillSquareImageWithPlanetTex(unsigned char * imageBuffer, int width,
 	unsigned char *imageBuffer = malloc(tex_bytes);
 	if (imageBuffer == NULL)  return NO;
 	
-	*textureData = imageBuffer;
-	*textureWidth = texture_w;
-	*textureHeight = texture_h;
-	
 	float land_fraction = [[planetInfo objectForKey:@"land_fraction"] floatValue];
 	float sea_bias = land_fraction - 1.0;
 	
-	OOLog(kOOLogPlanetTextureGen, @"genning texture for land_fraction %.5f", land_fraction);
-	
 	FloatRGB land_color = FloatRGBFromDictColor(planetInfo, @"land_color");
 	FloatRGB sea_color = FloatRGBFromDictColor(planetInfo, @"sea_color");
 	FloatRGB polar_land_color = FloatRGBFromDictColor(planetInfo, @"polar_land_color");
@@ -139,11 +209,29 @@ static void fillSquareImageWithPlanetTex(unsigned char * imageBuffer, int width,
 	// Pale sea colour gives a better transition between land and sea., Backported from the new planets code.
 	FloatRGB pale_sea_color = Blend(0.45, polar_sea_color, Blend(0.7, sea_color, land_color));
 	
-	fillSquareImageWithPlanetTex(imageBuffer, texture_w, 1.0, sea_bias,
-		sea_color,
-		pale_sea_color,
-		land_color,
-		polar_land_color);
+	// The noise buffer is made from sNoiseSeed, so the seed and colours identify the texture.
+	NSString *cacheKey = [NSString stringWithFormat:@"planet %u %u %u %u %.9g %@ %@ %@ %@", kTextureCacheVersion, texture_w, sNoiseSeed.high, sNoiseSeed.low, land_fraction, FloatRGBCacheKey(sea_color), FloatRGBCacheKey(pale_sea_color), FloatRGBCacheKey(land_color), FloatRGBCacheKey(polar_land_color)];
+	
+	if (!ReadCachedTexture(cacheKey, imageBuffer, tex_bytes))
+	{
+		OOLog(kOOLogPlanetTextureGen, @"genning texture for land_fraction %.5f", land_fraction);
+		
+		if (!fillSquareImageWithPlanetTex(imageBuffer, texture_w, 1.0, sea_bias,
+			sea_color,
+			pale_sea_color,
+			land_color,
+			polar_land_color))
+		{
+			free(imageBuffer);
+			return NO;
+		}
+		
+		WriteCachedTexture(cacheKey, imageBuffer, tex_bytes);
+	}
+	
+	*textureData = imageBuffer;
+	*textureWidth = texture_w;
+	*textureHeight = texture_h;
 	
 	return YES;
 }
@@ -162,21 +250,29 @@ static void fillSquareImageWithPlanetTex(unsigned char * imageBuffer, int width,
 	unsigned char *imageBuffer = malloc(tex_bytes);
 	if (imageBuffer == NULL)  return NO;
 	
+	NSString *cacheKey = [NSString stringWithFormat:@"cloud %u %u %u %u %.9g %.9g %.9g %.9g %.9g %.9g", kTextureCacheVersion, texture_w, sNoiseSeed.high, sNoiseSeed.low, impress, bias, [color redComponent], [color greenComponent], [color blueComponent], [color alphaComponent]];
+	
+	if (!ReadCachedTexture(cacheKey, imageBuffer, tex_bytes))
+	{
+		if (!fillSquareImageDataWithCloudTexture( imageBuffer, texture_w, color, impress, bias))
+		{
+			free(imageBuffer);
+			return NO;
+		}
+		
+		WriteCachedTexture(cacheKey, imageBuffer, tex_bytes);
+	}
+	
 	*textureData = imageBuffer;
 	*textureWidth = texture_w;
 	*textureHeight = texture_h;
 	
-	fillSquareImageDataWithCloudTexture( imageBuffer, texture_w, color, impress, bias);
-	
 	return YES;
 }
 
 @end
 
 
-static RANROTSeed sNoiseSeed;
-float ranNoiseBuffer[ 128 * 128];
-
 void fillRanNoiseBuffer()
 {
 	sNoiseSeed = RANROTGetFullSeed();
@@ -187,32 +283,6 @@ void fillRanNoiseBuffer()
 }
 
 
-static void addNoise(float * buffer, int p, int n, float scale)
-{
-	int x, y;
-	
-	float r = (float)p / (float)n;
-	for (y = 0; y < p; y++) for (x = 0; x < p; x++)
-	{
-		int ix = floor( (float)x / r);
-		int jx = (ix + 1) % n;
-		int iy = floor( (float)y / r);
-		int jy = (iy + 1) % n;
-		float qx = x / r - ix;
-		float qy = y / r - iy;
-		ix &= 127;
-		iy &= 127;
-		jx &= 127;
-		jy &= 127;
-		float rix = OOLerp(ranNoiseBuffer[iy * 128 + ix], ranNoiseBuffer[iy * 128 + jx], qx);
-		float rjx = OOLerp(ranNoiseBuffer[jy * 128 + ix], ranNoiseBuffer[jy * 128 + jx], qx);
-		float rfinal = scale * OOLerp(rix, rjx, qy);
-		
-		buffer[y * p + x] += rfinal;
-	}
-}
-
-
 static float q_factor(float* accbuffer, int x, int y, int width, BOOL polar_y_smooth, float polar_y_value, BOOL polar_x_smooth, float polar_x_value, float impress, float bias)
 {
 	while ( x < 0 ) x+= width;
@@ -243,40 +313,24 @@ static float q_factor(float* accbuffer, int x, int y, int width, BOOL polar_y_sm
 }
 
 
-static void fillSquareImageDataWithCloudTexture(unsigned char * imageBuffer, int width, OOColor* cloudcolor, float impress, float bias)
+static BOOL fillSquareImageDataWithCloudTexture(unsigned char * imageBuffer, int width, OOColor* cloudcolor, float impress, float bias)
 {
 	NSCParameterAssert(width > 0);
 	
-	float accbuffer[width * width];
-	memset(accbuffer, 0, sizeof accbuffer);
-	int x, y;
+	TextureGenContext context;
+	if (!SetUpTextureGenContext(&context, imageBuffer, width, impress, bias))  return NO;
 
-	GLfloat rgba[4];
-	rgba[0] = [cloudcolor redComponent];
-	rgba[1] = [cloudcolor greenComponent];
-	rgba[2] = [cloudcolor blueComponent];
-	rgba[3] = [cloudcolor alphaComponent];
+	context.rgba[0] = [cloudcolor redComponent];
+	context.rgba[1] = [cloudcolor greenComponent];
+	context.rgba[2] = [cloudcolor blueComponent];
+	context.rgba[3] = [cloudcolor alphaComponent];
 
-	int octave = 8;
-	float scale = 0.5;
-	while (octave < width)
-	{
-		addNoise(accbuffer, width, octave, scale);
-		octave *= 2;
-		scale *= 0.5;
-	}
+	RunRowFunction(FillNoiseRow, &context);
 	
-	float pole_value = (impress * accbuffer[0] - bias < 0.0)? 0.0: 1.0;
+	context.poleValue = (impress * context.accBuffer[0] - bias < 0.0)? 0.0: 1.0;
 	
-	for (y = 0; y < width; y++) for (x = 0; x < width; x++)
-	{
-		float q = q_factor(accbuffer, x, y, width, YES, pole_value, NO, 0.0, impress, bias);
-		
-		imageBuffer[0 + 4 * (y * width + x) ] = 255 * rgba[0];
-		imageBuffer[1 + 4 * (y * width + x) ] = 255 * rgba[1];
-		imageBuffer[2 + 4 * (y * width + x) ] = 255 * rgba[2];
-		imageBuffer[3 + 4 * (y * width + x) ] = 255 * rgba[3] * q;
-	}
+	RunRowFunction(FillCloudRow, &context);
+	DestroyTextureGenContext(&context);
 #if DEBUG_DUMP
 	NSString *name = [NSString stringWithFormat:@"atmosphere-%u-%u-old", sNoiseSeed.high, sNoiseSeed.low];
 	OOLog(@"planetTex.dump", [NSString stringWithFormat:@"Saving generated texture to file %@.", name]);
@@ -287,64 +341,322 @@ static void fillSquareImageDataWithCloudTexture(unsigned char * imageBuffer, int
 									  height:width
 									rowBytes:width * 4];
 #endif
+	
+	return YES;
 }
 
-static void fillSquareImageWithPlanetTex(unsigned char * imageBuffer, int width, float impress, float bias,
+static BOOL fillSquareImageWithPlanetTex(unsigned char * imageBuffer, int width, float impress, float bias,
 	FloatRGB seaColor,
 	FloatRGB paleSeaColor,
 	FloatRGB landColor,
 	FloatRGB paleLandColor)
 {
-	float accbuffer[width * width];
-	memset(accbuffer, 0, sizeof accbuffer);
+	TextureGenContext context;
+	if (!SetUpTextureGenContext(&context, imageBuffer, width, impress, bias))  return NO;
+	
+	context.qBuffer = malloc(width * width * sizeof *context.qBuffer);
+	if (context.qBuffer == NULL)
+	{
+		DestroyTextureGenContext(&context);
+		return NO;
+	}
 	
-	int octave = 8;
+	context.seaColor = seaColor;
+	context.paleSeaColor = paleSeaColor;
+	context.landColor = landColor;
+	context.paleLandColor = paleLandColor;
+	context.poleValue = (impress + bias > 0.5)? 0.5 * (impress + bias) : 0.0;
+	
+	RunRowFunction(FillNoiseRow, &context);
+	RunRowFunction(FillQRow, &context);
+	RunRowFunction(FillPlanetRow, &context);
+	DestroyTextureGenContext(&context);
+#if DEBUG_DUMP
+	OOLog(@"planetTex.dump", [NSString stringWithFormat:@"Saving generated texture to file planet-%u-%u-old.", sNoiseSeed.high, sNoiseSeed.low]);
+	
+	[[UNIVERSE gameView] dumpRGBAToFileNamed:[NSString stringWithFormat:@"planet-%u-%u-old", sNoiseSeed.high, sNoiseSeed.low]
+									   bytes:imageBuffer
+									   width:width
+									  height:width
+									rowBytes:width * 4];
+#endif
+	
+	return YES;
+}
+
+
+static BOOL SetUpTextureGenContext(TextureGenContext *context, unsigned char *imageBuffer, int width, float impress, float bias)
+{
+	NSCParameterAssert(context != NULL && imageBuffer != NULL && width > 0);
+	
+	memset(context, 0, sizeof *context);
+	context->width = width;
+	context->impress = impress;
+	context->bias = bias;
+	context->imageBuffer = imageBuffer;
+	
+	int octave;
+	for (octave = 8; octave < width; octave *= 2)  context->octaveCount++;
+	
+	context->accBuffer = calloc(width * width, sizeof *context->accBuffer);
+	context->lattice = malloc(MAX(context->octaveCount, 1U) * width * sizeof *context->lattice);
+	if (context->accBuffer == NULL || context->lattice == NULL)
+	{
+		DestroyTextureGenContext(context);
+		return NO;
+	}
+	
+	/*	Lattice positions are the same for every row, so they're found once
+		per octave rather than once per texel.
+	*/
+	NoiseLatticePosition *position = context->lattice;
+	for (octave = 8; octave < width; octave *= 2)
+	{
+		float r = (float)width / (float)octave;
+		int x;
+		for (x = 0; x < width; x++)
+		{
+			int i = floor( (float)x / r);
+			position->i = i & 127;
+			position->j = ((i + 1) % octave) & 127;
+			position->q = x / r - i;
+			position++;
+		}
+	}
+	
+	return YES;
+}
+
+
+static void DestroyTextureGenContext(TextureGenContext *context)
+{
+	free(context->accBuffer);
+	free(context->qBuffer);
+	free(context->lattice);
+	context->accBuffer = context->qBuffer = NULL;
+	context->lattice = NULL;
+}
+
+
+static void FillNoiseRow(TextureGenContext *context, int y)
+{
+	int width = context->width;
+	float *row = context->accBuffer + y * width;
+	const NoiseLatticePosition *columns = context->lattice;
 	float scale = 0.5;
-	while (octave < width)
+	unsigned octave;
+	
+	for (octave = 0; octave < context->octaveCount; octave++)
 	{
-		addNoise(accbuffer, width, octave, scale);
-		octave *= 2;
+		NoiseLatticePosition rowPosition = columns[y];
+		const float *noiseI = ranNoiseBuffer + rowPosition.i * 128;
+		const float *noiseJ = ranNoiseBuffer + rowPosition.j * 128;
+		int x;
+		
+		for (x = 0; x < width; x++)
+		{
+			NoiseLatticePosition column = columns[x];
+			float rix = OOLerp(noiseI[column.i], noiseI[column.j], column.q);
+			float rjx = OOLerp(noiseJ[column.i], noiseJ[column.j], column.q);
+			float rfinal = scale * OOLerp(rix, rjx, rowPosition.q);
+			
+			row[x] += rfinal;
+		}
+		
+		columns += width;
 		scale *= 0.5;
 	}
+}
+
+
+static void FillQRow(TextureGenContext *context, int y)
+{
+	int width = context->width;
+	float *row = context->qBuffer + y * width;
+	int x;
 	
-	float pole_value = (impress + bias > 0.5)? 0.5 * (impress + bias) : 0.0;
-	
-	int x, y;
-	for (y = 0; y < width; y++) for (x = 0; x < width; x++)
+	for (x = 0; x < width; x++)
 	{
-		float q = q_factor(accbuffer, x, y, width, YES, pole_value, NO, 0.0, impress, bias);
+		row[x] = q_factor(context->accBuffer, x, y, width, YES, context->poleValue, NO, 0.0, context->impress, context->bias);
+	}
+}
 
-		float yN = q_factor(accbuffer, x, y - 1, width, YES, pole_value, NO, 0.0, impress, bias);
-		float yS = q_factor(accbuffer, x, y + 1, width, YES, pole_value, NO, 0.0, impress, bias);
-		float yW = q_factor(accbuffer, x - 1, y, width, YES, pole_value, NO, 0.0, impress, bias);
-		float yE = q_factor(accbuffer, x + 1, y, width, YES, pole_value, NO, 0.0, impress, bias);
 
+static void FillPlanetRow(TextureGenContext *context, int y)
+{
+	int width = context->width;
+	const float *row = context->qBuffer + y * width;
+	const float *rowN = context->qBuffer + ((y + width - 1) % width) * width;
+	const float *rowS = context->qBuffer + ((y + 1) % width) * width;
+	unsigned char *pixel = context->imageBuffer + 4 * y * width;
+	int x;
+	
+	for (x = 0; x < width; x++)
+	{
+		float q = row[x];
+		
+		float yN = rowN[x];
+		float yS = rowS[x];
+		float yW = row[(x + width - 1) % width];
+		float yE = row[(x + 1) % width];
+		
 		Vector norm = make_vector( 24.0 * (yW - yE), 24.0 * (yS - yN), 2.0);
 		
 		norm = vector_normal(norm);
 		
 		GLfloat shade = pow(norm.z, 3.2);
 		
-		FloatRGB color = PlanetTextureColor(q, impress, bias, seaColor, paleSeaColor, landColor, paleLandColor);
+		FloatRGB color = PlanetTextureColor(q, context->impress, context->bias, context->seaColor, context->paleSeaColor, context->landColor, context->paleLandColor);
 		
 		color.r *= shade;
 		color.g *= shade;
 		color.b *= shade;
 		
-		imageBuffer[0 + 4 * (y * width + x)] = 255 * color.r;
-		imageBuffer[1 + 4 * (y * width + x)] = 255 * color.g;
-		imageBuffer[2 + 4 * (y * width + x)] = 255 * color.b;
-		imageBuffer[3 + 4 * (y * width + x)] = 255;
+		pixel[0] = 255 * color.r;
+		pixel[1] = 255 * color.g;
+		pixel[2] = 255 * color.b;
+		pixel[3] = 255;
+		pixel += 4;
 	}
-#if DEBUG_DUMP
-	OOLog(@"planetTex.dump", [NSString stringWithFormat:@"Saving generated texture to file planet-%u-%u-old.", sNoiseSeed.high, sNoiseSeed.low]);
+}
+
+
+static void FillCloudRow(TextureGenContext *context, int y)
+{
+	int width = context->width;
+	unsigned char *pixel = context->imageBuffer + 4 * y * width;
+	int x;
 	
-	[[UNIVERSE gameView] dumpRGBAToFileNamed:[NSString stringWithFormat:@"planet-%u-%u-old", sNoiseSeed.high, sNoiseSeed.low]
-									   bytes:imageBuffer
-									   width:width
-									  height:width
-									rowBytes:width * 4];
-#endif
+	for (x = 0; x < width; x++)
+	{
+		float q = q_factor(context->accBuffer, x, y, width, YES, context->poleValue, NO, 0.0, context->impress, context->bias);
+		
+		pixel[0] = 255 * context->rgba[0];
+		pixel[1] = 255 * context->rgba[1];
+		pixel[2] = 255 * context->rgba[2];
+		pixel[3] = 255 * context->rgba[3] * q;
+		pixel += 4;
+	}
 }
 
+
+/*	The work manager runs as many bands at once as it has threads, so one band
+	per CPU doesn't oversubscribe them. The calling thread does the first band
+	itself and then waits for the rest.
+*/
+static void RunRowFunction(RowFunction function, TextureGenContext *context)
+{
+	OOAsyncWorkManager		*workManager = [OOAsyncWorkManager sharedAsyncWorkManager];
+	int						height = context->width;
+	int						bandCount = MAX(MIN((int)OOCPUCount(), height), 1);
+	NSMutableArray			*bands = [NSMutableArray arrayWithCapacity:bandCount - 1];
+	int						i, y;
+	
+	for (i = 1; i < bandCount; i++)
+	{
+		OOTextureStoreRowBand *band = [[OOTextureStoreRowBand alloc] initWithFunction:function
+																			  context:context
+																			 firstRow:height * i / bandCount
+																			   endRow:height * (i + 1) / bandCount];
+		if (band != nil && [workManager addTask:band priority:kOOAsyncPriorityHigh])
+		{
+			[bands addObject:band];
+		}
+		else
+		{
+			// Couldn't queue it, so do it here.
+			for (y = height * i / bandCount; y < height * (i + 1) / bandCount; y++)  function(context, y);
+		}
+		[band release];
+	}
+	
+	for (y = 0; y < height / bandCount; y++)  function(context, y);
+	
+	NSEnumerator *bandEnum = nil;
+	OOTextureStoreRowBand *band = nil;
+	for (bandEnum = [bands objectEnumerator]; (band = [bandEnum nextObject]); )
+	{
+		[workManager waitForTaskToComplete:band];
+	}
+}
+
+
+static NSString *FloatRGBCacheKey(FloatRGB color)
+{
+	return [NSString stringWithFormat:@"%.9g %.9g %.9g", color.r, color.g, color.b];
+}
+
+
+// nil if the disk cache is disabled or its folder can't be created.
+static NSString *TextureCacheFolder(void)
+{
+	static BOOL					initialized = NO;
+	static NSString				*folder = nil;
+	
+	if (!initialized)
+	{
+		initialized = YES;
+		sTextureCacheSizeLimit = (unsigned long long)[[NSUserDefaults standardUserDefaults] oo_unsignedIntegerForKey:@"planet-texture-cache-megabytes" defaultValue:kDefaultTextureCacheMegabytes] << 20;
+		if (sTextureCacheSizeLimit != 0)
+		{
+			folder = [OOCacheFolderPath(@"Planet Textures") retain];
+		}
+	}
+	
+	return folder;
+}
+
+
+static BOOL ReadCachedTexture(NSString *key, unsigned char *imageBuffer, size_t size)
+{
+	NSString *folder = TextureCacheFolder();
+	if (folder == nil)  return NO;
+	
+	NSData *data = OOReadCacheFile(OOCacheFilePath(folder, key, kTextureCacheExtension), key);
+	if ([data length] != size)  return NO;
+	
+	[data getBytes:imageBuffer length:size];
+	return YES;
+}
+
+
+static void WriteCachedTexture(NSString *key, const unsigned char *imageBuffer, size_t size)
+{
+	NSString *folder = TextureCacheFolder();
+	if (folder == nil)  return;
+	
+	NSData *data = [NSData dataWithBytesNoCopy:(void *)imageBuffer length:size freeWhenDone:NO];
+	OOWriteCacheFile(OOCacheFilePath(folder, key, kTextureCacheExtension), key, data, sTextureCacheSizeLimit);
+}
+
+
+@implementation OOTextureStoreRowBand
+
+- (id) initWithFunction:(RowFunction)function context:(TextureGenContext *)context firstRow:(int)firstRow endRow:(int)endRow
+{
+	if ((self = [super init]))
+	{
+		_function = function;
+		_context = context;
+		_firstRow = firstRow;
+		_endRow = endRow;
+	}
+	return self;
+}
+
+
+- (void) performAsyncTask
+{
+	int y;
+	for (y = _firstRow; y < _endRow; y++)  _function(_context, y);
+}
+
+
+- (void) completeAsyncTask
+{
+	// Don't need to do anything, but this needs to be here so we can wait on it.
+}
+
+@end
+
 #endif	// !NEW_PLANETS
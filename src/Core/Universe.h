@@ -44,7 +44,8 @@ MA 02110-1301, USA.
 @class	GameController, CollisionRegion, MyOpenGLView, GuiDisplayGen,
 	Entity, ShipEntity, StationEntity, OOPlanetEntity, OOSunEntity,
 	OOVisualEffectEntity, PlayerEntity, OORoleSet, WormholeEntity, 
-	DockEntity, OOJSScript;
+	DockEntity, OOJSScript, OOMeshInstanceBatch, OOEffectBatch, OORenderQueue, OOCache,
+	OOGalaxyRouteGraph, OOSystemPrefetcher, OOQualityController, SkyEntity;
 
 
 typedef BOOL (*EntityFilterPredicate)(Entity *entity, void *parameter);
@@ -154,11 +155,33 @@ enum
 #endif
 
 
+/*	The frequently used properties of a system in the current galaxy, with
+	planetinfo.plist and script overrides applied. Strings are owned by
+	Universe and may be released when overrides change.
+*/
+typedef struct
+{
+	OOGovernmentID			government;
+	OOEconomyID				economy;
+	OOTechLevelID			techLevel;
+	unsigned				population;
+	unsigned				productivity;
+	unsigned				radius;
+	BOOL					sunGoneNova;
+	NSString				*name;
+	NSString				*inhabitant;
+	NSString				*inhabitants;
+} OOSystemSummary;
+
+
 @interface Universe: OOWeakRefObject
 {
 @public
 	// use a sorted list for drawing and other activities
 	Entity					*sortedEntities[UNIVERSE_MAX_ENTITIES + 1];	// One extra for padding; see -doRemoveEntity:.
+	OOMeshInstanceBatch		*instanceBatch;
+	OOEffectBatch			*effectBatch;
+	OORenderQueue			*renderQueue;
 	unsigned				n_entities;
 	
 	int						cursor_row;
@@ -191,6 +214,19 @@ enum
 	OOWeakReference			*_firstBeacon,
 							*_lastBeacon;
 	
+	// Scanner neighbourhood, see -scannerNeighbourhoodWithCount:.
+	Entity					*_scannerNeighbours[UNIVERSE_MAX_ENTITIES];
+	NSUInteger				_scannerNeighbourCount;
+	BOOL					_scannerNeighbourhoodValid;
+	GLfloat					_maxScannerEntityRadius;	// Largest collision radius of non-stellar entities added since the last system change.
+	
+	OOCache					*_routeCache;				// Results of -routeFromSystem:toSystem:optimizedBy: for the current galaxy.
+	OOGalaxyRouteGraph		*_routeGraph;				// Jump network of the current galaxy, built on demand.
+	struct OOSystemRecord	*_systemRecords;			// Summary and system data dictionary of each system in the current galaxy, filled in on demand.
+	OOSystemPrefetcher		*_systemPrefetcher;			// Destination of the hyperspace countdown in progress, if any.
+	OOQualityController		*_qualityController;		// Adjusts detail to the measured frame time.
+	uint32_t				_distantUpdatePhase;		// Counts updates, to spread out updates of distant ships.
+	
 	GLfloat					skyClearColor[4];
 	
 	NSString				*currentMessage;
@@ -297,6 +333,10 @@ enum
 	BOOL					doProcedurallyTexturedPlanets;
 	
 	GLfloat					frustum[6][4];
+	uint32_t				_cullFrameStamp;
+	NSUInteger				_visibleEntityCount;
+	NSUInteger				_frustumCulledCount;
+	NSUInteger				_occludedCount;
 	
 	NSMutableDictionary		*conditionScripts;
 	
@@ -444,10 +484,22 @@ enum
 - (NSDictionary *) gameSettings;
 
 - (void) drawUniverse;
+- (OOEffectBatch *) effectBatch;	// Statistics only; nil until the first translucent pass in flight.
+- (OOQualityController *) qualityController;
 
 - (void) defineFrustum;
 - (BOOL) viewFrustumIntersectsSphereAt:(Vector)position withRadius:(GLfloat)radius;
 
+/*	Changes every frame. Entities that the frame's culling pass finds visible
+	have their visibleFrameStamp set to it, and needn't be tested again.
+*/
+- (uint32_t) cullFrameStamp;
+
+// Culling statistics for the last frame drawn.
+- (NSUInteger) visibleEntityCount;
+- (NSUInteger) frustumCulledEntityCount;
+- (NSUInteger) occludedEntityCount;
+
 - (void) drawMessage;
 
 // Used to draw subentities. Should be getting this from camera.
@@ -469,6 +521,18 @@ enum
 
 - (ShipEntity *) firstShipHitByLaserFromShip:(ShipEntity *)srcEntity inDirection:(OOWeaponFacing)direction offset:(Vector)offset gettingRangeFound:(GLfloat*)range_ptr;
 - (Entity *) firstEntityTargetedByPlayer;
+
+/*	Entities the scanner, mass lock and ID computer may care about: every
+	non-stellar entity other than the player whose bounding sphere comes
+	within SCANNER_MAX_RANGE of the player, in no particular order, followed
+	by the planets and sun, which can mass lock from much further away.
+	
+	The list is gathered by walking every entity, and is only rebuilt after
+	entities have moved or been added or removed. Callers that want the
+	nearest entity must compare distances themselves. The entities are
+	retained until the next rebuild.
+*/
+- (Entity * const *) scannerNeighbourhoodWithCount:(NSUInteger *)outCount;
 - (Entity *) firstEntityTargetedByPlayerPrecisely;
 
 - (NSArray *) entitiesWithinRange:(double)range ofEntity:(Entity *)entity;
@@ -571,6 +635,7 @@ enum
 - (NSDictionary *) generateSystemData:(Random_Seed) system_seed;
 - (NSDictionary *) generateSystemData:(Random_Seed) s_seed useCache:(BOOL) useCache;
 - (NSDictionary *) currentSystemData;	// Same as generateSystemData:systemSeed unless in interstellar space.
+- (OOSystemSummary) systemSummaryForSystem:(OOSystemID)sysID;	// Much cheaper than -generateSystemData: if the summary properties are enough.
 - (BOOL) inInterstellarSpace;
 
 - (void)setObject:(id)object forKey:(NSString *)key forPlanetKey:(NSString *)planetKey;
@@ -605,12 +670,33 @@ enum
 - (NSDictionary *) routeFromSystem:(OOSystemID) start toSystem:(OOSystemID) goal optimizedBy:(OORouteType) optimizeBy;
 - (NSArray *) neighboursToSystem:(OOSystemID) system_number;
 - (NSArray *) neighboursToRandomSeed:(Random_Seed) seed;
+- (OOGalaxyRouteGraph *) routeGraph;
+#ifndef NDEBUG
+/*	Time the previous route search against the route graph for every route
+	from the first originCount systems, and check they agree. Slow: the old
+	search takes several milliseconds per route.
+*/
+- (NSDictionary *) routingBenchmarkWithOriginCount:(NSUInteger)originCount;
+#endif
 
 - (NSMutableDictionary *) localPlanetInfoOverrides;
 - (void) setLocalPlanetInfoOverrides:(NSDictionary*) dict;
 
 - (void) preloadPlanetTexturesForSystem:(Random_Seed)seed;
 
+/*	Start preparing the sky, main planet and likely ship models of a system
+	the player is about to jump to; see OOSystemPrefetcher. Work is done
+	during updates for as long as the player's hyperspace countdown is
+	running, and is used by -setUpSpace if the player arrives there.
+*/
+- (void) prefetchSystem:(Random_Seed)seed;
+- (void) cancelSystemPrefetch;
+
+// Parts of -setUpSpace shared with OOSystemPrefetcher.
+- (NSString *) defaultStationRoleForSystem:(Random_Seed)seed techLevel:(unsigned)techlevel;
+- (SkyEntity *) newSkyWithSystemInfo:(NSDictionary *)systeminfo OO_RETURNS_RETAINED;	// Expects seed_for_planet_description() for the system.
+- (NSDictionary *) mainPlanetDictionaryForSystem:(Random_Seed)seed;
+
 - (NSDictionary *) planetInfo;
 
 - (NSArray *) equipmentData;
@@ -34,14 +34,24 @@ MA 02110-1301, USA.
 #import "OOSound.h"
 #import "OOColor.h"
 #import "OOCacheManager.h"
+#import "OOCache.h"
+#import "OOGalaxyRouteGraph.h"
+#import "OOSystemPrefetcher.h"
+#import "OOQualityController.h"
 #import "OOStringExpander.h"
 #import "OOStringParsing.h"
+#import "OOProfilingStopwatch.h"
 #import "OOCollectionExtractors.h"
 #import "OOConstToString.h"
 #import "OOOpenGLExtensionManager.h"
 #import "OOCPUInfo.h"
 #import "OOMaterial.h"
 #import "OOTexture.h"
+#import "OOMesh.h"
+#import "OOMeshInstanceBatch.h"
+#import "OOEffectBatch.h"
+#import "OORenderQueue.h"
+#import "OOShaderUniform.h"
 #import "OORoleSet.h"
 #import "OOShipGroup.h"
 
@@ -106,6 +116,27 @@ enum
 #define STANDARD_STATION_ROLL				0.4
 #define WOLFPACK_SHIPS_DISTANCE				0.1
 #define FIXED_ASTEROID_FIELDS				0
+#define SYSTEM_PREFETCH_INTERVAL			0.004	// Seconds per update spent preparing the hyperspace destination.
+#define DISTANT_SHIP_RANGE2					(4.0 * SCANNER_MAX_RANGE2)	// Twice scanner range, squared.
+
+
+enum
+{
+	kRouteCacheSize				= 512		// Enough for the chart, contracts and passenger screens in one galaxy.
+};
+
+
+/*	One per system in the current galaxy. The summary and the full system data
+	dictionary are filled in separately, since most callers only need one of
+	them, and both are dropped when the system's overrides change.
+*/
+struct OOSystemRecord
+{
+	OOSystemSummary			summary;
+	NSDictionary			*dictionary;
+	BOOL					summaryValid;
+};
+typedef struct OOSystemRecord OOSystemRecord;
 
 
 static NSString * const kOOLogUniversePopulate				= @"universe.populate";
@@ -124,8 +155,25 @@ static BOOL MaintainLinkedLists(Universe* uni);
 static OOComparisonResult compareName(id dict1, id dict2, void * context);
 static OOComparisonResult comparePrice(id dict1, id dict2, void * context);
 
-#undef CACHE_ROUTE_FROM_SYSTEM_RESULTS
 
+/*	A stellar body as seen from the viewpoint, for occlusion culling.
+	angularRadius is the angle between its centre and its limb.
+*/
+typedef struct
+{
+	Vector			direction;
+	GLfloat			distance;
+	GLfloat			angularRadius;
+} OOOccluder;
+
+
+static BOOL IsCullable(Entity *entity, PlayerEntity *player);
+static void SpheresIntersectFrustum(const GLfloat *x, const GLfloat *y, const GLfloat *z, const GLfloat *radii, int count, GLfloat frustum[6][4], uint8_t *outInside);
+static BOOL SphereIsOccluded(Vector offset, GLfloat radius, const OOOccluder *occluders, unsigned occluderCount);
+static void AddOccluder(OOOccluder *occluders, unsigned *count, Entity *body, Vector viewpoint);
+
+#ifndef NDEBUG
+// The route search used before OOGalaxyRouteGraph, kept for -routingBenchmarkWithOriginCount:.
 @interface RouteElement: NSObject
 {
 @private
@@ -164,6 +212,7 @@ static OOComparisonResult comparePrice(id dict1, id dict2, void * context);
 - (double) getTime { return _time; }
 
 @end
+#endif
 
 
 @interface Universe (OOPrivate)
@@ -177,6 +226,13 @@ static OOComparisonResult comparePrice(id dict1, id dict2, void * context);
 - (Vector) fractionalPositionFrom:(Vector)point0 to:(Vector)point1 withFraction:(double)routeFraction;
 
 - (void) resetSystemDataCache;
+- (OOSystemRecord *) systemRecordForSystem:(OOSystemID)sysID;
+- (void) resetSystemDataForPlanetKey:(NSString *)planetKey;
+
+- (void) setUpAtmosphericFog;
+- (int) cullEntities:(Entity **)entities count:(int)count viewpoint:(Vector)viewpoint;
+- (void) queueEntity:(Entity *)entity fogged:(BOOL)fogged sunlit:(BOOL)sunlit;
+- (void) drawRenderQueueTranslucent:(BOOL)translucent viewMatrix:(OOMatrix)viewMatrix viewOffset:(Vector)viewOffset;
 
 - (void) populateSpaceFromActiveWormholes;
 - (void) populateSpaceFromHyperPoint:(Vector)h1_pos toPlanetPosition:(Vector)p1_pos andSunPosition:(Vector)s1_pos;
@@ -198,6 +254,9 @@ static OOComparisonResult comparePrice(id dict1, id dict2, void * context);
 - (void) prunePreloadingPlanetMaterials;
 #endif
 
+- (void) updateSystemPrefetch;
+- (void) finishSystemPrefetch;
+
 - (void) filterOutNonStrictEquipment;
 - (BOOL) reinitAndShowDemo:(BOOL) showDemo strictChanged:(BOOL) strictChanged;
 
@@ -207,6 +266,8 @@ static OOComparisonResult comparePrice(id dict1, id dict2, void * context);
 - (void) setFirstBeacon:(Entity <OOBeaconEntity> *)beacon;
 - (void) setLastBeacon:(Entity <OOBeaconEntity> *)beacon;
 
+- (void) clearScannerNeighbourhood;
+
 - (void) verifyDescriptions;
 - (void) loadDescriptions;
 
@@ -296,6 +357,7 @@ GLfloat docked_light_specular[4]	= { DOCKED_ILLUM_LEVEL, DOCKED_ILLUM_LEVEL, DOC
 	autoSave = [prefs oo_boolForKey:@"autosave" defaultValue:NO];
 	wireframeGraphics = [prefs oo_boolForKey:@"wireframe-graphics" defaultValue:NO];
 	doProcedurallyTexturedPlanets = [prefs oo_boolForKey:@"procedurally-textured-planets" defaultValue:YES];
+	_qualityController = [[OOQualityController alloc] init];
 	
 	// Set up speech synthesizer.
 #if OOLITE_SPEECH_SYNTH
@@ -394,6 +456,16 @@ GLfloat docked_light_specular[4]	= { DOCKED_ILLUM_LEVEL, DOCKED_ILLUM_LEVEL, DOC
 	gSharedUniverse = nil;
 	
 	[currentMessage release];
+	[instanceBatch release];
+	[effectBatch release];
+	[renderQueue release];
+	[self clearScannerNeighbourhood];
+	[_routeCache release];
+	[_routeGraph release];
+	[_systemPrefetcher release];
+	[_qualityController release];
+	[self resetSystemDataCache];
+	free(_systemRecords);
 	
 	[gui release];
 	[message_gui release];
@@ -890,9 +962,16 @@ GLfloat docked_light_specular[4]	= { DOCKED_ILLUM_LEVEL, DOCKED_ILLUM_LEVEL, DOC
 	seed_for_planet_description(system_seed);
 	
 	Random_Seed systemSeed = [self systemSeed];
-	NSMutableDictionary *planetDict = [NSMutableDictionary dictionaryWithDictionary:[self generateSystemData:systemSeed]];
-	[planetDict oo_setBool:YES forKey:@"mainForLocalSystem"];
-	OOPlanetEntity *a_planet = [[OOPlanetEntity alloc] initFromDictionary:planetDict withAtmosphere:YES andSeed:systemSeed];
+	NSDictionary *planetDict = [self mainPlanetDictionaryForSystem:systemSeed];
+	OOPlanetEntity *a_planet = nil;
+	if (_systemPrefetcher != nil && equal_seeds([_systemPrefetcher systemSeed], systemSeed))
+	{
+		a_planet = [[_systemPrefetcher claimMainPlanetForDictionary:planetDict] retain];
+	}
+	if (a_planet == nil)
+	{
+		a_planet = [[OOPlanetEntity alloc] initFromDictionary:planetDict withAtmosphere:YES andSeed:systemSeed];
+	}
 	
 	double planet_radius = [a_planet radius];
 	double planet_zpos = (12.0 + (Ranrot() & 3) - (Ranrot() & 3) ) * planet_radius; // 9..15 pr (planet radii) ahead
@@ -929,6 +1008,13 @@ GLfloat docked_light_specular[4]	= { DOCKED_ILLUM_LEVEL, DOCKED_ILLUM_LEVEL, DOC
 	
 	Vector				vf;
 	
+#if !OOLITE_MAC_OS_X
+	// Building the system takes a while, so don't leave the last frame drawn unshown meanwhile.
+	[gameView presentPendingFrame];
+#endif
+	
+	[OOMesh forgetInstancingKeys];
+	
 	NSDictionary		*systeminfo = [self generateSystemData:system_seed useCache:NO];
 	unsigned			techlevel = [systeminfo oo_unsignedIntForKey:KEY_TECHLEVEL];
 	NSString			*stationDesc = nil, *defaultStationDesc = nil;
@@ -953,15 +1039,15 @@ GLfloat docked_light_specular[4]	= { DOCKED_ILLUM_LEVEL, DOCKED_ILLUM_LEVEL, DOC
 	seed_for_planet_description(system_seed);
 	
 	/*- the sky backdrop -*/
-	// colors...
-	float h1 = randf();
-	float h2 = h1 + 1.0 / (1.0 + (Ranrot() % 5));
-	while (h2 > 1.0)
-		h2 -= 1.0;
-	OOColor *col1 = [OOColor colorWithHue:h1 saturation:randf() brightness:0.5 + randf()/2.0 alpha:1.0];
-	OOColor *col2 = [OOColor colorWithHue:h2 saturation:0.5 + randf()/2.0 brightness:0.5 + randf()/2.0 alpha:1.0];
-	
-	thing = [[SkyEntity alloc] initWithColors:col1:col2 andSystemInfo: systeminfo];	// alloc retains!
+	thing = nil;
+	if (_systemPrefetcher != nil && equal_seeds([_systemPrefetcher systemSeed], system_seed))
+	{
+		thing = [[_systemPrefetcher claimSkyForSystemInfo:systeminfo] retain];
+	}
+	if (thing == nil)
+	{
+		thing = [self newSkyWithSystemInfo:systeminfo];
+	}
 	[thing setScanClass: CLASS_NO_DRAW];
 	[self addEntity:thing];
 	bgcolor = [(SkyEntity *)thing skyColor];
@@ -1083,18 +1169,7 @@ GLfloat docked_light_specular[4]	= { DOCKED_ILLUM_LEVEL, DOCKED_ILLUM_LEVEL, DOC
 	
 	stationPos = vector_subtract(stationPos, vector_multiply_scalar(vf, 2.0 * planet_radius));
 	
-	defaultStationDesc = @"coriolis";
-	if (techlevel > 10)
-	{
-		if (system_seed.f & 0x03)   // 3 out of 4 get this type
-		{
-			defaultStationDesc = @"dodecahedron";
-		}
-		else
-		{
-			defaultStationDesc = @"icosahedron";
-		}
-	}
+	defaultStationDesc = [self defaultStationRoleForSystem:system_seed techLevel:techlevel];
 	
 	//// possibly systeminfo has an override for the station
 	stationDesc = [systeminfo oo_stringForKey:@"station" defaultValue:defaultStationDesc];
@@ -1256,6 +1331,47 @@ GLfloat docked_light_specular[4]	= { DOCKED_ILLUM_LEVEL, DOCKED_ILLUM_LEVEL, DOC
 													   forTarget:nil];
 		OO_DEBUG_POP_PROGRESS();
 	}
+	
+	[self finishSystemPrefetch];
+}
+
+
+- (NSString *) defaultStationRoleForSystem:(Random_Seed)seed techLevel:(unsigned)techlevel
+{
+	if (techlevel > 10)
+	{
+		if (seed.f & 0x03)   // 3 out of 4 get this type
+		{
+			return @"dodecahedron";
+		}
+		else
+		{
+			return @"icosahedron";
+		}
+	}
+	return @"coriolis";
+}
+
+
+- (SkyEntity *) newSkyWithSystemInfo:(NSDictionary *)systeminfo
+{
+	// colors...
+	float h1 = randf();
+	float h2 = h1 + 1.0 / (1.0 + (Ranrot() % 5));
+	while (h2 > 1.0)
+		h2 -= 1.0;
+	OOColor *col1 = [OOColor colorWithHue:h1 saturation:randf() brightness:0.5 + randf()/2.0 alpha:1.0];
+	OOColor *col2 = [OOColor colorWithHue:h2 saturation:0.5 + randf()/2.0 brightness:0.5 + randf()/2.0 alpha:1.0];
+	
+	return [[SkyEntity alloc] initWithColors:col1:col2 andSystemInfo:systeminfo];
+}
+
+
+- (NSDictionary *) mainPlanetDictionaryForSystem:(Random_Seed)seed
+{
+	NSMutableDictionary *planetDict = [NSMutableDictionary dictionaryWithDictionary:[self generateSystemData:seed]];
+	[planetDict oo_setBool:YES forKey:@"mainForLocalSystem"];
+	return planetDict;
 }
 
 
@@ -3418,7 +3534,176 @@ static BOOL IsFriendlyStationPredicate(Entity *entity, void *parameter)
 		}
 		
 		object_light_on = isLit;
+		OOCountRenderStateChange(kOORenderStateChangeLighting);
+	}
+}
+
+
+- (void) setUpAtmosphericFog
+{
+	GLfloat fogScale = BILLBOARD_DEPTH * 0.5 / airResistanceFactor;
+	
+	OOGL(glEnable(GL_FOG));
+	OOGLLinearFog(fogScale * 0.5, fogScale);
+	OOGLFogColor(skyClearColor);
+}
+
+
+/*	The frame's single culling pass, after -defineFrustum. Ships and visual
+	effects outside the view frustum, or hidden behind a planet or the sun,
+	are removed from entities, which is compacted in place in the same
+	order; the rest are stamped as visible. Returns the new count. Nothing
+	is culled in demo ship mode, but the stamp still changes.
+*/
+- (int) cullEntities:(Entity **)entities count:(int)count viewpoint:(Vector)viewpoint
+{
+	PlayerEntity	*player = PLAYER;
+	uint32_t		stamp = ++_cullFrameStamp;
+	
+	_frustumCulledCount = 0;
+	_occludedCount = 0;
+	_visibleEntityCount = count;
+	if ([player showDemoShips] || count == 0)  return count;
+	
+	int				i, kept = 0, cullableCount = 0;
+	BOOL			cullable[count];
+	GLfloat			x[count], y[count], z[count], radii[count];
+	uint8_t			inside[count];
+	
+	for (i = 0; i < count; i++)
+	{
+		Entity *entity = entities[i];
+		cullable[i] = IsCullable(entity, player);
+		if (cullable[i])
+		{
+			x[cullableCount] = entity->position.x;
+			y[cullableCount] = entity->position.y;
+			z[cullableCount] = entity->position.z;
+			radii[cullableCount] = [(OOEntityWithDrawable *)entity viewCullingRadius];
+			cullableCount++;
+		}
+	}
+	
+	SpheresIntersectFrustum(x, y, z, radii, cullableCount, frustum, inside);
+	
+	OOOccluder		occluders[[allPlanets count] + 1];
+	unsigned		occluderCount = 0;
+	NSEnumerator	*planetEnum = nil;
+	Entity			*planet = nil;
+	for (planetEnum = [allPlanets objectEnumerator]; (planet = [planetEnum nextObject]); )
+	{
+		AddOccluder(occluders, &occluderCount, planet, viewpoint);
+	}
+	if (cachedSun != nil)  AddOccluder(occluders, &occluderCount, cachedSun, viewpoint);
+	
+	int c = 0;
+	for (i = 0; i < count; i++)
+	{
+		Entity *entity = entities[i];
+		if (cullable[i])
+		{
+			Vector offset = make_vector(x[c] - viewpoint.x, y[c] - viewpoint.y, z[c] - viewpoint.z);
+			BOOL inView = inside[c];
+			GLfloat radius = radii[c];
+			c++;
+			
+			if (!inView)
+			{
+				_frustumCulledCount++;
+				continue;
+			}
+			if (occluderCount != 0 && SphereIsOccluded(offset, radius, occluders, occluderCount))
+			{
+				_occludedCount++;
+				continue;
+			}
+			entity->visibleFrameStamp = stamp;
+		}
+		entities[kept++] = entity;
+	}
+	
+	_visibleEntityCount = kept;
+	return kept;
+}
+
+
+- (void) queueEntity:(Entity *)entity fogged:(BOOL)fogged sunlit:(BOOL)sunlit
+{
+	/*	Ships and visual effects only depend on the depth buffer, and may be
+		reordered. Everything else (the player, sky, dust, stellar bodies)
+		may rely on painter's order or change fog state itself.
+	*/
+	BOOL sortable = entity != PLAYER && ([entity isShip] || [entity isVisualEffect]);
+	NSUInteger stateKey = sortable ? [[(OOEntityWithDrawable *)entity drawable] renderStateKey] : 0;
+	
+	[renderQueue addEntity:entity
+				  stateKey:stateKey
+					 depth:entity->cam_zero_distance
+					sunlit:sunlit
+					fogged:fogged
+				  sortable:sortable];
+}
+
+
+- (void) drawRenderQueueTranslucent:(BOOL)translucent viewMatrix:(OOMatrix)viewMatrix viewOffset:(Vector)viewOffset
+{
+	const OORenderQueueItem	*items = [renderQueue items];
+	NSUInteger				i, count = [renderQueue count];
+	PlayerEntity			*player = PLAYER;
+	GLfloat 				flat_ambdiff[4]	= {1.0, 1.0, 1.0, 1.0};   // for alpha
+	GLfloat 				mat_no[4]		= {0.0, 0.0, 0.0, 1.0};   // nothing
+	int						fogState = 0;	// -1 if unknown.
+	
+	for (i = 0; i < count; i++)
+	{
+		const OORenderQueueItem *item = &items[i];
+		Entity *drawthing = item->entity;
+		
+		if (!translucent)
+		{
+			// reset material properties
+			// FIXME: should be part of SetState
+			OOGL(glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, flat_ambdiff));
+			OOGL(glMaterialfv(GL_FRONT_AND_BACK, GL_EMISSION, mat_no));
+		}
+		
+		// atmospheric fog
+		if (fogState != item->fogged)
+		{
+			if (item->fogged)  [self setUpAtmosphericFog];
+			else  OOGL(glDisable(GL_FOG));
+			fogState = item->fogged;
+			OOCountRenderStateChange(kOORenderStateChangeFog);
+		}
+		
+		OOGL(glPushMatrix());
+		if (EXPECT(drawthing != player))
+		{
+			//translate the object
+			GLTranslateOOVector([drawthing position]);
+			//rotate the object
+			GLMultOOMatrix([drawthing drawRotationMatrix]);
+		}
+		else
+		{
+			// Load transformation matrix
+			GLLoadOOMatrix(viewMatrix);
+			//translate the object  from the viewpoint
+			GLTranslateOOVector(vector_flip(viewOffset));
+		}
+		
+		if (!translucent)  [self lightForEntity:item->sunlit];
+		
+		// draw the thing
+		[drawthing drawImmediate:false translucent:translucent];
+		
+		OOGL(glPopMatrix());
+		
+		// Unsortable entities may have set up their own fog.
+		if (!item->sortable)  fogState = -1;
 	}
+	
+	if (fogState != 0)  OOGL(glDisable(GL_FOG));
 }
 
 
@@ -3642,6 +3927,116 @@ static const OOMatrix	starboard_matrix =
 }
 
 
+- (uint32_t) cullFrameStamp
+{
+	return _cullFrameStamp;
+}
+
+
+- (NSUInteger) visibleEntityCount
+{
+	return _visibleEntityCount;
+}
+
+
+- (NSUInteger) frustumCulledEntityCount
+{
+	return _frustumCulledCount;
+}
+
+
+- (NSUInteger) occludedEntityCount
+{
+	return _occludedCount;
+}
+
+
+/*	Ships and visual effects are culled; everything else is either always
+	drawn or does its own tests. These are the entities that
+	-[OOEntityWithDrawable isInDrawRange] tests against the frustum.
+*/
+static BOOL IsCullable(Entity *entity, PlayerEntity *player)
+{
+	return ([entity isShip] || [entity isVisualEffect]) &&
+		   entity != player &&
+		   entity->no_draw_distance != INFINITY &&
+		   !entity->isImmuneToBreakPatternHide &&
+		   [entity status] != STATUS_COCKPIT_DISPLAY;
+}
+
+
+/*	Same test as -viewFrustumIntersectsSphereAt:withRadius:, over flat arrays
+	one plane at a time so that the inner loop vectorizes.
+*/
+static void SpheresIntersectFrustum(const GLfloat *x, const GLfloat *y, const GLfloat *z, const GLfloat *radii, int count, GLfloat frustum[6][4], uint8_t *outInside)
+{
+	int i, p;
+	
+	for (i = 0; i < count; i++)  outInside[i] = 1;
+	
+	for (p = 0; p < 6; p++)
+	{
+		GLfloat a = frustum[p][0], b = frustum[p][1], c = frustum[p][2], d = frustum[p][3];
+		for (i = 0; i < count; i++)
+		{
+			outInside[i] &= (a * x[i] + b * y[i] + c * z[i] + d > -radii[i]);
+		}
+	}
+}
+
+
+/*	A sphere is hidden by a body if all of it is further away than the body's
+	centre and inside the body's silhouette: any line of sight to it then
+	enters the body first.
+*/
+static BOOL SphereIsOccluded(Vector offset, GLfloat radius, const OOOccluder *occluders, unsigned occluderCount)
+{
+	GLfloat range = magnitude(offset);
+	if (range <= radius)  return NO;
+	
+	Vector direction = vector_multiply_scalar(offset, 1.0f / range);
+	GLfloat angularRadius = asinf(radius / range);
+	unsigned i;
+	
+	for (i = 0; i < occluderCount; i++)
+	{
+		const OOOccluder *occluder = &occluders[i];
+		if (range - radius <= occluder->distance || angularRadius >= occluder->angularRadius)  continue;
+		
+		GLfloat separation = acosf(fminf(fmaxf(dot_product(direction, occluder->direction), -1.0f), 1.0f));
+		if (separation + angularRadius < occluder->angularRadius)  return YES;
+	}
+	
+	return NO;
+}
+
+
+static void AddOccluder(OOOccluder *occluders, unsigned *count, Entity *body, Vector viewpoint)
+{
+	Vector offset = vector_subtract([body position], viewpoint);
+	GLfloat range = magnitude(offset);
+	GLfloat radius = body->collision_radius;
+	if (range <= radius)  return;
+	
+	occluders[*count].direction = vector_multiply_scalar(offset, 1.0f / range);
+	occluders[*count].distance = range;
+	occluders[*count].angularRadius = asinf(radius / range);
+	(*count)++;
+}
+
+
+- (OOEffectBatch *) effectBatch
+{
+	return effectBatch;
+}
+
+
+- (OOQualityController *) qualityController
+{
+	return _qualityController;
+}
+
+
 - (void) drawUniverse
 {
 	OOLog(@"universe.profile.draw",@"Begin draw");
@@ -3669,6 +4064,14 @@ static const OOMatrix	starboard_matrix =
 			}
 			wasDisplayGUI = displayGUI;
 			
+			// Only frames in flight say anything about the cost of the scene.
+			if (displayGUI)  [_qualityController suspendTiming];
+			else  [_qualityController frameDidBegin];
+			
+#ifndef NDEBUG
+			OOGLResetStateCacheStatistics();
+#endif
+			
 			// use a non-mutable copy so this can't be changed under us.
 			for (i = 0; i < ent_count; i++)
 			{
@@ -3746,10 +4149,8 @@ static const OOMatrix	starboard_matrix =
 				
 				int			furthest = draw_count - 1;
 				int			nearest = 0;
-				BOOL		fogging, bpHide = [self breakPatternHide];
+				BOOL		bpHide = [self breakPatternHide];
 				BOOL		inAtmosphere = airResistanceFactor > 0.01;
-				GLfloat		fogFactor = 0.5 / airResistanceFactor;
-				double 		fog_scale, half_scale;
 				GLfloat 	flat_ambdiff[4]	= {1.0, 1.0, 1.0, 1.0};   // for alpha
 				GLfloat 	mat_no[4]		= {0.0, 0.0, 0.0, 1.0};   // nothing			
 				
@@ -3757,12 +4158,31 @@ static const OOMatrix	starboard_matrix =
 				
 				[self defineFrustum]; // camera is set up for this frame
 				
+				// Both passes draw from the culled list.
+				draw_count = [self cullEntities:my_entities count:draw_count viewpoint:position];
+				furthest = draw_count - 1;
+				
 				OOVerifyOpenGLState();
 				OOCheckOpenGLErrors(@"Universe after setting up for opaque pass");
 				OOLog(@"universe.profile.draw",@"Begin opaque pass");
-
 				
-				//		DRAW ALL THE OPAQUE ENTITIES
+				[OOMesh resetDrawStatistics];
+#if !NEW_PLANETS
+				[PlanetEntity resetDrawStatistics];
+#endif
+#if OO_SHADERS
+				[OOShaderUniform resetUploadStatistics];
+#endif
+				OOResetRenderStateChangeCounts();
+				
+				// Ships sharing a model and materials are collected and drawn together after the loop.
+				BOOL batchInstances = !demoShipMode && !wireframeGraphics;
+				if (batchInstances && instanceBatch == nil)  instanceBatch = [[OOMeshInstanceBatch alloc] init];
+				
+				if (renderQueue == nil)  renderQueue = [[OORenderQueue alloc] init];
+				
+				//		QUEUE ALL THE OPAQUE ENTITIES
+				[renderQueue removeAllItems];
 				for (i = furthest; i >= nearest; i--)
 				{
 					drawthing = my_entities[i];
@@ -3770,64 +4190,67 @@ static const OOMatrix	starboard_matrix =
 					
 					if (bpHide && !drawthing->isImmuneToBreakPatternHide)  continue;
 					
-					if (!((d_status == STATUS_COCKPIT_DISPLAY) ^ demoShipMode)) // either demo ship mode or in flight
+					if (batchInstances && [drawthing isShip] && d_status != STATUS_COCKPIT_DISPLAY)
 					{
-						// reset material properties
-						// FIXME: should be part of SetState
-						OOGL(glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, flat_ambdiff));
-						OOGL(glMaterialfv(GL_FRONT_AND_BACK, GL_EMISSION, mat_no));
-						
-						OOGL(glPushMatrix());
-						if (EXPECT(drawthing != player))
+						ShipEntity *ship = (ShipEntity *)drawthing;
+						OOMesh *mesh = [ship meshForInstancedDrawing];
+						if (mesh != nil)
 						{
-							//translate the object
-							GLTranslateOOVector([drawthing position]);
-							//rotate the object
-							GLMultOOMatrix([drawthing drawRotationMatrix]);
-						}
-						else
-						{
-							// Load transformation matrix
-							GLLoadOOMatrix(view_matrix);
-							//translate the object  from the viewpoint
-							GLTranslateOOVector(vector_flip(viewOffset));
-						}
-						
-						// atmospheric fog
-						fogging = (inAtmosphere && ![drawthing isStellarObject]);
-						
-						if (fogging)
-						{
-							fog_scale = BILLBOARD_DEPTH * fogFactor;
-							half_scale = fog_scale * 0.50;
-							OOGL(glEnable(GL_FOG));
-							OOGL(glFogi(GL_FOG_MODE, GL_LINEAR));
-							OOGL(glFogfv(GL_FOG_COLOR, skyClearColor));
-							OOGL(glFogf(GL_FOG_START, half_scale));
-							OOGL(glFogf(GL_FOG_END, fog_scale));
-						}
-						
-						[self lightForEntity:demoShipMode || drawthing->isSunlit];
-						
-						// draw the thing
-						[drawthing drawImmediate:false translucent:false];
-						
-						// atmospheric fog
-						if (fogging)
-						{
-							OOGL(glDisable(GL_FOG));
+							if ([ship isInDrawRange])
+							{
+								OOMatrix transform = OOMatrixTranslate([ship drawRotationMatrix], [ship position]);
+								if ([instanceBatch addMesh:mesh transform:transform sunlit:ship->isSunlit])  continue;
+							}
+							else  continue;
 						}
-						
-						OOGL(glPopMatrix());
+					}
+					
+					if (!((d_status == STATUS_COCKPIT_DISPLAY) ^ demoShipMode)) // either demo ship mode or in flight
+					{
+						[self queueEntity:drawthing fogged:inAtmosphere && ![drawthing isStellarObject] sunlit:demoShipMode || drawthing->isSunlit];
 					}
 				}
 				
+				//		DRAW ALL THE OPAQUE ENTITIES
+				[renderQueue sortForStateChanges];
+				[self drawRenderQueueTranslucent:NO viewMatrix:view_matrix viewOffset:viewOffset];
+				
+				//		DRAW BATCHED INSTANCES
+				if ([instanceBatch instanceCount] != 0)
+				{
+					OOGL(glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, flat_ambdiff));
+					OOGL(glMaterialfv(GL_FRONT_AND_BACK, GL_EMISSION, mat_no));
+					
+					if (inAtmosphere)  [self setUpAtmosphericFog];
+					
+					[self lightForEntity:YES];
+					[instanceBatch renderOpaquePartsSunlit:YES];
+					[self lightForEntity:NO];
+					[instanceBatch renderOpaquePartsSunlit:NO];
+					
+					if (inAtmosphere)
+					{
+						OOGL(glDisable(GL_FOG));
+					}
+				}
+				[instanceBatch removeAllInstances];
+				
 				//		DRAW ALL THE TRANSLUCENT entsInDrawOrder
 				
 				OOSetOpenGLState(OPENGL_STATE_TRANSLUCENT_PASS);  // FIXME: should be redundant.
 				
 				OOCheckOpenGLErrors(@"Universe after setting up for translucent pass");
 				OOLog(@"universe.profile.draw",@"Begin translucent pass");
+				
+				// Additive effects add themselves to the effect batch while the translucent queue is drawn, and are drawn together after it.
+				if (!demoShipMode)
+				{
+					if (effectBatch == nil)  effectBatch = [[OOEffectBatch alloc] init];
+					[effectBatch beginWithOrigin:position];
+				}
+				
+				// Not sorted: translucent parts must be drawn back to front, which is the order they're queued in.
+				[renderQueue removeAllItems];
 				for (i = furthest; i >= nearest; i--)
 				{
 					drawthing = my_entities[i];
@@ -3837,52 +4260,29 @@ static const OOMatrix	starboard_matrix =
 					
 					if (!((d_status == STATUS_COCKPIT_DISPLAY) ^ demoShipMode)) // either in flight or in demo ship mode
 					{
-						
-						OOGL(glPushMatrix());
-						if (EXPECT(drawthing != player))
-						{
-							//translate the object
-							GLTranslateOOVector([drawthing position]);
-							//rotate the object
-							GLMultOOMatrix([drawthing drawRotationMatrix]);
-						}
-						else
-						{
-							// Load transformation matrix
-							GLLoadOOMatrix(view_matrix);
-							//translate the object  from the viewpoint
-							GLTranslateOOVector(vector_flip(viewOffset));
-						}
-						
 						// experimental - atmospheric fog
-						fogging = inAtmosphere;
-						
-						if (fogging)
-						{
-							fog_scale = BILLBOARD_DEPTH * fogFactor;
-							half_scale = fog_scale * 0.50;
-							OOGL(glEnable(GL_FOG));
-							OOGL(glFogi(GL_FOG_MODE, GL_LINEAR));
-							OOGL(glFogfv(GL_FOG_COLOR, skyClearColor));
-							OOGL(glFogf(GL_FOG_START, half_scale));
-							OOGL(glFogf(GL_FOG_END, fog_scale));
-						}
-						
-						// draw the thing
-						[drawthing drawImmediate:false translucent:true];
-						
-						// atmospheric fog
-						if (fogging)
-						{
-							OOGL(glDisable(GL_FOG));
-						}
-						
-						OOGL(glPopMatrix());
+						[self queueEntity:drawthing fogged:inAtmosphere sunlit:drawthing->isSunlit];
+					}
+				}
+				[self drawRenderQueueTranslucent:YES viewMatrix:view_matrix viewOffset:viewOffset];
+				[renderQueue removeAllItems];
+				
+				//		DRAW BATCHED EFFECTS
+				if ([OOEffectBatch activeBatch] != nil)
+				{
+					if (inAtmosphere)  [self setUpAtmosphericFog];
+					
+					[effectBatch drawAndEnd];
+					
+					if (inAtmosphere)
+					{
+						OOGL(glDisable(GL_FOG));
 					}
 				}
 			}
 			
 			OOGL(glPopMatrix()); //restore saved flat viewpoint
+			OOSnapshotRenderStateChangeCounts();
 			
 			OOCheckOpenGLErrors(@"Universe after drawing entities");
 			OOLog(@"universe.profile.draw",@"Begin HUD");
@@ -3948,6 +4348,7 @@ static const OOMatrix	starboard_matrix =
 		@catch (NSException *exception)
 		{
 			no_update = NO;	// make sure we don't get stuck in all subsequent frames.
+			[instanceBatch removeAllInstances];	// Don't carry this frame's ships into the next.
 			
 			if ([[exception name] hasPrefix:@"Oolite"])
 			{
@@ -4307,6 +4708,12 @@ static BOOL MaintainLinkedLists(Universe *uni)
 			doLinkedListMaintenanceThisUpdate = YES;
 		}
 		
+		if (![entity isStellarObject])
+		{
+			_maxScannerEntityRadius = fmax(_maxScannerEntityRadius, entity->collision_radius);
+		}
+		_scannerNeighbourhoodValid = NO;
+		
 		if ([entity isWormhole])
 		{
 			[activeWormholes addObject:entity];
@@ -4384,6 +4791,9 @@ static BOOL MaintainLinkedLists(Universe *uni)
 	// maintain sorted list
 	n_entities = 1;
 	
+	[self clearScannerNeighbourhood];
+	_maxScannerEntityRadius = 0.0f;
+	
 	cachedSun = nil;
 	cachedPlanet = nil;
 	cachedStation = nil;
@@ -4791,18 +5201,8 @@ static BOOL MaintainLinkedLists(Universe *uni)
 	Entity			*hit_entity = nil;
 	OOScalar		nearest2 = SCANNER_MAX_RANGE - 100;	// 100m shorter than range at which target is lost
 	nearest2 *= nearest2;
-	int				i;
-	int				ent_count = n_entities;
-	int				ship_count = 0;
-	Entity			*my_entities[ent_count];
-	
-	for (i = 0; i < ent_count; i++)
-	{
-		if (([sortedEntities[i] isShip] && ![sortedEntities[i] isPlayer]) || [sortedEntities[i] isWormhole])
-		{
-			my_entities[ship_count++] = [sortedEntities[i] retain];
-		}
-	}
+	NSUInteger		i, neighbour_count;
+	Entity * const	*neighbours = [self scannerNeighbourhoodWithCount:&neighbour_count];
 	
 	Quaternion q1 = [player normalOrientation];
 	Vector u1, f1, r1;
@@ -4828,9 +5228,11 @@ static BOOL MaintainLinkedLists(Universe *uni)
 	}
 	basis_vectors_from_quaternion(q1, &r1, NULL, &f1);
 	
-	for (i = 0; i < ship_count; i++)
+	for (i = 0; i < neighbour_count; i++)
 	{
-		Entity *e2 = my_entities[i];
+		Entity *e2 = neighbours[i];
+		if (!([e2 isShip] || [e2 isWormhole]))  continue;
+		
 		if ([e2 canCollide] && [e2 scanClass] != CLASS_NO_DRAW)
 		{
 			Vector rp = vector_subtract([e2 position], p1);
@@ -4862,12 +5264,69 @@ static BOOL MaintainLinkedLists(Universe *uni)
 		}
 	}
 	
-	for (i = 0; i < ship_count; i++)
+	return hit_entity;
+}
+
+
+- (Entity * const *) scannerNeighbourhoodWithCount:(NSUInteger *)outCount
+{
+	NSParameterAssert(outCount != NULL);
+	
+	if (!_scannerNeighbourhoodValid)
 	{
-		[my_entities[i] release];
+		[self clearScannerNeighbourhood];
+		
+		OOScalar		cutoff = SCANNER_MAX_RANGE + _maxScannerEntityRadius;
+		OOScalar		cutoff2 = cutoff * cutoff;
+		unsigned		i;
+		
+		/*	sortedEntities is only bubbled one step at a time as entities
+			move, so it isn't exactly ordered and the whole list must be
+			walked. The cutoff rejects most entities without a message send.
+		*/
+		for (i = 0; i < n_entities; i++)
+		{
+			Entity *e = sortedEntities[i];
+			OOScalar zd = e->zero_distance;
+			if (!(zd <= cutoff2) || [e isPlayer] || [e isStellarObject])  continue;
+			
+			OOScalar reach = SCANNER_MAX_RANGE + e->collision_radius;
+			if (zd <= reach * reach)
+			{
+				_scannerNeighbours[_scannerNeighbourCount++] = [e retain];
+			}
+		}
+		
+		// Stellar bodies are rare, and mass lock by their own size rather than by scanner range.
+		NSEnumerator	*planetEnum = nil;
+		Entity			*planet = nil;
+		for (planetEnum = [allPlanets objectEnumerator]; (planet = [planetEnum nextObject]) && _scannerNeighbourCount < UNIVERSE_MAX_ENTITIES; )
+		{
+			_scannerNeighbours[_scannerNeighbourCount++] = [planet retain];
+		}
+		if (cachedSun != nil && _scannerNeighbourCount < UNIVERSE_MAX_ENTITIES)
+		{
+			_scannerNeighbours[_scannerNeighbourCount++] = [cachedSun retain];
+		}
+		
+		_scannerNeighbourhoodValid = YES;
 	}
 	
-	return hit_entity;
+	*outCount = _scannerNeighbourCount;
+	return _scannerNeighbours;
+}
+
+
+- (void) clearScannerNeighbourhood
+{
+	NSUInteger i;
+	for (i = 0; i < _scannerNeighbourCount; i++)
+	{
+		[_scannerNeighbours[i] release];
+		_scannerNeighbours[i] = nil;
+	}
+	_scannerNeighbourCount = 0;
+	_scannerNeighbourhoodValid = NO;
 }
 
 
@@ -5725,6 +6184,8 @@ OOINLINE BOOL EntityInRange(Vector p1, Entity *e2, float range)
 			
 			update_stage = @"update:entity";
 			NSMutableSet *zombies = nil;
+			unsigned distantUpdateInterval = [_qualityController distantShipUpdateInterval];
+			_distantUpdatePhase++;
 			OOLog(@"universe.profile.update", @"%@", update_stage);
 			for (i = 0; i < ent_count; i++)
 			{
@@ -5741,7 +6202,21 @@ OOINLINE BOOL EntityInRange(Vector p1, Entity *e2, float range)
 					continue;
 				}
 				
-				[thing update:delta_t];
+				/*	Under load, ships too far away to be on the scanner or seen
+					as more than a dot are updated every few frames, staggered
+					by ID, and catch up on the time they missed when they are.
+				*/
+				if (distantUpdateInterval > 1 && thing->zero_distance > DISTANT_SHIP_RANGE2 &&
+					(thing->universalID + _distantUpdatePhase) % distantUpdateInterval != 0 &&
+					[thing isShip] && ![thing isPlayer] && ![thing isStation])
+				{
+					thing->deferredUpdateTime += delta_t;
+					continue;
+				}
+				
+				OOTimeDelta thingDeltaT = delta_t + thing->deferredUpdateTime;
+				thing->deferredUpdateTime = 0.0;
+				[thing update:thingDeltaT];
 				if (EXPECT_NOT(sessionID != _sessionID))
 				{
 					// Game was reset (in player update); end this update: cycle.
@@ -5799,6 +6274,9 @@ OOINLINE BOOL EntityInRange(Vector p1, Entity *e2, float range)
 				}
 			}
 			
+			// Entities have moved, so the scanner neighbourhood must be gathered again.
+			_scannerNeighbourhoodValid = NO;
+			
 			// Maintain x/y/z order lists
 			update_stage = @"updating linked lists";
 			OOLog(@"universe.profile.update", @"%@", update_stage);
@@ -5821,6 +6299,13 @@ OOINLINE BOOL EntityInRange(Vector p1, Entity *e2, float range)
 				MaintainLinkedLists(self);
 				doLinkedListMaintenanceThisUpdate = NO;
 			}
+			
+			if (_systemPrefetcher != nil)
+			{
+				update_stage = @"system prefetch";
+				OOLog(@"universe.profile.update", @"%@", update_stage);
+				[self updateSystemPrefetch];
+			}
 		}
 		@catch (NSException *exception)
 		{
@@ -6418,19 +6903,28 @@ OOINLINE BOOL EntityInRange(Vector p1, Entity *e2, float range)
 	
 	if (!equal_seeds(galaxy_seed, gal_seed) || forced) {
 		galaxy_seed = gal_seed;
+		DESTROY(_routeCache);
+		DESTROY(_routeGraph);
+		DESTROY(_systemPrefetcher);
 		
 		// systems
 		for (i = 0; i < 256; i++)
 		{
-			pool = [[NSAutoreleasePool alloc] init];
-			
 			systems[i] = g_seed;
-			if (system_names[i])	[system_names[i] release];
-			system_names[i] = [[self getSystemName:g_seed] retain];
 			rotate_seed(&g_seed);
 			rotate_seed(&g_seed);
 			rotate_seed(&g_seed);
 			rotate_seed(&g_seed);
+		}
+		
+		// Names come from the system summaries, which are looked up by seed, so all seeds must be in place first.
+		[self resetSystemDataCache];
+		for (i = 0; i < 256; i++)
+		{
+			pool = [[NSAutoreleasePool alloc] init];
+			
+			if (system_names[i])	[system_names[i] release];
+			system_names[i] = [[self getSystemName:systems[i]] retain];
 			
 			[pool release];
 		}
@@ -6674,27 +7168,26 @@ static void VerifyDesc(NSString *key, id desc)
 }
 
 
-static NSDictionary	*sCachedSystemData = nil;
+enum
+{
+	kSystemDataOverrideLevels	= 3
+};
 
 
-- (NSDictionary *) generateSystemData:(Random_Seed) s_seed useCache:(BOOL) useCache
+static id SystemDataOverride(NSDictionary * const overrides[kSystemDataOverrideLevels], NSString *key)
 {
-	OOJS_PROFILE_ENTER
-	
-	static Random_Seed	cachedSeed = {0};
-	
-	if (useCache)
+	unsigned i;
+	for (i = 0; i < kSystemDataOverrideLevels; i++)
 	{
-		// Cache hit ratio is over 95% during respawn, about 80% during initial set-up.
-		if (EXPECT(sCachedSystemData != nil && equal_seeds(cachedSeed, s_seed)))  return [[sCachedSystemData retain] autorelease];
+		id value = [overrides[i] objectForKey:key];
+		if (value != nil)  return value;
 	}
-	
-	DESTROY(sCachedSystemData);
-	cachedSeed = s_seed;
-	
-	RNG_Seed saved_seed = currentRandomSeed();
-	NSMutableDictionary *systemdata = [[NSMutableDictionary alloc] init];
-	
+	return nil;
+}
+
+
+static void GetUnmodifiedSystemSummary(Random_Seed s_seed, OOSystemSummary *summary)
+{
 	OOGovernmentID government = (s_seed.c / 8) & 7;
 	
 	OOEconomyID economy = s_seed.b & 7;
@@ -6709,6 +7202,32 @@ static NSDictionary	*sCachedSystemData = nil;
 	
 	unsigned radius = (((s_seed.f & 15) + 11) * 256) + s_seed.d;
 	
+	summary->government = government;
+	summary->economy = economy;
+	summary->techLevel = techlevel;
+	summary->population = population;
+	summary->productivity = productivity;
+	summary->radius = radius;
+}
+
+
+- (NSDictionary *) generateSystemData:(Random_Seed) s_seed useCache:(BOOL) useCache
+{
+	OOJS_PROFILE_ENTER
+	
+	OOSystemRecord *record = [self systemRecordForSystem:[self systemIDForSystemSeed:s_seed]];
+	
+	if (useCache && record != NULL && record->dictionary != nil)
+	{
+		return [[record->dictionary retain] autorelease];
+	}
+	
+	RNG_Seed saved_seed = currentRandomSeed();
+	NSMutableDictionary *systemdata = [[NSMutableDictionary alloc] init];
+	
+	OOSystemSummary base;
+	GetUnmodifiedSystemSummary(s_seed, &base);
+	
 	NSString *name = [self generateSystemName:s_seed];
 	NSString *inhabitant = [self generateSystemInhabitants:s_seed plural:NO];
 	NSString *inhabitants = [self generateSystemInhabitants:s_seed plural:YES];
@@ -6716,12 +7235,12 @@ static NSDictionary	*sCachedSystemData = nil;
 	
 	NSString *override_key = [self keyForPlanetOverridesForSystemSeed:s_seed inGalaxySeed:galaxy_seed];
 	
-	[systemdata oo_setUnsignedInteger:government	forKey:KEY_GOVERNMENT];
-	[systemdata oo_setUnsignedInteger:economy		forKey:KEY_ECONOMY];
-	[systemdata oo_setUnsignedInteger:techlevel		forKey:KEY_TECHLEVEL];
-	[systemdata oo_setUnsignedInteger:population	forKey:KEY_POPULATION];
-	[systemdata oo_setUnsignedInteger:productivity	forKey:KEY_PRODUCTIVITY];
-	[systemdata oo_setUnsignedInteger:radius		forKey:KEY_RADIUS];
+	[systemdata oo_setUnsignedInteger:base.government	forKey:KEY_GOVERNMENT];
+	[systemdata oo_setUnsignedInteger:base.economy		forKey:KEY_ECONOMY];
+	[systemdata oo_setUnsignedInteger:base.techLevel	forKey:KEY_TECHLEVEL];
+	[systemdata oo_setUnsignedInteger:base.population	forKey:KEY_POPULATION];
+	[systemdata oo_setUnsignedInteger:base.productivity	forKey:KEY_PRODUCTIVITY];
+	[systemdata oo_setUnsignedInteger:base.radius		forKey:KEY_RADIUS];
 	[systemdata setObject:name						forKey:KEY_NAME];
 	[systemdata setObject:inhabitant				forKey:KEY_INHABITANT];
 	[systemdata setObject:inhabitants				forKey:KEY_INHABITANTS];
@@ -6744,15 +7263,72 @@ static NSDictionary	*sCachedSystemData = nil;
 		[systemdata setObject:OOGenerateSystemDescription(s_seed, [systemdata oo_stringForKey:KEY_NAME]) forKey:KEY_DESCRIPTION];
 	}
 	if (useCache) setRandomSeed(saved_seed);
-	sCachedSystemData = [systemdata copy];
+	
+	NSDictionary *result = [[systemdata copy] autorelease];
 	[systemdata release];
 	
-	return sCachedSystemData;
+	if (record != NULL)
+	{
+		[record->dictionary release];
+		record->dictionary = [result retain];
+	}
+	
+	return result;
 	
 	OOJS_PROFILE_EXIT
 }
 
 
+- (OOSystemSummary) systemSummaryForSystem:(OOSystemID)sysID
+{
+	OOSystemRecord *record = [self systemRecordForSystem:sysID];
+	if (EXPECT_NOT(record == NULL))
+	{
+		OOSystemSummary none = {0};
+		return none;
+	}
+	
+	if (!record->summaryValid)
+	{
+		OOSystemSummary *summary = &record->summary;
+		Random_Seed s_seed = systems[sysID];
+		NSString *override_key = [self keyForPlanetOverridesForSystemSeed:s_seed inGalaxySeed:galaxy_seed];
+		
+		// Highest priority first; -generateSystemData: merges them in the opposite order.
+		NSDictionary *overrides[kSystemDataOverrideLevels] =
+		{
+			[localPlanetInfoOverrides oo_dictionaryForKey:override_key],
+			[planetInfo oo_dictionaryForKey:override_key],
+			[planetInfo oo_dictionaryForKey:PLANETINFO_UNIVERSAL_KEY]
+		};
+		
+		GetUnmodifiedSystemSummary(s_seed, summary);
+		summary->government = OOUnsignedCharFromObject(SystemDataOverride(overrides, KEY_GOVERNMENT), summary->government);
+		summary->economy = OOUnsignedCharFromObject(SystemDataOverride(overrides, KEY_ECONOMY), summary->economy);
+		summary->techLevel = OOUIntegerFromObject(SystemDataOverride(overrides, KEY_TECHLEVEL), summary->techLevel);
+		summary->population = OOUnsignedIntFromObject(SystemDataOverride(overrides, KEY_POPULATION), summary->population);
+		summary->productivity = OOUnsignedIntFromObject(SystemDataOverride(overrides, KEY_PRODUCTIVITY), summary->productivity);
+		summary->radius = OOUnsignedIntFromObject(SystemDataOverride(overrides, KEY_RADIUS), summary->radius);
+		summary->sunGoneNova = OOBooleanFromObject(SystemDataOverride(overrides, @"sun_gone_nova"), NO);
+		
+		id name = SystemDataOverride(overrides, KEY_NAME);
+		id inhabitant = SystemDataOverride(overrides, KEY_INHABITANT);
+		id inhabitants = SystemDataOverride(overrides, KEY_INHABITANTS);
+		
+		[summary->name release];
+		[summary->inhabitant release];
+		[summary->inhabitants release];
+		summary->name = [([name isKindOfClass:[NSString class]] ? name : [self generateSystemName:s_seed]) copy];
+		summary->inhabitant = [([inhabitant isKindOfClass:[NSString class]] ? inhabitant : [self generateSystemInhabitants:s_seed plural:NO]) copy];
+		summary->inhabitants = [([inhabitants isKindOfClass:[NSString class]] ? inhabitants : [self generateSystemInhabitants:s_seed plural:YES]) copy];
+		
+		record->summaryValid = YES;
+	}
+	
+	return record->summary;
+}
+
+
 - (NSDictionary *) currentSystemData
 {
 	OOJS_PROFILE_ENTER
@@ -6840,6 +7416,8 @@ static NSDictionary	*sCachedSystemData = nil;
 	{
 		[localPlanetInfoOverrides removeObjectForKey:planetKey];
 	}
+	
+	[self resetSystemDataForPlanetKey:planetKey];
 }
 
 
@@ -7003,12 +7581,16 @@ static NSDictionary	*sCachedSystemData = nil;
 
 - (NSString *) getSystemName:(Random_Seed)s_seed
 {
+	OOSystemID sysID = [self systemIDForSystemSeed:s_seed];
+	if (sysID != -1)  return [[[self systemSummaryForSystem:sysID].name retain] autorelease];
 	return [[self generateSystemData:s_seed] oo_stringForKey:KEY_NAME];
 }
 
 
 - (OOGovernmentID) getSystemGovernment:(Random_Seed)s_seed
 {
+	OOSystemID sysID = [self systemIDForSystemSeed:s_seed];
+	if (sysID != -1)  return [self systemSummaryForSystem:sysID].government;
 	return [[self generateSystemData:s_seed] oo_unsignedCharForKey:KEY_GOVERNMENT];
 }
 
@@ -7021,6 +7603,13 @@ static NSDictionary	*sCachedSystemData = nil;
 
 - (NSString *) getSystemInhabitants:(Random_Seed) s_seed plural:(BOOL)plural
 {	
+	OOSystemID sysID = [self systemIDForSystemSeed:s_seed];
+	if (sysID != -1)
+	{
+		OOSystemSummary summary = [self systemSummaryForSystem:sysID];
+		return [[(plural ? summary.inhabitants : summary.inhabitant) retain] autorelease];
+	}
+	
 	NSString *ret = nil;
 	if (!plural)
 		ret = [[self generateSystemData:s_seed] oo_stringForKey:KEY_INHABITANT];
@@ -7380,6 +7969,42 @@ static NSDictionary	*sCachedSystemData = nil;
 
 
 - (NSDictionary *) routeFromSystem:(OOSystemID) start toSystem:(OOSystemID) goal optimizedBy:(OORouteType) optimizeBy
+{
+	// no interstellar space for start and/or goal please
+	if (start < 0 || goal < 0 || start > kOOMaximumSystemID || goal > kOOMaximumSystemID)  return nil;
+	
+	// Routes only depend on the galaxy, so they're remembered until it changes. Unreachable goals are cached as NSNull.
+	NSNumber *cacheKey = [NSNumber numberWithUnsignedInt:(start << 16) | (goal << 8) | (optimizeBy & 0xFF)];
+	id cachedRoute = [_routeCache objectForKey:cacheKey];
+	if (cachedRoute != nil)
+	{
+		return (cachedRoute != [NSNull null]) ? [[cachedRoute retain] autorelease] : nil;
+	}
+	if (_routeCache == nil)
+	{
+		_routeCache = [[OOCache alloc] init];
+		[_routeCache setPruneThreshold:kRouteCacheSize];
+		[_routeCache setName:@"Routes"];
+	}
+	
+	NSDictionary *result = [[self routeGraph] routeFromSystem:start toSystem:goal optimizedBy:optimizeBy];
+	[_routeCache setObject:(result != nil) ? (id)result : (id)[NSNull null] forKey:cacheKey];
+	return result;
+}
+
+
+- (OOGalaxyRouteGraph *) routeGraph
+{
+	if (_routeGraph == nil)
+	{
+		_routeGraph = [[OOGalaxyRouteGraph alloc] initWithSystemSeeds:systems];
+	}
+	return _routeGraph;
+}
+
+
+#ifndef NDEBUG
+- (NSDictionary *) legacyRouteFromSystem:(OOSystemID) start toSystem:(OOSystemID) goal optimizedBy:(OORouteType) optimizeBy
 {
 	/*
 	 time_cost = distance * distance
@@ -7394,25 +8019,12 @@ static NSDictionary	*sCachedSystemData = nil;
 	// no interstellar space for start and/or goal please
 	if (start == -1 || goal == -1)  return nil;
 	
-#ifdef CACHE_ROUTE_FROM_SYSTEM_RESULTS
-	
-	static NSDictionary *c_route = nil;
-	static OOSystemID c_start, c_goal;
-	static OORouteType c_optimizeBy;
-	
-	if (c_route != nil && c_start == start && c_goal == goal && c_optimizeBy == optimizeBy)
-	{
-		return c_route;
-	}
-	
-#endif
-	
 	unsigned i, j;
 	
 	if (start > 255 || goal > 255) return nil;
 	
 	NSArray *neighbours[256];
-	for (i = 0; i < 256; i++) neighbours[i] = [self neighboursToSystem:i];
+	for (i = 0; i < 256; i++) neighbours[i] = [self neighboursToRandomSeed:systems[i]];
 	
 	RouteElement *cheapest[256];
 	for (i = 0; i < 256; i++) cheapest[i] = nil;
@@ -7466,23 +8078,93 @@ static NSDictionary	*sCachedSystemData = nil;
 		e = cheapest[[e getParent]];
 	}
 	
-#ifdef CACHE_ROUTE_FROM_SYSTEM_RESULTS
-	c_start = start;
-	c_goal = goal;
-	c_optimizeBy = optimizeBy;
-	c_route = [NSDictionary dictionaryWithObjectsAndKeys: route, @"route", [NSNumber numberWithDouble:[cheapest[goal] getDistance]], @"distance", nil];
-	
-	return c_route;
-#else
 	return [NSDictionary dictionaryWithObjectsAndKeys:
-			route, @"route",
+			[NSArray arrayWithArray:route], @"route",
 			[NSNumber numberWithDouble:[cheapest[goal] getDistance]], @"distance",
 			[NSNumber numberWithDouble:[cheapest[goal] getTime]], @"time",
 			nil];
-#endif
 }
 
 
+- (NSDictionary *) routingBenchmarkWithOriginCount:(NSUInteger)originCount
+{
+	OOSystemID			start, goal;
+	OORouteType			optimizeBy;
+	NSUInteger			routeCount = 0, costMismatches = 0, pathMismatches = 0;
+	OOHighResTimeValue	startTime, endTime;
+	OOTimeDelta			legacyTime = 0, graphTime = 0;
+	
+	if (originCount > kOOGalaxySystemCount)  originCount = kOOGalaxySystemCount;
+	
+	// A new graph, so the time includes building it and every shortest path tree.
+	startTime = OOGetHighResTime();
+	OOGalaxyRouteGraph *graph = [[OOGalaxyRouteGraph alloc] initWithSystemSeeds:systems];
+	endTime = OOGetHighResTime();
+	OOTimeDelta buildTime = OOHighResTimeDeltaInSeconds(startTime, endTime);
+	graphTime += buildTime;
+	OODisposeHighResTime(startTime);
+	OODisposeHighResTime(endTime);
+	
+	for (optimizeBy = OPTIMIZED_BY_JUMPS; optimizeBy <= OPTIMIZED_BY_TIME; optimizeBy++)
+	{
+		for (start = 0; start < (OOSystemID)originCount; start++)
+		{
+			NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+			
+			for (goal = 0; goal < kOOGalaxySystemCount; goal++)
+			{
+				startTime = OOGetHighResTime();
+				NSDictionary *legacyRoute = [self legacyRouteFromSystem:start toSystem:goal optimizedBy:optimizeBy];
+				endTime = OOGetHighResTime();
+				legacyTime += OOHighResTimeDeltaInSeconds(startTime, endTime);
+				OODisposeHighResTime(startTime);
+				OODisposeHighResTime(endTime);
+				
+				startTime = OOGetHighResTime();
+				NSDictionary *graphRoute = [graph routeFromSystem:start toSystem:goal optimizedBy:optimizeBy];
+				endTime = OOGetHighResTime();
+				graphTime += OOHighResTimeDeltaInSeconds(startTime, endTime);
+				OODisposeHighResTime(startTime);
+				OODisposeHighResTime(endTime);
+				
+				routeCount++;
+				
+				// Equal-cost routes may legitimately be found in a different order, so paths are only compared when costs agree.
+				NSString *costKey = (optimizeBy == OPTIMIZED_BY_TIME) ? @"time" : @"distance";
+				if ((legacyRoute == nil) != (graphRoute == nil) ||
+					fabs([legacyRoute oo_doubleForKey:costKey] - [graphRoute oo_doubleForKey:costKey]) > 1e-6 ||
+					[[legacyRoute oo_arrayForKey:@"route"] count] != [[graphRoute oo_arrayForKey:@"route"] count])
+				{
+					costMismatches++;
+				}
+				else if (legacyRoute != nil && ![[legacyRoute objectForKey:@"route"] isEqual:[graphRoute objectForKey:@"route"]])
+				{
+					pathMismatches++;
+				}
+			}
+			
+			[pool release];
+		}
+	}
+	
+	OOLog(@"universe.routing.benchmark", @"Routing benchmark, %lu routes: old search %.3f s, route graph %.3f s (%.3f ms to build, %lu trees). %lu cost mismatches, %lu equal-cost path differences.",
+		  (unsigned long)routeCount, legacyTime, graphTime, buildTime * 1000.0, (unsigned long)[graph treeCount], (unsigned long)costMismatches, (unsigned long)pathMismatches);
+	
+	NSDictionary *result = [NSDictionary dictionaryWithObjectsAndKeys:
+							[NSNumber numberWithUnsignedInteger:routeCount], @"routeCount",
+							[NSNumber numberWithDouble:legacyTime], @"legacyTime",
+							[NSNumber numberWithDouble:graphTime], @"graphTime",
+							[NSNumber numberWithDouble:buildTime], @"graphBuildTime",
+							[NSNumber numberWithUnsignedInteger:[graph linkCount]], @"linkCount",
+							[NSNumber numberWithUnsignedInteger:costMismatches], @"costMismatches",
+							[NSNumber numberWithUnsignedInteger:pathMismatches], @"pathMismatches",
+							nil];
+	[graph release];
+	return result;
+}
+#endif
+
+
 - (NSArray *) neighboursToRandomSeed: (Random_Seed) seed
 {
 	if (equal_seeds(system_seed, seed) && closeSystems != nil) 
@@ -7518,7 +8200,7 @@ static NSDictionary	*sCachedSystemData = nil;
 
 - (NSArray *) neighboursToSystem: (OOSystemID) system_number
 {
-	return [self neighboursToRandomSeed: systems[system_number]];
+	return [[self routeGraph] neighboursToSystem:system_number];
 }
 
 
@@ -7558,6 +8240,8 @@ static NSDictionary	*sCachedSystemData = nil;
 			[value release];
 		}
 	}
+	
+	[self resetSystemDataCache];
 }
 
 
@@ -7612,6 +8296,25 @@ static NSDictionary	*sCachedSystemData = nil;
 }
 
 
+- (void) prefetchSystem:(Random_Seed)seed
+{
+	if (_systemPrefetcher != nil && equal_seeds([_systemPrefetcher systemSeed], seed))  return;
+	
+	[_systemPrefetcher release];
+	_systemPrefetcher = [[OOSystemPrefetcher alloc] initWithSystemSeed:seed];
+	OOLog(@"universe.prefetch.start", @"Prefetching %@.", _systemPrefetcher);
+}
+
+
+- (void) cancelSystemPrefetch
+{
+	if (_systemPrefetcher == nil)  return;
+	
+	OOLog(@"universe.prefetch.cancel", @"Cancelled prefetching %@.", _systemPrefetcher);
+	DESTROY(_systemPrefetcher);
+}
+
+
 - (NSDictionary *) planetInfo
 {
 	return planetInfo;
@@ -9477,6 +10180,7 @@ Entity *gOOJSPlayerIfStale = nil;
 	
 	[planetInfo autorelease];
 	planetInfo = [[ResourceManager dictionaryFromFilesNamed:@"planetinfo.plist" inFolder:@"Config" mergeMode:MERGE_SMART cache:YES] retain];
+	[self resetSystemDataCache];
 	
 	[screenBackgrounds autorelease];
 	screenBackgrounds = [[ResourceManager dictionaryFromFilesNamed:@"screenbackgrounds.plist" inFolder:@"Config" andMerge:YES] retain];
@@ -9658,6 +10362,7 @@ Entity *gOOJSPlayerIfStale = nil;
 	OO_DEBUG_PUSH_PROGRESS(@"localPlanetInfoOverrides reset");
 	// these lines are needed here to reset systeminfo and long range chart properly
 	[localPlanetInfoOverrides removeAllObjects];
+	[self resetSystemDataCache];
 	OO_DEBUG_POP_PROGRESS();
 	
 	OO_DEBUG_PUSH_PROGRESS(@"Galaxy reset");
@@ -9814,6 +10519,7 @@ Entity *gOOJSPlayerIfStale = nil;
 	
 	// maintain sorted lists
 	int index = entity->zero_index;
+	_scannerNeighbourhoodValid = NO;
 	
 	int n = 1;
 	if (index >= 0)
@@ -9942,8 +10648,53 @@ static void PreloadOneSound(NSString *soundName)
 
 - (void) resetSystemDataCache
 {
-	[sCachedSystemData release];
-	sCachedSystemData = nil;
+	OOSystemID i;
+	
+	if (_systemRecords == NULL)  return;
+	
+	for (i = 0; i <= kOOMaximumSystemID; i++)
+	{
+		OOSystemRecord *record = &_systemRecords[i];
+		DESTROY(record->dictionary);
+		DESTROY(record->summary.name);
+		DESTROY(record->summary.inhabitant);
+		DESTROY(record->summary.inhabitants);
+		record->summaryValid = NO;
+	}
+}
+
+
+- (OOSystemRecord *) systemRecordForSystem:(OOSystemID)sysID
+{
+	if (sysID < 0 || sysID > kOOMaximumSystemID)  return NULL;
+	
+	if (EXPECT_NOT(_systemRecords == NULL))
+	{
+		_systemRecords = calloc(kOOMaximumSystemID + 1, sizeof *_systemRecords);
+		if (_systemRecords == NULL)  return NULL;
+	}
+	
+	return &_systemRecords[sysID];
+}
+
+
+- (void) resetSystemDataForPlanetKey:(NSString *)planetKey
+{
+	// Planet keys are "<galaxy> <system>". Anything else, such as the universal key, may affect every system.
+	NSScanner *scanner = [NSScanner scannerWithString:planetKey];
+	int galaxyID, sysID;
+	if (![scanner scanInt:&galaxyID] || ![scanner scanInt:&sysID] || ![scanner isAtEnd])
+	{
+		[self resetSystemDataCache];
+		return;
+	}
+	
+	// Keys for other galaxies aren't filtered out; resetting a record unnecessarily is harmless.
+	if (_systemRecords == NULL || sysID < 0 || sysID > kOOMaximumSystemID)  return;
+	
+	OOSystemRecord *record = &_systemRecords[sysID];
+	DESTROY(record->dictionary);
+	record->summaryValid = NO;
 }
 
 
@@ -10682,6 +11433,41 @@ static void PreloadOneSound(NSString *soundName)
 #endif
 
 
+- (void) updateSystemPrefetch
+{
+	PlayerEntity *player = PLAYER;
+	
+	// Arriving consumes the prefetcher, so if it's still here when the countdown has stopped, the jump didn't happen.
+	if ([player status] != STATUS_WITCHSPACE_COUNTDOWN || !equal_seeds([player target_system_seed], [_systemPrefetcher systemSeed]))
+	{
+		[self cancelSystemPrefetch];
+		return;
+	}
+	
+	[_systemPrefetcher performStepsForInterval:SYSTEM_PREFETCH_INTERVAL];
+}
+
+
+- (void) finishSystemPrefetch
+{
+	if (_systemPrefetcher == nil)  return;
+	
+	if (equal_seeds([_systemPrefetcher systemSeed], system_seed))
+	{
+		NSDictionary *report = [_systemPrefetcher report];
+		OOLog(@"universe.prefetch.report", @"Arrived in %@ with %u of %u prefetch steps done in %.1f ms. Sky %@, main planet %@; %u of %u ship models have finished loading their textures.",
+			  [self getSystemName:system_seed],
+			  [report oo_unsignedIntForKey:@"stepsDone"], [report oo_unsignedIntForKey:@"stepCount"],
+			  [report oo_doubleForKey:@"prefetchTime"] * 1000.0,
+			  [report oo_boolForKey:@"skyClaimed"] ? @"used" : @"not used",
+			  [report oo_boolForKey:@"planetClaimed"] ? @"used" : @"not used",
+			  [report oo_unsignedIntForKey:@"meshesReady"], [report oo_unsignedIntForKey:@"meshCount"]);
+	}
+	
+	DESTROY(_systemPrefetcher);
+}
+
+
 #if NEW_PLANETS
 // See notes at preloadPlanetTexturesForSystem:.
 - (void) prunePreloadingPlanetMaterials
@@ -140,6 +140,9 @@ extern int debug;
 	
 	BOOL				showSplashScreen;
 	
+	BOOL				pipelineFrames;
+	BOOL				framePending;		// Drawn and flushed, but not yet swapped to the screen.
+	
 #if OOLITE_WINDOWS
 
 	BOOL				wasFullScreen;
@@ -184,6 +187,7 @@ extern int debug;
 - (void) updateScreen;
 - (void) updateScreenWithVideoMode:(BOOL) v_mode;
 - (void) display;
+- (void) presentPendingFrame;
 
 - (BOOL) snapShot:(NSString *)filename;
 #if SNAPSHOTS_PNG_FORMAT
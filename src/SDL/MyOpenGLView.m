@@ -148,6 +148,7 @@ MA 02110-1301, USA.
 	
 	NSUserDefaults *prefs = [NSUserDefaults standardUserDefaults];	
 	showSplashScreen = [prefs oo_boolForKey:@"splash-screen" defaultValue:YES];
+	pipelineFrames = [prefs oo_boolForKey:@"pipeline-frames" defaultValue:NO];	// Adds a frame of latency; off until shown to pay for it.
 	
 	NSArray				*arguments = nil;
 	NSEnumerator		*argEnum = nil;
@@ -552,6 +553,8 @@ MA 02110-1301, USA.
 	if (surface == 0)
 		return;
 
+	[self presentPendingFrame];
+
 	// do all the drawing!
 	//
 	if (UNIVERSE)  [UNIVERSE drawUniverse];
@@ -562,7 +565,34 @@ MA 02110-1301, USA.
 		glClear( GL_COLOR_BUFFER_BIT);
 	}
 
-	SDL_GL_SwapBuffers();
+	if (pipelineFrames && ![UNIVERSE displayGUI])
+	{
+		/*	Swapping now would wait for the GPU to finish the frame (and, with
+			vsync, for the next refresh) before the next game tick could
+			start. Instead, get the GPU started on it and swap at the start
+			of the next frame, so the next tick's simulation runs while the
+			GPU works.
+			GUI screens are swapped straight away, since the next tick may
+			block for a while loading a game or building a system and the
+			screen asked for must be showing meanwhile.
+		*/
+		glFlush();
+		framePending = YES;
+	}
+	else
+	{
+		SDL_GL_SwapBuffers();
+	}
+}
+
+
+- (void) presentPendingFrame
+{
+	if (framePending)
+	{
+		SDL_GL_SwapBuffers();
+		framePending = NO;
+	}
 }
 
 - (void) initSplashScreen
@@ -657,7 +687,7 @@ MA 02110-1301, USA.
 	}
 	
 	glGenTextures( 1, &texture );
-	glBindTexture( GL_TEXTURE_2D, texture );
+	OOGLBindTexture( GL_TEXTURE_2D, texture );
 	
 	// Set the texture's stretching properties
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
@@ -667,7 +697,7 @@ MA 02110-1301, USA.
 	glTexImage2D( GL_TEXTURE_2D, 0, nOfColors, image->w, image->h, 0,
                       texture_format, GL_UNSIGNED_BYTE, image->pixels );
 	
-	glBindTexture( GL_TEXTURE_2D, texture );
+	OOGLBindTexture( GL_TEXTURE_2D, texture );
 	glBegin( GL_QUADS );
 	
 	glTexCoord2i( 0, 0 );
@@ -687,7 +717,7 @@ MA 02110-1301, USA.
 	if ( image ) { 
 		SDL_FreeSurface( image );
 	}
-	glDeleteTextures(1, &texture);
+	OOGLDeleteTextures(1, &texture);
 
 	glDisable( GL_TEXTURE_2D );
 	OOVerifyOpenGLState();
@@ -706,6 +736,7 @@ MA 02110-1301, USA.
 	viewSize = v_size;
 	OOLog(@"display.initGL", @"Requested a new surface of %d x %d, %@.", (int)viewSize.width, (int)viewSize.height,(fullScreen ? @"fullscreen" : @"windowed"));
 	SDL_GL_SwapBuffers();	// clear the buffer before resize
+	framePending = NO;
 #if OOLITE_WINDOWS
 
 	if (!updateContext) return;
@@ -837,6 +868,8 @@ MA 02110-1301, USA.
 
 	[self autoShowMouse];
 	
+	// Changing video mode may have replaced the OpenGL context.
+	OOGLInvalidateStateCache();
 	[[self gameController] setUpBasicOpenGLStateWithSize:viewSize];
 	SDL_GL_SwapBuffers();
 	squareX = 0.0f;